@@ -0,0 +1,40 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <GLES2/gl2.h>
+#include "util_egl.h"
+#include "bench_util.h"
+
+
+int
+main (int argc, char *argv[])
+{
+    if (bench_init (argc, argv) < 0)
+        return -1;
+
+    /*
+     *  Mesa picks X11/Wayland by default, which is not available on a
+     *  headless machine. The surfaceless platform works everywhere.
+     */
+    setenv ("EGL_PLATFORM", "surfaceless", 0);
+
+    if (egl_init_with_pbuffer_surface (3, 24, 0, 0, 16, 16) < 0)
+    {
+        fprintf (stderr, "ERR: %s(%d): failed to initialize EGL\n", __FILE__, __LINE__);
+        return -1;
+    }
+
+    fprintf (stderr, "GL_VERSION  : %s\n", glGetString (GL_VERSION));
+    fprintf (stderr, "GL_RENDERER : %s\n", glGetString (GL_RENDERER));
+
+    bench_matrix ();
+    bench_render ();
+    bench_scene ();
+
+    egl_terminate ();
+
+    return 0;
+}
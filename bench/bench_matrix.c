@@ -0,0 +1,363 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdio.h>
+#include <string.h>
+#include "util_matrix.h"
+#include "bench_util.h"
+
+static float s_m0[16];
+static float s_m1[16];
+static float s_m2[16];
+static float s_vec[4];
+static float s_dst[4];
+static float s_qtn[4];
+
+/* 2 hands x 26 joints, as in gl2handtrackOXR */
+#define BATCH_NUM   52
+static float s_mbatch[16 * BATCH_NUM];
+static float s_mbatch_dst[16 * BATCH_NUM];
+static float s_pose[8 * BATCH_NUM];     /* XrPosef + radius */
+
+
+static void
+setup_matrix (void)
+{
+    /* a view x model matrix of a typical scene (rotation + translation + scale) */
+    matrix_identity (s_m1);
+    matrix_translate (s_m1, 0.1f, 1.6f, -0.3f);
+    matrix_rotate (s_m1, 30.0f, 0.2f, 1.0f, 0.1f);
+
+    matrix_identity (s_m2);
+    matrix_translate (s_m2, 0.0f, 0.0f, -3.0f);
+    matrix_rotate (s_m2, 45.0f, 0.0f, 1.0f, 0.0f);
+    matrix_scale (s_m2, 0.3f, 0.3f, 0.3f);
+
+    s_vec[0] = 1.0f; s_vec[1] = 2.0f; s_vec[2] = 3.0f; s_vec[3] = 1.0f;
+    quaternion_identity (s_qtn);
+
+    for (int i = 0; i < BATCH_NUM; i ++)
+    {
+        float *pose = &s_pose[8 * i];
+        matrix_copy (&s_mbatch[16 * i], s_m2);
+        pose[0] = 0.0f; pose[1] = 0.3826834f; pose[2] = 0.0f; pose[3] = 0.9238795f;
+        pose[4] = 0.01f * i; pose[5] = 1.0f; pose[6] = -0.5f;
+        pose[7] = 0.01f;
+    }
+}
+
+
+static void
+bm_matrix_mult (void *arg, int iters)
+{
+    for (int i = 0; i < iters; i ++)
+        matrix_mult (s_m0, s_m1, s_m2);
+}
+
+static void
+bm_matrix_invert_affine (void *arg, int iters)
+{
+    matrix_copy (s_m0, s_m2);
+    for (int i = 0; i < iters; i ++)
+        matrix_invert (s_m0);
+}
+
+static void
+bm_matrix_invert_general (void *arg, int iters)
+{
+    matrix_proj_perspective (s_m0, 90.0f, 1.0f, 0.05f, 100.0f);
+    for (int i = 0; i < iters; i ++)
+        matrix_invert (s_m0);
+}
+
+static void
+bm_matrix_invert_affine_direct (void *arg, int iters)
+{
+    matrix_copy (s_m0, s_m2);
+    for (int i = 0; i < iters; i ++)
+        matrix_invert_affine (s_m0);
+}
+
+static void
+bm_matrix_invert_rigid (void *arg, int iters)
+{
+    matrix_copy (s_m0, s_m1);
+    for (int i = 0; i < iters; i ++)
+        matrix_invert_rigid (s_m0);
+}
+
+/* the normal matrix as render_stage.cpp computed it before matrix_normal3x3 */
+static void
+bm_normal_invert_transpose (void *arg, int iters)
+{
+    float n[9];
+    for (int i = 0; i < iters; i ++)
+    {
+        matrix_copy (s_m0, s_m2);
+        matrix_invert (s_m0);
+        matrix_transpose (s_m0);
+        n[0] = s_m0[0]; n[1] = s_m0[1]; n[2] = s_m0[ 2];
+        n[3] = s_m0[4]; n[4] = s_m0[5]; n[5] = s_m0[ 6];
+        n[6] = s_m0[8]; n[7] = s_m0[9]; n[8] = s_m0[10];
+        s_dst[0] = n[i % 9];
+    }
+}
+
+static void
+bm_matrix_normal3x3 (void *arg, int iters)
+{
+    float n[9];
+    for (int i = 0; i < iters; i ++)
+    {
+        matrix_normal3x3 (n, s_m2);
+        s_dst[0] = n[i % 9];
+    }
+}
+
+/* (iters) counts the matrices, not the batches */
+static void
+bm_matrix_mult_loop (void *arg, int iters)
+{
+    for (int i = 0; i < iters; i += BATCH_NUM)
+    {
+        for (int j = 0; j < BATCH_NUM; j ++)
+            matrix_mult (&s_mbatch_dst[16 * j], s_m1, &s_mbatch[16 * j]);
+    }
+}
+
+static void
+bm_matrix_mult_batch (void *arg, int iters)
+{
+    for (int i = 0; i < iters; i += BATCH_NUM)
+        matrix_mult_batch (s_mbatch_dst, s_m1, s_mbatch, BATCH_NUM);
+}
+
+static void
+bm_matrix_multvec4_batch (void *arg, int iters)
+{
+    for (int i = 0; i < iters; i += BATCH_NUM)
+        matrix_multvec4_batch (s_m1, s_mbatch, s_mbatch_dst, BATCH_NUM);
+}
+
+static void
+bm_matrix_trs_batch (void *arg, int iters)
+{
+    for (int i = 0; i < iters; i += BATCH_NUM)
+        matrix_trs_batch (s_mbatch_dst, s_pose, 8 * sizeof (float), &s_pose[7], 8 * sizeof (float), BATCH_NUM);
+}
+
+static void
+bm_matrix_transpose (void *arg, int iters)
+{
+    matrix_copy (s_m0, s_m2);
+    for (int i = 0; i < iters; i ++)
+        matrix_transpose (s_m0);
+}
+
+static void
+bm_matrix_copy (void *arg, int iters)
+{
+    for (int i = 0; i < iters; i ++)
+        matrix_copy (s_m0, s_m1);
+}
+
+static void
+bm_matrix_identity (void *arg, int iters)
+{
+    for (int i = 0; i < iters; i ++)
+        matrix_identity (s_m0);
+}
+
+static void
+bm_matrix_translate (void *arg, int iters)
+{
+    matrix_identity (s_m0);
+    for (int i = 0; i < iters; i ++)
+        matrix_translate (s_m0, 0.0f, 0.0f, 1e-6f);
+}
+
+static void
+bm_matrix_rotate (void *arg, int iters)
+{
+    matrix_identity (s_m0);
+    for (int i = 0; i < iters; i ++)
+        matrix_rotate (s_m0, 1.0f, 0.0f, 1.0f, 0.0f);
+}
+
+static void
+bm_matrix_scale (void *arg, int iters)
+{
+    matrix_identity (s_m0);
+    for (int i = 0; i < iters; i ++)
+        matrix_scale (s_m0, 1.0f, 1.0f, 1.0f);
+}
+
+static void
+bm_matrix_multvec3 (void *arg, int iters)
+{
+    for (int i = 0; i < iters; i ++)
+        matrix_multvec3 (s_m1, s_vec, s_dst);
+}
+
+static void
+bm_matrix_multvec4 (void *arg, int iters)
+{
+    for (int i = 0; i < iters; i ++)
+        matrix_multvec4 (s_m1, s_vec, s_dst);
+}
+
+static void
+bm_matrix_proj_perspective (void *arg, int iters)
+{
+    for (int i = 0; i < iters; i ++)
+        matrix_proj_perspective (s_m0, 90.0f, 1.0f, 0.05f, 100.0f);
+}
+
+static void
+bm_matrix_proj_ortho (void *arg, int iters)
+{
+    for (int i = 0; i < iters; i ++)
+        matrix_proj_ortho (s_m0, 0.0f, 1920.0f, 1080.0f, 0.0f, -1.0f, 1.0f);
+}
+
+static void
+bm_matrix_modellookat (void *arg, int iters)
+{
+    float src[3] = {0.0f, 1.6f, 0.0f};
+    float tgt[3] = {0.0f, 0.0f,-3.0f};
+    for (int i = 0; i < iters; i ++)
+        matrix_modellookat (s_m0, src, tgt, 0.0f);
+}
+
+static void
+bm_vec3_normalize (void *arg, int iters)
+{
+    float v[3];
+    for (int i = 0; i < iters; i ++)
+    {
+        v[0] = 1.0f; v[1] = 2.0f; v[2] = 3.0f;
+        vec3_normalize (v);
+    }
+}
+
+static void
+bm_vec3_cross (void *arg, int iters)
+{
+    float v0[3] = {1.0f, 0.0f, 0.0f};
+    float v1[3] = {0.0f, 1.0f, 0.0f};
+    for (int i = 0; i < iters; i ++)
+        vec3_cross (s_dst, v0, v1);
+}
+
+static void
+bm_vec3_get_triangle_normal (void *arg, int iters)
+{
+    float p0[3] = {0.0f, 0.0f, 0.0f};
+    float p1[3] = {1.0f, 0.0f, 0.0f};
+    float p2[3] = {0.0f, 1.0f, 0.0f};
+    for (int i = 0; i < iters; i ++)
+        vec3_get_triangle_normal (s_dst, p0, p1, p2);
+}
+
+/* laser pointer vs. UI plane, as in gl2hittestOXR */
+static void
+bm_ray_intersect (void *arg, int iters)
+{
+    float r0[3] = { 0.1f, 1.2f,  0.0f};
+    float r1[3] = { 0.0f, 1.0f, -5.0f};
+    float t0[3] = {-1.0f, 0.0f, -2.0f};
+    float t1[3] = { 1.0f, 0.0f, -2.0f};
+    float t2[3] = { 0.0f, 2.0f, -2.0f};
+    for (int i = 0; i < iters; i ++)
+        ray_intersect (r0, r1, t0, t1, t2, s_dst);
+}
+
+static void
+bm_quaternion_mult (void *arg, int iters)
+{
+    float q0[4] = {0.9238795f, 0.0f, 0.3826834f, 0.0f};
+    for (int i = 0; i < iters; i ++)
+        quaternion_mult (s_qtn, s_qtn, q0);
+}
+
+static void
+bm_quaternion_to_matrix (void *arg, int iters)
+{
+    float q0[4] = {0.9238795f, 0.0f, 0.3826834f, 0.0f};
+    for (int i = 0; i < iters; i ++)
+        quaternion_to_matrix (s_m0, q0);
+}
+
+
+/* the kernels of each SIMD implementation, e.g. "matrix_mult[sse]" */
+static void
+bench_matrix_simd (int n)
+{
+    int simd_list[] = {MATRIX_SIMD_NONE, MATRIX_SIMD_SSE, MATRIX_SIMD_AVX, MATRIX_SIMD_NEON};
+    int default_simd = matrix_simd_get ();
+    char name[64];
+
+    for (unsigned int i = 0; i < sizeof (simd_list) / sizeof (simd_list[0]); i ++)
+    {
+        const char *simd = matrix_simd_name (simd_list[i]);
+
+        if (matrix_simd_select (simd_list[i]) < 0)
+            continue;
+
+        snprintf (name, sizeof (name), "matrix_mult[%s]", simd);
+        bench_run_micro (name, bm_matrix_mult,           NULL, n);
+        snprintf (name, sizeof (name), "matrix_invert(affine)[%s]", simd);
+        bench_run_micro (name, bm_matrix_invert_affine,  NULL, n);
+        snprintf (name, sizeof (name), "matrix_invert(general)[%s]", simd);
+        bench_run_micro (name, bm_matrix_invert_general, NULL, n);
+        snprintf (name, sizeof (name), "matrix_transpose[%s]", simd);
+        bench_run_micro (name, bm_matrix_transpose,      NULL, n);
+        snprintf (name, sizeof (name), "matrix_multvec3[%s]", simd);
+        bench_run_micro (name, bm_matrix_multvec3,       NULL, n);
+        snprintf (name, sizeof (name), "matrix_multvec4[%s]", simd);
+        bench_run_micro (name, bm_matrix_multvec4,       NULL, n);
+    }
+
+    matrix_simd_select (default_simd);
+}
+
+
+void
+bench_matrix (void)
+{
+    int n = bench_get_opt()->iters;
+
+    setup_matrix ();
+
+    bench_run_micro ("matrix_mult",                 bm_matrix_mult,              NULL, n);
+    bench_run_micro ("matrix_invert(affine)",       bm_matrix_invert_affine,     NULL, n);
+    bench_run_micro ("matrix_invert(general)",      bm_matrix_invert_general,    NULL, n);
+    bench_run_micro ("matrix_invert_affine",        bm_matrix_invert_affine_direct, NULL, n);
+    bench_run_micro ("matrix_invert_rigid",         bm_matrix_invert_rigid,      NULL, n);
+    bench_run_micro ("normal(invert+transpose)",    bm_normal_invert_transpose,  NULL, n);
+    bench_run_micro ("matrix_normal3x3",            bm_matrix_normal3x3,         NULL, n);
+    bench_run_micro ("matrix_mult(loop)",           bm_matrix_mult_loop,         NULL, n);
+    bench_run_micro ("matrix_mult_batch",           bm_matrix_mult_batch,        NULL, n);
+    bench_run_micro ("matrix_multvec4_batch",       bm_matrix_multvec4_batch,    NULL, n);
+    bench_run_micro ("matrix_trs_batch",            bm_matrix_trs_batch,         NULL, n);
+    bench_run_micro ("matrix_transpose",            bm_matrix_transpose,         NULL, n);
+    bench_run_micro ("matrix_copy",                 bm_matrix_copy,              NULL, n);
+    bench_run_micro ("matrix_identity",             bm_matrix_identity,          NULL, n);
+    bench_run_micro ("matrix_translate",            bm_matrix_translate,         NULL, n);
+    bench_run_micro ("matrix_rotate",               bm_matrix_rotate,            NULL, n);
+    bench_run_micro ("matrix_scale",                bm_matrix_scale,             NULL, n);
+    bench_run_micro ("matrix_multvec3",             bm_matrix_multvec3,          NULL, n);
+    bench_run_micro ("matrix_multvec4",             bm_matrix_multvec4,          NULL, n);
+    bench_run_micro ("matrix_proj_perspective",     bm_matrix_proj_perspective,  NULL, n);
+    bench_run_micro ("matrix_proj_ortho",           bm_matrix_proj_ortho,        NULL, n);
+    bench_run_micro ("matrix_modellookat",          bm_matrix_modellookat,       NULL, n);
+    bench_run_micro ("vec3_normalize",              bm_vec3_normalize,           NULL, n);
+    bench_run_micro ("vec3_cross",                  bm_vec3_cross,               NULL, n);
+    bench_run_micro ("vec3_get_triangle_normal",    bm_vec3_get_triangle_normal, NULL, n);
+    bench_run_micro ("ray_intersect",               bm_ray_intersect,            NULL, n);
+    bench_run_micro ("quaternion_mult",             bm_quaternion_mult,          NULL, n);
+    bench_run_micro ("quaternion_to_matrix",        bm_quaternion_to_matrix,     NULL, n);
+
+    bench_matrix_simd (n);
+}
@@ -0,0 +1,267 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <GLES2/gl2.h>
+#include "assertgl.h"
+#include "util_gl_state.h"
+#include "util_shader.h"
+#include "util_render2d.h"
+#include "util_debugstr.h"
+#include "util_render_target.h"
+#include "util_texture.h"
+#include "bench_util.h"
+
+#define TEX_W 256
+#define TEX_H 256
+
+static render_target_t s_rtarget;
+static int             s_texid;
+static int             s_win_w;
+static int             s_win_h;
+
+static char s_strVS[] = "                                   \n\
+attribute vec4  a_Vertex;                                   \n\
+uniform   mat4  u_PMVMatrix;                                \n\
+void main(void)                                             \n\
+{                                                           \n\
+    gl_Position = u_PMVMatrix * a_Vertex;                   \n\
+}                                                           ";
+
+static char s_strFS[] = "                                   \n\
+precision mediump float;                                    \n\
+void main(void)                                             \n\
+{                                                           \n\
+    gl_FragColor = vec4(1.0);                               \n\
+}                                                           ";
+
+
+static int
+create_checker_texture (void)
+{
+    unsigned char *img = (unsigned char *)malloc (TEX_W * TEX_H * 4);
+    int x, y, texid;
+
+    for (y = 0; y < TEX_H; y ++)
+    {
+        for (x = 0; x < TEX_W; x ++)
+        {
+            unsigned char c = ((x / 16 + y / 16) & 1) ? 0xFF : 0x40;
+            unsigned char *p = &img[(y * TEX_W + x) * 4];
+            p[0] = c; p[1] = c; p[2] = c; p[3] = 0xFF;
+        }
+    }
+
+#if defined (HAVE_UTIL_TEXTURE)
+    texid = create_2d_texture (img, TEX_W, TEX_H);
+#else
+    {
+        GLuint tex;
+        glGenTextures (1, &tex);
+        glstate_bind_texture (GL_TEXTURE_2D, tex);
+        glTexImage2D (GL_TEXTURE_2D, 0, GL_RGBA, TEX_W, TEX_H, 0, GL_RGBA, GL_UNSIGNED_BYTE, img);
+        glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glstate_bind_texture (GL_TEXTURE_2D, 0);
+        texid = tex;
+    }
+#endif
+
+    free (img);
+    return texid;
+}
+
+
+
+/* ---------------------------------------------------------------- *
+ *  util_render2d
+ * ---------------------------------------------------------------- */
+static void
+bm_draw_2d_fillrect (void *arg, int iters)
+{
+    float col[] = {0.0f, 1.0f, 1.0f, 0.5f};
+    for (int i = 0; i < iters; i ++)
+        draw_2d_fillrect (i % s_win_w, 10, 100, 100, col);
+}
+
+static void
+bm_draw_2d_rect (void *arg, int iters)
+{
+    float col[] = {1.0f, 0.0f, 0.0f, 1.0f};
+    for (int i = 0; i < iters; i ++)
+        draw_2d_rect (i % s_win_w, 10, 100, 100, col, 2.0f);
+}
+
+static void
+bm_draw_2d_line (void *arg, int iters)
+{
+    float col[] = {0.73f, 0.75f, 0.75f, 1.0f};
+    for (int i = 0; i < iters; i ++)
+        draw_2d_line (0, i % s_win_h, s_win_w, i % s_win_h, col, 1.0f);
+}
+
+static void
+bm_draw_2d_line_wide (void *arg, int iters)
+{
+    float col[] = {0.73f, 0.75f, 0.75f, 1.0f};
+    for (int i = 0; i < iters; i ++)
+        draw_2d_line (0, i % s_win_h, s_win_w, s_win_h - i % s_win_h, col, 3.0f);
+}
+
+static void
+bm_draw_2d_circle (void *arg, int iters)
+{
+    float col[] = {0.0f, 0.0f, 1.0f, 1.0f};
+    for (int i = 0; i < iters; i ++)
+        draw_2d_circle (s_win_w / 2, s_win_h / 2, i % s_win_w, 50, col, 1.0f);
+}
+
+static void
+bm_draw_2d_fillcircle (void *arg, int iters)
+{
+    float col[] = {0.0f, 0.0f, 1.0f, 1.0f};
+    for (int i = 0; i < iters; i ++)
+        draw_2d_fillcircle (i % s_win_w, s_win_h / 2, 20, col);
+}
+
+/* the same calls recorded between begin_2d_batch() and end_2d_batch() */
+static void
+bm_draw_2d_batch (void *arg, int iters)
+{
+    void (*bm_func)(void *, int) = (void (*)(void *, int))arg;
+
+    begin_2d_batch ();
+    bm_func (NULL, iters);
+    end_2d_batch ();
+}
+
+static void
+bm_draw_2d_texture (void *arg, int iters)
+{
+    for (int i = 0; i < iters; i ++)
+        draw_2d_texture (s_texid, i % s_win_w, 10, TEX_W, TEX_H, 0);
+}
+
+static void
+bm_draw_2d_texture_modulate (void *arg, int iters)
+{
+    float col[] = {1.0f, 0.5f, 0.5f, 0.5f};
+    unsigned int blend[] = {GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA};
+    for (int i = 0; i < iters; i ++)
+        draw_2d_texture_modulate (s_texid, i % s_win_w, 10, TEX_W, TEX_H, 0, col, blend);
+}
+
+static void
+bm_draw_2d_colormap (void *arg, int iters)
+{
+    for (int i = 0; i < iters; i ++)
+        draw_2d_colormap (s_texid, i % s_win_w, 10, TEX_W, TEX_H, 1.0f, 0);
+}
+
+
+/* ---------------------------------------------------------------- *
+ *  util_debugstr
+ * ---------------------------------------------------------------- */
+static void
+bm_draw_dbgstr (void *arg, int iters)
+{
+    const char *str = (const char *)arg;
+    for (int i = 0; i < iters; i ++)
+        draw_dbgstr (str, 100, i % s_win_h);
+}
+
+
+/* ---------------------------------------------------------------- *
+ *  util_shader, util_render_target
+ * ---------------------------------------------------------------- */
+static void
+bm_generate_shader (void *arg, int iters)
+{
+    for (int i = 0; i < iters; i ++)
+    {
+        shader_obj_t sobj;
+        generate_shader (&sobj, s_strVS, s_strFS);
+        glDeleteProgram (sobj.program);
+    }
+}
+
+static void
+bm_create_render_target (void *arg, int iters)
+{
+    for (int i = 0; i < iters; i ++)
+    {
+        render_target_t rtarget;
+        create_render_target (&rtarget, 300, 740, RTARGET_COLOR | RTARGET_DEPTH);
+        destroy_render_target (&rtarget);
+    }
+}
+
+static void
+bm_set_render_target (void *arg, int iters)
+{
+    for (int i = 0; i < iters; i ++)
+        set_render_target (&s_rtarget);
+}
+
+static void
+bm_get_render_target (void *arg, int iters)
+{
+    render_target_t rtarget;
+    for (int i = 0; i < iters; i ++)
+        get_render_target (&rtarget);
+}
+
+
+void
+bench_render (void)
+{
+    bench_opt_t *opt = bench_get_opt();
+    int n_draw = opt->iters / 1000;
+    int n_obj  = opt->iters / 10000;
+
+    if (n_draw < 10) n_draw = 10;
+    if (n_obj  <  1) n_obj  = 1;
+
+    s_win_w = opt->view_w;
+    s_win_h = opt->view_h;
+
+    create_render_target (&s_rtarget, s_win_w, s_win_h, RTARGET_COLOR | RTARGET_DEPTH);
+    set_render_target (&s_rtarget);
+    glClearColor (0.1f, 0.1f, 0.1f, 1.0f);
+    glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    s_texid = create_checker_texture ();
+    init_2d_renderer (s_win_w, s_win_h);
+    init_dbgstr (s_win_w, s_win_h);
+    GLASSERT();
+
+    bench_run_micro ("draw_2d_fillrect",            bm_draw_2d_fillrect,         NULL, n_draw);
+    bench_run_micro ("draw_2d_rect",                bm_draw_2d_rect,             NULL, n_draw);
+    bench_run_micro ("draw_2d_line",                bm_draw_2d_line,             NULL, n_draw);
+    bench_run_micro ("draw_2d_line(width=3)",       bm_draw_2d_line_wide,        NULL, n_draw);
+    bench_run_micro ("draw_2d_circle(ndiv=50)",     bm_draw_2d_circle,           NULL, n_draw);
+    bench_run_micro ("draw_2d_fillcircle",          bm_draw_2d_fillcircle,       NULL, n_draw);
+    bench_run_micro ("draw_2d_texture",             bm_draw_2d_texture,          NULL, n_draw);
+    bench_run_micro ("draw_2d_texture_modulate",    bm_draw_2d_texture_modulate, NULL, n_draw);
+    bench_run_micro ("draw_2d_colormap",            bm_draw_2d_colormap,         NULL, n_draw);
+
+    bench_run_micro ("draw_2d_line[batch]",         bm_draw_2d_batch, (void *)bm_draw_2d_line,       n_draw);
+    bench_run_micro ("draw_2d_circle[batch]",       bm_draw_2d_batch, (void *)bm_draw_2d_circle,     n_draw);
+    bench_run_micro ("draw_2d_fillcircle[batch]",   bm_draw_2d_batch, (void *)bm_draw_2d_fillcircle, n_draw);
+    bench_run_micro ("draw_2d_texture[batch]",      bm_draw_2d_batch, (void *)bm_draw_2d_texture,    n_draw);
+
+    bench_run_micro ("draw_dbgstr(8 chars)",        bm_draw_dbgstr, (void *)"VIEWPOS:",                              n_draw);
+    bench_run_micro ("draw_dbgstr(36 chars)",       bm_draw_dbgstr, (void *)"VIEWPOS(0.0000, 1.6000, -0.3000)   ", n_draw);
+
+    bench_run_micro ("generate_shader",             bm_generate_shader,          NULL, n_obj);
+    bench_run_micro ("create+destroy_render_target",bm_create_render_target,     NULL, n_obj);
+    bench_run_micro ("set_render_target",           bm_set_render_target,        NULL, n_draw);
+    bench_run_micro ("get_render_target",           bm_get_render_target,        NULL, n_draw);
+
+    glstate_delete_textures (1, (GLuint *)&s_texid);
+    destroy_render_target (&s_rtarget);
+    GLASSERT();
+}
@@ -0,0 +1,498 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <GLES3/gl31.h>
+#include "assertgl.h"
+#include "util_gl_state.h"
+#include "util_shader.h"
+#include "util_matrix.h"
+#include "util_render2d.h"
+#include "util_render_line.h"
+#include "util_debugstr.h"
+#include "util_render_target.h"
+#include "teapot.h"
+#include "render_stage.h"
+#include "shapes.h"
+#include "bench_util.h"
+
+/*
+ *  Scene benchmarks replay the per-eye work of the sample apps:
+ *    stage     : draw_stage() of gl2*OXR/render_scene.cpp (43 lines in a line batch)
+ *    debugline : hand trajectories and bounding boxes in the same line batch
+ *    teapot    : draw_teapot() of gl2teapotOXR
+ *    handjoint : draw_axis() for 2 grips + draw_axes() for 2 x 26 hand joints (gl2handtrackOXR)
+ *    grid      : draw_grid() of gl2gridOXR
+ *    dbgstr    : the VIEWPOS/VIEWROT/VIEWFOV lines printed by every app
+ *    shape_create : a 256x256 torus, generated every time (cold) and from
+ *                the shape cache (cached)
+ *
+ *  A frame renders both eyes into their own render target, as the apps do
+ *  with their per-eye swapchains.
+ *  The *_mv variants render both eyes in one pass into a 2-layer
+ *  GL_OVR_multiview2 render target, as gl2teapotOXR does when the
+ *  extension is available. They are skipped when it is not.
+ */
+
+#define VIEW_NUM    2
+#define JOINT_NUM   26
+
+static render_target_t  s_rtarget[VIEW_NUM];
+static render_target_t  s_rtarget_mv;
+static float            s_matStage[16];
+static float            s_matP[VIEW_NUM][16];
+static float            s_matV[VIEW_NUM][16];
+static float            s_jointPose[2 + 2 * JOINT_NUM][8];    /* XrPosef + radius */
+static float            s_matJoint[2 + 2 * JOINT_NUM][16];
+
+
+/* ---------------------------------------------------------------- *
+ *  Replay of render_scene.cpp: draw_stage()
+ * ---------------------------------------------------------------- */
+static int
+draw_stage_replay (float *matStage)
+{
+    float col_r[4] = {1.0f, 0.0f, 0.0f, 1.0f};
+    float col_g[4] = {0.0f, 1.0f, 0.0f, 1.0f};
+    float col_b[4] = {0.0f, 0.0f, 1.0f, 1.0f};
+    float col_gray[] = {0.5f, 0.5f, 0.5f, 1.0f};
+    float p0[3]  = {0.0f, 0.0f, 0.0f};
+    float py[3]  = {0.0f, 1.0f, 0.0f};
+
+    for (int x = -10; x <= 10; x ++)
+    {
+        float *col = (x == 0) ? col_b : col_gray;
+        float p0[3]  = {1.0f * x, 0.0f, -10.0f};
+        float p1[3]  = {1.0f * x, 0.0f,  10.0f};
+        line_batch_add (matStage, p0, p1, col);
+    }
+    for (int z = -10; z <= 10; z ++)
+    {
+        float *col = (z == 0) ? col_r : col_gray;
+        float p0[3]  = {-10.0f, 0.0f, 1.0f * z};
+        float p1[3]  = { 10.0f, 0.0f, 1.0f * z};
+        line_batch_add (matStage, p0, p1, col);
+    }
+
+    line_batch_add (matStage, p0, py, col_g);
+    GLASSERT();
+
+    return 0;
+}
+
+
+/* ---------------------------------------------------------------- *
+ *  Debug geometry: trajectories of both hands and joint bounding boxes
+ * ---------------------------------------------------------------- */
+#define TRAJECTORY_NUM  256
+
+static void
+draw_debugline_replay (int frame)
+{
+    float col_traj[4] = {0.0f, 1.0f, 1.0f, 1.0f};
+    float col_bbox[4] = {1.0f, 1.0f, 0.0f, 1.0f};
+    float pts[TRAJECTORY_NUM][3];
+
+    for (int hand = 0; hand < 2; hand ++)
+    {
+        for (int i = 0; i < TRAJECTORY_NUM; i ++)
+        {
+            float t = (frame + i) * 0.02f;
+            pts[i][0] = (hand ? 0.2f : -0.2f) + 0.1f * cosf (t);
+            pts[i][1] = 1.2f + 0.1f * sinf (t);
+            pts[i][2] = -0.4f - 0.001f * i;
+        }
+        line_batch_add_strip (NULL, &pts[0][0], TRAJECTORY_NUM, col_traj);
+    }
+
+    for (int i = 2; i < 2 + 2 * JOINT_NUM; i ++)
+    {
+        float vmin[3] = {-1.0f, -1.0f, -1.0f};
+        float vmax[3] = { 1.0f,  1.0f,  1.0f};
+        line_batch_add_box (s_matJoint[i], vmin, vmax, col_bbox);
+    }
+}
+
+
+/* ---------------------------------------------------------------- *
+ *  Replay of gl2gridOXR render_scene.cpp: draw_grid()
+ * ---------------------------------------------------------------- */
+static void
+draw_grid_replay (int win_w, int win_h)
+{
+    float col_gray[]   = {0.73f, 0.75f, 0.75f, 1.0f};
+    float col_blue[]   = {0.00f, 0.00f, 1.00f, 1.0f};
+    float col_red []   = {1.00f, 0.00f, 0.00f, 1.0f};
+    float *col;
+    int cx = win_w / 2;
+    int cy = win_h / 2;
+
+    set_2d_projection_matrix (win_w, win_h);
+
+    begin_2d_batch ();
+
+    col = col_gray;
+    for (int y = 0; y < cy; y += 10)
+    {
+        draw_2d_line (0, cy + y, win_w, cy + y, col, 1.0f);
+        draw_2d_line (0, cy - y, win_w, cy - y, col, 1.0f);
+    }
+
+    for (int x = 0; x < cx; x += 10)
+    {
+        draw_2d_line (cx + x, 0, cx + x, win_h, col, 1.0f);
+        draw_2d_line (cx - x, 0, cx - x, win_h, col, 1.0f);
+    }
+
+    col = col_blue;
+    for (int y = 0; y < cy; y += 100)
+    {
+        draw_2d_line (0, cy + y, win_w, cy + y, col, 1.0f);
+        draw_2d_line (0, cy - y, win_w, cy - y, col, 1.0f);
+    }
+
+    for (int x = 0; x < cx; x += 100)
+    {
+        draw_2d_line (cx + x, 0, cx + x, win_h, col, 1.0f);
+        draw_2d_line (cx - x, 0, cx - x, win_h, col, 1.0f);
+    }
+
+    col = col_red;
+    for (int y = 0; y < cy; y += 500)
+    {
+        draw_2d_line (0, cy + y, win_w, cy + y, col, 1.0f);
+        draw_2d_line (0, cy - y, win_w, cy - y, col, 1.0f);
+    }
+
+    for (int x = 0; x < cx; x += 500)
+    {
+        draw_2d_line (cx + x, 0, cx + x, win_h, col, 1.0f);
+        draw_2d_line (cx - x, 0, cx - x, win_h, col, 1.0f);
+    }
+
+    /* circle */
+    int radius = std::max (win_w, win_h);
+    for (int r = 0; r < radius; r += 100)
+        draw_2d_circle (cx, cy, r, 50, col_blue, 1.0f);
+
+    for (int r = 0; r < radius; r += 500)
+        draw_2d_circle (cx, cy, r, 50, col_red, 1.0f);
+
+    end_2d_batch ();
+
+
+    /* strings */
+    update_dbgstr_winsize (win_w, win_h);
+    for (int x = 0; x < cx; x += 100)
+    {
+        char strbuf[128];
+        sprintf(strbuf, "%d", x);
+        draw_dbgstr(strbuf, cx + x, cy);
+
+        sprintf(strbuf, "%d", -x);
+        draw_dbgstr(strbuf, cx - x, cy);
+    }
+
+    for (int y = 0; y < cy; y += 100)
+    {
+        char strbuf[128];
+        sprintf(strbuf, "%d", y);
+        draw_dbgstr(strbuf, cx, cy + y);
+
+        sprintf(strbuf, "%d", -y);
+        draw_dbgstr(strbuf, cx, cy - y);
+    }
+}
+
+
+static void
+draw_dbgstr_replay (int frame, int win_w, int win_h)
+{
+    float t = frame * 0.001f;
+    int x = 100;
+    int y = 100;
+    char strbuf[128];
+
+    update_dbgstr_winsize (win_w, win_h);
+
+    sprintf (strbuf, "VIEWPOS(%6.4f, %6.4f, %6.4f)", 0.03f + t, 1.6f, -0.1f);
+    draw_dbgstr(strbuf, x, y); y += 22;
+
+    sprintf (strbuf, "VIEWROT(%6.4f, %6.4f, %6.4f, %6.4f)", 0.0f, t, 0.0f, 1.0f);
+    draw_dbgstr(strbuf, x, y); y += 22;
+
+    sprintf (strbuf, "VIEWFOV(%6.4f, %6.4f, %6.4f, %6.4f)", -0.9f, 0.8f, 0.85f, -0.9f);
+    draw_dbgstr(strbuf, x, y); y += 22;
+}
+
+
+
+/* ---------------------------------------------------------------- *
+ *  Frame
+ * ---------------------------------------------------------------- */
+#define SCENE_STAGE     (1 << 0)
+#define SCENE_TEAPOT    (1 << 1)
+#define SCENE_HANDJOINT (1 << 2)
+#define SCENE_GRID      (1 << 3)
+#define SCENE_DBGSTR    (1 << 4)
+#define SCENE_DEBUGLINE (1 << 5)
+
+static void
+setup_view_matrix (void)
+{
+    for (int i = 0; i < VIEW_NUM; i ++)
+    {
+        float ipd = 0.064f;
+        float aspect = (float)s_rtarget[i].width / (float)s_rtarget[i].height;
+
+        matrix_proj_perspective (s_matP[i], 90.0f, aspect, 0.05f, 100.0f);
+
+        /* View matrix = inverse of the eye pose (standing at 1.6m) */
+        matrix_identity (s_matV[i]);
+        matrix_translate (s_matV[i], (i == 0) ? ipd * 0.5f : -ipd * 0.5f, -1.6f, 0.0f);
+    }
+
+    /* 2 grips and 2 x 26 joints in front of the viewer */
+    for (int i = 0; i < 2 + 2 * JOINT_NUM; i ++)
+    {
+        float *pose = s_jointPose[i];
+        float rad = (i < 2) ? 0.2f : 0.01f;
+        float hand_x = ((i & 1) ? 0.2f : -0.2f);
+        float axis[3] = {0.3f, 1.0f, 0.2f};
+        float half = DEG_TO_RAD (10.0f * i) * 0.5f;
+
+        vec3_normalize (axis);
+        pose[0] = axis[0] * sinf (half);    /* orientation (x, y, z, w) */
+        pose[1] = axis[1] * sinf (half);
+        pose[2] = axis[2] * sinf (half);
+        pose[3] = cosf (half);
+        pose[4] = hand_x + 0.01f * (i / 2 % 5);
+        pose[5] = 1.2f + 0.02f * (i / 10);
+        pose[6] = -0.4f;
+        pose[7] = rad;
+    }
+
+    matrix_trs_batch (s_matJoint[0], &s_jointPose[0][0], sizeof (s_jointPose[0]),
+                      &s_jointPose[0][7], sizeof (s_jointPose[0]), 2 + 2 * JOINT_NUM);
+
+    matrix_identity (s_matStage);
+}
+
+
+static void
+render_frame (void *arg, int frame)
+{
+    unsigned int flags = *(unsigned int *)arg;
+
+    for (int i = 0; i < VIEW_NUM; i ++)
+    {
+        render_target_t *rtarget = &s_rtarget[i];
+        float matPV[16];
+
+        set_render_target (rtarget);
+        glClearColor (0.1f, 0.1f, 0.1f, 1.0f);
+        glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glstate_enable (GL_DEPTH_TEST);
+
+        matrix_mult (matPV, s_matP[i], s_matV[i]);
+
+        if (flags & SCENE_STAGE)
+            draw_stage_replay (s_matStage);
+
+        if (flags & SCENE_DEBUGLINE)
+            draw_debugline_replay (frame);
+
+        line_batch_flush (matPV);
+
+        if (flags & SCENE_TEAPOT)
+        {
+            float col[] = {1.0f, 0.0f, 0.0f};
+            draw_teapot (frame, col, s_matP[i], s_matV[i]);
+        }
+
+        if (flags & SCENE_HANDJOINT)
+        {
+            /* the app locates the joints every frame */
+            matrix_trs_batch (s_matJoint[0], &s_jointPose[0][0], sizeof (s_jointPose[0]),
+                              &s_jointPose[0][7], sizeof (s_jointPose[0]), 2 + 2 * JOINT_NUM);
+
+            /* grips: one by one. joints: both hands at once. */
+            draw_axis (s_matP[i], s_matV[i], s_matJoint[0]);
+            draw_axis (s_matP[i], s_matV[i], s_matJoint[1]);
+            draw_axes (s_matP[i], s_matV[i], s_matJoint[2], 2 * JOINT_NUM);
+        }
+
+        if (flags & SCENE_GRID)
+            draw_grid_replay (rtarget->width, rtarget->height);
+
+        if (flags & SCENE_DBGSTR)
+            draw_dbgstr_replay (frame, rtarget->width, rtarget->height);
+    }
+
+    glBindFramebuffer (GL_FRAMEBUFFER, 0);
+}
+
+
+/* the same frame in a single multiview pass. (SCENE_STAGE, SCENE_TEAPOT, SCENE_DBGSTR) only */
+static void
+render_frame_multiview (void *arg, int frame)
+{
+    unsigned int flags = *(unsigned int *)arg;
+    render_target_t *rtarget = &s_rtarget_mv;
+    float matPV[VIEW_NUM][16];
+
+    set_render_target (rtarget);
+    glClearColor (0.1f, 0.1f, 0.1f, 1.0f);
+    glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glstate_enable (GL_DEPTH_TEST);
+
+    for (int i = 0; i < VIEW_NUM; i ++)
+        matrix_mult (matPV[i], s_matP[i], s_matV[i]);
+
+    if (flags & SCENE_STAGE)
+        draw_stage_replay (s_matStage);
+
+    line_batch_flush_multiview (&matPV[0][0]);
+
+    if (flags & SCENE_TEAPOT)
+    {
+        float col[] = {1.0f, 0.0f, 0.0f};
+        draw_teapot_multiview (frame, col, &s_matP[0][0], &s_matV[0][0]);
+    }
+
+    if (flags & SCENE_DBGSTR)
+    {
+        set_dbgstr_multiview (1);
+        draw_dbgstr_replay (frame, rtarget->width, rtarget->height);
+        set_dbgstr_multiview (0);
+    }
+
+    glBindFramebuffer (GL_FRAMEBUFFER, 0);
+}
+
+
+static void
+bench_scene_multiview (void)
+{
+    bench_opt_t *opt = bench_get_opt();
+    int n = opt->frames;
+    unsigned int flags;
+
+    if (!bench_is_enabled ("scene/teapot_mv") && !bench_is_enabled ("scene/teapotapp_mv"))
+        return;
+
+    if (create_render_target_multiview (&s_rtarget_mv, opt->view_w, opt->view_h, VIEW_NUM) < 0 ||
+        init_line_renderer_multiview () < 0 ||
+        init_teapot_multiview () < 0 ||
+        init_dbgstr_multiview () < 0)
+    {
+        fprintf (stderr, "scene/*_mv: skipped (GL_OVR_multiview2 is not supported)\n");
+        destroy_render_target (&s_rtarget_mv);
+        return;
+    }
+    GLASSERT();
+
+    flags = SCENE_TEAPOT;
+    bench_run_frame ("scene/teapot_mv",     render_frame_multiview, &flags, n);
+
+    flags = SCENE_STAGE | SCENE_TEAPOT | SCENE_DBGSTR;
+    bench_run_frame ("scene/teapotapp_mv",  render_frame_multiview, &flags, n);
+
+    destroy_render_target (&s_rtarget_mv);
+    GLASSERT();
+}
+
+
+static void
+bm_shape_create (void *arg, int iters)
+{
+    int cold = *(int *)arg;
+    shape_obj_t shape;
+
+    for (int i = 0; i < iters; i ++)
+    {
+        if (cold)
+            shape_clear_cache ();
+        shape_create_ex (SHAPE_TORUS, 256, 256, (1 << MESH_ATTR_VTX) | (1 << MESH_ATTR_NRM),
+                         MESH_FMT_COMPACT, &shape);
+        shape_destroy (&shape);
+    }
+}
+
+static void
+bench_shape_create (void)
+{
+    bench_opt_t *opt = bench_get_opt();
+    int n_obj = std::max (opt->iters / 10000, 1);
+    int cold;
+
+    cold = 1;
+    bench_run_micro ("shape_create(256x256)[cold]",   bm_shape_create, &cold, n_obj);
+    cold = 0;
+    bench_run_micro ("shape_create(256x256)[cached]", bm_shape_create, &cold, n_obj);
+
+    shape_clear_cache ();
+    GLASSERT();
+}
+
+
+void
+bench_scene (void)
+{
+    bench_opt_t *opt = bench_get_opt();
+    int n = opt->frames;
+    unsigned int flags;
+
+    for (int i = 0; i < VIEW_NUM; i ++)
+        create_render_target (&s_rtarget[i], opt->view_w, opt->view_h, RTARGET_COLOR | RTARGET_DEPTH);
+
+    init_line_renderer ();
+    init_teapot ();
+    init_stage ();
+    init_2d_renderer (opt->view_w, opt->view_h);
+    init_dbgstr (opt->view_w, opt->view_h);
+    setup_view_matrix ();
+    GLASSERT();
+
+    if (!opt->csv)
+        report_render_target_memory ();
+
+    flags = SCENE_STAGE;
+    bench_run_frame ("scene/stage",         render_frame, &flags, n);
+
+    flags = SCENE_DEBUGLINE;
+    bench_run_frame ("scene/debugline",     render_frame, &flags, n);
+
+    flags = SCENE_TEAPOT;
+    bench_run_frame ("scene/teapot",        render_frame, &flags, n);
+
+    flags = SCENE_HANDJOINT;
+    bench_run_frame ("scene/handjoint",     render_frame, &flags, n);
+
+    flags = SCENE_GRID;
+    bench_run_frame ("scene/grid",          render_frame, &flags, n);
+
+    flags = SCENE_DBGSTR;
+    bench_run_frame ("scene/dbgstr",        render_frame, &flags, n);
+
+    /* what gl2handtrackOXR renders per frame, except for the imgui plane */
+    flags = SCENE_STAGE | SCENE_TEAPOT | SCENE_HANDJOINT | SCENE_DBGSTR;
+    bench_run_frame ("scene/handtrack",     render_frame, &flags, n);
+
+    /* what gl2teapotOXR renders per frame: per-eye and multiview */
+    flags = SCENE_STAGE | SCENE_TEAPOT | SCENE_DBGSTR;
+    bench_run_frame ("scene/teapotapp",     render_frame, &flags, n);
+
+    bench_scene_multiview ();
+
+    bench_shape_create ();
+
+    delete_teapot ();
+    for (int i = 0; i < VIEW_NUM; i ++)
+        destroy_render_target (&s_rtarget[i]);
+    GLASSERT();
+}
@@ -0,0 +1,305 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <GLES2/gl2.h>
+#include <GLES3/gl3.h>
+#include "util_gl_state.h"
+#include "bench_util.h"
+
+
+static bench_opt_t s_opt = {
+    1000000,    /* iters  */
+    120,        /* frames */
+    1024,       /* view_w */
+    1024,       /* view_h */
+    0,          /* csv    */
+    NULL,       /* filter */
+};
+
+static int s_header_printed = 0;
+
+
+/* ---------------------------------------------------------------- *
+ *  Draw call counter
+ *
+ *    The host build links with -Wl,--wrap=glDraw* so that every draw
+ *    issued by common/ and the app modules is routed through here.
+ * ---------------------------------------------------------------- */
+static uint64_t s_draw_count = 0;
+
+#if defined (BENCH_WRAP_DRAWCALLS)
+void __real_glDrawArrays (GLenum mode, GLint first, GLsizei count);
+void __real_glDrawElements (GLenum mode, GLsizei count, GLenum type, const void *indices);
+void __real_glDrawArraysInstanced (GLenum mode, GLint first, GLsizei count, GLsizei instancecount);
+void __real_glDrawElementsInstanced (GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instancecount);
+void __real_glDrawRangeElements (GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type, const void *indices);
+
+void
+__wrap_glDrawArrays (GLenum mode, GLint first, GLsizei count)
+{
+    s_draw_count ++;
+    __real_glDrawArrays (mode, first, count);
+}
+
+void
+__wrap_glDrawElements (GLenum mode, GLsizei count, GLenum type, const void *indices)
+{
+    s_draw_count ++;
+    __real_glDrawElements (mode, count, type, indices);
+}
+
+void
+__wrap_glDrawArraysInstanced (GLenum mode, GLint first, GLsizei count, GLsizei instancecount)
+{
+    s_draw_count ++;
+    __real_glDrawArraysInstanced (mode, first, count, instancecount);
+}
+
+void
+__wrap_glDrawElementsInstanced (GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instancecount)
+{
+    s_draw_count ++;
+    __real_glDrawElementsInstanced (mode, count, type, indices, instancecount);
+}
+
+void
+__wrap_glDrawRangeElements (GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type, const void *indices)
+{
+    s_draw_count ++;
+    __real_glDrawRangeElements (mode, start, end, count, type, indices);
+}
+#endif
+
+
+uint64_t
+bench_get_draw_count (void)
+{
+    return s_draw_count;
+}
+
+
+uint64_t
+bench_get_time_ns (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+
+
+/* ---------------------------------------------------------------- *
+ *  Options
+ * ---------------------------------------------------------------- */
+static void
+print_usage (const char *argv0)
+{
+    fprintf (stderr, "Usage: %s [options]\n", argv0);
+    fprintf (stderr, "  -i, --iters  N      iterations of micro benchmarks (default %d)\n", s_opt.iters);
+    fprintf (stderr, "  -f, --frames N      frames of scene benchmarks (default %d)\n", s_opt.frames);
+    fprintf (stderr, "  -s, --size   WxH    per-eye render target size (default %dx%d)\n", s_opt.view_w, s_opt.view_h);
+    fprintf (stderr, "  -F, --filter STR    run benchmarks whose name contains STR\n");
+    fprintf (stderr, "      --csv           output in CSV format\n");
+    fprintf (stderr, "      --glstate-validate  check the GL state cache against glGet (slow)\n");
+}
+
+int
+bench_init (int argc, char *argv[])
+{
+    int i;
+
+    for (i = 1; i < argc; i ++)
+    {
+        const char *arg = argv[i];
+        const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (strcmp (arg, "--csv") == 0)
+        {
+            s_opt.csv = 1;
+            continue;
+        }
+        if (strcmp (arg, "--glstate-validate") == 0)
+        {
+            glstate_set_validate (1);
+            continue;
+        }
+
+        if (val == NULL)
+        {
+            print_usage (argv[0]);
+            return -1;
+        }
+
+        if (strcmp (arg, "-i") == 0 || strcmp (arg, "--iters") == 0)
+            s_opt.iters = atoi (val);
+        else if (strcmp (arg, "-f") == 0 || strcmp (arg, "--frames") == 0)
+            s_opt.frames = atoi (val);
+        else if (strcmp (arg, "-s") == 0 || strcmp (arg, "--size") == 0)
+            sscanf (val, "%dx%d", &s_opt.view_w, &s_opt.view_h);
+        else if (strcmp (arg, "-F") == 0 || strcmp (arg, "--filter") == 0)
+            s_opt.filter = val;
+        else
+        {
+            print_usage (argv[0]);
+            return -1;
+        }
+        i ++;
+    }
+
+    if (s_opt.iters < 1 || s_opt.frames < 1 || s_opt.view_w < 1 || s_opt.view_h < 1)
+    {
+        print_usage (argv[0]);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+bench_opt_t *
+bench_get_opt (void)
+{
+    return &s_opt;
+}
+
+
+int
+bench_is_enabled (const char *name)
+{
+    if (s_opt.filter == NULL)
+        return 1;
+
+    return (strstr (name, s_opt.filter) != NULL);
+}
+
+
+
+/* ---------------------------------------------------------------- *
+ *  Runner
+ * ---------------------------------------------------------------- */
+static void
+print_result (const char *name, int iters, double ns_op, double cpu_ns_op, double draws_op,
+              glstate_stats_t *st0, glstate_stats_t *st1)
+{
+    double issued_op = (double)(st1->issued - st0->issued) / iters;
+    double elided_op = (double)(st1->elided - st0->elided) / iters;
+
+    if (!s_header_printed)
+    {
+        if (s_opt.csv)
+            printf ("name,iters,ns_per_op,cpu_ns_per_op,draws_per_op,state_calls_per_op,state_elided_per_op\n");
+        else
+            printf ("%-36s %10s %14s %14s %10s %10s %10s\n",
+                    "benchmark", "iters", "ns/op", "cpu ns/op", "draws/op", "states/op", "elided/op");
+        s_header_printed = 1;
+    }
+
+    if (s_opt.csv)
+    {
+#if defined (BENCH_WRAP_DRAWCALLS)
+        printf ("%s,%d,%.2f,%.2f,%.2f,%.2f,%.2f\n", name, iters, ns_op, cpu_ns_op, draws_op, issued_op, elided_op);
+#else
+        printf ("%s,%d,%.2f,%.2f,,%.2f,%.2f\n", name, iters, ns_op, cpu_ns_op, issued_op, elided_op);
+#endif
+    }
+    else
+    {
+#if defined (BENCH_WRAP_DRAWCALLS)
+        printf ("%-36s %10d %14.2f %14.2f %10.2f %10.2f %10.2f\n", name, iters, ns_op, cpu_ns_op, draws_op, issued_op, elided_op);
+#else
+        printf ("%-36s %10d %14.2f %14.2f %10s %10.2f %10.2f\n", name, iters, ns_op, cpu_ns_op, "n/a", issued_op, elided_op);
+#endif
+    }
+    fflush (stdout);
+}
+
+
+/*
+ *  Run (func) once with its own loop of (iters).
+ *  GPU work queued by the loop is drained with glFinish() and included in ns/op.
+ */
+void
+bench_run_micro (const char *name, bench_func_t func, void *arg, int iters)
+{
+    uint64_t t0, t1, t2, d0, d1;
+    glstate_stats_t st0, st1;
+
+    if (!bench_is_enabled (name))
+        return;
+
+    if (iters < 1)
+        iters = 1;
+
+    /* warm up */
+    func (arg, 1);
+    glFinish ();
+
+    d0 = bench_get_draw_count ();
+    glstate_get_stats (&st0);
+    t0 = bench_get_time_ns ();
+    func (arg, iters);
+    t1 = bench_get_time_ns ();
+    glFinish ();
+    t2 = bench_get_time_ns ();
+    glstate_get_stats (&st1);
+    d1 = bench_get_draw_count ();
+
+    print_result (name, iters,
+                  (double)(t2 - t0) / iters,
+                  (double)(t1 - t0) / iters,
+                  (double)(d1 - d0) / iters, &st0, &st1);
+}
+
+
+/*
+ *  Call (func) once per frame. Each frame is finished before the next one
+ *  starts, as a swapchain would throttle the app on a device.
+ *    ns/op     : wall time of a frame (CPU submit + GPU)
+ *    cpu ns/op : time spent in (func) only
+ *    draws/op  : draw calls per frame
+ *    states/op : state calls passed to GL per frame (util_gl_state.h)
+ *    elided/op : state calls skipped by the state cache per frame
+ */
+void
+bench_run_frame (const char *name, bench_func_t func, void *arg, int frames)
+{
+    uint64_t t0, t1, t_cpu = 0, t_all = 0, d0, d1;
+    glstate_stats_t st0, st1;
+    int i;
+
+    if (!bench_is_enabled (name))
+        return;
+
+    if (frames < 1)
+        frames = 1;
+
+    /* warm up */
+    func (arg, 0);
+    glFinish ();
+
+    d0 = bench_get_draw_count ();
+    glstate_get_stats (&st0);
+    for (i = 0; i < frames; i ++)
+    {
+        t0 = bench_get_time_ns ();
+        func (arg, i);
+        t1 = bench_get_time_ns ();
+        glFinish ();
+
+        t_cpu += t1 - t0;
+        t_all += bench_get_time_ns () - t0;
+    }
+    glstate_get_stats (&st1);
+    d1 = bench_get_draw_count ();
+
+    print_result (name, frames,
+                  (double)t_all / frames,
+                  (double)t_cpu / frames,
+                  (double)(d1 - d0) / frames, &st0, &st1);
+}
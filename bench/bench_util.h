@@ -0,0 +1,47 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef BENCH_UTIL_H_
+#define BENCH_UTIL_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct bench_opt_t
+{
+    int         iters;      /* iterations of a micro benchmark  */
+    int         frames;     /* frames of a scene benchmark      */
+    int         view_w;     /* per-eye render target size       */
+    int         view_h;
+    int         csv;        /* output in CSV format             */
+    const char  *filter;    /* run only benchmarks matching it  */
+} bench_opt_t;
+
+/*
+ *  micro benchmark: (func) runs the operation (iters) times in its own loop.
+ *  scene benchmark: (func) submits one stereo frame. (iters) is the frame number.
+ */
+typedef void (*bench_func_t) (void *arg, int iters);
+
+int          bench_init (int argc, char *argv[]);
+bench_opt_t *bench_get_opt (void);
+int          bench_is_enabled (const char *name);
+
+uint64_t     bench_get_time_ns (void);
+uint64_t     bench_get_draw_count (void);
+
+void         bench_run_micro (const char *name, bench_func_t func, void *arg, int iters);
+void         bench_run_frame (const char *name, bench_func_t func, void *arg, int frames);
+
+void         bench_matrix (void);
+void         bench_render (void);
+void         bench_scene  (void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* BENCH_UTIL_H_ */
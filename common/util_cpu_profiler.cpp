@@ -0,0 +1,491 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <atomic>
+#include <algorithm>
+#include "util_log.h"
+#include "util_cpu_profiler.h"
+
+#define RING_MASK   (CPU_PROF_RING_SIZE - 1)
+
+/*
+ *  ring of a thread.
+ *    (head) is the number of events ever recorded, written by the owner only.
+ *    (tail) is where the export starts, moved by cpu_profiler_clear().
+ */
+typedef struct cpu_prof_ring_t
+{
+    std::atomic<uint64_t>   head;
+    std::atomic<uint64_t>   tail;
+    int                     tid;
+    char                    name[CPU_PROF_NAME_LEN];
+    cpu_prof_event_t        event[CPU_PROF_RING_SIZE];
+} cpu_prof_ring_t;
+
+typedef struct cpu_prof_thread_t
+{
+    int                             tid;
+    std::string                     name;
+    std::vector<cpu_prof_event_t>   events;
+} cpu_prof_thread_t;
+
+static std::atomic<cpu_prof_ring_t *>   s_ring[CPU_PROF_MAX_THREAD];
+static std::atomic<int>                 s_ring_num {0};
+static std::atomic<int64_t>             s_clock_offset {0};
+static std::atomic<bool>                s_enabled {true};
+
+static thread_local cpu_prof_ring_t     *t_ring;
+static thread_local bool                t_no_ring;
+static thread_local int                 t_depth;
+
+
+int64_t
+cpu_profiler_now (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    int64_t ns = (int64_t)ts.tv_sec * 1000000000ll + ts.tv_nsec;
+    return ns + s_clock_offset.load (std::memory_order_relaxed);
+}
+
+
+/* (XrTime) - (CLOCK_MONOTONIC) [ns] */
+void
+cpu_profiler_set_clock_offset (int64_t offset_ns)
+{
+    s_clock_offset.store (offset_ns, std::memory_order_relaxed);
+}
+
+
+void
+cpu_profiler_set_enabled (bool enabled)
+{
+    s_enabled.store (enabled, std::memory_order_relaxed);
+}
+
+
+bool
+cpu_profiler_is_enabled (void)
+{
+    return s_enabled.load (std::memory_order_relaxed);
+}
+
+
+/*
+ *  the ring of the calling thread, allocated at its first event.
+ *  threads beyond CPU_PROF_MAX_THREAD are not recorded.
+ */
+static cpu_prof_ring_t *
+get_thread_ring (void)
+{
+    if (t_ring || t_no_ring)
+        return t_ring;
+
+    int slot = s_ring_num.fetch_add (1);
+    if (slot >= CPU_PROF_MAX_THREAD)
+    {
+        LOGW ("CPU profiler: more than %d threads. not recorded.\n", CPU_PROF_MAX_THREAD);
+        t_no_ring = true;
+        return nullptr;
+    }
+
+    cpu_prof_ring_t *ring = new cpu_prof_ring_t;
+    ring->head.store (0, std::memory_order_relaxed);
+    ring->tail.store (0, std::memory_order_relaxed);
+    ring->tid = (int)syscall (SYS_gettid);
+    snprintf (ring->name, CPU_PROF_NAME_LEN, "thread %d", slot);
+
+    s_ring[slot].store (ring, std::memory_order_release);
+    t_ring = ring;
+    return ring;
+}
+
+
+void
+cpu_profiler_set_thread_name (const char *name)
+{
+    cpu_prof_ring_t *ring = get_thread_ring ();
+    if (ring == nullptr)
+        return;
+
+    strncpy (ring->name, name, CPU_PROF_NAME_LEN - 1);
+    ring->name[CPU_PROF_NAME_LEN - 1] = '\0';
+}
+
+
+void
+cpu_profiler_clear (void)
+{
+    int num = std::min (s_ring_num.load (), CPU_PROF_MAX_THREAD);
+    for (int i = 0; i < num; i ++)
+    {
+        cpu_prof_ring_t *ring = s_ring[i].load (std::memory_order_acquire);
+        if (ring)
+            ring->tail.store (ring->head.load (std::memory_order_acquire), std::memory_order_relaxed);
+    }
+}
+
+
+void
+cpu_profiler_record (const char *name, int64_t begin, int64_t end, int depth)
+{
+    cpu_prof_ring_t *ring = get_thread_ring ();
+    if (ring == nullptr)
+        return;
+
+    uint64_t head = ring->head.load (std::memory_order_relaxed);
+    cpu_prof_event_t *ev = &ring->event[head & RING_MASK];
+    ev->name  = name;
+    ev->begin = begin;
+    ev->end   = end;
+    ev->depth = depth;
+
+    ring->head.store (head + 1, std::memory_order_release);
+}
+
+
+CpuProfileScope::CpuProfileScope (const char *name)
+    : m_name (nullptr), m_begin (0)
+{
+    if (!s_enabled.load (std::memory_order_relaxed))
+        return;
+
+    m_name  = name;
+    m_begin = cpu_profiler_now ();
+    t_depth ++;
+}
+
+
+CpuProfileScope::~CpuProfileScope ()
+{
+    if (m_name == nullptr)
+        return;
+
+    t_depth --;
+    cpu_profiler_record (m_name, m_begin, cpu_profiler_now (), t_depth);
+}
+
+
+
+/* ---------------------------------------------------------------------------- *
+ *  Export
+ * ---------------------------------------------------------------------------- */
+/*
+ *  copy the events of every ring, sorted by the begin time (outer scope first).
+ *  the owner threads may keep recording: the events overwritten during the
+ *  copy are detected by reading (head) again, and dropped.
+ */
+static int
+collect_events (std::vector<cpu_prof_thread_t> &threads)
+{
+    int total = 0;
+    int num = std::min (s_ring_num.load (), CPU_PROF_MAX_THREAD);
+
+    threads.clear ();
+    for (int i = 0; i < num; i ++)
+    {
+        cpu_prof_ring_t *ring = s_ring[i].load (std::memory_order_acquire);
+        if (ring == nullptr)
+            continue;
+
+        uint64_t head  = ring->head.load (std::memory_order_acquire);
+        uint64_t start = ring->tail.load (std::memory_order_relaxed);
+        if (head - start > CPU_PROF_RING_SIZE)
+            start = head - CPU_PROF_RING_SIZE;
+
+        cpu_prof_thread_t thread;
+        thread.tid  = ring->tid;
+        thread.name = ring->name;
+        thread.events.reserve (head - start);
+        for (uint64_t pos = start; pos < head; pos ++)
+            thread.events.push_back (ring->event[pos & RING_MASK]);
+
+        /* the owner may be filling the slot of (head2) too: it is dropped with them */
+        uint64_t head2 = ring->head.load (std::memory_order_acquire);
+        if (head2 + 1 - start > CPU_PROF_RING_SIZE)
+        {
+            size_t lost = std::min ((size_t)(head2 + 1 - start - CPU_PROF_RING_SIZE), thread.events.size ());
+            thread.events.erase (thread.events.begin (), thread.events.begin () + lost);
+        }
+
+        std::sort (thread.events.begin (), thread.events.end (),
+                   [](const cpu_prof_event_t &a, const cpu_prof_event_t &b) {
+                       return (a.begin != b.begin) ? (a.begin < b.begin) : (a.depth < b.depth);
+                   });
+
+        total += (int)thread.events.size ();
+        threads.push_back (std::move (thread));
+    }
+    return total;
+}
+
+
+static void
+append_json_string (std::string &str, const char *s)
+{
+    str += '"';
+    for (; *s; s ++)
+    {
+        if (*s == '"' || *s == '\\')
+            str += '\\';
+        if ((unsigned char)*s >= 0x20)
+            str += *s;
+    }
+    str += '"';
+}
+
+
+/*
+ *  Chrome trace event format: a complete event ("ph":"X") per scope,
+ *  and a thread_name metadata event per thread. [us]
+ */
+int
+cpu_profiler_export_chrome_trace (std::string &json)
+{
+    std::vector<cpu_prof_thread_t> threads;
+    int  total = collect_events (threads);
+    int  pid   = (int)getpid ();
+    char buf[128];
+
+    json.clear ();
+    json.reserve (total * 96 + 256);
+    json += "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+    bool first = true;
+    for (const cpu_prof_thread_t &thread : threads)
+    {
+        snprintf (buf, sizeof (buf), "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":",
+                  first ? "" : ",", pid, thread.tid);
+        json += buf;
+        append_json_string (json, thread.name.c_str ());
+        json += "}}";
+        first = false;
+
+        for (const cpu_prof_event_t &ev : thread.events)
+        {
+            json += ",\n{\"name\":";
+            append_json_string (json, ev.name);
+            snprintf (buf, sizeof (buf), ",\"cat\":\"cpu\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d}",
+                      ev.begin / 1000.0, (ev.end - ev.begin) / 1000.0, pid, thread.tid);
+            json += buf;
+        }
+    }
+    json += "\n]}\n";
+
+    return total;
+}
+
+
+/*
+ *  Perfetto protobuf trace (perfetto/trace/trace.proto), encoded by hand:
+ *    Trace { repeated TracePacket packet = 1; }
+ *    a TrackDescriptor packet per thread, then TrackEvent SLICE_BEGIN/END
+ *    packets on the track of the thread.
+ *    all the packets are on one sequence. its first packet clears the
+ *    incremental state: trace_processor drops the TrackEvents of a
+ *    sequence until then.
+ */
+#define PB_VARINT                   0
+#define PB_BYTES                    2
+
+#define TRACE_PACKET                1
+#define PACKET_TIMESTAMP            8
+#define PACKET_SEQUENCE_ID          10
+#define PACKET_TRACK_EVENT          11
+#define PACKET_SEQUENCE_FLAGS       13
+#define PACKET_TRACK_DESCRIPTOR     60
+#define TRACK_DESC_UUID             1
+#define TRACK_DESC_THREAD           4
+#define THREAD_DESC_PID             1
+#define THREAD_DESC_TID             2
+#define THREAD_DESC_NAME            5
+#define TRACK_EVENT_TYPE            9
+#define TRACK_EVENT_TRACK_UUID      11
+#define TRACK_EVENT_NAME            23
+#define TYPE_SLICE_BEGIN            1
+#define TYPE_SLICE_END              2
+#define SEQ_INCREMENTAL_STATE_CLEARED   1
+#define SEQ_NEEDS_INCREMENTAL_STATE     2
+
+#define PERFETTO_SEQUENCE_ID        1
+#define PERFETTO_TRACK_UUID_BASE    0x6f78725f63707500ull   /* "oxr_cpu\0" */
+
+static void
+pb_varint (std::vector<uint8_t> &buf, uint64_t val)
+{
+    while (val >= 0x80)
+    {
+        buf.push_back ((uint8_t)(val | 0x80));
+        val >>= 7;
+    }
+    buf.push_back ((uint8_t)val);
+}
+
+static void
+pb_uint (std::vector<uint8_t> &buf, int field, uint64_t val)
+{
+    pb_varint (buf, (field << 3) | PB_VARINT);
+    pb_varint (buf, val);
+}
+
+static void
+pb_bytes (std::vector<uint8_t> &buf, int field, const void *data, size_t len)
+{
+    pb_varint (buf, (field << 3) | PB_BYTES);
+    pb_varint (buf, len);
+    buf.insert (buf.end (), (const uint8_t *)data, (const uint8_t *)data + len);
+}
+
+static void
+pb_string (std::vector<uint8_t> &buf, int field, const char *str)
+{
+    pb_bytes (buf, field, str, strlen (str));
+}
+
+static void
+pb_message (std::vector<uint8_t> &buf, int field, const std::vector<uint8_t> &msg)
+{
+    pb_bytes (buf, field, msg.data (), msg.size ());
+}
+
+
+static void
+add_track_descriptor (std::vector<uint8_t> &trace, uint64_t uuid, int pid, const cpu_prof_thread_t &thread,
+                      uint32_t seq_flags)
+{
+    std::vector<uint8_t> thread_desc, track_desc, packet;
+
+    pb_uint   (thread_desc, THREAD_DESC_PID,  pid);
+    pb_uint   (thread_desc, THREAD_DESC_TID,  thread.tid);
+    pb_string (thread_desc, THREAD_DESC_NAME, thread.name.c_str ());
+
+    pb_uint    (track_desc, TRACK_DESC_UUID,   uuid);
+    pb_message (track_desc, TRACK_DESC_THREAD, thread_desc);
+
+    pb_uint    (packet, PACKET_SEQUENCE_ID,      PERFETTO_SEQUENCE_ID);
+    if (seq_flags)
+        pb_uint (packet, PACKET_SEQUENCE_FLAGS,  seq_flags);
+    pb_message (packet, PACKET_TRACK_DESCRIPTOR, track_desc);
+
+    pb_message (trace, TRACE_PACKET, packet);
+}
+
+
+static void
+add_track_event (std::vector<uint8_t> &trace, uint64_t uuid, int64_t time, int type, const char *name)
+{
+    std::vector<uint8_t> track_event, packet;
+
+    pb_uint (track_event, TRACK_EVENT_TYPE,       type);
+    pb_uint (track_event, TRACK_EVENT_TRACK_UUID, uuid);
+    if (name)
+        pb_string (track_event, TRACK_EVENT_NAME, name);
+
+    pb_uint    (packet, PACKET_TIMESTAMP,      (uint64_t)time);
+    pb_uint    (packet, PACKET_SEQUENCE_ID,    PERFETTO_SEQUENCE_ID);
+    pb_uint    (packet, PACKET_SEQUENCE_FLAGS, SEQ_NEEDS_INCREMENTAL_STATE);
+    pb_message (packet, PACKET_TRACK_EVENT,    track_event);
+
+    pb_message (trace, TRACE_PACKET, packet);
+}
+
+
+int
+cpu_profiler_export_perfetto_trace (std::vector<uint8_t> &trace)
+{
+    std::vector<cpu_prof_thread_t> threads;
+    int total = collect_events (threads);
+    int pid   = (int)getpid ();
+
+    trace.clear ();
+    trace.reserve (total * 2 * 32 + 256);
+
+    for (size_t i = 0; i < threads.size (); i ++)
+    {
+        const cpu_prof_thread_t &thread = threads[i];
+        uint64_t uuid = PERFETTO_TRACK_UUID_BASE + i;
+
+        add_track_descriptor (trace, uuid, pid, thread, (i == 0) ? SEQ_INCREMENTAL_STATE_CLEARED : 0);
+
+        /*
+         *  slices must be properly nested on a track. the scopes are sorted
+         *  by begin time, so close the open ones as deep as or deeper than
+         *  the next scope before it begins.
+         */
+        std::vector<const cpu_prof_event_t *> stack;
+        for (const cpu_prof_event_t &ev : thread.events)
+        {
+            while (!stack.empty () && stack.back ()->depth >= ev.depth)
+            {
+                add_track_event (trace, uuid, stack.back ()->end, TYPE_SLICE_END, nullptr);
+                stack.pop_back ();
+            }
+            add_track_event (trace, uuid, ev.begin, TYPE_SLICE_BEGIN, ev.name);
+            stack.push_back (&ev);
+        }
+        while (!stack.empty ())
+        {
+            add_track_event (trace, uuid, stack.back ()->end, TYPE_SLICE_END, nullptr);
+            stack.pop_back ();
+        }
+    }
+
+    return total;
+}
+
+
+static int
+write_file (const char *path, const void *data, size_t size)
+{
+    FILE *fp = fopen (path, "wb");
+    if (fp == NULL)
+    {
+        LOGE ("CPU profiler: can't open %s\n", path);
+        return -1;
+    }
+
+    size_t written = fwrite (data, 1, size, fp);
+    fclose (fp);
+
+    if (written != size)
+    {
+        LOGE ("CPU profiler: failed to write %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+
+int
+cpu_profiler_write_chrome_trace (const char *path)
+{
+    std::string json;
+    int num = cpu_profiler_export_chrome_trace (json);
+
+    if (write_file (path, json.data (), json.size ()) < 0)
+        return -1;
+
+    LOGI ("CPU profiler: %d events -> %s\n", num, path);
+    return num;
+}
+
+
+int
+cpu_profiler_write_perfetto_trace (const char *path)
+{
+    std::vector<uint8_t> trace;
+    int num = cpu_profiler_export_perfetto_trace (trace);
+
+    if (write_file (path, trace.data (), trace.size ()) < 0)
+        return -1;
+
+    LOGI ("CPU profiler: %d events -> %s\n", num, path);
+    return num;
+}
@@ -0,0 +1,82 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef UTIL_CPU_PROFILER_H_
+#define UTIL_CPU_PROFILER_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+#define CPU_PROF_RING_SIZE      (1 << 15)   /* events kept per thread (power of two) */
+#define CPU_PROF_MAX_THREAD     16
+#define CPU_PROF_NAME_LEN       32
+
+typedef struct cpu_prof_event_t
+{
+    const char  *name;          /* string literal: not copied */
+    int64_t     begin;          /* XrTime [ns] */
+    int64_t     end;
+    int32_t     depth;          /* nesting of the scopes on the thread */
+} cpu_prof_event_t;
+
+
+/*
+ *  Scoped CPU profiler.
+ *
+ *    void AppEngine::RenderFrame () {
+ *        CPU_PROF_SCOPE ("RenderFrame");
+ *        ...
+ *    }
+ *
+ *    Every thread records into its own ring of CPU_PROF_RING_SIZE events,
+ *    allocated at its first scope. Recording takes no lock: the owner thread
+ *    is the only writer, and publishes an event with a release store. When
+ *    the ring is full, the oldest events are overwritten, and an export
+ *    keeps the newest CPU_PROF_RING_SIZE - 1 of them.
+ *
+ *    The timestamps are CLOCK_MONOTONIC shifted onto the XrTime clock by
+ *    cpu_profiler_set_clock_offset() (see oxr_create_instance()), so the
+ *    scopes line up with predictedDisplayTime in the trace.
+ *
+ *    Exported as Chrome trace JSON (chrome://tracing, ui.perfetto.dev) or
+ *    as a Perfetto protobuf trace (ui.perfetto.dev, trace_processor).
+ */
+int64_t cpu_profiler_now (void);
+void    cpu_profiler_set_clock_offset (int64_t offset_ns);
+
+void    cpu_profiler_set_enabled (bool enabled);
+bool    cpu_profiler_is_enabled (void);
+void    cpu_profiler_set_thread_name (const char *name);
+void    cpu_profiler_clear (void);
+
+void    cpu_profiler_record (const char *name, int64_t begin, int64_t end, int depth);
+
+/* events of every thread still in the rings, oldest first. returns the event num */
+int     cpu_profiler_export_chrome_trace (std::string &json);
+int     cpu_profiler_export_perfetto_trace (std::vector<uint8_t> &trace);
+
+int     cpu_profiler_write_chrome_trace (const char *path);
+int     cpu_profiler_write_perfetto_trace (const char *path);
+
+
+class CpuProfileScope {
+public:
+    explicit CpuProfileScope (const char *name);
+    ~CpuProfileScope ();
+
+private:
+    CpuProfileScope (const CpuProfileScope &) = delete;
+    CpuProfileScope &operator= (const CpuProfileScope &) = delete;
+
+    const char  *m_name;
+    int64_t     m_begin;
+};
+
+#define CPU_PROF_CONCAT_(a, b)  a##b
+#define CPU_PROF_CONCAT(a, b)   CPU_PROF_CONCAT_(a, b)
+#define CPU_PROF_SCOPE(name)    CpuProfileScope CPU_PROF_CONCAT(cpu_prof_scope_, __LINE__) (name)
+
+#endif /* UTIL_CPU_PROFILER_H_ */
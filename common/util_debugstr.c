@@ -3,10 +3,13 @@
  * Copyright (c) 2019 terryky1220@gmail.com
  * ------------------------------------------------ */
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <GLES2/gl2.h>
 #include "util_shader.h"
 #include "util_debugstr.h"
 #include "assertgl.h"
+#include "util_gl_state.h"
 
 #define UNUSED(x) (void)(x)
 
@@ -40,6 +43,42 @@ static const char s_strDbgStrFS[] =
     "   gl_FragColor = mix (u_ColorBG, u_ColorFG, texcol.r);\n"
     "}                                                      \n";
 
+/* the same shader for GL_OVR_multiview2: the string is at the same position in both views */
+static const char s_strDbgStrMultiviewVS[] =
+    "#version 300 es                                        \n"
+    "#extension GL_OVR_multiview2 : require                 \n"
+    "layout(num_views = 2) in;                              \n"
+    "in        vec4 a_Vertex;                               \n"
+    "in        vec2 a_UV;                                   \n"
+    "uniform   vec4 u_Translate;                            \n"
+    "uniform   vec4 u_PrjMul, u_PrjAdd;                     \n"
+    "out       vec2 v_UV;                                   \n"
+    "                                                       \n"
+    "void main()                                            \n"
+    "{                                                      \n"
+    "   vec4 pos;                                           \n"
+    "   pos         = a_Vertex + u_Translate;               \n"
+    "   pos         = pos * u_PrjMul;                       \n"
+    "   gl_Position = pos + u_PrjAdd;                       \n"
+    "   v_UV        = a_UV;                                 \n"
+    "}                                                      \n";
+
+static const char s_strDbgStrMultiviewFS[] =
+    "#version 300 es                                        \n"
+    "precision mediump float;                               \n"
+    "                                                       \n"
+    "in      vec2       v_UV;                               \n"
+    "uniform sampler2D  u_Sampler0;                         \n"
+    "uniform vec4       u_ColorFG;                          \n"
+    "uniform vec4       u_ColorBG;                          \n"
+    "out     vec4       o_FragColor;                        \n"
+    "                                                       \n"
+    "void main()                                            \n"
+    "{                                                      \n"
+    "   vec4 texcol = texture (u_Sampler0, v_UV);           \n"
+    "   o_FragColor = mix (u_ColorBG, u_ColorFG, texcol.r); \n"
+    "}                                                      \n";
+
 
 #define DEBSTR_FONT_WIDTH   (12)
 #define DEBSTR_FONT_HEIGHT  (22)
@@ -51,6 +90,7 @@ static unsigned int     s_font12x22[];
 static unsigned int     s_fontTexID;
 static int              s_wndW, s_wndH;
 static GLuint           s_progShader;
+static GLuint           s_progShaderSingle, s_progShaderMultiview;
 static int              locVtx, locUv, locTranslate, locSampler0;
 static int              locPrjMul, locPrjAdd;
 static int              locColFG, locColBG;
@@ -59,7 +99,7 @@ static int
 load_debug_font_texture (void)
 {
     glGenTextures (1, &s_fontTexID);
-    glBindTexture (GL_TEXTURE_2D, s_fontTexID);
+    glstate_bind_texture (GL_TEXTURE_2D, s_fontTexID);
     glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR      );
     glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR      );
     glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,     GL_CLAMP_TO_EDGE);
@@ -76,10 +116,10 @@ load_debug_font_texture (void)
 }
 
 
-static int
-setup_shader() 
+static void
+get_shader_locations (GLuint prog)
 {
-    s_progShader = build_shader (s_strDbgStrVS, s_strDbgStrFS);
+    s_progShader = prog;
 
     locVtx = glGetAttribLocation (s_progShader, "a_Vertex");
     locUv  = glGetAttribLocation (s_progShader, "a_UV"    );
@@ -90,6 +130,14 @@ setup_shader()
     locPrjAdd    = glGetUniformLocation (s_progShader, "u_PrjAdd");
     locColFG     = glGetUniformLocation (s_progShader, "u_ColorFG" );
     locColBG     = glGetUniformLocation (s_progShader, "u_ColorBG" );
+}
+
+
+static int
+setup_shader() 
+{
+    s_progShaderSingle = build_shader (s_strDbgStrVS, s_strDbgStrFS);
+    get_shader_locations (s_progShaderSingle);
 
     return 0;
 }
@@ -108,6 +156,29 @@ init_dbgstr (int win_w, int win_h)
 }
 
 
+/* build the stereo multiview shader. */
+int
+init_dbgstr_multiview (void)
+{
+    s_progShaderMultiview = build_shader (s_strDbgStrMultiviewVS, s_strDbgStrMultiviewFS);
+    if (s_progShaderMultiview == 0)
+        return -1;
+
+    return 0;
+}
+
+
+/* draw the following strings into both layers of a GL_OVR_multiview2 render target. */
+void
+set_dbgstr_multiview (int enable)
+{
+    if (enable && s_progShaderMultiview)
+        get_shader_locations (s_progShaderMultiview);
+    else
+        get_shader_locations (s_progShaderSingle);
+}
+
+
 void
 update_dbgstr_winsize (int win_w, int win_h)
 {
@@ -115,55 +186,77 @@ update_dbgstr_winsize (int win_w, int win_h)
     s_wndH = win_h;
 }
 
-int
-draw_dbgstr_ex (const char *str, int x, int y, float scale, float *col_fg, float *col_bg)
-{
-    int   i, row, column;
-    float u0, u1;
-    float vertices[8], texcoord[8];
-    float fW = DEBSTR_FONT_WIDTH  * scale;
-    float fH = DEBSTR_FONT_HEIGHT * scale;
-    float fx = (float)x;
-    float fy = (float)y;
-
-    vertices[ 2 * 0 + 0 ] = fx;      vertices[ 2 * 0 + 1 ] = fy;
-    vertices[ 2 * 1 + 0 ] = fx;      vertices[ 2 * 1 + 1 ] = fy + fH;
-    vertices[ 2 * 2 + 0 ] = fx + fW; vertices[ 2 * 2 + 1 ] = fy;
-    vertices[ 2 * 3 + 0 ] = fx + fW; vertices[ 2 * 3 + 1 ] = fy + fH;
+/*
+ *  Glyph quad cache.
+ *
+ *    Each string is built into one vertex buffer of glyph quads relative
+ *    to its origin, and drawn with a single glDrawArrays(). The buffers of
+ *    the recent strings are kept, so that the same string drawn again (the
+ *    other eye, the next frame, the static labels) costs no rebuild.
+ */
+#define DBGSTR_CACHE_NUM    64
 
-    glUseProgram (s_progShader);
+typedef struct _dbgstr_cache_t
+{
+    char            *str;
+    unsigned int    hash;
+    float           scale;
+    GLuint          vbo;
+    GLsizeiptr      vbo_size;
+    int             vtx_num;
+    unsigned int    last_used;
+} dbgstr_cache_t;
 
-    glBindBuffer (GL_ARRAY_BUFFER, 0);
-    glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+static dbgstr_cache_t   s_cache[DBGSTR_CACHE_NUM];
+static unsigned int     s_cache_tick;
+static float            *s_vtx_buf;
+static int              s_vtx_buf_len;
 
-    glEnableVertexAttribArray (locVtx);
-    glEnableVertexAttribArray (locUv );
-    glVertexAttribPointer (locVtx, 2, GL_FLOAT, GL_FALSE, 0, vertices);
-    glVertexAttribPointer (locUv,  2, GL_FLOAT, GL_FALSE, 0, texcoord);
+static unsigned int
+hash_string (const char *str, int *len)
+{
+    unsigned int hash = 2166136261u;    /* FNV-1a */
+    int i;
 
-    glUniform1i (locSampler0, 0);
-    glUniform4f (locPrjMul, 2.0f / s_wndW, -2.0f / s_wndH, 0.0f, 0.0f);
-    glUniform4f (locPrjAdd, -1.0f, 1.0f, 1.0f, 1.0f);
-    glUniform4fv(locColFG, 1, col_fg);
-    glUniform4fv(locColBG, 1, col_bg);
+    for (i = 0; str[i]; i ++)
+    {
+        hash ^= (unsigned char)str[i];
+        hash *= 16777619u;
+    }
+    *len = i;
+    return hash;
+}
 
-    glDisable (GL_DEPTH_TEST);
-    glDisable (GL_CULL_FACE );
-    glActiveTexture (GL_TEXTURE0);
-    glBindTexture   (GL_TEXTURE_2D, s_fontTexID);
-    GLASSERT();
+/* 6 vertices (x, y, u, v) per glyph */
+static int
+build_glyph_quads (dbgstr_cache_t *cache, const char *str, int len, float scale)
+{
+    int   i, row, column, num;
+    float u0, u1;
+    float fW = DEBSTR_FONT_WIDTH  * scale;
+    float fH = DEBSTR_FONT_HEIGHT * scale;
+    float *vtx;
 
-    glEnable (GL_BLEND);
-    glBlendFuncSeparate (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, 
-    	       GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    if (len * 6 * 4 > s_vtx_buf_len)
+    {
+        int new_len = len * 6 * 4;
+        float *new_buf = (float *)realloc (s_vtx_buf, new_len * sizeof (float));
+        if (new_buf == NULL)
+        {
+            fprintf (stderr, "ERR: %s(%d)\n", __FILE__, __LINE__);
+            return -1;
+        }
+        s_vtx_buf     = new_buf;
+        s_vtx_buf_len = new_len;
+    }
 
+    vtx = s_vtx_buf;
+    num = 0;
     row = column = 0;
-    for (i = 0; ; i ++)
+    for (i = 0; i < len; i ++)
     {
         int c = str[i];
-
-        if ( c == 0 )
-            break;
+        float x0, y0, x1, y1;
 
         if (c == '\n')
         {
@@ -175,21 +268,132 @@ draw_dbgstr_ex (const char *str, int x, int y, float scale, float *col_fg, float
         u0 = (c - 0x20) * (1.0f / DEBSTR_FONT_NUM);
         u1 = u0 + (1.0f / DEBSTR_FONT_NUM);
 
-        texcoord[ 2 * 0 + 0 ] = texcoord[ 2 * 1 + 0 ] = u0;
-        texcoord[ 2 * 2 + 0 ] = texcoord[ 2 * 3 + 0 ] = u1;
-        texcoord[ 2 * 0 + 1 ] = texcoord[ 2 * 2 + 1 ] = 0.0;
-        texcoord[ 2 * 1 + 1 ] = texcoord[ 2 * 3 + 1 ] = 1.0;
-
-        glUniform4f (locTranslate, column * fW, row * fH, 0.0f, 0.0f );
+        x0 = column * fW;
+        y0 = row    * fH;
+        x1 = x0 + fW;
+        y1 = y0 + fH;
 
-        glDrawArrays (GL_TRIANGLE_STRIP, 0, 4);
+        /* (x0, y0) - (x0, y1) - (x1, y0),  (x1, y0) - (x0, y1) - (x1, y1) */
+        vtx[ 0] = x0; vtx[ 1] = y0; vtx[ 2] = u0; vtx[ 3] = 0.0f;
+        vtx[ 4] = x0; vtx[ 5] = y1; vtx[ 6] = u0; vtx[ 7] = 1.0f;
+        vtx[ 8] = x1; vtx[ 9] = y0; vtx[10] = u1; vtx[11] = 0.0f;
+        vtx[12] = x1; vtx[13] = y0; vtx[14] = u1; vtx[15] = 0.0f;
+        vtx[16] = x0; vtx[17] = y1; vtx[18] = u0; vtx[19] = 1.0f;
+        vtx[20] = x1; vtx[21] = y1; vtx[22] = u1; vtx[23] = 1.0f;
+        vtx += 24;
+        num += 6;
 
         column ++;
     }
 
-    glDisable (GL_BLEND);
-    glDisableVertexAttribArray (locVtx);
-    glDisableVertexAttribArray (locUv );
+    if (cache->vbo == 0)
+        glGenBuffers (1, &cache->vbo);
+
+    glstate_bind_buffer (GL_ARRAY_BUFFER, cache->vbo);
+    if (num * 4 * (GLsizeiptr)sizeof (float) > cache->vbo_size)
+    {
+        cache->vbo_size = num * 4 * sizeof (float);
+        glBufferData (GL_ARRAY_BUFFER, cache->vbo_size, s_vtx_buf, GL_DYNAMIC_DRAW);
+    }
+    else if (num > 0)
+    {
+        glBufferSubData (GL_ARRAY_BUFFER, 0, num * 4 * sizeof (float), s_vtx_buf);
+    }
+
+    cache->vtx_num = num;
+    return 0;
+}
+
+static dbgstr_cache_t *
+get_glyph_quads (const char *str, float scale)
+{
+    dbgstr_cache_t *lru = &s_cache[0];
+    unsigned int hash;
+    int len, i;
+
+    hash = hash_string (str, &len);
+    s_cache_tick ++;
+
+    for (i = 0; i < DBGSTR_CACHE_NUM; i ++)
+    {
+        dbgstr_cache_t *cache = &s_cache[i];
+
+        if (cache->str && cache->hash == hash && cache->scale == scale &&
+            strcmp (cache->str, str) == 0)
+        {
+            cache->last_used = s_cache_tick;
+            return cache;
+        }
+
+        if (cache->last_used < lru->last_used)
+            lru = cache;
+    }
+
+    /* miss: rebuild the least recently used entry */
+    free (lru->str);
+    lru->str = (char *)malloc (len + 1);
+    if (lru->str == NULL)
+    {
+        fprintf (stderr, "ERR: %s(%d)\n", __FILE__, __LINE__);
+        return NULL;
+    }
+    memcpy (lru->str, str, len + 1);
+    lru->hash      = hash;
+    lru->scale     = scale;
+    lru->last_used = s_cache_tick;
+
+    if (build_glyph_quads (lru, str, len, scale) < 0)
+    {
+        free (lru->str);
+        lru->str = NULL;
+        return NULL;
+    }
+
+    return lru;
+}
+
+
+int
+draw_dbgstr_ex (const char *str, int x, int y, float scale, float *col_fg, float *col_bg)
+{
+    dbgstr_cache_t *cache = get_glyph_quads (str, scale);
+    if (cache == NULL)
+        return -1;
+
+    if (cache->vtx_num == 0)
+        return 0;
+
+    glstate_use_program (s_progShader);
+
+    glstate_bind_vertex_array (0);
+    glstate_bind_buffer (GL_ARRAY_BUFFER, cache->vbo);
+    glstate_bind_buffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    glstate_enable_vertex_attrib_array (locVtx);
+    glstate_enable_vertex_attrib_array (locUv );
+    glVertexAttribPointer (locVtx, 2, GL_FLOAT, GL_FALSE, 4 * sizeof (float), (void *)0);
+    glVertexAttribPointer (locUv,  2, GL_FLOAT, GL_FALSE, 4 * sizeof (float), (void *)(2 * sizeof (float)));
+
+    glUniform1i (locSampler0, 0);
+    glUniform4f (locPrjMul, 2.0f / s_wndW, -2.0f / s_wndH, 0.0f, 0.0f);
+    glUniform4f (locPrjAdd, -1.0f, 1.0f, 1.0f, 1.0f);
+    glUniform4f (locTranslate, (float)x, (float)y, 0.0f, 0.0f);
+    glUniform4fv(locColFG, 1, col_fg);
+    glUniform4fv(locColBG, 1, col_bg);
+
+    glstate_disable (GL_DEPTH_TEST);
+    glstate_disable (GL_CULL_FACE );
+    glstate_active_texture (GL_TEXTURE0);
+    glstate_bind_texture   (GL_TEXTURE_2D, s_fontTexID);
+    GLASSERT();
+
+    glstate_enable (GL_BLEND);
+    glstate_blend_func_separate (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, 
+    	       GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    glDrawArrays (GL_TRIANGLES, 0, cache->vtx_num);
+
+    /* the state is left as it is: the next string sets the same */
     GLASSERT();
 
     return 0;
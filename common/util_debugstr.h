@@ -11,6 +11,8 @@ extern "C" {
 
 void init_dbgstr (int win_w, int win_h);
 void update_dbgstr_winsize (int win_w, int win_h);
+int  init_dbgstr_multiview (void);
+void set_dbgstr_multiview  (int enable);
 int  draw_dbgstr    (const char *str, int x, int y);
 int  draw_dbgstr_ex (const char *str, int x, int y, float scale, float *col_fg, float *col_bg);
 
@@ -0,0 +1,91 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <math.h>
+#include "util_log.h"
+#include "util_dynres.h"
+
+#define AVERAGE_WEIGHT      0.3f    /* weight of the latest frame in the moving average */
+
+
+DynamicResolution::DynamicResolution ()
+    : m_min_scale (DYNRES_MIN_SCALE),
+      m_max_scale (DYNRES_MAX_SCALE),
+      m_scale     (DYNRES_MAX_SCALE),
+      m_target_ms (1000.0f / 72.0f),
+      m_avg_ms    (0.0f),
+      m_over_cnt  (0),
+      m_under_cnt (0),
+      m_hold_cnt  (0)
+{
+}
+
+
+void
+DynamicResolution::set_range (float min_scale, float max_scale)
+{
+    m_min_scale = min_scale;
+    m_max_scale = max_scale;
+    change_scale (m_scale);
+}
+
+
+void
+DynamicResolution::change_scale (float scale)
+{
+    if (scale < m_min_scale) scale = m_min_scale;
+    if (scale > m_max_scale) scale = m_max_scale;
+
+    if (scale != m_scale)
+    {
+        LOGV ("render scale %.2f -> %.2f (GPU %.2f ms, target %.2f ms)", m_scale, scale, m_avg_ms, m_target_ms);
+        m_hold_cnt = DYNRES_HOLD_FRAMES;
+
+        /* the average was measured at the old scale */
+        m_avg_ms *= (scale * scale) / (m_scale * m_scale);
+    }
+
+    m_scale     = scale;
+    m_over_cnt  = 0;
+    m_under_cnt = 0;
+}
+
+
+float
+DynamicResolution::update (float gpu_ms)
+{
+    if (m_avg_ms <= 0.0f)
+        m_avg_ms = gpu_ms;
+    else
+        m_avg_ms += (gpu_ms - m_avg_ms) * AVERAGE_WEIGHT;
+
+    if (m_hold_cnt > 0)
+    {
+        m_hold_cnt --;
+    }
+    else if (m_avg_ms > m_target_ms * DYNRES_SHRINK_RATIO)
+    {
+        m_under_cnt = 0;
+        if (++ m_over_cnt >= DYNRES_SHRINK_FRAMES && m_scale > m_min_scale)
+        {
+            /* pixels ~ scale^2: aim at the middle of the hysteresis band */
+            float goal = m_target_ms * 0.5f * (DYNRES_SHRINK_RATIO + DYNRES_GROW_RATIO);
+            change_scale (m_scale * sqrtf (goal / m_avg_ms));
+        }
+    }
+    else if (m_avg_ms < m_target_ms * DYNRES_GROW_RATIO)
+    {
+        m_over_cnt = 0;
+        if (++ m_under_cnt >= DYNRES_GROW_FRAMES && m_scale < m_max_scale)
+            change_scale (m_scale + DYNRES_GROW_STEP);
+    }
+    else
+    {
+        m_over_cnt  = 0;
+        m_under_cnt = 0;
+    }
+
+    return m_scale;
+}
+
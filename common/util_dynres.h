@@ -0,0 +1,71 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef UTIL_DYNRES_H_
+#define UTIL_DYNRES_H_
+
+
+#define DYNRES_MIN_SCALE        0.6f    /* of the swapchain width/height */
+#define DYNRES_MAX_SCALE        1.0f
+#define DYNRES_GROW_STEP        0.02f   /* scale added per grow */
+
+#define DYNRES_SHRINK_RATIO     0.90f   /* shrink when the GPU time is above 90% of the target */
+#define DYNRES_GROW_RATIO       0.70f   /* grow when the GPU time is below 70% of the target */
+#define DYNRES_SHRINK_FRAMES    3       /* frames over the shrink threshold before a shrink */
+#define DYNRES_GROW_FRAMES      30      /* frames under the grow threshold before a grow */
+#define DYNRES_HOLD_FRAMES      10      /* frames after a change before the next one */
+
+#define DYNRES_ALIGN            8       /* imageRect extent is a multiple of this [pixel] */
+
+
+/*
+ *  Dynamic resolution controller.
+ *
+ *    update() takes the GPU time of a frame and returns the scale of the
+ *    imageRect to render into. The cost is taken as proportional to the
+ *    pixels, so a shrink jumps straight to the scale expected to meet the
+ *    target, while a grow creeps up by DYNRES_GROW_STEP. The gap between the
+ *    two thresholds and the hold time after a change give the hysteresis.
+ *
+ *    The scale is applied by setting viewsurface_t::render_scale (util_oxr.h)
+ *    before oxr_acquire_viewsurface().
+ */
+class DynamicResolution {
+public:
+    DynamicResolution ();
+
+    void    set_range  (float min_scale, float max_scale);
+    void    set_target (float target_ms)            { m_target_ms = target_ms; }
+    float   update     (float gpu_ms);
+
+    float   scale () const                          { return m_scale; }
+    float   average_ms () const                     { return m_avg_ms; }
+
+    /* (size) * (scale), rounded to DYNRES_ALIGN */
+    static int scaled_size (int size, float scale)
+    {
+        if (scale >= 1.0f)
+            return size;
+
+        int scaled = (int)(size * scale + 0.5f);
+        scaled = (scaled + DYNRES_ALIGN / 2) / DYNRES_ALIGN * DYNRES_ALIGN;
+        if (scaled > size)          scaled = size;
+        if (scaled < DYNRES_ALIGN)  scaled = DYNRES_ALIGN;
+        return scaled;
+    }
+
+private:
+    void    change_scale (float scale);
+
+    float   m_min_scale;
+    float   m_max_scale;
+    float   m_scale;
+    float   m_target_ms;
+    float   m_avg_ms;
+    int     m_over_cnt;
+    int     m_under_cnt;
+    int     m_hold_cnt;
+};
+
+#endif /* UTIL_DYNRES_H_ */
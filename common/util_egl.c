@@ -411,6 +411,40 @@ egl_terminate ()
     return 0;
 }
 
+/*
+ *  Move the context to another thread: release it on the current thread,
+ *  then make it current on the new one (e.g. a dedicated render thread).
+ */
+int
+egl_make_current ()
+{
+    EGLBoolean ret;
+
+    ret = eglMakeCurrent (s_dpy, s_sfc, s_sfc, s_ctx);
+    if (ret != EGL_TRUE)
+    {
+        fprintf (stderr, "ERR: %s(%d)\n", __FILE__, __LINE__);
+        return -1;
+    }
+
+    return 0;
+}
+
+int
+egl_release_current ()
+{
+    EGLBoolean ret;
+
+    ret = eglMakeCurrent (s_dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (ret != EGL_TRUE)
+    {
+        fprintf (stderr, "ERR: %s(%d)\n", __FILE__, __LINE__);
+        return -1;
+    }
+
+    return 0;
+}
+
 int
 egl_swap ()
 {
@@ -21,6 +21,8 @@ int egl_init_with_eglstream_surface       (int gles_version, int depth_size, int
 int egl_init_and_create_eglstream         (int *stream_fd);
 int egl_create_eglstream_surface          (int gles_version, int depth_size, int stencil_size, int sample_num, int win_w, int win_h);
 int egl_terminate ();
+int egl_make_current ();
+int egl_release_current ();
 int egl_swap ();
 int egl_set_swap_interval (int interval);
 
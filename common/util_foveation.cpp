@@ -0,0 +1,84 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include "util_log.h"
+#include "util_foveation.h"
+
+#define AVERAGE_WEIGHT      0.2f    /* weight of the latest frame in the moving average */
+
+
+FoveationController::FoveationController ()
+    : m_min_level (FOVEATION_LEVEL_NONE),
+      m_max_level (FOVEATION_LEVEL_HIGH),
+      m_level     (FOVEATION_LEVEL_NONE),
+      m_applied   (false),
+      m_target_ms (1000.0f / 72.0f),
+      m_avg_ms    (0.0f),
+      m_over_cnt  (0),
+      m_under_cnt (0),
+      m_hold_cnt  (0)
+{
+}
+
+
+void
+FoveationController::set_range (int min_level, int max_level)
+{
+    m_min_level = min_level;
+    m_max_level = max_level;
+
+    if (m_level < m_min_level) change_level (m_min_level);
+    if (m_level > m_max_level) change_level (m_max_level);
+}
+
+
+void
+FoveationController::change_level (int level)
+{
+    if (level != m_level)
+        LOGV ("foveation level %d -> %d (GPU %.2f ms, target %.2f ms)", m_level, level, m_avg_ms, m_target_ms);
+
+    m_level     = level;
+    m_applied   = false;
+    m_over_cnt  = 0;
+    m_under_cnt = 0;
+    m_hold_cnt  = FOVEATION_HOLD_FRAMES;
+}
+
+
+int
+FoveationController::update (float gpu_ms)
+{
+    if (m_avg_ms <= 0.0f)
+        m_avg_ms = gpu_ms;
+    else
+        m_avg_ms += (gpu_ms - m_avg_ms) * AVERAGE_WEIGHT;
+
+    if (m_hold_cnt > 0)
+    {
+        m_hold_cnt --;
+    }
+    else if (m_avg_ms > m_target_ms * FOVEATION_RAISE_RATIO)
+    {
+        m_under_cnt = 0;
+        if (++ m_over_cnt >= FOVEATION_RAISE_FRAMES && m_level < m_max_level)
+            change_level (m_level + 1);
+    }
+    else if (m_avg_ms < m_target_ms * FOVEATION_LOWER_RATIO)
+    {
+        m_over_cnt = 0;
+        if (++ m_under_cnt >= FOVEATION_LOWER_FRAMES && m_level > m_min_level)
+            change_level (m_level - 1);
+    }
+    else
+    {
+        m_over_cnt  = 0;
+        m_under_cnt = 0;
+    }
+
+    if (!m_applied && m_apply)
+        m_applied = m_apply (m_level);
+
+    return m_level;
+}
@@ -0,0 +1,67 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef UTIL_FOVEATION_H_
+#define UTIL_FOVEATION_H_
+
+#include <functional>
+
+
+/* same values as XrFoveationLevelFB */
+#define FOVEATION_LEVEL_NONE        0
+#define FOVEATION_LEVEL_LOW         1
+#define FOVEATION_LEVEL_MEDIUM      2
+#define FOVEATION_LEVEL_HIGH        3
+
+#define FOVEATION_RAISE_RATIO       0.95f   /* raise when the GPU time is above 95% of the target */
+#define FOVEATION_LOWER_RATIO       0.75f   /* lower when the GPU time is below 75% of the target */
+#define FOVEATION_RAISE_FRAMES      5       /* frames over the raise threshold before a raise */
+#define FOVEATION_LOWER_FRAMES      90      /* frames under the lower threshold before a lower */
+#define FOVEATION_HOLD_FRAMES       30      /* frames after a change before the next one */
+
+
+/*
+ *  Foveation level controller.
+ *
+ *    update() takes the GPU time of a frame, and raises the level quickly
+ *    when it nears the target, but lowers it only after a long run of cheap
+ *    frames. The band between the two thresholds and the hold time after
+ *    every change keep the level from oscillating.
+ *
+ *    The level is applied through (apply), e.g. oxr_set_foveation() of
+ *    util_oxr.h. It is not called again until the level changes, or when it
+ *    returns false (the level is retried on the next update).
+ *
+ *    With set_range(L, L) the level is fixed to L.
+ */
+class FoveationController {
+public:
+    typedef std::function<bool (int level)> apply_func_t;
+
+    FoveationController ();
+
+    void    set_apply_func (apply_func_t apply)     { m_apply = apply; }
+    void    set_range  (int min_level, int max_level);
+    void    set_target (float target_ms)            { m_target_ms = target_ms; }
+    int     update     (float gpu_ms);
+
+    int     level () const                          { return m_level; }
+    float   average_ms () const                     { return m_avg_ms; }
+
+private:
+    void    change_level (int level);
+
+    apply_func_t    m_apply;
+    int             m_min_level;
+    int             m_max_level;
+    int             m_level;
+    bool            m_applied;
+    float           m_target_ms;
+    float           m_avg_ms;
+    int             m_over_cnt;
+    int             m_under_cnt;
+    int             m_hold_cnt;
+};
+
+#endif /* UTIL_FOVEATION_H_ */
@@ -0,0 +1,154 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef UTIL_FRAME_PIPELINE_H_
+#define UTIL_FRAME_PIPELINE_H_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+
+/*
+ *  Pipelined frame loop.
+ *
+ *    The main thread runs xrWaitFrame, input and simulation of frame N+1,
+ *    and hands a snapshot (T) of everything needed to draw it to push().
+ *    The render thread owns the GL context, and renders frame N from the
+ *    previous snapshot (xrBeginFrame, GL submission, xrEndFrame).
+ *
+ *    The hand-off queue holds at most (depth) snapshots. push() blocks when
+ *    it is full, so the main thread never runs more than (depth) frames
+ *    ahead of the render thread.
+ *
+ *    T is copied into preallocated slots. Keep it free of heap allocations
+ *    (fixed size arrays instead of std::vector) to avoid per-frame mallocs.
+ */
+template <typename T>
+class FramePipeline {
+public:
+    typedef std::function<void (T &frame)> render_func_t;
+    typedef std::function<void (void)>     thread_func_t;
+
+    explicit FramePipeline (size_t depth = 1)
+        : m_slots (depth > 0 ? depth : 1)
+    {
+    }
+
+    ~FramePipeline ()
+    {
+        stop ();
+    }
+
+    /*
+     *  (on_begin) runs first on the render thread (e.g. egl_make_current),
+     *  (on_end) runs last on it (e.g. egl_release_current).
+     */
+    void start (render_func_t render, thread_func_t on_begin = nullptr, thread_func_t on_end = nullptr)
+    {
+        if (m_thread.joinable ())
+            return;
+
+        m_render  = render;
+        m_stop    = false;
+        m_thread  = std::thread ([this, on_begin, on_end] {
+            if (on_begin)
+                on_begin ();
+            thread_main ();
+            if (on_end)
+                on_end ();
+        });
+    }
+
+    /* render the remaining frames, then terminate the render thread. */
+    void stop ()
+    {
+        if (!m_thread.joinable ())
+            return;
+
+        {
+            std::unique_lock<std::mutex> lock (m_mutex);
+            m_stop = true;
+        }
+        m_cond.notify_all ();
+        m_thread.join ();
+    }
+
+    bool is_running () const
+    {
+        return m_thread.joinable ();
+    }
+
+    /* returns false when the pipeline is stopped and (frame) is dropped. */
+    bool push (const T &frame)
+    {
+        std::unique_lock<std::mutex> lock (m_mutex);
+        m_cond.wait (lock, [this] { return m_count < m_slots.size () || m_stop; });
+        if (m_stop)
+            return false;
+
+        m_slots[(m_head + m_count) % m_slots.size ()] = frame;
+        m_count ++;
+
+        lock.unlock ();
+        m_cond.notify_all ();
+        return true;
+    }
+
+    /*
+     *  wait until every pushed frame has been rendered.
+     *  Call it before operations that must not overlap with a frame in flight
+     *  (e.g. xrEndSession).
+     */
+    void drain ()
+    {
+        std::unique_lock<std::mutex> lock (m_mutex);
+        m_cond.wait (lock, [this] { return (m_count == 0 && !m_busy) || !m_thread.joinable (); });
+    }
+
+private:
+    void thread_main ()
+    {
+        T frame;
+
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock (m_mutex);
+                m_cond.wait (lock, [this] { return m_count > 0 || m_stop; });
+                if (m_count == 0)
+                    break;      /* stopped and nothing left */
+
+                frame   = m_slots[m_head];
+                m_head  = (m_head + 1) % m_slots.size ();
+                m_count --;
+                m_busy  = true;
+            }
+            m_cond.notify_all ();
+
+            m_render (frame);
+
+            {
+                std::unique_lock<std::mutex> lock (m_mutex);
+                m_busy = false;
+            }
+            m_cond.notify_all ();
+        }
+    }
+
+    std::vector<T>          m_slots;
+    size_t                  m_head  = 0;
+    size_t                  m_count = 0;
+    bool                    m_busy  = false;
+    bool                    m_stop  = false;
+
+    render_func_t           m_render;
+    std::thread             m_thread;
+    std::mutex              m_mutex;
+    std::condition_variable m_cond;
+};
+
+#endif /* UTIL_FRAME_PIPELINE_H_ */
@@ -0,0 +1,654 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdio.h>
+#include <string.h>
+#include <GLES3/gl3.h>
+#include <GLES2/gl2ext.h>
+#include "util_log.h"
+#include "util_gl_state.h"
+
+#define UNKNOWN     0xFFFFFFFFu     /* shadow of a GLenum/GLuint state not known */
+#define CAP_UNKNOWN (-1)
+
+static const GLenum s_cap_list[] =
+{
+    GL_DEPTH_TEST,
+    GL_CULL_FACE,
+    GL_BLEND,
+    GL_SCISSOR_TEST,
+    GL_STENCIL_TEST,
+    GL_POLYGON_OFFSET_FILL,
+    GL_SAMPLE_ALPHA_TO_COVERAGE,
+    GL_DITHER,
+    GL_PRIMITIVE_RESTART_FIXED_INDEX,
+    GL_RASTERIZER_DISCARD,
+};
+#define CAP_NUM     (int)(sizeof (s_cap_list) / sizeof (s_cap_list[0]))
+
+static const GLenum s_textarget_list[] =
+{
+    GL_TEXTURE_2D,
+    GL_TEXTURE_2D_ARRAY,
+    GL_TEXTURE_CUBE_MAP,
+    GL_TEXTURE_EXTERNAL_OES,
+};
+static const GLenum s_texbinding_list[] =
+{
+    GL_TEXTURE_BINDING_2D,
+    GL_TEXTURE_BINDING_2D_ARRAY,
+    GL_TEXTURE_BINDING_CUBE_MAP,
+    0,                              /* GL_TEXTURE_BINDING_EXTERNAL_OES: not validated */
+};
+#define TEXTARGET_NUM   (int)(sizeof (s_textarget_list) / sizeof (s_textarget_list[0]))
+
+typedef struct glstate_t
+{
+    int     cap[CAP_NUM];                   /* CAP_UNKNOWN, 0, 1 */
+    GLenum  front_face;
+    GLenum  cull_face;
+    GLuint  depth_mask;
+    GLenum  depth_func;
+    GLenum  blend_func[4];
+    GLuint  program;
+    GLuint  array_buffer;
+    GLuint  vertex_array;
+    GLuint  element_buffer;                 /* of the default VAO */
+    int     attrib[GLSTATE_MAX_ATTRIB];     /* of the default VAO. CAP_UNKNOWN, 0, 1 */
+    GLenum  active_texture;
+    GLuint  texture[GLSTATE_MAX_TEXUNIT][TEXTARGET_NUM];
+} glstate_t;
+
+static glstate_t        s_state;
+static int              s_state_valid;      /* s_state is initialized (as unknown) */
+static glstate_stats_t  s_stats;
+static int              s_validate;
+
+
+void
+glstate_invalidate (void)
+{
+    memset (&s_state, 0xFF, sizeof (s_state));     /* UNKNOWN and CAP_UNKNOWN */
+    s_state_valid = 1;
+}
+
+static glstate_t *
+get_state (void)
+{
+    if (!s_state_valid)
+        glstate_invalidate ();
+    return &s_state;
+}
+
+
+/* ---------------------------------------------------------------- *
+ *  validation against glGet
+ * ---------------------------------------------------------------- */
+static GLuint
+get_integer (GLenum pname)
+{
+    GLint val = 0;
+    glGetIntegerv (pname, &val);
+    return (GLuint)val;
+}
+
+/* a stale shadow is reported, and set to unknown so that the call is issued */
+static int
+check_uint (GLuint *shadow, GLuint actual, const char *name)
+{
+    if (*shadow == UNKNOWN || *shadow == actual)
+        return 0;
+
+    LOGE ("glstate: %s is 0x%x, but the shadow is 0x%x.\n", name, actual, *shadow);
+    s_stats.mismatch ++;
+    *shadow = UNKNOWN;
+    return 1;
+}
+
+static int
+check_cap (int *shadow, int actual, const char *name)
+{
+    if (*shadow == CAP_UNKNOWN || *shadow == actual)
+        return 0;
+
+    LOGE ("glstate: %s is %s, but the shadow is %s.\n", name,
+          actual ? "enabled" : "disabled", *shadow ? "enabled" : "disabled");
+    s_stats.mismatch ++;
+    *shadow = CAP_UNKNOWN;
+    return 1;
+}
+
+static int
+find_cap (GLenum cap)
+{
+    for (int i = 0; i < CAP_NUM; i ++)
+    {
+        if (s_cap_list[i] == cap)
+            return i;
+    }
+    return -1;
+}
+
+static int
+find_textarget (GLenum target)
+{
+    for (int i = 0; i < TEXTARGET_NUM; i ++)
+    {
+        if (s_textarget_list[i] == target)
+            return i;
+    }
+    return -1;
+}
+
+static int
+validate_cap (int idx)
+{
+    char name[32];
+    snprintf (name, sizeof (name), "cap(0x%x)", s_cap_list[idx]);
+    return check_cap (&s_state.cap[idx], glIsEnabled (s_cap_list[idx]) ? 1 : 0, name);
+}
+
+static int
+validate_blend_func (void)
+{
+    static const GLenum pname[4] = {GL_BLEND_SRC_RGB, GL_BLEND_DST_RGB, GL_BLEND_SRC_ALPHA, GL_BLEND_DST_ALPHA};
+    int ret = 0;
+
+    for (int i = 0; i < 4; i ++)
+        ret += check_uint (&s_state.blend_func[i], get_integer (pname[i]), "GL_BLEND_FUNC");
+
+    /* the four factors are set at once */
+    if (ret)
+        memset (s_state.blend_func, 0xFF, sizeof (s_state.blend_func));
+    return ret;
+}
+
+static int
+validate_buffer (GLenum target)
+{
+    if (target == GL_ARRAY_BUFFER)
+        return check_uint (&s_state.array_buffer, get_integer (GL_ARRAY_BUFFER_BINDING), "GL_ARRAY_BUFFER_BINDING");
+    else
+        return check_uint (&s_state.element_buffer, get_integer (GL_ELEMENT_ARRAY_BUFFER_BINDING), "GL_ELEMENT_ARRAY_BUFFER_BINDING");
+}
+
+static int
+validate_attrib (GLuint index)
+{
+    GLint enabled = 0;
+    char  name[48];
+
+    glGetVertexAttribiv (index, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled);
+    snprintf (name, sizeof (name), "GL_VERTEX_ATTRIB_ARRAY_ENABLED(%d)", index);
+    return check_cap (&s_state.attrib[index], enabled ? 1 : 0, name);
+}
+
+/* bindings of the active texture unit only */
+static int
+validate_texture (int unit, int target_idx)
+{
+    if (s_texbinding_list[target_idx] == 0)
+        return 0;
+
+    return check_uint (&s_state.texture[unit][target_idx],
+                       get_integer (s_texbinding_list[target_idx]), "GL_TEXTURE_BINDING");
+}
+
+
+/* ---------------------------------------------------------------- *
+ *  state calls
+ * ---------------------------------------------------------------- */
+static void
+set_cap (GLenum cap, int enable)
+{
+    glstate_t *st = get_state ();
+    int idx = find_cap (cap);
+
+    if (idx >= 0)
+    {
+        if (s_validate)
+            validate_cap (idx);
+
+        if (st->cap[idx] == enable)
+        {
+            s_stats.elided ++;
+            return;
+        }
+        st->cap[idx] = enable;
+    }
+
+    if (enable)
+        glEnable (cap);
+    else
+        glDisable (cap);
+    s_stats.issued ++;
+}
+
+void
+glstate_enable (GLenum cap)
+{
+    set_cap (cap, 1);
+}
+
+void
+glstate_disable (GLenum cap)
+{
+    set_cap (cap, 0);
+}
+
+
+void
+glstate_front_face (GLenum mode)
+{
+    glstate_t *st = get_state ();
+
+    if (s_validate)
+        check_uint (&st->front_face, get_integer (GL_FRONT_FACE), "GL_FRONT_FACE");
+
+    if (st->front_face == mode)
+    {
+        s_stats.elided ++;
+        return;
+    }
+    st->front_face = mode;
+    glFrontFace (mode);
+    s_stats.issued ++;
+}
+
+
+void
+glstate_cull_face (GLenum mode)
+{
+    glstate_t *st = get_state ();
+
+    if (s_validate)
+        check_uint (&st->cull_face, get_integer (GL_CULL_FACE_MODE), "GL_CULL_FACE_MODE");
+
+    if (st->cull_face == mode)
+    {
+        s_stats.elided ++;
+        return;
+    }
+    st->cull_face = mode;
+    glCullFace (mode);
+    s_stats.issued ++;
+}
+
+
+void
+glstate_depth_mask (GLboolean flag)
+{
+    glstate_t *st = get_state ();
+    GLuint val = flag ? 1 : 0;
+
+    if (s_validate)
+    {
+        GLboolean actual = GL_FALSE;
+        glGetBooleanv (GL_DEPTH_WRITEMASK, &actual);
+        check_uint (&st->depth_mask, actual ? 1 : 0, "GL_DEPTH_WRITEMASK");
+    }
+
+    if (st->depth_mask == val)
+    {
+        s_stats.elided ++;
+        return;
+    }
+    st->depth_mask = val;
+    glDepthMask (flag);
+    s_stats.issued ++;
+}
+
+
+void
+glstate_depth_func (GLenum func)
+{
+    glstate_t *st = get_state ();
+
+    if (s_validate)
+        check_uint (&st->depth_func, get_integer (GL_DEPTH_FUNC), "GL_DEPTH_FUNC");
+
+    if (st->depth_func == func)
+    {
+        s_stats.elided ++;
+        return;
+    }
+    st->depth_func = func;
+    glDepthFunc (func);
+    s_stats.issued ++;
+}
+
+
+void
+glstate_blend_func_separate (GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha)
+{
+    glstate_t *st = get_state ();
+
+    if (s_validate)
+        validate_blend_func ();
+
+    if (st->blend_func[0] == src_rgb   && st->blend_func[1] == dst_rgb &&
+        st->blend_func[2] == src_alpha && st->blend_func[3] == dst_alpha)
+    {
+        s_stats.elided ++;
+        return;
+    }
+    st->blend_func[0] = src_rgb;
+    st->blend_func[1] = dst_rgb;
+    st->blend_func[2] = src_alpha;
+    st->blend_func[3] = dst_alpha;
+    glBlendFuncSeparate (src_rgb, dst_rgb, src_alpha, dst_alpha);
+    s_stats.issued ++;
+}
+
+void
+glstate_blend_func (GLenum sfactor, GLenum dfactor)
+{
+    glstate_blend_func_separate (sfactor, dfactor, sfactor, dfactor);
+}
+
+
+void
+glstate_use_program (GLuint program)
+{
+    glstate_t *st = get_state ();
+
+    if (s_validate)
+        check_uint (&st->program, get_integer (GL_CURRENT_PROGRAM), "GL_CURRENT_PROGRAM");
+
+    if (st->program == program)
+    {
+        s_stats.elided ++;
+        return;
+    }
+    st->program = program;
+    glUseProgram (program);
+    s_stats.issued ++;
+}
+
+
+void
+glstate_bind_buffer (GLenum target, GLuint buffer)
+{
+    glstate_t *st = get_state ();
+    GLuint *shadow = NULL;
+
+    if (target == GL_ARRAY_BUFFER)
+        shadow = &st->array_buffer;
+    else if (target == GL_ELEMENT_ARRAY_BUFFER && st->vertex_array == 0)
+        shadow = &st->element_buffer;
+    else if (target == GL_ELEMENT_ARRAY_BUFFER && st->vertex_array == UNKNOWN)
+        st->element_buffer = UNKNOWN;       /* the default VAO may be bound */
+
+    if (shadow)
+    {
+        if (s_validate)
+            validate_buffer (target);
+
+        if (*shadow == buffer)
+        {
+            s_stats.elided ++;
+            return;
+        }
+        *shadow = buffer;
+    }
+
+    glBindBuffer (target, buffer);
+    s_stats.issued ++;
+}
+
+
+/*
+ *  the element array buffer and the attribute arrays are the state of the
+ *  VAO. they are shadowed for the default VAO only, and pass through while
+ *  another VAO is bound.
+ */
+void
+glstate_bind_vertex_array (GLuint array)
+{
+    glstate_t *st = get_state ();
+
+    if (s_validate)
+        check_uint (&st->vertex_array, get_integer (GL_VERTEX_ARRAY_BINDING), "GL_VERTEX_ARRAY_BINDING");
+
+    if (st->vertex_array == array)
+    {
+        s_stats.elided ++;
+        return;
+    }
+    st->vertex_array = array;
+    glBindVertexArray (array);
+    s_stats.issued ++;
+}
+
+
+static void
+set_attrib (GLuint index, int enable)
+{
+    glstate_t *st = get_state ();
+
+    if (index < GLSTATE_MAX_ATTRIB && st->vertex_array == 0)
+    {
+        if (s_validate)
+            validate_attrib (index);
+
+        if (st->attrib[index] == enable)
+        {
+            s_stats.elided ++;
+            return;
+        }
+        st->attrib[index] = enable;
+    }
+    else if (index < GLSTATE_MAX_ATTRIB && st->vertex_array == UNKNOWN)
+    {
+        st->attrib[index] = CAP_UNKNOWN;    /* the default VAO may be bound */
+    }
+
+    if (enable)
+        glEnableVertexAttribArray (index);
+    else
+        glDisableVertexAttribArray (index);
+    s_stats.issued ++;
+}
+
+void
+glstate_enable_vertex_attrib_array (GLuint index)
+{
+    set_attrib (index, 1);
+}
+
+void
+glstate_disable_vertex_attrib_array (GLuint index)
+{
+    set_attrib (index, 0);
+}
+
+
+void
+glstate_active_texture (GLenum texture)
+{
+    glstate_t *st = get_state ();
+
+    if (s_validate)
+        check_uint (&st->active_texture, get_integer (GL_ACTIVE_TEXTURE), "GL_ACTIVE_TEXTURE");
+
+    if (st->active_texture == texture)
+    {
+        s_stats.elided ++;
+        return;
+    }
+    st->active_texture = texture;
+    glActiveTexture (texture);
+    s_stats.issued ++;
+}
+
+
+void
+glstate_bind_texture (GLenum target, GLuint texture)
+{
+    glstate_t *st = get_state ();
+    int unit = (st->active_texture == UNKNOWN) ? -1 : (int)(st->active_texture - GL_TEXTURE0);
+    int tidx = find_textarget (target);
+
+    if (unit >= 0 && unit < GLSTATE_MAX_TEXUNIT && tidx >= 0)
+    {
+        if (s_validate)
+            validate_texture (unit, tidx);
+
+        if (st->texture[unit][tidx] == texture)
+        {
+            s_stats.elided ++;
+            return;
+        }
+        st->texture[unit][tidx] = texture;
+    }
+    else if (unit < 0 && tidx >= 0)
+    {
+        /* the unit is unknown: the binding of any unit may change */
+        for (int i = 0; i < GLSTATE_MAX_TEXUNIT; i ++)
+            st->texture[i][tidx] = UNKNOWN;
+    }
+
+    glBindTexture (target, texture);
+    s_stats.issued ++;
+}
+
+
+/* ---------------------------------------------------------------- *
+ *  deletion: GL unbinds the deleted objects
+ * ---------------------------------------------------------------- */
+void
+glstate_delete_buffers (GLsizei n, const GLuint *buffers)
+{
+    glstate_t *st = get_state ();
+
+    for (int i = 0; i < n; i ++)
+    {
+        if (buffers[i] == 0)
+            continue;
+        if (st->array_buffer == buffers[i])
+            st->array_buffer = 0;
+
+        /*
+         *  unbound from the current VAO only. (element_buffer) is the binding
+         *  of the default VAO: with another VAO bound, the deleted buffer stays
+         *  attached to it, and its name may be reused by the next glGenBuffers().
+         */
+        if (st->element_buffer == buffers[i])
+        {
+            if (st->vertex_array == 0)
+                st->element_buffer = 0;
+            else
+                st->element_buffer = UNKNOWN;
+        }
+    }
+    glDeleteBuffers (n, buffers);
+}
+
+
+/* the default VAO is bound when the current one is deleted */
+void
+glstate_delete_vertex_arrays (GLsizei n, const GLuint *arrays)
+{
+    glstate_t *st = get_state ();
+
+    for (int i = 0; i < n; i ++)
+    {
+        if (arrays[i] != 0 && st->vertex_array == arrays[i])
+            st->vertex_array = 0;
+    }
+    glDeleteVertexArrays (n, arrays);
+}
+
+
+/* a texture is unbound from every unit, and the shadow of the units is kept */
+void
+glstate_delete_textures (GLsizei n, const GLuint *textures)
+{
+    glstate_t *st = get_state ();
+
+    for (int i = 0; i < n; i ++)
+    {
+        if (textures[i] == 0)
+            continue;
+
+        for (int unit = 0; unit < GLSTATE_MAX_TEXUNIT; unit ++)
+        {
+            for (int t = 0; t < TEXTARGET_NUM; t ++)
+            {
+                if (st->texture[unit][t] == textures[i])
+                    st->texture[unit][t] = 0;
+            }
+        }
+    }
+    glDeleteTextures (n, textures);
+}
+
+
+/* ---------------------------------------------------------------- *
+ *  statistics, debug
+ * ---------------------------------------------------------------- */
+void
+glstate_get_stats (glstate_stats_t *stats)
+{
+    *stats = s_stats;
+}
+
+void
+glstate_reset_stats (void)
+{
+    memset (&s_stats, 0, sizeof (s_stats));
+}
+
+void
+glstate_set_validate (int validate)
+{
+    s_validate = validate;
+}
+
+
+/*
+ *  compare every known state with glGet. the stale ones are logged and
+ *  forgotten. returns the number of them.
+ */
+int
+glstate_validate (void)
+{
+    glstate_t *st = get_state ();
+    int ret = 0;
+
+    for (int i = 0; i < CAP_NUM; i ++)
+        ret += validate_cap (i);
+
+    ret += check_uint (&st->front_face, get_integer (GL_FRONT_FACE),      "GL_FRONT_FACE");
+    ret += check_uint (&st->cull_face,  get_integer (GL_CULL_FACE_MODE),  "GL_CULL_FACE_MODE");
+    ret += check_uint (&st->depth_func, get_integer (GL_DEPTH_FUNC),      "GL_DEPTH_FUNC");
+    ret += check_uint (&st->program,    get_integer (GL_CURRENT_PROGRAM), "GL_CURRENT_PROGRAM");
+    ret += validate_blend_func ();
+    ret += validate_buffer (GL_ARRAY_BUFFER);
+    ret += check_uint (&st->vertex_array, get_integer (GL_VERTEX_ARRAY_BINDING), "GL_VERTEX_ARRAY_BINDING");
+    if (st->vertex_array == 0)
+        ret += validate_buffer (GL_ELEMENT_ARRAY_BUFFER);
+
+    {
+        GLboolean mask = GL_FALSE;
+        glGetBooleanv (GL_DEPTH_WRITEMASK, &mask);
+        ret += check_uint (&st->depth_mask, mask ? 1 : 0, "GL_DEPTH_WRITEMASK");
+    }
+
+    for (int i = 0; i < GLSTATE_MAX_ATTRIB && st->vertex_array == 0; i ++)
+        ret += validate_attrib (i);
+
+    ret += check_uint (&st->active_texture, get_integer (GL_ACTIVE_TEXTURE), "GL_ACTIVE_TEXTURE");
+    if (st->active_texture != UNKNOWN)
+    {
+        int unit = (int)(st->active_texture - GL_TEXTURE0);
+        if (unit >= 0 && unit < GLSTATE_MAX_TEXUNIT)
+        {
+            for (int t = 0; t < TEXTARGET_NUM; t ++)
+                ret += validate_texture (unit, t);
+        }
+    }
+
+    return ret;
+}
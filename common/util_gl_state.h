@@ -0,0 +1,82 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef UTIL_GL_STATE_H_
+#define UTIL_GL_STATE_H_
+
+#include <stdint.h>
+#include <GLES3/gl3.h>
+
+#define GLSTATE_MAX_ATTRIB      16      /* GL_MAX_VERTEX_ATTRIBS of ES 3.0 at least */
+#define GLSTATE_MAX_TEXUNIT     8
+
+typedef struct glstate_stats_t
+{
+    uint64_t    issued;         /* state calls passed to GL */
+    uint64_t    elided;         /* state calls skipped: no change */
+    uint64_t    mismatch;       /* shadow found stale by the validation */
+} glstate_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ *  GL state cache.
+ *
+ *    Shadows the state below, and skips the calls that do not change it:
+ *      glEnable/glDisable (DEPTH_TEST, CULL_FACE, BLEND, SCISSOR_TEST, ...),
+ *      glFrontFace, glCullFace, glDepthMask, glDepthFunc, glBlendFuncSeparate,
+ *      glUseProgram, glBindBuffer (ARRAY, ELEMENT_ARRAY), glBindVertexArray,
+ *      glActiveTexture, glBindTexture (2D, 2D_ARRAY, CUBE_MAP, EXTERNAL_OES),
+ *      glEnable/DisableVertexAttribArray.
+ *
+ *    All the code sharing the GL context must set this state through the
+ *    cache. The state starts unknown, so the first call of each is issued.
+ *    Call glstate_invalidate() after code that changes it behind the cache.
+ *    The element array buffer and the attribute arrays are the state of the
+ *    bound VAO. They are shadowed for the default VAO only: code drawing
+ *    from the default VAO binds it with glstate_bind_vertex_array(0) first.
+ *
+ *    Buffers, textures and VAOs are deleted through glstate_delete_*(), as
+ *    GL unbinds them and may give the name to a new object.
+ *
+ *    With glstate_set_validate(1), every call compares the shadow with
+ *    glGet*() first, and logs the state found stale (slow: debug only).
+ */
+void glstate_invalidate (void);
+
+void glstate_enable  (GLenum cap);
+void glstate_disable (GLenum cap);
+void glstate_front_face (GLenum mode);
+void glstate_cull_face  (GLenum mode);
+void glstate_depth_mask (GLboolean flag);
+void glstate_depth_func (GLenum func);
+void glstate_blend_func (GLenum sfactor, GLenum dfactor);
+void glstate_blend_func_separate (GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha);
+
+void glstate_use_program (GLuint program);
+void glstate_bind_buffer (GLenum target, GLuint buffer);
+void glstate_bind_vertex_array (GLuint array);
+void glstate_enable_vertex_attrib_array  (GLuint index);
+void glstate_disable_vertex_attrib_array (GLuint index);
+void glstate_active_texture (GLenum texture);
+void glstate_bind_texture (GLenum target, GLuint texture);
+
+void glstate_delete_buffers  (GLsizei n, const GLuint *buffers);
+void glstate_delete_textures (GLsizei n, const GLuint *textures);
+void glstate_delete_vertex_arrays (GLsizei n, const GLuint *arrays);
+
+/* statistics */
+void glstate_get_stats (glstate_stats_t *stats);
+void glstate_reset_stats (void);
+
+/* debug: (validate) every call against glGet. glstate_validate() checks all at once */
+void glstate_set_validate (int validate);
+int  glstate_validate (void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* UTIL_GL_STATE_H_ */
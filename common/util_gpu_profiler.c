@@ -0,0 +1,430 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+#include <GLES3/gl3.h>
+#include "assertgl.h"
+#include "util_egl.h"
+#include "util_log.h"
+#include "util_debugstr.h"
+#include "util_gpu_profiler.h"
+
+#define FRAME_RING      (GPU_PROF_FRAME_LATENCY + 1)
+
+/*
+ *  a pass issued in a frame. it uses a pair of query objects:
+ *    timestamps at begin and end, or a TIME_ELAPSED query in [0].
+ */
+typedef struct gpu_record_t
+{
+    short   pass;
+    short   measured;           /* 0: nested pass skipped without timestamps */
+} gpu_record_t;
+
+typedef struct gpu_frame_t
+{
+    GLuint          query[GPU_PROF_MAX_RECORD * 2];
+    gpu_record_t    record[GPU_PROF_MAX_RECORD];
+    int             record_num;
+    GLuint          last_query;         /* issued last, so finished last */
+} gpu_frame_t;
+
+typedef struct gpu_pass_t
+{
+    char    name[GPU_PROF_NAME_LEN];
+    int     depth;
+    float   history[GPU_PROF_HISTORY];  /* ring of the per-frame GPU time [ms] */
+    int     hist_num;
+    int     hist_pos;
+    float   last_ms;
+} gpu_pass_t;
+
+static PFNGLQUERYCOUNTEREXTPROC         s_glQueryCounterEXT;
+static PFNGLGETQUERYOBJECTUI64VEXTPROC  s_glGetQueryObjectui64vEXT;
+
+static int          s_enabled;
+static int          s_use_timestamp;
+static gpu_frame_t  s_frame[FRAME_RING];
+static int          s_frame_idx;
+static int          s_frame_num;
+static gpu_pass_t   s_pass[GPU_PROF_MAX_PASS];
+static int          s_pass_num;
+static int          s_stack[GPU_PROF_MAX_DEPTH];    /* record index of the open passes */
+static int          s_stack_depth;
+static int          s_overflow_depth;                /* passes opened beyond GPU_PROF_MAX_DEPTH */
+static float        s_frame_ms;
+static int          s_dropped_frames;
+
+
+int
+init_gpu_profiler (void)
+{
+    if (s_enabled)
+        return 0;
+
+    const char *ext = (const char *)glGetString (GL_EXTENSIONS);
+    if (ext == NULL || strstr (ext, "GL_EXT_disjoint_timer_query") == NULL)
+    {
+        LOGI ("GPU profiler: GL_EXT_disjoint_timer_query is not supported.\n");
+        return -1;
+    }
+
+    s_glQueryCounterEXT = (PFNGLQUERYCOUNTEREXTPROC)
+        eglGetProcAddress ("glQueryCounterEXT");
+    s_glGetQueryObjectui64vEXT = (PFNGLGETQUERYOBJECTUI64VEXTPROC)
+        eglGetProcAddress ("glGetQueryObjectui64vEXT");
+    if (s_glGetQueryObjectui64vEXT == NULL)
+        return -1;
+
+    GLint bits = 0;
+    if (s_glQueryCounterEXT)
+        glGetQueryiv (GL_TIMESTAMP_EXT, GL_QUERY_COUNTER_BITS_EXT, &bits);
+    s_use_timestamp = (bits > 0);
+    glGetError ();  /* GL_TIMESTAMP_EXT may be rejected by glGetQueryiv */
+
+    for (int i = 0; i < FRAME_RING; i ++)
+    {
+        glGenQueries (GPU_PROF_MAX_RECORD * 2, s_frame[i].query);
+        s_frame[i].record_num = 0;
+    }
+
+    s_frame_idx   = 0;
+    s_frame_num   = 0;
+    s_pass_num    = 0;
+    s_stack_depth = 0;
+    s_frame_ms    = 0.0f;
+    s_enabled     = 1;
+
+    LOGI ("GPU profiler: %s queries, results after %d frames.\n",
+          s_use_timestamp ? "GL_TIMESTAMP_EXT" : "GL_TIME_ELAPSED_EXT", GPU_PROF_FRAME_LATENCY);
+
+    GLASSERT();
+    return 0;
+}
+
+
+void
+destroy_gpu_profiler (void)
+{
+    if (!s_enabled)
+        return;
+
+    for (int i = 0; i < FRAME_RING; i ++)
+        glDeleteQueries (GPU_PROF_MAX_RECORD * 2, s_frame[i].query);
+
+    s_enabled = 0;
+}
+
+
+int
+is_gpu_profiler_enabled (void)
+{
+    return s_enabled;
+}
+
+
+static int
+find_or_add_pass (const char *name)
+{
+    for (int i = 0; i < s_pass_num; i ++)
+    {
+        if (strcmp (s_pass[i].name, name) == 0)
+            return i;
+    }
+
+    if (s_pass_num >= GPU_PROF_MAX_PASS)
+        return -1;
+
+    gpu_pass_t *pass = &s_pass[s_pass_num];
+    memset (pass, 0, sizeof (*pass));
+    strncpy (pass->name, name, GPU_PROF_NAME_LEN - 1);
+    pass->depth = s_stack_depth;
+
+    return s_pass_num ++;
+}
+
+
+/*
+ *  read back a frame issued FRAME_RING frames ago.
+ *  the frame is dropped if it is not finished yet, or the GPU was disjoint.
+ */
+static void
+resolve_frame (gpu_frame_t *frame)
+{
+    float pass_ms[GPU_PROF_MAX_PASS] = {0};
+    char  pass_hit[GPU_PROF_MAX_PASS] = {0};
+
+    if (frame->record_num == 0 || frame->last_query == 0)
+    {
+        frame->record_num = 0;
+        return;
+    }
+
+    GLuint available = 0;
+    glGetQueryObjectuiv (frame->last_query, GL_QUERY_RESULT_AVAILABLE, &available);
+
+    GLint disjoint = 0;
+    glGetIntegerv (GL_GPU_DISJOINT_EXT, &disjoint);
+
+    if (!available || disjoint)
+    {
+        s_dropped_frames ++;
+        frame->record_num = 0;
+        return;
+    }
+
+    for (int i = 0; i < frame->record_num; i ++)
+    {
+        gpu_record_t *rec = &frame->record[i];
+        GLuint64 t0 = 0, t1 = 0;
+
+        if (!rec->measured)
+            continue;
+
+        if (s_use_timestamp)
+        {
+            s_glGetQueryObjectui64vEXT (frame->query[i * 2 + 0], GL_QUERY_RESULT, &t0);
+            s_glGetQueryObjectui64vEXT (frame->query[i * 2 + 1], GL_QUERY_RESULT, &t1);
+        }
+        else
+        {
+            s_glGetQueryObjectui64vEXT (frame->query[i * 2 + 0], GL_QUERY_RESULT, &t1);
+        }
+
+        pass_ms[rec->pass] += (t1 - t0) / 1000000.0f;
+        pass_hit[rec->pass] = 1;
+    }
+    frame->record_num = 0;
+
+    float frame_ms = 0.0f;
+    for (int i = 0; i < s_pass_num; i ++)
+    {
+        if (!pass_hit[i])
+            continue;
+
+        gpu_pass_t *pass = &s_pass[i];
+        pass->last_ms = pass_ms[i];
+        pass->history[pass->hist_pos] = pass_ms[i];
+        pass->hist_pos = (pass->hist_pos + 1) % GPU_PROF_HISTORY;
+        if (pass->hist_num < GPU_PROF_HISTORY)
+            pass->hist_num ++;
+
+        if (pass->depth == 0)
+            frame_ms += pass_ms[i];
+    }
+    s_frame_ms = frame_ms;
+}
+
+
+void
+gpu_profiler_begin_frame (void)
+{
+    if (!s_enabled)
+        return;
+
+    s_frame_idx = s_frame_num % FRAME_RING;
+    resolve_frame (&s_frame[s_frame_idx]);
+    s_frame[s_frame_idx].last_query = 0;
+
+    s_stack_depth    = 0;
+    s_overflow_depth = 0;
+}
+
+
+void
+gpu_profiler_end_frame (void)
+{
+    if (!s_enabled)
+        return;
+
+    if (s_stack_depth != 0)
+    {
+        LOGW ("GPU profiler: %d passes are not ended.\n", s_stack_depth);
+        while (s_stack_depth > 0)
+            gpu_profiler_end_pass ();
+    }
+
+    s_frame_num ++;
+}
+
+
+void
+gpu_profiler_begin_pass (const char *name)
+{
+    if (!s_enabled)
+        return;
+
+    gpu_frame_t *frame = &s_frame[s_frame_idx];
+    int pass = find_or_add_pass (name);
+
+    if (s_stack_depth >= GPU_PROF_MAX_DEPTH)
+    {
+        s_overflow_depth ++;
+        return;
+    }
+
+    if (pass < 0 || frame->record_num >= GPU_PROF_MAX_RECORD)
+    {
+        s_stack[s_stack_depth ++] = -1;     /* not measured, but ended as usual */
+        return;
+    }
+
+    int idx = frame->record_num ++;
+    gpu_record_t *rec = &frame->record[idx];
+    rec->pass     = pass;
+    rec->measured = 1;
+
+    if (s_use_timestamp)
+    {
+        s_glQueryCounterEXT (frame->query[idx * 2 + 0], GL_TIMESTAMP_EXT);
+        frame->last_query = frame->query[idx * 2 + 0];
+    }
+    else if (s_stack_depth == 0)
+    {
+        glBeginQuery (GL_TIME_ELAPSED_EXT, frame->query[idx * 2 + 0]);
+        frame->last_query = frame->query[idx * 2 + 0];
+    }
+    else
+    {
+        rec->measured = 0;      /* TIME_ELAPSED queries do not nest */
+    }
+
+    s_stack[s_stack_depth ++] = idx;
+}
+
+
+void
+gpu_profiler_end_pass (void)
+{
+    if (!s_enabled)
+        return;
+
+    if (s_overflow_depth > 0)
+    {
+        s_overflow_depth --;
+        return;
+    }
+
+    if (s_stack_depth <= 0)
+        return;
+
+    int idx = s_stack[-- s_stack_depth];
+    if (idx < 0)
+        return;
+
+    gpu_frame_t *frame = &s_frame[s_frame_idx];
+    if (!frame->record[idx].measured)
+        return;
+
+    if (s_use_timestamp)
+    {
+        s_glQueryCounterEXT (frame->query[idx * 2 + 1], GL_TIMESTAMP_EXT);
+        frame->last_query = frame->query[idx * 2 + 1];
+    }
+    else
+    {
+        glEndQuery (GL_TIME_ELAPSED_EXT);
+    }
+}
+
+
+float
+gpu_profiler_get_frame_ms (void)
+{
+    return s_frame_ms;
+}
+
+
+int
+gpu_profiler_get_pass_num (void)
+{
+    return s_pass_num;
+}
+
+
+int
+gpu_profiler_find_pass (const char *name)
+{
+    for (int i = 0; i < s_pass_num; i ++)
+    {
+        if (strcmp (s_pass[i].name, name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+
+static int
+compare_float (const void *a, const void *b)
+{
+    float fa = *(const float *)a;
+    float fb = *(const float *)b;
+    return (fa > fb) - (fa < fb);
+}
+
+int
+gpu_profiler_get_stats (int pass_id, gpu_pass_stats_t *stats)
+{
+    if (pass_id < 0 || pass_id >= s_pass_num)
+        return -1;
+
+    gpu_pass_t *pass = &s_pass[pass_id];
+    int   num = pass->hist_num;
+    float sorted[GPU_PROF_HISTORY];
+
+    memset (stats, 0, sizeof (*stats));
+    stats->name    = pass->name;
+    stats->depth   = pass->depth;
+    stats->samples = num;
+    stats->last_ms = pass->last_ms;
+    if (num == 0)
+        return 0;
+
+    float sum = 0.0f;
+    for (int i = 0; i < num; i ++)
+    {
+        sorted[i] = pass->history[i];
+        sum += sorted[i];
+    }
+    qsort (sorted, num, sizeof (float), compare_float);
+
+    stats->avg_ms = sum / num;
+    stats->p50_ms = sorted[(num - 1) * 50 / 100];
+    stats->p90_ms = sorted[(num - 1) * 90 / 100];
+    stats->p99_ms = sorted[(num - 1) * 99 / 100];
+    stats->max_ms = sorted[num - 1];
+
+    return 0;
+}
+
+
+void
+draw_gpu_profiler (int x, int y)
+{
+    char strbuf[128];
+
+    if (!s_enabled)
+        return;
+
+    sprintf (strbuf, "GPU %6.2f ms (dropped frames: %d)", s_frame_ms, s_dropped_frames);
+    draw_dbgstr (strbuf, x, y); y += 22;
+
+    sprintf (strbuf, "%-16s %6s %6s %6s %6s", "[ms]", "avg", "p50", "p90", "p99");
+    draw_dbgstr (strbuf, x, y); y += 22;
+
+    for (int i = 0; i < s_pass_num; i ++)
+    {
+        gpu_pass_stats_t stats;
+        gpu_profiler_get_stats (i, &stats);
+
+        sprintf (strbuf, "%*s%-*s %6.2f %6.2f %6.2f %6.2f",
+                 stats.depth * 2, "", 16 - stats.depth * 2, stats.name,
+                 stats.avg_ms, stats.p50_ms, stats.p90_ms, stats.p99_ms);
+        draw_dbgstr (strbuf, x, y); y += 22;
+    }
+}
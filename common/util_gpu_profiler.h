@@ -0,0 +1,71 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef UTIL_GPU_PROFILER_H_
+#define UTIL_GPU_PROFILER_H_
+
+#define GPU_PROF_MAX_PASS       32      /* distinct pass names */
+#define GPU_PROF_MAX_RECORD     64      /* passes issued in a frame */
+#define GPU_PROF_MAX_DEPTH      8       /* nesting of passes */
+#define GPU_PROF_FRAME_LATENCY  3       /* frames until the results of a frame are read back */
+#define GPU_PROF_HISTORY        128     /* frames kept for the statistics */
+#define GPU_PROF_NAME_LEN       32
+
+typedef struct gpu_pass_stats_t
+{
+    const char  *name;
+    int         depth;          /* nesting depth */
+    int         samples;        /* frames in the statistics */
+    float       last_ms;        /* GPU time of the pass in the latest frame read back */
+    float       avg_ms;
+    float       p50_ms;
+    float       p90_ms;
+    float       p99_ms;
+    float       max_ms;
+} gpu_pass_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ *  GPU timer of named passes (GL_EXT_disjoint_timer_query).
+ *
+ *    gpu_profiler_begin_frame ();
+ *      gpu_profiler_begin_pass ("eye0");
+ *        gpu_profiler_begin_pass ("teapot"); ... gpu_profiler_end_pass ();
+ *      gpu_profiler_end_pass ();
+ *    gpu_profiler_end_frame ();
+ *
+ *    The queries of a frame are read back by gpu_profiler_begin_frame()
+ *    after GPU_PROF_FRAME_LATENCY more frames, and only if they are
+ *    available, so the CPU never waits for the GPU. A pass issued more
+ *    than once in a frame (e.g. per eye) is summed.
+ *    Passes nest with GL_TIMESTAMP_EXT. Without timestamps, only the
+ *    outermost passes are measured, with GL_TIME_ELAPSED_EXT.
+ *
+ *    Every call is a no-op when the extension is not supported.
+ */
+int   init_gpu_profiler (void);
+void  destroy_gpu_profiler (void);
+int   is_gpu_profiler_enabled (void);
+
+void  gpu_profiler_begin_frame (void);
+void  gpu_profiler_end_frame (void);
+void  gpu_profiler_begin_pass (const char *name);
+void  gpu_profiler_end_pass (void);
+
+/* sum of the outermost passes of the latest frame read back [ms]. 0 if none yet */
+float gpu_profiler_get_frame_ms (void);
+int   gpu_profiler_get_pass_num (void);
+int   gpu_profiler_find_pass (const char *name);
+int   gpu_profiler_get_stats (int pass, gpu_pass_stats_t *stats);
+
+/* statistics of every pass, drawn with draw_dbgstr() */
+void  draw_gpu_profiler (int x, int y);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* UTIL_GPU_PROFILER_H_ */
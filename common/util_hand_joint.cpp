@@ -0,0 +1,124 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "util_log.h"
+#include "util_hand_joint.h"
+
+
+HandJointStore::HandJointStore ()
+    : m_buf (nullptr), m_front (0)
+{
+    void *buf = nullptr;
+    size_t size = sizeof (hand_joint_set_t) * 2 * HAND_NUM;
+
+    if (posix_memalign (&buf, 64, size) != 0)
+    {
+        LOGE ("%s(%d): posix_memalign() failed.\n", __FILE__, __LINE__);
+        abort ();
+    }
+    memset (buf, 0, size);
+    m_buf = (hand_joint_set_t *)buf;
+}
+
+
+HandJointStore::~HandJointStore ()
+{
+    free (m_buf);
+}
+
+
+hand_joint_set_t *
+HandJointStore::back (int hand)
+{
+    int idx = 1 - m_front.load (std::memory_order_relaxed);
+    return &m_buf[idx * HAND_NUM + hand];
+}
+
+
+const hand_joint_set_t &
+HandJointStore::front (int hand) const
+{
+    int idx = m_front.load (std::memory_order_acquire);
+    return m_buf[idx * HAND_NUM + hand];
+}
+
+
+void
+HandJointStore::publish ()
+{
+    int idx = m_front.load (std::memory_order_relaxed);
+    m_front.store (1 - idx, std::memory_order_release);
+}
+
+
+/*
+ *  q = exp (0.5 * w * dt) * q
+ *    (w) is in the base space, so the delta rotation is applied on the left.
+ */
+static void
+integrate_qtn (float *q, const float *w, float dt)
+{
+    float wx = w[0], wy = w[1], wz = w[2];
+    float wlen = sqrtf (wx * wx + wy * wy + wz * wz);
+    if (wlen < 1e-6f)
+        return;
+
+    float half = 0.5f * wlen * dt;
+    float s    = sinf (half) / wlen;
+    float dx   = wx * s;
+    float dy   = wy * s;
+    float dz   = wz * s;
+    float dw   = cosf (half);
+
+    float qx = q[0], qy = q[1], qz = q[2], qw = q[3];
+    float rx = dw * qx + dx * qw + dy * qz - dz * qy;
+    float ry = dw * qy - dx * qz + dy * qw + dz * qx;
+    float rz = dw * qz + dx * qy - dy * qx + dz * qw;
+    float rw = dw * qw - dx * qx - dy * qy - dz * qz;
+
+    float rlen = sqrtf (rx * rx + ry * ry + rz * rz + rw * rw);
+    float inv  = (rlen > 0.0f) ? 1.0f / rlen : 0.0f;
+    q[0] = rx * inv;
+    q[1] = ry * inv;
+    q[2] = rz * inv;
+    q[3] = rw * inv;
+}
+
+
+bool
+HandJointStore::extrapolate (int hand, int64_t time, float *pos, float *qtn) const
+{
+    const hand_joint_set_t &src = front (hand);
+
+    memcpy (pos, src.pos, sizeof (src.pos));
+    memcpy (qtn, src.qtn, sizeof (src.qtn));
+
+    if (!src.active)
+        return false;
+
+    int64_t dt_ns = time - src.time;
+    if (dt_ns >  HAND_JOINT_MAX_EXTRAPOLATE_NS) dt_ns =  HAND_JOINT_MAX_EXTRAPOLATE_NS;
+    if (dt_ns < -HAND_JOINT_MAX_EXTRAPOLATE_NS) dt_ns = -HAND_JOINT_MAX_EXTRAPOLATE_NS;
+    if (dt_ns == 0)
+        return true;
+
+    float dt = dt_ns * 1e-9f;
+
+    for (int i = 0; i < HAND_JOINT_NUM; i ++)
+    {
+        if (!(src.flags[i] & HAND_JOINT_VELOCITY_VALID))
+            continue;
+
+        pos[3 * i + 0] += src.linvel[3 * i + 0] * dt;
+        pos[3 * i + 1] += src.linvel[3 * i + 1] * dt;
+        pos[3 * i + 2] += src.linvel[3 * i + 2] * dt;
+
+        integrate_qtn (&qtn[4 * i], &src.angvel[3 * i], dt);
+    }
+
+    return true;
+}
@@ -0,0 +1,80 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef UTIL_HAND_JOINT_H_
+#define UTIL_HAND_JOINT_H_
+
+#include <stdint.h>
+#include <atomic>
+
+
+#define HAND_NUM                    2
+#define HAND_JOINT_NUM              26      /* XR_HAND_JOINT_COUNT_EXT */
+
+/* hand_joint_set_t::flags */
+#define HAND_JOINT_POSE_VALID       (1 << 0)    /* orientation and position */
+#define HAND_JOINT_VELOCITY_VALID   (1 << 1)    /* linear and angular velocity */
+
+/* the longest interval extrapolate() predicts over [ns] */
+#define HAND_JOINT_MAX_EXTRAPOLATE_NS   (50 * 1000 * 1000)
+
+
+/*
+ *  Joints of a hand at (time), as structure-of-arrays.
+ *    pos    : px, py, pz             x HAND_JOINT_NUM
+ *    qtn    : qx, qy, qz, qw         x HAND_JOINT_NUM
+ *    linvel : vx, vy, vz   [m/s]     x HAND_JOINT_NUM
+ *    angvel : wx, wy, wz   [rad/s]   x HAND_JOINT_NUM  (in the base space)
+ *    radius :                        x HAND_JOINT_NUM
+ *
+ *  Each array starts on its own cache line.
+ */
+typedef struct hand_joint_set_t
+{
+    alignas (64) float  pos   [HAND_JOINT_NUM * 3];
+    alignas (64) float  qtn   [HAND_JOINT_NUM * 4];
+    alignas (64) float  linvel[HAND_JOINT_NUM * 3];
+    alignas (64) float  angvel[HAND_JOINT_NUM * 3];
+    alignas (64) float  radius[HAND_JOINT_NUM];
+    uint32_t            flags [HAND_JOINT_NUM];
+    int64_t             time;       /* XrTime of the sample */
+    bool                active;
+} hand_joint_set_t;
+
+
+/*
+ *  Double-buffered joints of both hands.
+ *
+ *    The producer fills back() of both hands (e.g. oxr_locate_handjoints())
+ *    and calls publish(). Renderers and gesture code read front(), which is
+ *    not touched by the producer until the next publish().
+ *
+ *    All the buffers are allocated once in the constructor.
+ */
+class HandJointStore {
+public:
+    HandJointStore ();
+    ~HandJointStore ();
+
+    hand_joint_set_t       *back  (int hand);
+    const hand_joint_set_t &front (int hand) const;
+    void                    publish ();
+
+    /*
+     *  predict the joints of front(hand) at (time) from their velocities.
+     *    (pos) : float[HAND_JOINT_NUM * 3], (qtn) : float[HAND_JOINT_NUM * 4]
+     *  Joints without a valid velocity keep the sampled pose.
+     *  returns false if the hand is not tracked.
+     */
+    bool extrapolate (int hand, int64_t time, float *pos, float *qtn) const;
+
+private:
+    HandJointStore (const HandJointStore &) = delete;
+    HandJointStore &operator= (const HandJointStore &) = delete;
+
+    hand_joint_set_t   *m_buf;      /* [2][HAND_NUM] */
+    std::atomic<int>    m_front;
+};
+
+#endif /* UTIL_HAND_JOINT_H_ */
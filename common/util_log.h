@@ -5,6 +5,30 @@
 #ifndef UTIL_LOG_H_
 #define UTIL_LOG_H_
 
+/*
+ *  Compile-time log verbosity.
+ *    LOGV is for messages issued every frame. It is compiled away unless
+ *    UTIL_LOG_LEVEL >= UTIL_LOG_LEVEL_VERBOSE, which is the default only in
+ *    debug (non NDEBUG) builds. Lower levels also compile LOGI/LOGW away.
+ */
+#define UTIL_LOG_LEVEL_NONE     0
+#define UTIL_LOG_LEVEL_ERROR    1
+#define UTIL_LOG_LEVEL_WARN     2
+#define UTIL_LOG_LEVEL_INFO     3
+#define UTIL_LOG_LEVEL_VERBOSE  4
+
+#ifndef UTIL_LOG_LEVEL
+#if defined (NDEBUG)
+#define UTIL_LOG_LEVEL  UTIL_LOG_LEVEL_INFO
+#else
+#define UTIL_LOG_LEVEL  UTIL_LOG_LEVEL_VERBOSE
+#endif
+#endif
+
+/* keeps the format checked by the compiler, but emits no code */
+#define DBG_LOG_NOP(...) do { if (0) { DBG_LOG(__VA_ARGS__); } } while(0)
+
+
 #ifdef __ANDROID__
 
 #include <android/log.h>
@@ -49,16 +73,36 @@
     } \
 } while(0)
 
+#ifndef LOGV
+#if (UTIL_LOG_LEVEL >= UTIL_LOG_LEVEL_VERBOSE)
+#define LOGV DBG_LOGI
+#else
+#define LOGV DBG_LOG_NOP
+#endif
+#endif
+
 #ifndef LOGI
+#if (UTIL_LOG_LEVEL >= UTIL_LOG_LEVEL_INFO)
 #define LOGI DBG_LOGI
+#else
+#define LOGI DBG_LOG_NOP
+#endif
 #endif
 
 #ifndef LOGW
+#if (UTIL_LOG_LEVEL >= UTIL_LOG_LEVEL_WARN)
 #define LOGW DBG_LOGW
+#else
+#define LOGW DBG_LOG_NOP
+#endif
 #endif
 
 #ifndef LOGE
+#if (UTIL_LOG_LEVEL >= UTIL_LOG_LEVEL_ERROR)
 #define LOGE DBG_LOGE
+#else
+#define LOGE DBG_LOG_NOP
+#endif
 #endif
 
 #ifndef LOG
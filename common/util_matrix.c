@@ -6,8 +6,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <float.h>
 #define M_PId180f     (3.1415926f / 180.0f)
 #include "util_matrix.h"
+#include "util_matrix_simd.h"
 
 float
 vec3_length (float *v)
@@ -823,8 +825,8 @@ matrix_modellookat (float *m, float *src_pos, float *tgt_pos, float twist)
    Multiply Matrix
      M = M1 * M2
 *******************************************/
-void
-matrix_mult (float *m, float *m1, float *m2)
+static void
+matrix_mult_scalar (float *m, float *m1, float *m2)
 {
     float fm0, fm1, fm2, fm3;
     float fpm00, fpm01, fpm02, fpm03;
@@ -1115,8 +1117,8 @@ matrix_multvec2 (float *m, float *svec, float *dvec)
     dvec[1] = _d1;
 }
 
-void
-matrix_multvec3 (float *m, float *svec, float *dvec)
+static void
+matrix_multvec3_scalar (float *m, float *svec, float *dvec)
 {
     float v0 = svec[0];
     float v1 = svec[1];
@@ -1148,8 +1150,8 @@ matrix_multvec3 (float *m, float *svec, float *dvec)
     dvec[2] = _d2;
 }
 
-void
-matrix_multvec4 (float *m, float *svec, float *dvec)
+static void
+matrix_multvec4_scalar (float *m, float *svec, float *dvec)
 {
     float v0 = svec[0];
     float v1 = svec[1];
@@ -1252,8 +1254,8 @@ matrix_proj_ortho (float *mat, float left, float right, float bottom, float top,
     mat[15] = 1.0f;
 }
 
-void
-matrix_transpose (float *m)
+static void
+matrix_transpose_scalar (float *m)
 {
     float      m01, m02, m03;
     float m04,      m06, m07;
@@ -1284,8 +1286,150 @@ matrix_transpose (float *m)
 }
 
 
+/******************************************
+   Invert Matrix
+     matrix_invert_affine : M = [R|t], 4th row is (0, 0, 0, 1). R may have scale/skew.
+     matrix_invert_rigid  : M = [R|t], R is a pure rotation.
+     The matrix is left untouched when it is singular.
+*******************************************/
 void
-matrix_invert (float *m)
+matrix_invert_affine (float *m)
+{
+    float m00, m01, m02;
+    float m04, m05, m06;
+    float m08, m09, m10;
+    float m12, m13, m14;
+    float W00, W04, W08;
+    float W01, W05, W09;
+    float W02, W06, W10;
+    float W03, W07, W11;
+    float det, invdet;
+
+    m00 = m[ 0]; m04 = m[ 4]; m08 = m[ 8]; m12 = m[12];
+    m01 = m[ 1]; m05 = m[ 5]; m09 = m[ 9]; m13 = m[13];
+    m02 = m[ 2]; m06 = m[ 6]; m10 = m[10]; m14 = m[14];
+
+    W00 =   m05 * m10 - m09 * m06;
+    W04 = -(m01 * m10 - m09 * m02);
+    W08 =   m01 * m06 - m05 * m02;
+
+    det = m00 * W00 + m04 * W04 + m08 * W08;
+
+    if ( det == 0.0f )
+    {
+        return;
+    }
+    invdet = 1.0f / det;
+
+    W01 = -(m04 * m10 - m08 * m06);
+    W05 =   m00 * m10 - m08 * m02;
+    W09 = -(m00 * m06 - m04 * m02);
+
+    W02 =   m04 * m09  - m08 * m05;
+    W06 = -(m00 * m09  - m08 * m01);
+    W10 =   m00 * m05  - m04 * m01;
+
+    W03 = -(W00 * m12 + W01 * m13 + W02 * m14);
+    W07 = -(W04 * m12 + W05 * m13 + W06 * m14);
+    W11 = -(W08 * m12 + W09 * m13 + W10 * m14);
+
+    /* M^-1[ij] = invdet * M[ji] */
+    m[ 0]  = W00 * invdet;
+    m[ 4]  = W01 * invdet;
+    m[ 8]  = W02 * invdet;
+    m[12]  = W03 * invdet;
+
+    m[ 1]  = W04 * invdet;
+    m[ 5]  = W05 * invdet;
+    m[ 9]  = W06 * invdet;
+    m[13]  = W07 * invdet;
+
+    m[ 2]  = W08 * invdet;
+    m[ 6]  = W09 * invdet;
+    m[10]  = W10 * invdet;
+    m[14]  = W11 * invdet;
+
+    m[ 3]  = 0.0f;
+    m[ 7]  = 0.0f;
+    m[11]  = 0.0f;
+    m[15]  = 1.0f;
+}
+
+/* M^-1 = [R^T | -R^T t] */
+void
+matrix_invert_rigid (float *m)
+{
+    float m01 = m[ 1], m02 = m[ 2];
+    float m04 = m[ 4], m06 = m[ 6];
+    float m08 = m[ 8], m09 = m[ 9];
+    float tx  = m[12], ty  = m[13], tz  = m[14];
+
+    m[ 1] = m04; m[ 4] = m01;
+    m[ 2] = m08; m[ 8] = m02;
+    m[ 6] = m09; m[ 9] = m06;
+
+    m[12] = -(m[ 0] * tx + m[ 4] * ty + m[ 8] * tz);
+    m[13] = -(m[ 1] * tx + m[ 5] * ty + m[ 9] * tz);
+    m[14] = -(m[ 2] * tx + m[ 6] * ty + m[10] * tz);
+
+    m[ 3] = 0.0f;
+    m[ 7] = 0.0f;
+    m[11] = 0.0f;
+    m[15] = 1.0f;
+}
+
+/*
+ *  normal matrix: inverse-transpose of the upper 3x3 of (m).
+ *    (n) is a column-major 3x3 for glUniformMatrix3fv().
+ *
+ *  The columns of (M^-1)^T are the cofactors (c1 x c2, c2 x c0, c0 x c1) / det,
+ *  where c0, c1, c2 are the columns of M.
+ *  When M is singular, (n) is the transpose of M (as matrix_invert + matrix_transpose).
+ */
+void
+matrix_normal3x3 (float *n, float *m)
+{
+    float m00 = m[ 0], m01 = m[ 1], m02 = m[ 2];
+    float m04 = m[ 4], m05 = m[ 5], m06 = m[ 6];
+    float m08 = m[ 8], m09 = m[ 9], m10 = m[10];
+    float c00, c01, c02;
+    float c04, c05, c06;
+    float c08, c09, c10;
+    float det, invdet;
+
+    /* c1 x c2 */
+    c00 = m05 * m10 - m06 * m09;
+    c01 = m06 * m08 - m04 * m10;
+    c02 = m04 * m09 - m05 * m08;
+
+    det = m00 * c00 + m01 * c01 + m02 * c02;
+    if (det == 0.0f)
+    {
+        n[0] = m00; n[1] = m04; n[2] = m08;
+        n[3] = m01; n[4] = m05; n[5] = m09;
+        n[6] = m02; n[7] = m06; n[8] = m10;
+        return;
+    }
+    invdet = 1.0f / det;
+
+    /* c2 x c0 */
+    c04 = m09 * m02 - m10 * m01;
+    c05 = m10 * m00 - m08 * m02;
+    c06 = m08 * m01 - m09 * m00;
+
+    /* c0 x c1 */
+    c08 = m01 * m06 - m02 * m05;
+    c09 = m02 * m04 - m00 * m06;
+    c10 = m00 * m05 - m01 * m04;
+
+    n[0] = c00 * invdet; n[1] = c01 * invdet; n[2] = c02 * invdet;
+    n[3] = c04 * invdet; n[4] = c05 * invdet; n[5] = c06 * invdet;
+    n[6] = c08 * invdet; n[7] = c09 * invdet; n[8] = c10 * invdet;
+}
+
+
+static void
+matrix_invert_scalar (float *m)
 {
     float m00, m01, m02, m03;
     float m04, m05, m06, m07;
@@ -1304,50 +1448,7 @@ matrix_invert (float *m)
 
     if (m03 == 0.0f && m07 == 0.0f && m11 == 0.0f && m15 == 1.0f)
     {
-        W00 =   m05 * m10 - m09 * m06;
-        W04 = -(m01 * m10 - m09 * m02);
-        W08 =   m01 * m06 - m05 * m02;
-
-        det = m00 * W00 + m04 * W04 + m08 * W08;
-
-        if ( det == 0.0f )
-        {
-            return;
-        }
-        invdet = 1.0f / det;
-
-        W01 = -(m04 * m10 - m08 * m06);
-        W05 =   m00 * m10 - m08 * m02;
-        W09 = -(m00 * m06 - m04 * m02);
-
-        W02 =   m04 * m09  - m08 * m05;
-        W06 = -(m00 * m09  - m08 * m01);
-        W10 =   m00 * m05  - m04 * m01;
-
-        W03 = -(W00 * m12 + W01 * m13 + W02 * m14);
-        W07 = -(W04 * m12 + W05 * m13 + W06 * m14);
-        W11 = -(W08 * m12 + W09 * m13 + W10 * m14);
-
-        /* M^-1[ij] = invdet * M[ji] */
-        m[ 0]  = W00 * invdet;
-        m[ 4]  = W01 * invdet;
-        m[ 8]  = W02 * invdet;
-        m[12]  = W03 * invdet;
-
-        m[ 1]  = W04 * invdet;
-        m[ 5]  = W05 * invdet;
-        m[ 9]  = W06 * invdet;
-        m[13]  = W07 * invdet;
-
-        m[ 2]  = W08 * invdet;
-        m[ 6]  = W09 * invdet;
-        m[10]  = W10 * invdet;
-        m[14]  = W11 * invdet;
-
-        m[ 3]  = 0.0f;
-        m[ 7]  = 0.0f;
-        m[11]  = 0.0f;
-        m[15]  = 1.0f;
+        matrix_invert_affine (m);
     }
     else
     {
@@ -1531,3 +1632,339 @@ void quaternion_copy (float *lpTo, float *lpFrom)
     lpTo[2] = lpFrom[2];    /* y */
     lpTo[3] = lpFrom[3];    /* z */
 }
+
+
+/******************************************
+   Batch
+     (num) elements of contiguous arrays.
+*******************************************/
+static void
+matrix_mult_batch_scalar (float *m, float *m1, float *m2, int num)
+{
+    float mat[16];
+
+    /* (m1) may be overwritten when (m) overlaps it */
+    matrix_copy (mat, m1);
+    for (int i = 0; i < num; i ++)
+        matrix_mult_scalar (&m[16 * i], mat, &m2[16 * i]);
+}
+
+static void
+matrix_multvec3_batch_scalar (float *m, float *svec, float *dvec, int num)
+{
+    for (int i = 0; i < num; i ++)
+        matrix_multvec3_scalar (m, &svec[3 * i], &dvec[3 * i]);
+}
+
+static void
+matrix_multvec4_batch_scalar (float *m, float *svec, float *dvec, int num)
+{
+    for (int i = 0; i < num; i ++)
+        matrix_multvec4_scalar (m, &svec[4 * i], &dvec[4 * i]);
+}
+
+
+/* M = T * R * S  from a quaternion (q), a position (p) and a uniform scale (s) */
+static void
+matrix_trs (float *m, const float *q, const float *p, float s)
+{
+    float qx = q[0];
+    float qy = q[1];
+    float qz = q[2];
+    float qw = q[3];
+
+    float x2 = qx + qx;
+    float y2 = qy + qy;
+    float z2 = qz + qz;
+
+    float xx2 = qx * x2;
+    float yy2 = qy * y2;
+    float zz2 = qz * z2;
+
+    float yz2 = qy * z2;
+    float wx2 = qw * x2;
+    float xy2 = qx * y2;
+    float wz2 = qw * z2;
+    float xz2 = qx * z2;
+    float wy2 = qw * y2;
+
+    m[ 0] = (1.0f - yy2 - zz2) * s;
+    m[ 1] = (xy2 + wz2) * s;
+    m[ 2] = (xz2 - wy2) * s;
+    m[ 3] = 0.0f;
+
+    m[ 4] = (xy2 - wz2) * s;
+    m[ 5] = (1.0f - xx2 - zz2) * s;
+    m[ 6] = (yz2 + wx2) * s;
+    m[ 7] = 0.0f;
+
+    m[ 8] = (xz2 + wy2) * s;
+    m[ 9] = (yz2 - wx2) * s;
+    m[10] = (1.0f - xx2 - yy2) * s;
+    m[11] = 0.0f;
+
+    m[12] = p[0];
+    m[13] = p[1];
+    m[14] = p[2];
+    m[15] = 1.0f;
+}
+
+
+/*
+ *  M[i] = T * R * S  from (num) poses.
+ *
+ *    pose  : qx, qy, qz, qw, px, py, pz  (the layout of XrPosef)
+ *    scale : uniform scale of each pose (e.g. XrHandJointLocationEXT.radius).
+ *            1.0 when NULL.
+ *    pose_stride, scale_stride : in bytes. (e.g. sizeof (XrHandJointLocationEXT))
+ *
+ *  The result is the same as XrMatrix4x4f_CreateTranslationRotationScale().
+ */
+void
+matrix_trs_batch (float *m, const void *pose, int pose_stride,
+                  const float *scale, int scale_stride, int num)
+{
+    const char *ppose  = (const char *)pose;
+    const char *pscale = (const char *)scale;
+
+    for (int i = 0; i < num; i ++, m += 16)
+    {
+        const float *p = (const float *)(ppose + pose_stride * i);
+        float s  = scale ? *(const float *)(pscale + scale_stride * i) : 1.0f;
+
+        matrix_trs (m, &p[0], &p[4], s);
+    }
+}
+
+
+/*
+ *  structure-of-arrays version of matrix_trs_batch().
+ *    qtn : float[num * 4], pos : float[num * 3], scale : float[num] or NULL.
+ *    (e.g. hand_joint_set_t::qtn, ::pos, ::radius)
+ */
+void
+matrix_trs_batch_soa (float *m, const float *qtn, const float *pos,
+                      const float *scale, int num)
+{
+    for (int i = 0; i < num; i ++, m += 16)
+        matrix_trs (m, &qtn[4 * i], &pos[3 * i], scale ? scale[i] : 1.0f);
+}
+
+
+/******************************************
+   SIMD dispatch
+     matrix_mult, matrix_multvec3/4, matrix_transpose and matrix_invert
+     call the kernels selected by matrix_simd_select().
+     The best one for the build target is used by default, and AVX is
+     picked up at load time when the CPU supports it.
+*******************************************/
+typedef struct matrix_func_t
+{
+    void (*mult)      (float *m, float *m1, float *m2);
+    void (*multvec3)  (float *m, float *svec, float *dvec);
+    void (*multvec4)  (float *m, float *svec, float *dvec);
+    void (*transpose) (float *m);
+    void (*invert)    (float *m);
+    void (*mult_batch)     (float *m, float *m1, float *m2, int num);
+    void (*multvec3_batch) (float *m, float *svec, float *dvec, int num);
+    void (*multvec4_batch) (float *m, float *svec, float *dvec, int num);
+} matrix_func_t;
+
+static const matrix_func_t s_func_scalar = {
+    matrix_mult_scalar,
+    matrix_multvec3_scalar,
+    matrix_multvec4_scalar,
+    matrix_transpose_scalar,
+    matrix_invert_scalar,
+    matrix_mult_batch_scalar,
+    matrix_multvec3_batch_scalar,
+    matrix_multvec4_batch_scalar,
+};
+
+#if defined (MATRIX_HAVE_SSE)
+static void
+matrix_invert_sse (float *m)
+{
+    if (m[3] == 0.0f && m[7] == 0.0f && m[11] == 0.0f && m[15] == 1.0f)
+        matrix_invert_affine (m);
+    else
+        matrix_invert_general_sse (m);
+}
+
+static const matrix_func_t s_func_sse = {
+    matrix_mult_sse,
+    matrix_multvec3_sse,
+    matrix_multvec4_sse,
+    matrix_transpose_sse,
+    matrix_invert_sse,
+    matrix_mult_batch_sse,
+    matrix_multvec3_batch_sse,
+    matrix_multvec4_batch_sse,
+};
+#endif
+
+#if defined (MATRIX_HAVE_AVX)
+static const matrix_func_t s_func_avx = {
+    matrix_mult_avx,
+    matrix_multvec3_sse,
+    matrix_multvec4_sse,
+    matrix_transpose_sse,
+    matrix_invert_sse,
+    matrix_mult_batch_avx,
+    matrix_multvec3_batch_sse,
+    matrix_multvec4_batch_sse,
+};
+#endif
+
+#if defined (MATRIX_HAVE_NEON)
+static const matrix_func_t s_func_neon = {
+    matrix_mult_neon,
+    matrix_multvec3_neon,
+    matrix_multvec4_neon,
+    matrix_transpose_neon,
+    matrix_invert_scalar,
+    matrix_mult_batch_neon,
+    matrix_multvec3_batch_neon,
+    matrix_multvec4_batch_neon,
+};
+#endif
+
+#if defined (MATRIX_HAVE_NEON)
+static const matrix_func_t *s_func = &s_func_neon;
+static int                  s_simd = MATRIX_SIMD_NEON;
+#elif defined (MATRIX_HAVE_SSE)
+static const matrix_func_t *s_func = &s_func_sse;
+static int                  s_simd = MATRIX_SIMD_SSE;
+#else
+static const matrix_func_t *s_func = &s_func_scalar;
+static int                  s_simd = MATRIX_SIMD_NONE;
+#endif
+
+
+#if defined (MATRIX_HAVE_AVX)
+static void __attribute__ ((constructor))
+matrix_simd_init (void)
+{
+    if (matrix_cpu_has_avx ())
+        matrix_simd_select (MATRIX_SIMD_AVX);
+}
+#endif
+
+
+int
+matrix_simd_is_available (int simd)
+{
+    switch (simd)
+    {
+    case MATRIX_SIMD_NONE:
+        return 1;
+#if defined (MATRIX_HAVE_SSE)
+    case MATRIX_SIMD_SSE:
+        return 1;
+#endif
+#if defined (MATRIX_HAVE_AVX)
+    case MATRIX_SIMD_AVX:
+        return matrix_cpu_has_avx ();
+#endif
+#if defined (MATRIX_HAVE_NEON)
+    case MATRIX_SIMD_NEON:
+        return 1;
+#endif
+    default:
+        return 0;
+    }
+}
+
+int
+matrix_simd_select (int simd)
+{
+    if (!matrix_simd_is_available (simd))
+        return -1;
+
+    switch (simd)
+    {
+#if defined (MATRIX_HAVE_SSE)
+    case MATRIX_SIMD_SSE:  s_func = &s_func_sse;    break;
+#endif
+#if defined (MATRIX_HAVE_AVX)
+    case MATRIX_SIMD_AVX:  s_func = &s_func_avx;    break;
+#endif
+#if defined (MATRIX_HAVE_NEON)
+    case MATRIX_SIMD_NEON: s_func = &s_func_neon;   break;
+#endif
+    default:               s_func = &s_func_scalar; break;
+    }
+
+    s_simd = simd;
+    return 0;
+}
+
+int
+matrix_simd_get (void)
+{
+    return s_simd;
+}
+
+const char *
+matrix_simd_name (int simd)
+{
+    switch (simd)
+    {
+    case MATRIX_SIMD_NONE: return "scalar";
+    case MATRIX_SIMD_SSE:  return "sse";
+    case MATRIX_SIMD_AVX:  return "avx";
+    case MATRIX_SIMD_NEON: return "neon";
+    default:               return "unknown";
+    }
+}
+
+
+void
+matrix_mult (float *m, float *m1, float *m2)
+{
+    s_func->mult (m, m1, m2);
+}
+
+void
+matrix_multvec3 (float *m, float *svec, float *dvec)
+{
+    s_func->multvec3 (m, svec, dvec);
+}
+
+void
+matrix_multvec4 (float *m, float *svec, float *dvec)
+{
+    s_func->multvec4 (m, svec, dvec);
+}
+
+void
+matrix_transpose (float *m)
+{
+    s_func->transpose (m);
+}
+
+void
+matrix_invert (float *m)
+{
+    s_func->invert (m);
+}
+
+/* M[i] = M1 * M2[i]. (m) may be (m2), but must not overlap (m1) */
+void
+matrix_mult_batch (float *m, float *m1, float *m2, int num)
+{
+    s_func->mult_batch (m, m1, m2, num);
+}
+
+/* dvec[i] = M * svec[i]. vec3 are packed (x, y, z, x, y, z, ...) */
+void
+matrix_multvec3_batch (float *m, float *svec, float *dvec, int num)
+{
+    s_func->multvec3_batch (m, svec, dvec, num);
+}
+
+void
+matrix_multvec4_batch (float *m, float *svec, float *dvec, int num)
+{
+    s_func->multvec4_batch (m, svec, dvec, num);
+}
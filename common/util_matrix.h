@@ -46,6 +46,18 @@ void matrix_proj_ortho ( float *mat, float left, float right, float bottom, floa
 
 void matrix_transpose (float *m);
 void matrix_invert (float *m);
+void matrix_invert_affine (float *m);
+void matrix_invert_rigid (float *m);
+void matrix_normal3x3 (float *n, float *m);
+
+/* batch versions: (num) elements of contiguous arrays */
+void matrix_mult_batch     (float *m, float *m1, float *m2, int num);
+void matrix_multvec3_batch (float *m, float *svec, float *dvec, int num);
+void matrix_multvec4_batch (float *m, float *svec, float *dvec, int num);
+void matrix_trs_batch      (float *m, const void *pose, int pose_stride,
+                            const float *scale, int scale_stride, int num);
+void matrix_trs_batch_soa  (float *m, const float *qtn, const float *pos,
+                            const float *scale, int num);
 
 float vec3_length (float *v);
 float vec3_normalize (float *v);
@@ -71,6 +83,17 @@ void quaternion_copy (float *lpTo, float *lpFrom);
 
 float vector_normalize(float *lpV);
 
+/* SIMD implementation of matrix_mult, matrix_multvec3/4, matrix_transpose, matrix_invert and the batch versions */
+#define MATRIX_SIMD_NONE    (0)     /* scalar */
+#define MATRIX_SIMD_SSE     (1)
+#define MATRIX_SIMD_AVX     (2)
+#define MATRIX_SIMD_NEON    (3)
+
+int         matrix_simd_is_available (int simd);
+int         matrix_simd_select (int simd);
+int         matrix_simd_get (void);
+const char *matrix_simd_name (int simd);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,541 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdio.h>
+#include "util_matrix_simd.h"
+
+/*
+ *  All matrices are column-major float[16], the same as util_matrix.c.
+ *
+ *  The kernels keep the multiply/add order of the scalar code, so that
+ *  matrix_mult, matrix_multvec3/4 and matrix_transpose give bit-identical
+ *  results as long as the scalar code is not contracted into FMA by the
+ *  compiler. Only matrix_invert_general_sse rounds differently.
+ */
+
+#if defined (MATRIX_HAVE_SSE)
+#include <emmintrin.h>
+
+#define SSE_SHUFFLE(x, y, z, w)     ((x) | ((y) << 2) | ((z) << 4) | ((w) << 6))
+#define SSE_SWIZZLE(v, x, y, z, w)  _mm_shuffle_ps (v, v, SSE_SHUFFLE(x, y, z, w))
+#define SSE_SPLAT(v, x)             _mm_shuffle_ps (v, v, SSE_SHUFFLE(x, x, x, x))
+
+
+/******************************************
+   Multiply Matrix
+     M = M1 * M2
+*******************************************/
+void
+matrix_mult_sse (float *m, float *m1, float *m2)
+{
+    __m128 c0 = _mm_loadu_ps (&m1[ 0]);
+    __m128 c1 = _mm_loadu_ps (&m1[ 4]);
+    __m128 c2 = _mm_loadu_ps (&m1[ 8]);
+    __m128 c3 = _mm_loadu_ps (&m1[12]);
+    __m128 b0 = _mm_loadu_ps (&m2[ 0]);
+    __m128 b1 = _mm_loadu_ps (&m2[ 4]);
+    __m128 b2 = _mm_loadu_ps (&m2[ 8]);
+    __m128 b3 = _mm_loadu_ps (&m2[12]);
+    __m128 d0, d1, d2, d3;
+
+#define SSE_MULT_COLUMN(d, b)                                       \
+    d = _mm_mul_ps (c0, SSE_SPLAT(b, 0));                           \
+    d = _mm_add_ps (d, _mm_mul_ps (c1, SSE_SPLAT(b, 1)));           \
+    d = _mm_add_ps (d, _mm_mul_ps (c2, SSE_SPLAT(b, 2)));           \
+    d = _mm_add_ps (d, _mm_mul_ps (c3, SSE_SPLAT(b, 3)));
+
+    SSE_MULT_COLUMN (d0, b0);
+    SSE_MULT_COLUMN (d1, b1);
+    SSE_MULT_COLUMN (d2, b2);
+    SSE_MULT_COLUMN (d3, b3);
+#undef SSE_MULT_COLUMN
+
+    _mm_storeu_ps (&m[ 0], d0);
+    _mm_storeu_ps (&m[ 4], d1);
+    _mm_storeu_ps (&m[ 8], d2);
+    _mm_storeu_ps (&m[12], d3);
+}
+
+
+/*
+ *  (dst_vec) = (matrix)*(src_vec)
+ *    - accept (dst_vec) == (src_vec)
+ */
+void
+matrix_multvec3_sse (float *m, float *svec, float *dvec)
+{
+    __m128 v0 = _mm_set1_ps (svec[0]);
+    __m128 v1 = _mm_set1_ps (svec[1]);
+    __m128 v2 = _mm_set1_ps (svec[2]);
+    __m128 d;
+
+    d = _mm_loadu_ps (&m[12]);
+    d = _mm_add_ps (d, _mm_mul_ps (_mm_loadu_ps (&m[ 8]), v2));
+    d = _mm_add_ps (d, _mm_mul_ps (_mm_loadu_ps (&m[ 4]), v1));
+    d = _mm_add_ps (d, _mm_mul_ps (_mm_loadu_ps (&m[ 0]), v0));
+
+    _mm_storel_pi ((__m64 *)&dvec[0], d);
+    _mm_store_ss (&dvec[2], _mm_movehl_ps (d, d));
+}
+
+void
+matrix_multvec4_sse (float *m, float *svec, float *dvec)
+{
+    __m128 v0 = _mm_set1_ps (svec[0]);
+    __m128 v1 = _mm_set1_ps (svec[1]);
+    __m128 v2 = _mm_set1_ps (svec[2]);
+    __m128 v3 = _mm_set1_ps (svec[3]);
+    __m128 d;
+
+    d = _mm_mul_ps (_mm_loadu_ps (&m[12]), v3);
+    d = _mm_add_ps (d, _mm_mul_ps (_mm_loadu_ps (&m[ 8]), v2));
+    d = _mm_add_ps (d, _mm_mul_ps (_mm_loadu_ps (&m[ 4]), v1));
+    d = _mm_add_ps (d, _mm_mul_ps (_mm_loadu_ps (&m[ 0]), v0));
+
+    _mm_storeu_ps (dvec, d);
+}
+
+
+void
+matrix_transpose_sse (float *m)
+{
+    __m128 c0 = _mm_loadu_ps (&m[ 0]);
+    __m128 c1 = _mm_loadu_ps (&m[ 4]);
+    __m128 c2 = _mm_loadu_ps (&m[ 8]);
+    __m128 c3 = _mm_loadu_ps (&m[12]);
+
+    _MM_TRANSPOSE4_PS (c0, c1, c2, c3);
+
+    _mm_storeu_ps (&m[ 0], c0);
+    _mm_storeu_ps (&m[ 4], c1);
+    _mm_storeu_ps (&m[ 8], c2);
+    _mm_storeu_ps (&m[12], c3);
+}
+
+
+/* 2x2 matrix ops on (x00, x01, x10, x11) */
+static inline __m128
+sse_mat2_mul (__m128 v1, __m128 v2)             /* A * B  */
+{
+    return _mm_add_ps (_mm_mul_ps (v1, SSE_SWIZZLE(v2, 0, 3, 0, 3)),
+                       _mm_mul_ps (SSE_SWIZZLE(v1, 1, 0, 3, 2), SSE_SWIZZLE(v2, 2, 1, 2, 1)));
+}
+
+static inline __m128
+sse_mat2_adjmul (__m128 v1, __m128 v2)          /* adj(A) * B */
+{
+    return _mm_sub_ps (_mm_mul_ps (SSE_SWIZZLE(v1, 3, 3, 0, 0), v2),
+                       _mm_mul_ps (SSE_SWIZZLE(v1, 1, 1, 2, 2), SSE_SWIZZLE(v2, 2, 3, 0, 1)));
+}
+
+static inline __m128
+sse_mat2_muladj (__m128 v1, __m128 v2)          /* A * adj(B) */
+{
+    return _mm_sub_ps (_mm_mul_ps (v1, SSE_SWIZZLE(v2, 3, 0, 3, 0)),
+                       _mm_mul_ps (SSE_SWIZZLE(v1, 1, 0, 3, 2), SSE_SWIZZLE(v2, 2, 1, 2, 1)));
+}
+
+/*
+ *  block-wise inverse.
+ *    | A B |-1          | X Y |
+ *    | C D |   = 1/|M| * | Z W |
+ *
+ *  The columns are handled as if they were rows. As inv(M^T) = inv(M)^T,
+ *  the columns of the result are the columns of inv(M).
+ *
+ *  Only for non-affine matrices: the affine path of the scalar code is
+ *  already as fast as a 4-wide version of it.
+ */
+void
+matrix_invert_general_sse (float *m)
+{
+    __m128 c0, c1, c2, c3;
+    __m128 A, B, C, D;
+    __m128 detSub, detA, detB, detC, detD, detM, tr;
+    __m128 D_C, A_B, X_, Y_, Z_, W_, rdet;
+
+    c0 = _mm_loadu_ps (&m[ 0]);
+    c1 = _mm_loadu_ps (&m[ 4]);
+    c2 = _mm_loadu_ps (&m[ 8]);
+    c3 = _mm_loadu_ps (&m[12]);
+
+    A = _mm_movelh_ps (c0, c1);
+    B = _mm_movehl_ps (c1, c0);
+    C = _mm_movelh_ps (c2, c3);
+    D = _mm_movehl_ps (c3, c2);
+
+    /* (|A|, |B|, |C|, |D|) */
+    detSub = _mm_sub_ps (
+        _mm_mul_ps (_mm_shuffle_ps (c0, c2, SSE_SHUFFLE(0, 2, 0, 2)),
+                    _mm_shuffle_ps (c1, c3, SSE_SHUFFLE(1, 3, 1, 3))),
+        _mm_mul_ps (_mm_shuffle_ps (c0, c2, SSE_SHUFFLE(1, 3, 1, 3)),
+                    _mm_shuffle_ps (c1, c3, SSE_SHUFFLE(0, 2, 0, 2))));
+    detA = SSE_SPLAT(detSub, 0);
+    detB = SSE_SPLAT(detSub, 1);
+    detC = SSE_SPLAT(detSub, 2);
+    detD = SSE_SPLAT(detSub, 3);
+
+    D_C = sse_mat2_adjmul (D, C);
+    A_B = sse_mat2_adjmul (A, B);
+
+    X_ = _mm_sub_ps (_mm_mul_ps (detD, A), sse_mat2_mul (B, D_C));
+    W_ = _mm_sub_ps (_mm_mul_ps (detA, D), sse_mat2_mul (C, A_B));
+    Y_ = _mm_sub_ps (_mm_mul_ps (detB, C), sse_mat2_muladj (D, A_B));
+    Z_ = _mm_sub_ps (_mm_mul_ps (detC, B), sse_mat2_muladj (A, D_C));
+
+    /* |M| = |A||D| + |B||C| - tr((A#B)(D#C)) */
+    detM = _mm_add_ps (_mm_mul_ps (detA, detD), _mm_mul_ps (detB, detC));
+    tr   = _mm_mul_ps (A_B, SSE_SWIZZLE(D_C, 0, 2, 1, 3));
+    tr   = _mm_add_ps (tr, SSE_SWIZZLE(tr, 2, 3, 0, 1));
+    tr   = _mm_add_ps (tr, SSE_SWIZZLE(tr, 1, 0, 3, 2));
+    detM = _mm_sub_ps (detM, tr);
+
+    if (_mm_cvtss_f32 (detM) == 0.0f)
+        return;
+
+    rdet = _mm_div_ps (_mm_setr_ps (1.0f, -1.0f, -1.0f, 1.0f), detM);
+    X_ = _mm_mul_ps (X_, rdet);
+    Y_ = _mm_mul_ps (Y_, rdet);
+    Z_ = _mm_mul_ps (Z_, rdet);
+    W_ = _mm_mul_ps (W_, rdet);
+
+    _mm_storeu_ps (&m[ 0], _mm_shuffle_ps (X_, Y_, SSE_SHUFFLE(3, 1, 3, 1)));
+    _mm_storeu_ps (&m[ 4], _mm_shuffle_ps (X_, Y_, SSE_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps (&m[ 8], _mm_shuffle_ps (Z_, W_, SSE_SHUFFLE(3, 1, 3, 1)));
+    _mm_storeu_ps (&m[12], _mm_shuffle_ps (Z_, W_, SSE_SHUFFLE(2, 0, 2, 0)));
+}
+
+/******************************************
+   Batch
+     (m1) and (m) are kept in registers across the elements.
+*******************************************/
+void
+matrix_mult_batch_sse (float *m, float *m1, float *m2, int num)
+{
+    __m128 c0 = _mm_loadu_ps (&m1[ 0]);
+    __m128 c1 = _mm_loadu_ps (&m1[ 4]);
+    __m128 c2 = _mm_loadu_ps (&m1[ 8]);
+    __m128 c3 = _mm_loadu_ps (&m1[12]);
+
+    for (int i = 0; i < num; i ++, m += 16, m2 += 16)
+    {
+        __m128 b0 = _mm_loadu_ps (&m2[ 0]);
+        __m128 b1 = _mm_loadu_ps (&m2[ 4]);
+        __m128 b2 = _mm_loadu_ps (&m2[ 8]);
+        __m128 b3 = _mm_loadu_ps (&m2[12]);
+        __m128 d0, d1, d2, d3;
+
+#define SSE_MULT_COLUMN(d, b)                                       \
+        d = _mm_mul_ps (c0, SSE_SPLAT(b, 0));                       \
+        d = _mm_add_ps (d, _mm_mul_ps (c1, SSE_SPLAT(b, 1)));       \
+        d = _mm_add_ps (d, _mm_mul_ps (c2, SSE_SPLAT(b, 2)));       \
+        d = _mm_add_ps (d, _mm_mul_ps (c3, SSE_SPLAT(b, 3)));
+
+        SSE_MULT_COLUMN (d0, b0);
+        SSE_MULT_COLUMN (d1, b1);
+        SSE_MULT_COLUMN (d2, b2);
+        SSE_MULT_COLUMN (d3, b3);
+#undef SSE_MULT_COLUMN
+
+        _mm_storeu_ps (&m[ 0], d0);
+        _mm_storeu_ps (&m[ 4], d1);
+        _mm_storeu_ps (&m[ 8], d2);
+        _mm_storeu_ps (&m[12], d3);
+    }
+}
+
+void
+matrix_multvec3_batch_sse (float *m, float *svec, float *dvec, int num)
+{
+    __m128 c0 = _mm_loadu_ps (&m[ 0]);
+    __m128 c1 = _mm_loadu_ps (&m[ 4]);
+    __m128 c2 = _mm_loadu_ps (&m[ 8]);
+    __m128 c3 = _mm_loadu_ps (&m[12]);
+
+    for (int i = 0; i < num; i ++, svec += 3, dvec += 3)
+    {
+        __m128 d;
+
+        d = _mm_add_ps (c3, _mm_mul_ps (c2, _mm_set1_ps (svec[2])));
+        d = _mm_add_ps (d,  _mm_mul_ps (c1, _mm_set1_ps (svec[1])));
+        d = _mm_add_ps (d,  _mm_mul_ps (c0, _mm_set1_ps (svec[0])));
+
+        _mm_storel_pi ((__m64 *)&dvec[0], d);
+        _mm_store_ss (&dvec[2], _mm_movehl_ps (d, d));
+    }
+}
+
+void
+matrix_multvec4_batch_sse (float *m, float *svec, float *dvec, int num)
+{
+    __m128 c0 = _mm_loadu_ps (&m[ 0]);
+    __m128 c1 = _mm_loadu_ps (&m[ 4]);
+    __m128 c2 = _mm_loadu_ps (&m[ 8]);
+    __m128 c3 = _mm_loadu_ps (&m[12]);
+
+    for (int i = 0; i < num; i ++, svec += 4, dvec += 4)
+    {
+        __m128 v = _mm_loadu_ps (svec);
+        __m128 d;
+
+        d = _mm_mul_ps (c3, SSE_SPLAT(v, 3));
+        d = _mm_add_ps (d, _mm_mul_ps (c2, SSE_SPLAT(v, 2)));
+        d = _mm_add_ps (d, _mm_mul_ps (c1, SSE_SPLAT(v, 1)));
+        d = _mm_add_ps (d, _mm_mul_ps (c0, SSE_SPLAT(v, 0)));
+
+        _mm_storeu_ps (dvec, d);
+    }
+}
+#endif /* MATRIX_HAVE_SSE */
+
+
+
+#if defined (MATRIX_HAVE_AVX)
+#include <immintrin.h>
+#include <cpuid.h>
+
+/* AVX is usable only when both the CPU and the OS (XSAVE of YMM) support it */
+int
+matrix_cpu_has_avx (void)
+{
+    unsigned int eax, ebx, ecx, edx;
+    unsigned int xcr0_lo, xcr0_hi;
+
+    if (!__get_cpuid (1, &eax, &ebx, &ecx, &edx))
+        return 0;
+
+    if (!(ecx & bit_OSXSAVE) || !(ecx & bit_AVX))
+        return 0;
+
+    __asm__ ("xgetbv" : "=a" (xcr0_lo), "=d" (xcr0_hi) : "c" (0));
+    (void)xcr0_hi;
+
+    return ((xcr0_lo & 0x6) == 0x6);
+}
+
+
+/*
+ *  two columns at once.
+ *    (c_k, c_k) x (m2[4j+k], m2[4j+4+k])
+ */
+__attribute__ ((target ("avx"))) void
+matrix_mult_avx (float *m, float *m1, float *m2)
+{
+    __m256 c0  = _mm256_broadcast_ps ((const __m128 *)&m1[ 0]);
+    __m256 c1  = _mm256_broadcast_ps ((const __m128 *)&m1[ 4]);
+    __m256 c2  = _mm256_broadcast_ps ((const __m128 *)&m1[ 8]);
+    __m256 c3  = _mm256_broadcast_ps ((const __m128 *)&m1[12]);
+    __m256 b01 = _mm256_loadu_ps (&m2[0]);
+    __m256 b23 = _mm256_loadu_ps (&m2[8]);
+    __m256 d01, d23;
+
+    d01 = _mm256_mul_ps (c0, _mm256_permute_ps (b01, 0x00));
+    d23 = _mm256_mul_ps (c0, _mm256_permute_ps (b23, 0x00));
+    d01 = _mm256_add_ps (d01, _mm256_mul_ps (c1, _mm256_permute_ps (b01, 0x55)));
+    d23 = _mm256_add_ps (d23, _mm256_mul_ps (c1, _mm256_permute_ps (b23, 0x55)));
+    d01 = _mm256_add_ps (d01, _mm256_mul_ps (c2, _mm256_permute_ps (b01, 0xAA)));
+    d23 = _mm256_add_ps (d23, _mm256_mul_ps (c2, _mm256_permute_ps (b23, 0xAA)));
+    d01 = _mm256_add_ps (d01, _mm256_mul_ps (c3, _mm256_permute_ps (b01, 0xFF)));
+    d23 = _mm256_add_ps (d23, _mm256_mul_ps (c3, _mm256_permute_ps (b23, 0xFF)));
+
+    _mm256_storeu_ps (&m[0], d01);
+    _mm256_storeu_ps (&m[8], d23);
+}
+
+__attribute__ ((target ("avx"))) void
+matrix_mult_batch_avx (float *m, float *m1, float *m2, int num)
+{
+    __m256 c0  = _mm256_broadcast_ps ((const __m128 *)&m1[ 0]);
+    __m256 c1  = _mm256_broadcast_ps ((const __m128 *)&m1[ 4]);
+    __m256 c2  = _mm256_broadcast_ps ((const __m128 *)&m1[ 8]);
+    __m256 c3  = _mm256_broadcast_ps ((const __m128 *)&m1[12]);
+
+    for (int i = 0; i < num; i ++, m += 16, m2 += 16)
+    {
+        __m256 b01 = _mm256_loadu_ps (&m2[0]);
+        __m256 b23 = _mm256_loadu_ps (&m2[8]);
+        __m256 d01, d23;
+
+        d01 = _mm256_mul_ps (c0, _mm256_permute_ps (b01, 0x00));
+        d23 = _mm256_mul_ps (c0, _mm256_permute_ps (b23, 0x00));
+        d01 = _mm256_add_ps (d01, _mm256_mul_ps (c1, _mm256_permute_ps (b01, 0x55)));
+        d23 = _mm256_add_ps (d23, _mm256_mul_ps (c1, _mm256_permute_ps (b23, 0x55)));
+        d01 = _mm256_add_ps (d01, _mm256_mul_ps (c2, _mm256_permute_ps (b01, 0xAA)));
+        d23 = _mm256_add_ps (d23, _mm256_mul_ps (c2, _mm256_permute_ps (b23, 0xAA)));
+        d01 = _mm256_add_ps (d01, _mm256_mul_ps (c3, _mm256_permute_ps (b01, 0xFF)));
+        d23 = _mm256_add_ps (d23, _mm256_mul_ps (c3, _mm256_permute_ps (b23, 0xFF)));
+
+        _mm256_storeu_ps (&m[0], d01);
+        _mm256_storeu_ps (&m[8], d23);
+    }
+}
+#endif /* MATRIX_HAVE_AVX */
+
+
+
+#if defined (MATRIX_HAVE_NEON)
+#include <arm_neon.h>
+
+void
+matrix_mult_neon (float *m, float *m1, float *m2)
+{
+    float32x4_t c0 = vld1q_f32 (&m1[ 0]);
+    float32x4_t c1 = vld1q_f32 (&m1[ 4]);
+    float32x4_t c2 = vld1q_f32 (&m1[ 8]);
+    float32x4_t c3 = vld1q_f32 (&m1[12]);
+    float32x4_t b0 = vld1q_f32 (&m2[ 0]);
+    float32x4_t b1 = vld1q_f32 (&m2[ 4]);
+    float32x4_t b2 = vld1q_f32 (&m2[ 8]);
+    float32x4_t b3 = vld1q_f32 (&m2[12]);
+    float32x4_t d0, d1, d2, d3;
+
+    /* vmulq + vaddq (not vfmaq) to keep the rounding of the scalar code */
+#define NEON_MULT_COLUMN(d, b)                                                  \
+    d = vmulq_lane_f32 (c0, vget_low_f32  (b), 0);                              \
+    d = vaddq_f32 (d, vmulq_lane_f32 (c1, vget_low_f32  (b), 1));               \
+    d = vaddq_f32 (d, vmulq_lane_f32 (c2, vget_high_f32 (b), 0));               \
+    d = vaddq_f32 (d, vmulq_lane_f32 (c3, vget_high_f32 (b), 1));
+
+    NEON_MULT_COLUMN (d0, b0);
+    NEON_MULT_COLUMN (d1, b1);
+    NEON_MULT_COLUMN (d2, b2);
+    NEON_MULT_COLUMN (d3, b3);
+#undef NEON_MULT_COLUMN
+
+    vst1q_f32 (&m[ 0], d0);
+    vst1q_f32 (&m[ 4], d1);
+    vst1q_f32 (&m[ 8], d2);
+    vst1q_f32 (&m[12], d3);
+}
+
+void
+matrix_multvec3_neon (float *m, float *svec, float *dvec)
+{
+    float v0 = svec[0];
+    float v1 = svec[1];
+    float v2 = svec[2];
+    float32x4_t d;
+
+    d = vld1q_f32 (&m[12]);
+    d = vaddq_f32 (d, vmulq_n_f32 (vld1q_f32 (&m[ 8]), v2));
+    d = vaddq_f32 (d, vmulq_n_f32 (vld1q_f32 (&m[ 4]), v1));
+    d = vaddq_f32 (d, vmulq_n_f32 (vld1q_f32 (&m[ 0]), v0));
+
+    vst1_f32 (&dvec[0], vget_low_f32 (d));
+    dvec[2] = vgetq_lane_f32 (d, 2);
+}
+
+void
+matrix_multvec4_neon (float *m, float *svec, float *dvec)
+{
+    float v0 = svec[0];
+    float v1 = svec[1];
+    float v2 = svec[2];
+    float v3 = svec[3];
+    float32x4_t d;
+
+    d = vmulq_n_f32 (vld1q_f32 (&m[12]), v3);
+    d = vaddq_f32 (d, vmulq_n_f32 (vld1q_f32 (&m[ 8]), v2));
+    d = vaddq_f32 (d, vmulq_n_f32 (vld1q_f32 (&m[ 4]), v1));
+    d = vaddq_f32 (d, vmulq_n_f32 (vld1q_f32 (&m[ 0]), v0));
+
+    vst1q_f32 (dvec, d);
+}
+
+void
+matrix_transpose_neon (float *m)
+{
+    /* de-interleaving load of 4 columns gives 4 rows */
+    float32x4x4_t t = vld4q_f32 (m);
+
+    vst1q_f32 (&m[ 0], t.val[0]);
+    vst1q_f32 (&m[ 4], t.val[1]);
+    vst1q_f32 (&m[ 8], t.val[2]);
+    vst1q_f32 (&m[12], t.val[3]);
+}
+
+/******************************************
+   Batch
+*******************************************/
+void
+matrix_mult_batch_neon (float *m, float *m1, float *m2, int num)
+{
+    float32x4_t c0 = vld1q_f32 (&m1[ 0]);
+    float32x4_t c1 = vld1q_f32 (&m1[ 4]);
+    float32x4_t c2 = vld1q_f32 (&m1[ 8]);
+    float32x4_t c3 = vld1q_f32 (&m1[12]);
+
+    for (int i = 0; i < num; i ++, m += 16, m2 += 16)
+    {
+        float32x4_t b0 = vld1q_f32 (&m2[ 0]);
+        float32x4_t b1 = vld1q_f32 (&m2[ 4]);
+        float32x4_t b2 = vld1q_f32 (&m2[ 8]);
+        float32x4_t b3 = vld1q_f32 (&m2[12]);
+        float32x4_t d0, d1, d2, d3;
+
+#define NEON_MULT_COLUMN(d, b)                                                  \
+        d = vmulq_lane_f32 (c0, vget_low_f32  (b), 0);                          \
+        d = vaddq_f32 (d, vmulq_lane_f32 (c1, vget_low_f32  (b), 1));           \
+        d = vaddq_f32 (d, vmulq_lane_f32 (c2, vget_high_f32 (b), 0));           \
+        d = vaddq_f32 (d, vmulq_lane_f32 (c3, vget_high_f32 (b), 1));
+
+        NEON_MULT_COLUMN (d0, b0);
+        NEON_MULT_COLUMN (d1, b1);
+        NEON_MULT_COLUMN (d2, b2);
+        NEON_MULT_COLUMN (d3, b3);
+#undef NEON_MULT_COLUMN
+
+        vst1q_f32 (&m[ 0], d0);
+        vst1q_f32 (&m[ 4], d1);
+        vst1q_f32 (&m[ 8], d2);
+        vst1q_f32 (&m[12], d3);
+    }
+}
+
+void
+matrix_multvec3_batch_neon (float *m, float *svec, float *dvec, int num)
+{
+    float32x4_t c0 = vld1q_f32 (&m[ 0]);
+    float32x4_t c1 = vld1q_f32 (&m[ 4]);
+    float32x4_t c2 = vld1q_f32 (&m[ 8]);
+    float32x4_t c3 = vld1q_f32 (&m[12]);
+
+    for (int i = 0; i < num; i ++, svec += 3, dvec += 3)
+    {
+        float v0 = svec[0];
+        float v1 = svec[1];
+        float v2 = svec[2];
+        float32x4_t d;
+
+        d = vaddq_f32 (c3, vmulq_n_f32 (c2, v2));
+        d = vaddq_f32 (d,  vmulq_n_f32 (c1, v1));
+        d = vaddq_f32 (d,  vmulq_n_f32 (c0, v0));
+
+        vst1_f32 (&dvec[0], vget_low_f32 (d));
+        dvec[2] = vgetq_lane_f32 (d, 2);
+    }
+}
+
+void
+matrix_multvec4_batch_neon (float *m, float *svec, float *dvec, int num)
+{
+    float32x4_t c0 = vld1q_f32 (&m[ 0]);
+    float32x4_t c1 = vld1q_f32 (&m[ 4]);
+    float32x4_t c2 = vld1q_f32 (&m[ 8]);
+    float32x4_t c3 = vld1q_f32 (&m[12]);
+
+    for (int i = 0; i < num; i ++, svec += 4, dvec += 4)
+    {
+        float32x4_t v = vld1q_f32 (svec);
+        float32x4_t d;
+
+        d = vmulq_lane_f32 (c3, vget_high_f32 (v), 1);
+        d = vaddq_f32 (d, vmulq_lane_f32 (c2, vget_high_f32 (v), 0));
+        d = vaddq_f32 (d, vmulq_lane_f32 (c1, vget_low_f32  (v), 1));
+        d = vaddq_f32 (d, vmulq_lane_f32 (c0, vget_low_f32  (v), 0));
+
+        vst1q_f32 (dvec, d);
+    }
+}
+#endif /* MATRIX_HAVE_NEON */
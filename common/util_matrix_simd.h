@@ -0,0 +1,59 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef _MATRIX_SIMD_H_
+#define _MATRIX_SIMD_H_
+
+/*
+ *  SIMD kernels of util_matrix.c.
+ *  Do not call these directly: matrix_mult() etc. dispatch to the kernels
+ *  selected by matrix_simd_select().
+ */
+
+#if defined (__SSE2__) || defined (_M_X64)
+#define MATRIX_HAVE_SSE
+#if defined (__GNUC__) || defined (__clang__)
+#define MATRIX_HAVE_AVX
+#endif
+#endif
+
+#if defined (__ARM_NEON) || defined (__ARM_NEON__)
+#define MATRIX_HAVE_NEON
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined (MATRIX_HAVE_SSE)
+void matrix_mult_sse      (float *m, float *m1, float *m2);
+void matrix_multvec3_sse  (float *m, float *svec, float *dvec);
+void matrix_multvec4_sse  (float *m, float *svec, float *dvec);
+void matrix_transpose_sse (float *m);
+void matrix_invert_general_sse (float *m);
+void matrix_mult_batch_sse     (float *m, float *m1, float *m2, int num);
+void matrix_multvec3_batch_sse (float *m, float *svec, float *dvec, int num);
+void matrix_multvec4_batch_sse (float *m, float *svec, float *dvec, int num);
+#endif
+
+#if defined (MATRIX_HAVE_AVX)
+int  matrix_cpu_has_avx   (void);
+void matrix_mult_avx      (float *m, float *m1, float *m2);
+void matrix_mult_batch_avx (float *m, float *m1, float *m2, int num);
+#endif
+
+#if defined (MATRIX_HAVE_NEON)
+void matrix_mult_neon      (float *m, float *m1, float *m2);
+void matrix_multvec3_neon  (float *m, float *svec, float *dvec);
+void matrix_multvec4_neon  (float *m, float *svec, float *dvec);
+void matrix_transpose_neon (float *m);
+void matrix_mult_batch_neon     (float *m, float *m1, float *m2, int num);
+void matrix_multvec3_batch_neon (float *m, float *svec, float *dvec, int num);
+void matrix_multvec4_batch_neon (float *m, float *svec, float *dvec, int num);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _MATRIX_SIMD_H_ */
@@ -0,0 +1,744 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <GLES3/gl3.h>
+#include "assertgl.h"
+#include "util_log.h"
+#include "util_gl_state.h"
+#include "util_mesh.h"
+
+static const char *s_attr_name[MESH_ATTR_NUM] =
+{
+    "a_Vertex",
+    "a_Normal",
+    "a_TexCoord",
+    "a_Tangent",
+    "a_Color",
+};
+
+
+/* ---------------------------------------------------------------- *
+ *  encoders
+ * ---------------------------------------------------------------- */
+typedef union
+{
+    float       f;
+    uint32_t    u;
+} float_bits_t;
+
+/* round to nearest even */
+uint16_t
+mesh_float_to_half (float f)
+{
+    float_bits_t v;
+    v.f = f;
+    uint32_t sign = (v.u >> 16) & 0x8000;
+    uint32_t absu = v.u & 0x7fffffff;
+
+    if (absu >= 0x7f800000)                         /* Inf, NaN */
+        return sign | 0x7c00 | ((absu > 0x7f800000) ? 0x200 : 0);
+
+    if (absu >= 0x477ff000)                         /* rounds up to 65536 or more */
+        return sign | 0x7c00;
+
+    if (absu < 0x38800000)                          /* half subnormal: < 2^-14 */
+    {
+        if (absu < 0x33000000)                      /* < 2^-25 */
+            return sign;
+
+        uint32_t e     = absu >> 23;
+        uint32_t m     = (absu & 0x7fffff) | 0x800000;
+        uint32_t shift = 126 - e;
+        uint32_t h     = m >> shift;
+        uint32_t rem   = m & ((1u << shift) - 1);
+        uint32_t half  = 1u << (shift - 1);
+
+        if (rem > half || (rem == half && (h & 1)))
+            h ++;
+        return sign | h;
+    }
+
+    {
+        uint32_t h   = (absu - 0x38000000) >> 13;   /* rebias 127 -> 15 */
+        uint32_t rem = absu & 0x1fff;
+
+        if (rem > 0x1000 || (rem == 0x1000 && (h & 1)))
+            h ++;
+        return sign | h;
+    }
+}
+
+
+float
+mesh_half_to_float (uint16_t h)
+{
+    float_bits_t v;
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exp  = (h >> 10) & 0x1f;
+    uint32_t man  = h & 0x3ff;
+
+    if (exp == 0)
+    {
+        float f = ldexpf ((float)man, -24);
+        return sign ? -f : f;
+    }
+
+    if (exp == 31)
+        v.u = sign | 0x7f800000 | (man << 13);
+    else
+        v.u = sign | ((exp + 112) << 23) | (man << 13);
+    return v.f;
+}
+
+
+static int16_t
+to_snorm16 (float f)
+{
+    if (f >  1.0f) f =  1.0f;
+    if (f < -1.0f) f = -1.0f;
+    return (int16_t)lrintf (f * 32767.0f);
+}
+
+static float
+sign_not_zero (float f)
+{
+    return (f >= 0.0f) ? 1.0f : -1.0f;
+}
+
+/*
+ *  octahedral encoding: the unit vector is projected onto the octahedron,
+ *  and the lower half is folded over the upper one.
+ */
+void
+mesh_oct_encode (const float *n, int16_t *oct)
+{
+    float l1 = fabsf (n[0]) + fabsf (n[1]) + fabsf (n[2]);
+    float x, y;
+
+    if (l1 <= 0.0f)
+    {
+        oct[0] = oct[1] = 0;    /* decodes to +Z */
+        return;
+    }
+
+    x = n[0] / l1;
+    y = n[1] / l1;
+    if (n[2] < 0.0f)
+    {
+        float ox = x;
+        x = (1.0f - fabsf (y )) * sign_not_zero (ox);
+        y = (1.0f - fabsf (ox)) * sign_not_zero (y );
+    }
+
+    oct[0] = to_snorm16 (x);
+    oct[1] = to_snorm16 (y);
+}
+
+
+/* the same as oct_decode() of MESH_GLSL_OCT_DECODE */
+void
+mesh_oct_decode (const int16_t *oct, float *n)
+{
+    float x = fmaxf (oct[0] / 32767.0f, -1.0f);
+    float y = fmaxf (oct[1] / 32767.0f, -1.0f);
+    float z = 1.0f - fabsf (x) - fabsf (y);
+
+    if (z < 0.0f)
+    {
+        float ox = x;
+        x = (1.0f - fabsf (y )) * sign_not_zero (ox);
+        y = (1.0f - fabsf (ox)) * sign_not_zero (y );
+    }
+
+    float len = sqrtf (x * x + y * y + z * z);
+    n[0] = x / len;
+    n[1] = y / len;
+    n[2] = z / len;
+}
+
+
+static uint16_t
+to_unorm16 (float f)
+{
+    if (f > 1.0f) f = 1.0f;
+    if (f < 0.0f) f = 0.0f;
+    return (uint16_t)lrintf (f * 65535.0f);
+}
+
+static uint8_t
+to_unorm8 (float f)
+{
+    if (f > 1.0f) f = 1.0f;
+    if (f < 0.0f) f = 0.0f;
+    return (uint8_t)lrintf (f * 255.0f);
+}
+
+
+/* ---------------------------------------------------------------- *
+ *  vertex layout
+ * ---------------------------------------------------------------- */
+static void
+get_attrib_format (int attr, unsigned int format, mesh_attrib_t *a)
+{
+    a->normalized = GL_FALSE;
+    a->type = GL_FLOAT;
+
+    switch (attr)
+    {
+    case MESH_ATTR_VTX:
+        if (format & MESH_FMT_VTX_HALF) { a->size = 4; a->type = GL_HALF_FLOAT; }
+        else                            { a->size = 3; }
+        break;
+    case MESH_ATTR_NRM:
+    case MESH_ATTR_TNG:
+        if (format & ((attr == MESH_ATTR_NRM) ? MESH_FMT_NRM_OCT : MESH_FMT_TNG_OCT))
+            { a->size = 2; a->type = GL_SHORT; a->normalized = GL_TRUE; }
+        else
+            { a->size = 3; }
+        break;
+    case MESH_ATTR_UV:
+        if (format & MESH_FMT_UV_UNORM16) { a->size = 2; a->type = GL_UNSIGNED_SHORT; a->normalized = GL_TRUE; }
+        else                              { a->size = 2; }
+        break;
+    case MESH_ATTR_CLR:
+        if (format & MESH_FMT_CLR_UNORM8) { a->size = 4; a->type = GL_UNSIGNED_BYTE; a->normalized = GL_TRUE; }
+        else                              { a->size = 3; }
+        break;
+    }
+}
+
+static GLsizei
+get_type_size (GLenum type)
+{
+    switch (type)
+    {
+    case GL_UNSIGNED_BYTE:  return 1;
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+    case GL_HALF_FLOAT:     return 2;
+    default:                return 4;
+    }
+}
+
+/* every attribute is 4 byte aligned */
+static GLsizei
+setup_layout (unsigned int attr_mask, unsigned int format, mesh_attrib_t *attrib)
+{
+    GLsizei offset = 0;
+
+    for (int i = 0; i < MESH_ATTR_NUM; i ++)
+    {
+        mesh_attrib_t a;
+
+        if ((attr_mask & (1u << i)) == 0)
+            continue;
+
+        get_attrib_format (i, format, &a);
+        a.offset = offset;
+        offset += (a.size * get_type_size (a.type) + 3) & ~3;
+
+        if (attrib)
+            attrib[i] = a;
+    }
+    return offset;
+}
+
+GLsizei
+mesh_get_stride (unsigned int attr_mask, unsigned int format)
+{
+    return setup_layout (attr_mask, format, NULL);
+}
+
+
+static void
+pack_vertex (mesh_obj_t *mesh, const mesh_src_t *src, int n, uint8_t *dst)
+{
+    mesh_attrib_t *attrib = mesh->attrib;
+    unsigned int   format = mesh->format;
+
+    if (src->vtx)
+    {
+        const float *v = &src->vtx[3 * n];
+        void *p = dst + attrib[MESH_ATTR_VTX].offset;
+
+        if (format & MESH_FMT_VTX_HALF)
+        {
+            uint16_t h[4] = {mesh_float_to_half (v[0]), mesh_float_to_half (v[1]),
+                             mesh_float_to_half (v[2]), mesh_float_to_half (1.0f)};
+            memcpy (p, h, sizeof (h));
+        }
+        else
+            memcpy (p, v, sizeof (float) * 3);
+    }
+
+    if (src->nrm)
+    {
+        const float *v = &src->nrm[3 * n];
+        void *p = dst + attrib[MESH_ATTR_NRM].offset;
+        int16_t oct[2];
+
+        if (format & MESH_FMT_NRM_OCT)
+        {
+            mesh_oct_encode (v, oct);
+            memcpy (p, oct, sizeof (oct));
+        }
+        else
+            memcpy (p, v, sizeof (float) * 3);
+    }
+
+    if (src->uv)
+    {
+        const float *v = &src->uv[2 * n];
+        void *p = dst + attrib[MESH_ATTR_UV].offset;
+
+        if (format & MESH_FMT_UV_UNORM16)
+        {
+            uint16_t uv[2] = {to_unorm16 (v[0]), to_unorm16 (v[1])};
+            memcpy (p, uv, sizeof (uv));
+        }
+        else
+            memcpy (p, v, sizeof (float) * 2);
+    }
+
+    if (src->tng)
+    {
+        const float *v = &src->tng[3 * n];
+        void *p = dst + attrib[MESH_ATTR_TNG].offset;
+        int16_t oct[2];
+
+        if (format & MESH_FMT_TNG_OCT)
+        {
+            mesh_oct_encode (v, oct);
+            memcpy (p, oct, sizeof (oct));
+        }
+        else
+            memcpy (p, v, sizeof (float) * 3);
+    }
+
+    if (src->clr)
+    {
+        const float *v = &src->clr[3 * n];
+        void *p = dst + attrib[MESH_ATTR_CLR].offset;
+
+        if (format & MESH_FMT_CLR_UNORM8)
+        {
+            uint8_t c[4] = {to_unorm8 (v[0]), to_unorm8 (v[1]), to_unorm8 (v[2]), 255};
+            memcpy (p, c, sizeof (c));
+        }
+        else
+            memcpy (p, v, sizeof (float) * 3);
+    }
+}
+
+
+/* ---------------------------------------------------------------- *
+ *  mesh object
+ * ---------------------------------------------------------------- */
+int
+mesh_create (mesh_obj_t *mesh, const mesh_src_t *src, unsigned int format)
+{
+    const float *arrays[MESH_ATTR_NUM] = {src->vtx, src->nrm, src->uv, src->tng, src->clr};
+
+    memset (mesh, 0, sizeof (*mesh));
+
+    for (int i = 0; i < MESH_ATTR_NUM; i ++)
+    {
+        if (arrays[i])
+            mesh->attr_mask |= (1u << i);
+    }
+    if (src->vtx == NULL || src->num_vtx <= 0)
+    {
+        LOGE ("%s: no vertex\n", __FUNCTION__);
+        return -1;
+    }
+
+    mesh->format   = format;
+    mesh->stride   = setup_layout (mesh->attr_mask, format, mesh->attrib);
+    mesh->prim     = src->prim;
+    mesh->idx_type = src->idx_type;
+    mesh->num_vtx  = src->num_vtx;
+    mesh->num_idx  = src->num_idx;
+
+    uint8_t *buf = (uint8_t *)calloc (src->num_vtx, mesh->stride);
+    if (buf == NULL)
+        return -1;
+
+    for (int i = 0; i < src->num_vtx; i ++)
+        pack_vertex (mesh, src, i, buf + i * mesh->stride);
+
+    glGenBuffers (1, &mesh->vbo);
+    glstate_bind_buffer (GL_ARRAY_BUFFER, mesh->vbo);
+    glBufferData (GL_ARRAY_BUFFER, (GLsizeiptr)src->num_vtx * mesh->stride, buf, GL_STATIC_DRAW);
+    free (buf);
+
+    /* the element buffer is attached to each VAO by mesh_bind() */
+    if (src->num_idx > 0)
+    {
+        GLsizeiptr size = (GLsizeiptr)src->num_idx *
+                          ((src->idx_type == GL_UNSIGNED_INT) ? 4 : 2);
+
+        glstate_bind_vertex_array (0);
+        glGenBuffers (1, &mesh->ibo);
+        glstate_bind_buffer (GL_ELEMENT_ARRAY_BUFFER, mesh->ibo);
+        glBufferData (GL_ELEMENT_ARRAY_BUFFER, size, src->idx, GL_STATIC_DRAW);
+    }
+
+    GLASSERT ();
+    return 0;
+}
+
+
+void
+mesh_destroy (mesh_obj_t *mesh)
+{
+    glstate_delete_vertex_arrays (mesh->vao_num, mesh->vao);
+    glstate_delete_buffers (1, &mesh->vbo);
+    if (mesh->ibo)
+        glstate_delete_buffers (1, &mesh->ibo);
+
+    memset (mesh, 0, sizeof (*mesh));
+}
+
+
+int
+mesh_bind (mesh_obj_t *mesh, GLuint program)
+{
+    for (int i = 0; i < mesh->vao_num; i ++)
+    {
+        if (mesh->program[i] == program)
+        {
+            glstate_bind_vertex_array (mesh->vao[i]);
+            return 0;
+        }
+    }
+
+    if (mesh->vao_num >= MESH_VAO_MAX)
+    {
+        LOGE ("%s: too many programs (%d)\n", __FUNCTION__, mesh->vao_num);
+        return -1;
+    }
+
+    GLuint vao;
+    glGenVertexArrays (1, &vao);
+    glstate_bind_vertex_array (vao);
+    glstate_bind_buffer (GL_ARRAY_BUFFER, mesh->vbo);
+
+    for (int i = 0; i < MESH_ATTR_NUM; i ++)
+    {
+        mesh_attrib_t *a = &mesh->attrib[i];
+        GLint loc;
+
+        if ((mesh->attr_mask & (1u << i)) == 0)
+            continue;
+
+        loc = glGetAttribLocation (program, s_attr_name[i]);
+        if (loc < 0)
+            continue;
+
+        glstate_enable_vertex_attrib_array (loc);
+        glVertexAttribPointer (loc, a->size, a->type, a->normalized, mesh->stride,
+                               (const void *)(uintptr_t)a->offset);
+    }
+
+    if (mesh->ibo)
+        glstate_bind_buffer (GL_ELEMENT_ARRAY_BUFFER, mesh->ibo);
+
+    mesh->vao    [mesh->vao_num] = vao;
+    mesh->program[mesh->vao_num] = program;
+    mesh->vao_num ++;
+
+    GLASSERT ();
+    return 1;
+}
+
+
+void
+mesh_draw (mesh_obj_t *mesh)
+{
+    if (mesh->ibo)
+        glDrawElements (mesh->prim, mesh->num_idx, mesh->idx_type, 0);
+    else
+        glDrawArrays (mesh->prim, 0, mesh->num_vtx);
+}
+
+void
+mesh_draw_instanced (mesh_obj_t *mesh, int num)
+{
+    if (mesh->ibo)
+        glDrawElementsInstanced (mesh->prim, mesh->num_idx, mesh->idx_type, 0, num);
+    else
+        glDrawArraysInstanced (mesh->prim, 0, mesh->num_vtx, num);
+}
+
+
+/* ---------------------------------------------------------------- *
+ *  index conditioning
+ * ---------------------------------------------------------------- */
+static inline unsigned int
+get_index (const void *idx, GLenum idx_type, int i)
+{
+    if (idx_type == GL_UNSIGNED_INT)
+        return ((const uint32_t *)idx)[i];
+    return ((const uint16_t *)idx)[i];
+}
+
+static inline void
+set_index (void *idx, GLenum idx_type, int i, unsigned int val)
+{
+    if (idx_type == GL_UNSIGNED_INT)
+        ((uint32_t *)idx)[i] = val;
+    else
+        ((uint16_t *)idx)[i] = (uint16_t)val;
+}
+
+
+/*
+ *  triangle strips -> triangle list, in the same winding.
+ *  the degenerate triangles joining the strips are dropped.
+ */
+int
+mesh_strips_to_triangles (const void *strip_idx, GLenum idx_type,
+                          const mesh_strip_t *strips, int num_strips, void *tri_idx)
+{
+    int num_idx = 0;
+
+    for (int s = 0; s < num_strips; s ++)
+    {
+        for (int k = 0; k + 2 < strips[s].count; k ++)
+        {
+            int i = strips[s].first + k;
+            unsigned int a = get_index (strip_idx, idx_type, i + 0);
+            unsigned int b = get_index (strip_idx, idx_type, i + 1);
+            unsigned int c = get_index (strip_idx, idx_type, i + 2);
+
+            if (a == b || b == c || c == a)
+                continue;
+
+            /* the odd triangles of a strip are flipped */
+            if (k & 1)
+            {
+                unsigned int t = a; a = b; b = t;
+            }
+            set_index (tri_idx, idx_type, num_idx ++, a);
+            set_index (tri_idx, idx_type, num_idx ++, b);
+            set_index (tri_idx, idx_type, num_idx ++, c);
+        }
+    }
+    return num_idx;
+}
+
+
+/* average cache miss ratio: transformed vertices per triangle, FIFO cache */
+float
+mesh_get_acmr (const void *idx, GLenum idx_type, int num_idx, int num_vtx, int cache_size)
+{
+    int *stamp = (int *)malloc (sizeof (int) * num_vtx);
+    int miss = 0;
+
+    if (stamp == NULL || num_idx < 3)
+    {
+        free (stamp);
+        return 0.0f;
+    }
+
+    /* a vertex is in the cache while fewer than (cache_size) misses followed its own */
+    for (int v = 0; v < num_vtx; v ++)
+        stamp[v] = -cache_size;
+
+    for (int i = 0; i < num_idx; i ++)
+    {
+        unsigned int v = get_index (idx, idx_type, i);
+        if (miss - stamp[v] >= cache_size)
+            stamp[v] = ++ miss;
+    }
+
+    free (stamp);
+    return (float)miss / (float)(num_idx / 3);
+}
+
+
+/*
+ *  Tom Forsyth, "Linear-Speed Vertex Cache Optimisation" (2006).
+ *    the triangles are emitted greedily by a score of their vertices:
+ *    recently used ones, and ones with few triangles left, score high.
+ */
+#define VCACHE_SIZE             32
+#define VCACHE_DECAY_POWER      1.5f
+#define VCACHE_LAST_TRI_SCORE   0.75f
+#define VCACHE_VALENCE_SCALE    2.0f
+#define VCACHE_VALENCE_POWER    0.5f
+
+static float
+get_vertex_score (int cache_pos, int num_tris)
+{
+    float score = 0.0f;
+
+    if (num_tris == 0)
+        return -1.0f;
+
+    if (cache_pos >= 3)
+    {
+        float s = 1.0f - (float)(cache_pos - 3) / (float)(VCACHE_SIZE - 3);
+        score = powf (s, VCACHE_DECAY_POWER);
+    }
+    else if (cache_pos >= 0)
+    {
+        /* the last triangle's vertices: fixed, not to favor its neighbors too much */
+        score = VCACHE_LAST_TRI_SCORE;
+    }
+
+    score += VCACHE_VALENCE_SCALE * powf ((float)num_tris, -VCACHE_VALENCE_POWER);
+    return score;
+}
+
+int
+mesh_optimize_vcache (void *idx, GLenum idx_type, int num_idx, int num_vtx)
+{
+    int   num_tri = num_idx / 3;
+    int   *tri_start  = (int   *)calloc (num_vtx + 1, sizeof (int));
+    int   *tri_live   = (int   *)calloc (num_vtx,     sizeof (int));
+    int   *cache_pos  = (int   *)malloc (num_vtx * sizeof (int));
+    float *vtx_score  = (float *)malloc (num_vtx * sizeof (float));
+    int   *vtx_tris   = (int   *)malloc (num_idx * sizeof (int));
+    float *tri_score  = (float *)malloc (num_tri * sizeof (float));
+    char  *tri_done   = (char  *)calloc (num_tri, 1);
+    unsigned int *dst = (unsigned int *)malloc (num_idx * sizeof (unsigned int));
+    int   cache[VCACHE_SIZE + 3], cache_num = 0;
+    int   ret = -1;
+
+    if (!tri_start || !tri_live || !cache_pos || !vtx_score || !vtx_tris ||
+        !tri_score || !tri_done || !dst)
+    {
+        LOGE ("%s: can't allocate\n", __FUNCTION__);
+        goto exit;
+    }
+
+    /* the triangles of each vertex */
+    for (int i = 0; i < num_idx; i ++)
+        tri_start[get_index (idx, idx_type, i) + 1] ++;
+    for (int v = 0; v < num_vtx; v ++)
+        tri_start[v + 1] += tri_start[v];
+    for (int i = 0; i < num_tri * 3; i ++)
+    {
+        unsigned int v = get_index (idx, idx_type, i);
+        vtx_tris[tri_start[v] + tri_live[v] ++] = i / 3;
+    }
+
+    for (int v = 0; v < num_vtx; v ++)
+    {
+        cache_pos[v] = -1;
+        vtx_score[v] = get_vertex_score (-1, tri_live[v]);
+    }
+    for (int t = 0; t < num_tri; t ++)
+    {
+        tri_score[t] = 0.0f;
+        for (int k = 0; k < 3; k ++)
+            tri_score[t] += vtx_score[get_index (idx, idx_type, t * 3 + k)];
+    }
+
+    int best = -1;
+    for (int n = 0; n < num_tri; n ++)
+    {
+        /* no candidate around the cache: the best of all the rest */
+        if (best < 0)
+        {
+            float best_score = -1.0f;
+            for (int t = 0; t < num_tri; t ++)
+            {
+                if (!tri_done[t] && tri_score[t] > best_score)
+                {
+                    best_score = tri_score[t];
+                    best = t;
+                }
+            }
+        }
+
+        int new_cache[VCACHE_SIZE + 3], new_num = 0;
+
+        tri_done[best] = 1;
+        for (int k = 0; k < 3; k ++)
+        {
+            unsigned int v = get_index (idx, idx_type, best * 3 + k);
+            dst[n * 3 + k] = v;
+
+            /* remove (best) from the live triangles of (v) */
+            int *tris = &vtx_tris[tri_start[v]];
+            for (int j = 0; j < tri_live[v]; j ++)
+            {
+                if (tris[j] == best)
+                {
+                    tris[j] = tris[-- tri_live[v]];
+                    break;
+                }
+            }
+
+            int dup = 0;
+            for (int j = 0; j < new_num; j ++)
+                dup |= (new_cache[j] == (int)v);
+            if (!dup)
+                new_cache[new_num ++] = v;
+        }
+
+        /* the vertices of (best) move to the front, and push the rest back */
+        for (int j = 0; j < cache_num; j ++)
+        {
+            int v = cache[j], dup = 0;
+            for (int k = 0; k < new_num && k < 3; k ++)
+                dup |= (new_cache[k] == v);
+            if (!dup)
+                new_cache[new_num ++] = v;
+        }
+
+        for (int j = 0; j < new_num; j ++)
+        {
+            int v = new_cache[j];
+            cache_pos[v] = (j < VCACHE_SIZE) ? j : -1;
+            vtx_score[v] = get_vertex_score (cache_pos[v], tri_live[v]);
+        }
+
+        /* rescore the triangles around the cache, and find the next one there */
+        best = -1;
+        float best_score = -1.0f;
+        for (int j = 0; j < new_num; j ++)
+        {
+            int v = new_cache[j];
+            for (int i = 0; i < tri_live[v]; i ++)
+            {
+                int t = vtx_tris[tri_start[v] + i];
+                float score = 0.0f;
+                for (int k = 0; k < 3; k ++)
+                    score += vtx_score[get_index (idx, idx_type, t * 3 + k)];
+                tri_score[t] = score;
+
+                if (score > best_score)
+                {
+                    best_score = score;
+                    best = t;
+                }
+            }
+        }
+
+        cache_num = (new_num < VCACHE_SIZE) ? new_num : VCACHE_SIZE;
+        memcpy (cache, new_cache, sizeof (int) * cache_num);
+    }
+
+    for (int i = 0; i < num_tri * 3; i ++)
+        set_index (idx, idx_type, i, dst[i]);
+    ret = 0;
+
+exit:
+    free (tri_start);
+    free (tri_live);
+    free (cache_pos);
+    free (vtx_score);
+    free (vtx_tris);
+    free (tri_score);
+    free (tri_done);
+    free (dst);
+    return ret;
+}
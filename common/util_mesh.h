@@ -0,0 +1,139 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef UTIL_MESH_H_
+#define UTIL_MESH_H_
+
+#include <stdint.h>
+#include <GLES3/gl3.h>
+
+/* vertex attributes, bound to the shader inputs of the same name */
+#define MESH_ATTR_VTX           0       /* a_Vertex   */
+#define MESH_ATTR_NRM           1       /* a_Normal   */
+#define MESH_ATTR_UV            2       /* a_TexCoord */
+#define MESH_ATTR_TNG           3       /* a_Tangent  */
+#define MESH_ATTR_CLR           4       /* a_Color    */
+#define MESH_ATTR_NUM           5
+
+/* vertex encodings. 32bit float when not specified */
+#define MESH_FMT_FLOAT          (0)
+#define MESH_FMT_VTX_HALF       (1 << 0)    /* vec4 half float (w = 1.0)          :  8 bytes */
+#define MESH_FMT_NRM_OCT        (1 << 1)    /* vec2 octahedral, snorm16           :  4 bytes */
+#define MESH_FMT_TNG_OCT        (1 << 2)    /* vec2 octahedral, snorm16           :  4 bytes */
+#define MESH_FMT_UV_UNORM16     (1 << 3)    /* vec2 unorm16, UV in [0, 1]         :  4 bytes */
+#define MESH_FMT_CLR_UNORM8     (1 << 4)    /* vec4 unorm8 (a = 1.0)              :  4 bytes */
+#define MESH_FMT_COMPACT        (0x1f)
+
+#define MESH_VAO_MAX            4       /* programs a mesh is drawn with */
+
+/*
+ *  the shader decodes the octahedral normal/tangent (MESH_FMT_xxx_OCT),
+ *  declared as "vec2", with oct_decode(). GLSL ES 1.00 and 3.00.
+ */
+#define MESH_GLSL_OCT_DECODE                                                \
+"vec3 oct_decode (vec2 e)                                               \n" \
+"{                                                                      \n" \
+"    vec3 v = vec3 (e, 1.0 - abs (e.x) - abs (e.y));                    \n" \
+"    if (v.z < 0.0)                                                     \n" \
+"    {                                                                  \n" \
+"        vec2 s = vec2 (v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);\n" \
+"        v.xy = (1.0 - abs (v.yx)) * s;                                 \n" \
+"    }                                                                  \n" \
+"    return normalize (v);                                              \n" \
+"}                                                                      \n"
+
+/* source arrays of mesh_create(). NULL for an absent attribute */
+typedef struct mesh_src_t
+{
+    int         num_vtx;
+    const float *vtx;       /* xyz */
+    const float *nrm;       /* xyz */
+    const float *uv;        /* uv  */
+    const float *tng;       /* xyz */
+    const float *clr;       /* rgb */
+
+    int         num_idx;    /* 0: drawn with glDrawArrays() */
+    const void  *idx;
+    GLenum      idx_type;   /* GL_UNSIGNED_SHORT, GL_UNSIGNED_INT */
+    GLenum      prim;       /* GL_TRIANGLES etc. */
+} mesh_src_t;
+
+/* a triangle strip in an index array */
+typedef struct mesh_strip_t
+{
+    int         first;
+    int         count;
+} mesh_strip_t;
+
+typedef struct mesh_attrib_t
+{
+    GLint       size;
+    GLenum      type;
+    GLboolean   normalized;
+    GLuint      offset;
+} mesh_attrib_t;
+
+typedef struct mesh_obj_t
+{
+    GLuint          vbo;            /* interleaved vertices */
+    GLuint          ibo;
+    GLsizei         stride;
+    unsigned int    attr_mask;      /* (1 << MESH_ATTR_xxx) */
+    unsigned int    format;         /* MESH_FMT_xxx */
+    mesh_attrib_t   attrib[MESH_ATTR_NUM];
+
+    GLenum          prim;
+    GLenum          idx_type;
+    int             num_vtx;
+    int             num_idx;
+
+    int             vao_num;
+    GLuint          vao    [MESH_VAO_MAX];
+    GLuint          program[MESH_VAO_MAX];  /* the program each VAO is set up for */
+} mesh_obj_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ *  mesh with one interleaved vertex buffer, and a VAO per program.
+ *
+ *    mesh_bind() binds the VAO for (program), and sets it up on the first
+ *    call: it returns 1 then, so that the caller can add its own attributes
+ *    (instance data etc.) to it. The VAO stays bound after the draw: code
+ *    drawing from the default VAO binds it again (util_gl_state.h).
+ */
+int  mesh_create  (mesh_obj_t *mesh, const mesh_src_t *src, unsigned int format);
+void mesh_destroy (mesh_obj_t *mesh);
+int  mesh_bind    (mesh_obj_t *mesh, GLuint program);
+void mesh_draw    (mesh_obj_t *mesh);
+void mesh_draw_instanced (mesh_obj_t *mesh, int num);
+
+GLsizei  mesh_get_stride (unsigned int attr_mask, unsigned int format);
+
+/* encoders. exported for the tests and the CPU side users */
+uint16_t mesh_float_to_half (float f);
+float    mesh_half_to_float (uint16_t h);
+void     mesh_oct_encode (const float *n, int16_t *oct);
+void     mesh_oct_decode (const int16_t *oct, float *n);
+
+/*
+ *  index conditioning, on the CPU before mesh_create().
+ *    mesh_strips_to_triangles() : returns the number of indices written to
+ *                                 (tri_idx), sized for 3 * (count - 2) per strip.
+ *    mesh_optimize_vcache()     : reorders a triangle list in place for the
+ *                                 post-transform vertex cache (Forsyth).
+ *    mesh_get_acmr()            : transformed vertices per triangle with a FIFO
+ *                                 cache of (cache_size). 0.5 at best, 3.0 at worst.
+ */
+int   mesh_strips_to_triangles (const void *strip_idx, GLenum idx_type,
+                                const mesh_strip_t *strips, int num_strips, void *tri_idx);
+int   mesh_optimize_vcache (void *idx, GLenum idx_type, int num_idx, int num_vtx);
+float mesh_get_acmr (const void *idx, GLenum idx_type, int num_idx, int num_vtx, int cache_size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* UTIL_MESH_H_ */
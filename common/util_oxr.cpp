@@ -3,6 +3,7 @@
  * Copyright (c) 2022 terryky1220@gmail.com
  * ------------------------------------------------ */
 #include <string>
+#include <string.h>
 #include <GLES3/gl31.h>
 #include "util_egl.h"
 #include "util_oxr.h"
@@ -28,6 +29,82 @@ MAKE_TO_STRING_FUNC(XrFormFactor);
 static XrInstance s_instance = XR_NULL_HANDLE;
 
 
+/* ---------------------------------------------------------------------------- *
+ *  Extension dispatch table
+ *    xrGetInstanceProcAddr goes through the loader and the runtime, and is far
+ *    too slow for the frame loop. All the extension entry points are resolved
+ *    once per XrInstance. An entry is nullptr if the extension is not enabled.
+ * ---------------------------------------------------------------------------- */
+typedef struct oxr_ext_dispatch_t
+{
+    XrInstance                                  instance;
+    PFN_xrGetOpenGLESGraphicsRequirementsKHR    xrGetOpenGLESGraphicsRequirementsKHR;
+#if defined (XR_KHR_locate_spaces)
+    PFN_xrLocateSpacesKHR                       xrLocateSpacesKHR;
+#endif
+#if defined (XR_KHR_convert_timespec_time)
+    PFN_xrConvertTimespecTimeToTimeKHR          xrConvertTimespecTimeToTimeKHR;
+#endif
+#if defined (XR_FB_foveation) && defined (XR_FB_swapchain_update_state)
+    PFN_xrCreateFoveationProfileFB              xrCreateFoveationProfileFB;
+    PFN_xrDestroyFoveationProfileFB             xrDestroyFoveationProfileFB;
+    PFN_xrUpdateSwapchainFB                     xrUpdateSwapchainFB;
+#endif
+#if defined (USE_OXR_HANDTRACK)
+    PFN_xrCreateHandTrackerEXT                  xrCreateHandTrackerEXT;
+    PFN_xrLocateHandJointsEXT                   xrLocateHandJointsEXT;
+#endif
+#if defined (USE_OXR_PASSTHROUGH)
+    PFN_xrCreatePassthroughFB                   xrCreatePassthroughFB;
+    PFN_xrCreatePassthroughLayerFB              xrCreatePassthroughLayerFB;
+    PFN_xrPassthroughStartFB                    xrPassthroughStartFB;
+    PFN_xrPassthroughLayerResumeFB              xrPassthroughLayerResumeFB;
+    PFN_xrPassthroughLayerSetStyleFB            xrPassthroughLayerSetStyleFB;
+#endif
+} oxr_ext_dispatch_t;
+
+static oxr_ext_dispatch_t s_ext = {XR_NULL_HANDLE};
+
+#define OXR_LOAD_EXT_FUNC(instance, table, name)                                \
+    xrGetInstanceProcAddr (instance, #name, (PFN_xrVoidFunction *)&(table).name)
+
+static const oxr_ext_dispatch_t &
+oxr_get_ext_dispatch (XrInstance instance)
+{
+    if (s_ext.instance == instance)
+        return s_ext;
+
+    s_ext = {};
+    s_ext.instance = instance;
+
+    OXR_LOAD_EXT_FUNC (instance, s_ext, xrGetOpenGLESGraphicsRequirementsKHR);
+#if defined (XR_KHR_locate_spaces)
+    OXR_LOAD_EXT_FUNC (instance, s_ext, xrLocateSpacesKHR);
+#endif
+#if defined (XR_KHR_convert_timespec_time)
+    OXR_LOAD_EXT_FUNC (instance, s_ext, xrConvertTimespecTimeToTimeKHR);
+#endif
+#if defined (XR_FB_foveation) && defined (XR_FB_swapchain_update_state)
+    OXR_LOAD_EXT_FUNC (instance, s_ext, xrCreateFoveationProfileFB);
+    OXR_LOAD_EXT_FUNC (instance, s_ext, xrDestroyFoveationProfileFB);
+    OXR_LOAD_EXT_FUNC (instance, s_ext, xrUpdateSwapchainFB);
+#endif
+#if defined (USE_OXR_HANDTRACK)
+    OXR_LOAD_EXT_FUNC (instance, s_ext, xrCreateHandTrackerEXT);
+    OXR_LOAD_EXT_FUNC (instance, s_ext, xrLocateHandJointsEXT);
+#endif
+#if defined (USE_OXR_PASSTHROUGH)
+    OXR_LOAD_EXT_FUNC (instance, s_ext, xrCreatePassthroughFB);
+    OXR_LOAD_EXT_FUNC (instance, s_ext, xrCreatePassthroughLayerFB);
+    OXR_LOAD_EXT_FUNC (instance, s_ext, xrPassthroughStartFB);
+    OXR_LOAD_EXT_FUNC (instance, s_ext, xrPassthroughLayerResumeFB);
+    OXR_LOAD_EXT_FUNC (instance, s_ext, xrPassthroughLayerSetStyleFB);
+#endif
+
+    return s_ext;
+}
+
+
 /* ---------------------------------------------------------------------------- *
  *  Initialize OpenXR Loader
  * ---------------------------------------------------------------------------- */
@@ -72,6 +149,49 @@ oxr_enumerate_instance_ext ()
     }
 }
 
+bool
+oxr_is_instance_ext_supported (const char *name)
+{
+    uint32_t ext_count = 0;
+    xrEnumerateInstanceExtensionProperties (NULL, 0, &ext_count, NULL);
+
+    std::vector<XrExtensionProperties> extProps (ext_count, {XR_TYPE_EXTENSION_PROPERTIES});
+    xrEnumerateInstanceExtensionProperties (NULL, ext_count, &ext_count, extProps.data());
+
+    for (uint32_t i = 0; i < ext_count; i++)
+    {
+        if (strcmp (extProps[i].extensionName, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+/*
+ *  shift the CPU profiler onto the XrTime clock, so that its scopes line up
+ *  with predictedDisplayTime. the Android runtimes use CLOCK_MONOTONIC for
+ *  XrTime, which is the profiler's own clock without the extension.
+ */
+static void
+oxr_sync_profiler_clock (XrInstance instance)
+{
+#if defined (XR_KHR_convert_timespec_time)
+    const oxr_ext_dispatch_t &ext = oxr_get_ext_dispatch (instance);
+    if (ext.xrConvertTimespecTimeToTimeKHR == nullptr)
+        return;
+
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    XrTime xr_time;
+    if (XR_FAILED (ext.xrConvertTimespecTimeToTimeKHR (instance, &ts, &xr_time)))
+        return;
+
+    int64_t mono_ns = (int64_t)ts.tv_sec * 1000000000ll + ts.tv_nsec;
+    cpu_profiler_set_clock_offset (xr_time - mono_ns);
+    LOGI ("CPU profiler clock: XrTime - CLOCK_MONOTONIC = %lld ns", (long long)(xr_time - mono_ns));
+#endif
+}
+
 XrInstance
 oxr_create_instance (void *appVM, void *appCtx)
 {
@@ -89,6 +209,27 @@ oxr_create_instance (void *appVM, void *appCtx)
 #if defined (USE_OXR_PASSTHROUGH)
     extensions.push_back (XR_FB_PASSTHROUGH_EXTENSION_NAME);
 #endif
+#if defined (XR_KHR_locate_spaces)
+    /* optional: SpaceLocator falls back to xrLocateSpace without it */
+    if (oxr_is_instance_ext_supported (XR_KHR_LOCATE_SPACES_EXTENSION_NAME))
+        extensions.push_back (XR_KHR_LOCATE_SPACES_EXTENSION_NAME);
+#endif
+#if defined (XR_KHR_convert_timespec_time)
+    /* optional: the CPU profiler assumes XrTime == CLOCK_MONOTONIC without it */
+    if (oxr_is_instance_ext_supported (XR_KHR_CONVERT_TIMESPEC_TIME_EXTENSION_NAME))
+        extensions.push_back (XR_KHR_CONVERT_TIMESPEC_TIME_EXTENSION_NAME);
+#endif
+#if defined (XR_FB_foveation) && defined (XR_FB_swapchain_update_state)
+    /* optional: oxr_set_foveation() does nothing without them */
+    if (oxr_is_instance_ext_supported (XR_FB_FOVEATION_EXTENSION_NAME) &&
+        oxr_is_instance_ext_supported (XR_FB_FOVEATION_CONFIGURATION_EXTENSION_NAME) &&
+        oxr_is_instance_ext_supported (XR_FB_SWAPCHAIN_UPDATE_STATE_EXTENSION_NAME))
+    {
+        extensions.push_back (XR_FB_FOVEATION_EXTENSION_NAME);
+        extensions.push_back (XR_FB_FOVEATION_CONFIGURATION_EXTENSION_NAME);
+        extensions.push_back (XR_FB_SWAPCHAIN_UPDATE_STATE_EXTENSION_NAME);
+    }
+#endif
 
     XrInstanceCreateInfoAndroidKHR ciAndroid = {XR_TYPE_INSTANCE_CREATE_INFO_ANDROID_KHR};
     ciAndroid.applicationVM       = appVM;
@@ -104,6 +245,8 @@ oxr_create_instance (void *appVM, void *appCtx)
     XrInstance instance;
     OXR_CHECK (xrCreateInstance (&ci, &instance));
     s_instance = instance;
+    oxr_get_ext_dispatch (instance);
+    oxr_sync_profiler_clock (instance);
 
     /* query instance name, version */
     XrInstanceProperties prop = {XR_TYPE_INSTANCE_PROPERTIES};
@@ -188,12 +331,10 @@ oxr_get_system_name (XrInstance instance, XrSystemId sysid)
 int
 oxr_confirm_gfx_requirements (XrInstance instance, XrSystemId sysid)
 {
-    PFN_xrGetOpenGLESGraphicsRequirementsKHR xrGetOpenGLESGraphicsRequirementsKHR;
-    xrGetInstanceProcAddr (instance, "xrGetOpenGLESGraphicsRequirementsKHR",
-                           (PFN_xrVoidFunction *)&xrGetOpenGLESGraphicsRequirementsKHR);
+    const oxr_ext_dispatch_t &ext = oxr_get_ext_dispatch (instance);
 
     XrGraphicsRequirementsOpenGLESKHR gfxReq = {XR_TYPE_GRAPHICS_REQUIREMENTS_OPENGL_ES_KHR};
-    xrGetOpenGLESGraphicsRequirementsKHR (instance, sysid, &gfxReq);
+    ext.xrGetOpenGLESGraphicsRequirementsKHR (instance, sysid, &gfxReq);
 
 
     GLint major, minor;
@@ -282,23 +423,73 @@ oxr_locate_views (XrSession session, XrTime dpy_time, XrSpace space, uint32_t *v
  *    +-- view[1] -- viewSurface[1]
  *                   +----------------------------------------------+
  *                   | uint32_t    width, height                    |
+ *                   | float       render_scale  (of imageRect)     |
  *                   | XrSwapchain swapchain                        |
  *                   | rtarget_array[0]: (fbo_id, texc_id, texz_id) |
  *                   | rtarget_array[1]: (fbo_id, texc_id, texz_id) |
  *                   | rtarget_array[2]: (fbo_id, texc_id, texz_id) |
  *                   +----------------------------------------------+
+ *                   (share_depth: every texz_id is that of rtarget_array[0])
+ *
+ *  With GL_OVR_multiview2, both views share one 2-layer array swapchain:
+ *
+ *  --+-- view[0] -- viewSurface[0] (array_size = 2, imageArrayIndex = 0)
+ *    |
+ *    +-- view[1] -- viewSurface[0] (array_size = 2, imageArrayIndex = 1)
  *
  * ---------------------------------------------------------------------------- */
+static const oxr_swapchain_config_t s_default_swapchain_config = OXR_SWAPCHAIN_CONFIG_DEFAULT;
+
+/*
+ *  pick the first of the candidates the runtime supports.
+ *  falls back to the runtime's most preferred format.
+ */
+static int64_t
+oxr_select_swapchain_format (XrSession session, const oxr_swapchain_config_t &config)
+{
+    uint32_t fmtCnt;
+    xrEnumerateSwapchainFormats (session, 0, &fmtCnt, NULL);
+    if (fmtCnt == 0)
+        return GL_RGBA8;
+
+    std::vector<int64_t> formats (fmtCnt);
+    xrEnumerateSwapchainFormats (session, fmtCnt, &fmtCnt, formats.data());
+
+    static const int64_t s_linear_first[] = {GL_RGBA8, GL_SRGB8_ALPHA8};
+    static const int64_t s_srgb_first[]   = {GL_SRGB8_ALPHA8, GL_RGBA8};
+
+    const int64_t *cand    = config.srgb ? s_srgb_first : s_linear_first;
+    uint32_t      candNum  = 2;
+    if (config.color_formats != NULL)
+    {
+        cand    = config.color_formats;
+        candNum = config.color_format_num;
+    }
+
+    for (uint32_t i = 0; i < candNum; i ++)
+    {
+        for (uint32_t j = 0; j < fmtCnt; j ++)
+        {
+            if (formats[j] == cand[i])
+                return cand[i];
+        }
+    }
+
+    LOGW ("no requested swapchain format is supported. use 0x%x.", (int)formats[0]);
+    return formats[0];
+}
+
+
 static XrSwapchain
-oxr_create_swapchain (XrSession session, uint32_t width, uint32_t height)
+oxr_create_swapchain (XrSession session, uint32_t width, uint32_t height, uint32_t array_size, int64_t format)
 {
     XrSwapchainCreateInfo ci = {XR_TYPE_SWAPCHAIN_CREATE_INFO};
     ci.usageFlags  = XR_SWAPCHAIN_USAGE_SAMPLED_BIT | XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT;
-    ci.format      = GL_RGBA8;
+    ci.format      = format;
     ci.width       = width;
     ci.height      = height;
     ci.faceCount   = 1;
-    ci.arraySize   = 1;
+    ci.arraySize   = array_size;
     ci.mipCount    = 1;
     ci.sampleCount = 1;
 
@@ -310,7 +501,8 @@ oxr_create_swapchain (XrSession session, uint32_t width, uint32_t height)
 
 
 static int
-oxr_alloc_swapchain_rtargets (XrSwapchain swapchain, uint32_t width, uint32_t height,
+oxr_alloc_swapchain_rtargets (XrSwapchain swapchain, uint32_t width, uint32_t height, int64_t format,
+                              GLenum depth_format, uint32_t sample_count, bool share_depth,
                               std::vector<render_target_t> &rtarget_array)
 {
     uint32_t imgCnt;
@@ -324,39 +516,21 @@ oxr_alloc_swapchain_rtargets (XrSwapchain swapchain, uint32_t width, uint32_t he
 
     for (uint32_t i = 0; i < imgCnt; i ++)
     {
-        GLuint tex_c = img_gles[i].image;
-        GLuint tex_z = 0;
-        GLuint fbo   = 0;
-
-        /* Depth Buffer */
-        glGenRenderbuffers (1, &tex_z);
-        glBindRenderbuffer (GL_RENDERBUFFER, tex_z);
-        glRenderbufferStorage (GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        /* the first image owns the depth, the others attach it if shared */
+        GLuint shared_z = (share_depth && !rtarget_array.empty()) ? rtarget_array[0].texz_id : 0;
 
-        /* FBO */
-        glGenFramebuffers (1, &fbo);
-        glBindFramebuffer (GL_FRAMEBUFFER, fbo);
-        glFramebufferTexture2D    (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,   tex_c, 0);
-        glFramebufferRenderbuffer (GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,  GL_RENDERBUFFER, tex_z);
-
-        GLenum stat = glCheckFramebufferStatus (GL_FRAMEBUFFER);
-        if (stat != GL_FRAMEBUFFER_COMPLETE)
+        render_target_t rtarget;
+        if (attach_render_target (&rtarget, img_gles[i].image, (GLenum)format, width, height,
+                                  depth_format, sample_count, shared_z) < 0)
         {
             LOGE ("FBO Imcomplete");
+            free (img_gles);
             return -1;
         }
-        glBindRenderbuffer (GL_RENDERBUFFER, 0);
-        glBindFramebuffer (GL_FRAMEBUFFER, 0);
-
-        render_target_t rtarget;
-        rtarget.texc_id = tex_c;
-        rtarget.texz_id = tex_z;
-        rtarget.fbo_id  = fbo;
-        rtarget.width   = width;
-        rtarget.height  = height;
         rtarget_array.push_back (rtarget);
 
-        LOGI ("SwapchainImage[%d/%d] FBO:%d, TEXC:%d, TEXZ:%d, WH(%d, %d)", i, imgCnt, fbo, tex_c, tex_z, width, height);
+        LOGI ("SwapchainImage[%d/%d] FBO:%d, TEXC:%d, TEXZ:%d, WH(%d, %d), MSAA(%d)", i, imgCnt,
+              rtarget.fbo_id, rtarget.texc_id, rtarget.texz_id, width, height, sample_count);
     }
     free (img_gles);
     return 0;
@@ -367,22 +541,43 @@ static uint32_t
 oxr_acquire_swapchain_img (XrSwapchain swapchain)
 {
     uint32_t imgIdx;
-    XrSwapchainImageAcquireInfo acquireInfo {XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO};
-    xrAcquireSwapchainImage (swapchain, &acquireInfo, &imgIdx);
+    {
+        CPU_PROF_SCOPE ("xrAcquireSwapchainImage");
+        XrSwapchainImageAcquireInfo acquireInfo {XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO};
+        xrAcquireSwapchainImage (swapchain, &acquireInfo, &imgIdx);
+    }
 
-    XrSwapchainImageWaitInfo waitInfo {XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
-    waitInfo.timeout = XR_INFINITE_DURATION;
-    xrWaitSwapchainImage (swapchain, &waitInfo);
+    {
+        CPU_PROF_SCOPE ("xrWaitSwapchainImage");
+        XrSwapchainImageWaitInfo waitInfo {XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
+        waitInfo.timeout = XR_INFINITE_DURATION;
+        xrWaitSwapchainImage (swapchain, &waitInfo);
+    }
 
     return imgIdx;
 }
 
 
+/* one swapchain per view. Returns an empty vector when an image can't be attached to an FBO. */
 std::vector<viewsurface_t>
-oxr_create_viewsurface (XrInstance instance, XrSystemId sysid, XrSession session)
+oxr_create_viewsurface (XrInstance instance, XrSystemId sysid, XrSession session,
+                        const oxr_swapchain_config_t *config)
 {
     std::vector<viewsurface_t> sfcArray;
 
+    if (config == NULL)
+        config = &s_default_swapchain_config;
+
+    int64_t  format  = oxr_select_swapchain_format (session, *config);
+    uint32_t samples = config->sample_count;
+    if (samples > (uint32_t)get_msaa_rtt_max_samples ())
+    {
+        LOGW ("MSAA x%d is not available. use x%d.", samples, get_msaa_rtt_max_samples ());
+        samples = get_msaa_rtt_max_samples ();
+    }
+    if (samples < 1)
+        samples = 1;
+
     uint32_t viewCount;
     XrViewConfigurationView *conf_views = oxr_enumerate_viewconfig (instance, sysid, &viewCount);
 
@@ -392,16 +587,152 @@ oxr_create_viewsurface (XrInstance instance, XrSystemId sysid, XrSession session
         uint32_t vp_w = vp.recommendedImageRectWidth;
         uint32_t vp_h = vp.recommendedImageRectHeight;
 
-        LOGI("Swapchain for view %d: WH(%d, %d), SampleCount=%d", i, vp_w, vp_h, vp.recommendedSwapchainSampleCount);
+        LOGI("Swapchain for view %d: WH(%d, %d), Format=0x%x, SampleCount=%d (recommended %d), Depth=0x%x",
+             i, vp_w, vp_h, (int)format, samples, vp.recommendedSwapchainSampleCount, config->depth_format);
 
         viewsurface_t sfc;
-        sfc.width     = vp_w;
-        sfc.height    = vp_h;
-        sfc.swapchain = oxr_create_swapchain (session, sfc.width, sfc.height);
-        oxr_alloc_swapchain_rtargets (sfc.swapchain, sfc.width, sfc.height, sfc.rtarget_array);
-
+        sfc.width        = vp_w;
+        sfc.height       = vp_h;
+        sfc.array_size   = 1;
+        sfc.format       = format;
+        sfc.sample_count = samples;
+        sfc.acquired_idx = 0;
+        sfc.render_scale = 1.0f;
+        sfc.swapchain    = oxr_create_swapchain (session, sfc.width, sfc.height, 1, format);
         sfcArray.push_back (sfc);
+
+        /* the frames index rtarget_array by the swapchain image: no view is usable without all of them */
+        if (oxr_alloc_swapchain_rtargets (sfc.swapchain, sfc.width, sfc.height, format, config->depth_format,
+                                          samples, config->share_depth, sfcArray.back ().rtarget_array) < 0)
+        {
+            for (auto &created : sfcArray)
+            {
+                for (auto &rtarget : created.rtarget_array)
+                    detach_render_target (&rtarget);
+                xrDestroySwapchain (created.swapchain);
+            }
+            sfcArray.clear ();
+            break;
+        }
+    }
+    free (conf_views);
+
+    if (sfcArray.empty ())
+        return sfcArray;
+
+    if (config->foveation_level != FOVEATION_LEVEL_NONE || config->foveation_dynamic)
+        oxr_set_foveation (instance, session, sfcArray, config->foveation_level, config->foveation_dynamic);
+
+    report_render_target_memory ();
+
+    return sfcArray;
+}
+
+
+static int
+oxr_alloc_swapchain_rtargets_multiview (XrSwapchain swapchain, uint32_t width, uint32_t height,
+                                        uint32_t array_size, int64_t format, GLenum depth_format,
+                                        bool share_depth, std::vector<render_target_t> &rtarget_array)
+{
+    uint32_t imgCnt;
+    xrEnumerateSwapchainImages (swapchain, 0, &imgCnt, NULL);
+
+    XrSwapchainImageOpenGLESKHR *img_gles = (XrSwapchainImageOpenGLESKHR *)calloc(sizeof(XrSwapchainImageOpenGLESKHR), imgCnt);
+    for (uint32_t i = 0; i < imgCnt; i ++)
+        img_gles[i].type = XR_TYPE_SWAPCHAIN_IMAGE_OPENGL_ES_KHR;
+
+    xrEnumerateSwapchainImages (swapchain, imgCnt, &imgCnt, (XrSwapchainImageBaseHeader *)img_gles);
+
+    for (uint32_t i = 0; i < imgCnt; i ++)
+    {
+        /* the first image owns the depth array, the others attach it if shared */
+        GLuint shared_z = (share_depth && !rtarget_array.empty()) ? rtarget_array[0].texz_id : 0;
+
+        render_target_t rtarget;
+        if (attach_render_target_multiview (&rtarget, img_gles[i].image, (GLenum)format, width, height,
+                                            array_size, depth_format, shared_z) < 0)
+        {
+            LOGE ("FBO Imcomplete");
+            free (img_gles);
+            return -1;
+        }
+        rtarget_array.push_back (rtarget);
+
+        LOGI ("SwapchainImage[%d/%d] FBO:%d, TEXC:%d, TEXZ:%d, WH(%d, %d), Multiview(%d)", i, imgCnt,
+              rtarget.fbo_id, rtarget.texc_id, rtarget.texz_id, width, height, array_size);
     }
+    free (img_gles);
+    return 0;
+}
+
+
+/*
+ *  Create one array swapchain shared by all the views.
+ *  Returns an empty vector when GL_OVR_multiview2 is not available, or the
+ *  views differ in size. The caller then falls back to oxr_create_viewsurface().
+ *  (config->sample_count) is ignored: the multiview FBO is single sampled.
+ */
+std::vector<viewsurface_t>
+oxr_create_viewsurface_multiview (XrInstance instance, XrSystemId sysid, XrSession session,
+                                  const oxr_swapchain_config_t *config)
+{
+    std::vector<viewsurface_t> sfcArray;
+
+    if (!is_multiview_supported ())
+    {
+        LOGI ("GL_OVR_multiview2 is not supported.");
+        return sfcArray;
+    }
+
+    if (config == NULL)
+        config = &s_default_swapchain_config;
+
+    uint32_t viewCount;
+    XrViewConfigurationView *conf_views = oxr_enumerate_viewconfig (instance, sysid, &viewCount);
+
+    uint32_t vp_w = conf_views[0].recommendedImageRectWidth;
+    uint32_t vp_h = conf_views[0].recommendedImageRectHeight;
+    for (uint32_t i = 1; i < viewCount; i ++)
+    {
+        if (conf_views[i].recommendedImageRectWidth  != vp_w ||
+            conf_views[i].recommendedImageRectHeight != vp_h)
+        {
+            LOGI ("Multiview is disabled: views differ in size.");
+            free (conf_views);
+            return sfcArray;
+        }
+    }
+    free (conf_views);
+
+    int64_t format = oxr_select_swapchain_format (session, *config);
+
+    LOGI("Multiview Swapchain for %d views: WH(%d, %d), Format=0x%x, Depth=0x%x",
+         viewCount, vp_w, vp_h, (int)format, config->depth_format);
+
+    viewsurface_t sfc;
+    sfc.width        = vp_w;
+    sfc.height       = vp_h;
+    sfc.array_size   = viewCount;
+    sfc.format       = format;
+    sfc.sample_count = 1;
+    sfc.acquired_idx = 0;
+    sfc.render_scale = 1.0f;
+    sfc.swapchain    = oxr_create_swapchain (session, sfc.width, sfc.height, viewCount, format);
+    if (oxr_alloc_swapchain_rtargets_multiview (sfc.swapchain, sfc.width, sfc.height, viewCount, format,
+                                                config->depth_format, config->share_depth, sfc.rtarget_array) < 0)
+    {
+        for (auto &rtarget : sfc.rtarget_array)
+            detach_render_target (&rtarget);
+        xrDestroySwapchain (sfc.swapchain);
+        return sfcArray;
+    }
+
+    sfcArray.push_back (sfc);
+
+    if (config->foveation_level != FOVEATION_LEVEL_NONE || config->foveation_dynamic)
+        oxr_set_foveation (instance, session, sfcArray, config->foveation_level, config->foveation_dynamic);
+
+    report_render_target_memory ();
 
     return sfcArray;
 }
@@ -413,19 +744,47 @@ oxr_acquire_viewsurface (viewsurface_t &viewSurface, render_target_t &rtarget, X
     subImg.swapchain               = viewSurface.swapchain;
     subImg.imageRect.offset.x      = 0;
     subImg.imageRect.offset.y      = 0;
-    subImg.imageRect.extent.width  = viewSurface.width;
-    subImg.imageRect.extent.height = viewSurface.height;
+    subImg.imageRect.extent.width  = DynamicResolution::scaled_size (viewSurface.width,  viewSurface.render_scale);
+    subImg.imageRect.extent.height = DynamicResolution::scaled_size (viewSurface.height, viewSurface.render_scale);
     subImg.imageArrayIndex         = 0;
 
     uint32_t imgIdx = oxr_acquire_swapchain_img (viewSurface.swapchain);
+    viewSurface.acquired_idx = imgIdx;
+    rtarget = viewSurface.rtarget_array[imgIdx];
+
+    return 0;
+}
+
+/* (subImg) is an array of (viewSurface.array_size) sub images, one per layer. */
+int
+oxr_acquire_viewsurface_multiview (viewsurface_t &viewSurface, render_target_t &rtarget, XrSwapchainSubImage *subImg)
+{
+    for (uint32_t i = 0; i < viewSurface.array_size; i ++)
+    {
+        subImg[i].swapchain               = viewSurface.swapchain;
+        subImg[i].imageRect.offset.x      = 0;
+        subImg[i].imageRect.offset.y      = 0;
+        subImg[i].imageRect.extent.width  = DynamicResolution::scaled_size (viewSurface.width,  viewSurface.render_scale);
+        subImg[i].imageRect.extent.height = DynamicResolution::scaled_size (viewSurface.height, viewSurface.render_scale);
+        subImg[i].imageArrayIndex         = i;
+    }
+
+    uint32_t imgIdx = oxr_acquire_swapchain_img (viewSurface.swapchain);
+    viewSurface.acquired_idx = imgIdx;
     rtarget = viewSurface.rtarget_array[imgIdx];
 
     return 0;
 }
 
+/*
+ *  the depth of the eye is not read after this point.
+ *  invalidate it before the release so that it is never stored to memory.
+ */
 int
 oxr_release_viewsurface (viewsurface_t &viewSurface)
 {
+    invalidate_render_target_depth (&viewSurface.rtarget_array[viewSurface.acquired_idx]);
+
     XrSwapchainImageReleaseInfo releaseInfo {XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO};
     xrReleaseSwapchainImage (viewSurface.swapchain, &releaseInfo);
 
@@ -433,28 +792,195 @@ oxr_release_viewsurface (viewsurface_t &viewSurface)
 }
 
 
+/* ---------------------------------------------------------------------------- *
+ *  Foveation (XR_FB_foveation, XR_FB_foveation_configuration)
+ *    a profile of (level) is created, set to every swapchain with
+ *    xrUpdateSwapchainFB, and destroyed: the swapchains keep the state.
+ *    (dynamic) lets the runtime lower the level below (level) when the GPU
+ *    has headroom.
+ * ---------------------------------------------------------------------------- */
+bool
+oxr_is_foveation_supported (XrInstance instance)
+{
+#if defined (XR_FB_foveation) && defined (XR_FB_swapchain_update_state)
+    const oxr_ext_dispatch_t &ext = oxr_get_ext_dispatch (instance);
+    return ext.xrCreateFoveationProfileFB != nullptr && ext.xrUpdateSwapchainFB != nullptr;
+#else
+    return false;
+#endif
+}
+
+
+int
+oxr_set_foveation (XrInstance instance, XrSession session, std::vector<viewsurface_t> &sfcArray,
+                   int level, bool dynamic)
+{
+    if (!oxr_is_foveation_supported (instance))
+        return -1;
+
+#if defined (XR_FB_foveation) && defined (XR_FB_swapchain_update_state)
+    const oxr_ext_dispatch_t &ext = oxr_get_ext_dispatch (instance);
+
+    XrFoveationLevelProfileCreateInfoFB levelInfo = {XR_TYPE_FOVEATION_LEVEL_PROFILE_CREATE_INFO_FB};
+    levelInfo.level          = (XrFoveationLevelFB)level;
+    levelInfo.verticalOffset = 0.0f;
+    levelInfo.dynamic        = dynamic ? XR_FOVEATION_DYNAMIC_LEVEL_ENABLED_FB : XR_FOVEATION_DYNAMIC_DISABLED_FB;
+
+    XrFoveationProfileCreateInfoFB ci = {XR_TYPE_FOVEATION_PROFILE_CREATE_INFO_FB};
+    ci.next = &levelInfo;
+
+    XrFoveationProfileFB profile = XR_NULL_HANDLE;
+    XrResult ret = ext.xrCreateFoveationProfileFB (session, &ci, &profile);
+    OXR_CHECK (ret);
+    if (XR_FAILED (ret))
+        return -1;
+
+    /* the caller retries the level when any swapchain is not updated */
+    int updated = 1;
+    XrSwapchainStateFoveationFB state = {XR_TYPE_SWAPCHAIN_STATE_FOVEATION_FB};
+    state.profile = profile;
+    for (auto &sfc : sfcArray)
+    {
+        ret = ext.xrUpdateSwapchainFB (sfc.swapchain, (XrSwapchainStateBaseHeaderFB *)&state);
+        OXR_CHECK (ret);
+        if (XR_FAILED (ret))
+            updated = 0;
+    }
+
+    OXR_CHECK (ext.xrDestroyFoveationProfileFB (profile));
+
+    if (!updated)
+        return -1;
+
+    LOGV ("foveation: level=%d, dynamic=%d", level, dynamic);
+#endif
+
+    return 0;
+}
+
+
 
 /* ---------------------------------------------------------------------------- *
  *  Frame operation
  * ---------------------------------------------------------------------------- */
+/*
+ *  CPU budget check.
+ *    When the previous frame missed its display period, predictedDisplayTime
+ *    advances by two or more periods. Then the apps drop their optional
+ *    passes (imgui refresh, offscreen UI planes) for a while, so that they
+ *    catch up instead of missing every other frame.
+ */
+#define BUDGET_RECOVER_FRAMES   30      /* frames in the budget exceeded mode after a miss */
+
+static XrTime   s_prev_dpy_time;
+static int      s_budget_exceeded_cnt;
+static XrDuration s_dpy_period;
+
+static void
+oxr_update_frame_budget (const XrFrameState *frameState)
+{
+    XrTime     dpy_time = frameState->predictedDisplayTime;
+    XrDuration period   = frameState->predictedDisplayPeriod;
+
+    if (period > 0)
+        s_dpy_period = period;
+
+    /* the runtime may throttle the frames it does not show */
+    if (!frameState->shouldRender)
+    {
+        s_prev_dpy_time = 0;
+        return;
+    }
+
+    if (s_prev_dpy_time > 0 && period > 0 &&
+        (dpy_time - s_prev_dpy_time) > period + period / 2)
+    {
+        if (s_budget_exceeded_cnt == 0)
+            LOGW ("CPU budget exceeded: %.2f ms > %.2f ms",
+                  (dpy_time - s_prev_dpy_time) / 1000000.0, period / 1000000.0);
+        s_budget_exceeded_cnt = BUDGET_RECOVER_FRAMES;
+    }
+    else if (s_budget_exceeded_cnt > 0)
+    {
+        s_budget_exceeded_cnt --;
+    }
+
+    s_prev_dpy_time = dpy_time;
+}
+
+
+static void
+oxr_reset_frame_budget ()
+{
+    s_prev_dpy_time       = 0;
+    s_budget_exceeded_cnt = 0;
+}
+
+
+bool
+oxr_is_cpu_budget_exceeded ()
+{
+    return s_budget_exceeded_cnt > 0;
+}
+
+
+/* predictedDisplayPeriod of the latest frame [ms]. 0 before the first frame */
+float
+oxr_get_display_period_ms ()
+{
+    return s_dpy_period / 1000000.0f;
+}
+
+
 int
 oxr_begin_frame (XrSession session, XrTime *dpy_time)
 {
-    XrFrameWaitInfo frameWait  = {XR_TYPE_FRAME_WAIT_INFO};
-    XrFrameState    frameState = {XR_TYPE_FRAME_STATE};
-    xrWaitFrame (session, &frameWait, &frameState);
+    XrFrameState frameState = {XR_TYPE_FRAME_STATE};
+    oxr_wait_frame (session, &frameState);
+    oxr_begin_frame_nowait (session);
+
+    *dpy_time = frameState.predictedDisplayTime;
+    return (int)frameState.shouldRender;
+}
+
+
+/*
+ *  xrWaitFrame and xrBeginFrame separately, for the pipelined frame loop
+ *  (util_frame_pipeline.h): the main thread waits for frame N+1 while the
+ *  render thread begins, renders and ends frame N.
+ */
+int
+oxr_wait_frame (XrSession session, XrFrameState *frameState)
+{
+    CPU_PROF_SCOPE ("xrWaitFrame");
+
+    XrFrameWaitInfo frameWait = {XR_TYPE_FRAME_WAIT_INFO};
+    *frameState = {XR_TYPE_FRAME_STATE};
+    xrWaitFrame (session, &frameWait, frameState);
+
+    oxr_update_frame_budget (frameState);
+
+    return (int)frameState->shouldRender;
+}
+
+
+int
+oxr_begin_frame_nowait (XrSession session)
+{
+    CPU_PROF_SCOPE ("xrBeginFrame");
 
     XrFrameBeginInfo frameBegin = {XR_TYPE_FRAME_BEGIN_INFO};
     xrBeginFrame (session, &frameBegin);
 
-    *dpy_time = frameState.predictedDisplayTime;
-    return (int)frameState.shouldRender;
+    return 0;
 }
 
 
 int
 oxr_end_frame (XrSession session, XrTime dpy_time, std::vector<XrCompositionLayerBaseHeader*> &layers)
 {
+    CPU_PROF_SCOPE ("xrEndFrame");
+
     XrFrameEndInfo frameEnd {XR_TYPE_FRAME_END_INFO};
     frameEnd.displayTime          = dpy_time;
     frameEnd.environmentBlendMode = XR_ENVIRONMENT_BLEND_MODE_OPAQUE;
@@ -499,6 +1025,93 @@ oxr_create_action_space (XrSession session, XrAction action, XrPath subpath)
 
 
 
+/* ---------------------------------------------------------------------------- *
+ *  Space location cache
+ * ---------------------------------------------------------------------------- */
+void
+SpaceLocator::init (XrInstance instance, XrSession session, XrSpace baseSpace)
+{
+    m_instance  = instance;
+    m_session   = session;
+    m_baseSpace = baseSpace;
+    m_time      = 0;
+    m_space.clear ();
+    m_loc.clear ();
+#if defined (XR_KHR_locate_spaces)
+    m_locData.clear ();
+#endif
+}
+
+
+int
+SpaceLocator::add (XrSpace space)
+{
+    m_space.push_back (space);
+    m_loc.push_back ({XR_TYPE_SPACE_LOCATION});
+#if defined (XR_KHR_locate_spaces)
+    m_locData.push_back ({});
+#endif
+    m_time = 0;
+
+    return (int)m_space.size () - 1;
+}
+
+
+int
+SpaceLocator::locate (XrTime time)
+{
+    if (time == m_time)
+        return 0;
+
+    uint32_t num = (uint32_t)m_space.size ();
+
+#if defined (XR_KHR_locate_spaces)
+    const oxr_ext_dispatch_t &ext = oxr_get_ext_dispatch (m_instance);
+    if (ext.xrLocateSpacesKHR)
+    {
+        XrSpacesLocateInfoKHR info = {XR_TYPE_SPACES_LOCATE_INFO_KHR};
+        info.baseSpace  = m_baseSpace;
+        info.time       = time;
+        info.spaceCount = num;
+        info.spaces     = m_space.data ();
+
+        XrSpaceLocationsKHR locs = {XR_TYPE_SPACE_LOCATIONS_KHR};
+        locs.locationCount = num;
+        locs.locations     = m_locData.data ();
+
+        XrResult ret = ext.xrLocateSpacesKHR (m_session, &info, &locs);
+        OXR_CHECK (ret);
+        if (XR_FAILED (ret))
+        {
+            /* no valid pose this time, and located again on the next call */
+            for (uint32_t i = 0; i < num; i ++)
+                m_loc[i].locationFlags = 0;
+            m_time = 0;
+            return -1;
+        }
+
+        for (uint32_t i = 0; i < num; i ++)
+        {
+            m_loc[i].locationFlags = m_locData[i].locationFlags;
+            m_loc[i].pose          = m_locData[i].pose;
+        }
+        m_time = time;
+        return 0;
+    }
+#endif
+
+    for (uint32_t i = 0; i < num; i ++)
+    {
+        m_loc[i] = {XR_TYPE_SPACE_LOCATION};
+        xrLocateSpace (m_space[i], m_baseSpace, time, &m_loc[i]);
+    }
+    m_time = time;
+
+    return 0;
+}
+
+
+
 
 /* ---------------------------------------------------------------------------- *
  *  Action operation
@@ -659,6 +1272,168 @@ oxr_apply_haptic_feedback_vibrate (XrSession session, XrAction action, XrPath su
     return 0;
 }
 
+
+
+/* ---------------------------------------------------------------------------- *
+ *  Declarative action table
+ * ---------------------------------------------------------------------------- */
+static const char *s_hand_path[OXR_HAND_NUM] = {"/user/hand/left", "/user/hand/right"};
+
+int
+oxr_create_action_table (XrInstance instance, XrSession session, const char *profile,
+                         const oxr_action_desc_t *desc, int num, oxr_action_table_t &table)
+{
+    if (num > OXR_ACTION_MAX)
+    {
+        LOGE ("too many actions: %d > %d", num, OXR_ACTION_MAX);
+        return -1;
+    }
+
+    table.actionSet = oxr_create_actionset (instance, "app_action_set", "AppActionSet", 0);
+    table.desc      = desc;
+    table.num       = num;
+    table.action .assign (num, XR_NULL_HANDLE);
+    table.space  .assign (num * OXR_HAND_NUM, XR_NULL_HANDLE);
+    table.getInfo.assign (num * OXR_HAND_NUM, {XR_TYPE_ACTION_STATE_GET_INFO});
+
+    for (int hand = 0; hand < OXR_HAND_NUM; hand ++)
+        table.handPath[hand] = oxr_str2path (instance, s_hand_path[hand]);
+
+    /* actions and their bindings */
+    std::vector<XrActionSuggestedBinding> bindings;
+    for (int i = 0; i < num; i ++)
+    {
+        int     subpath_num = desc[i].per_hand ? OXR_HAND_NUM : 0;
+        XrPath *subpath     = desc[i].per_hand ? table.handPath : NULL;
+
+        table.action[i] = oxr_create_action (table.actionSet, desc[i].type, desc[i].name,
+                                             desc[i].local_name, subpath_num, subpath);
+
+        for (int hand = 0; hand < OXR_HAND_NUM; hand ++)
+        {
+            if (desc[i].binding[hand] == NULL)
+                continue;
+
+            std::string path = std::string (s_hand_path[hand]) + desc[i].binding[hand];
+            bindings.push_back ({table.action[i], oxr_str2path (instance, path.c_str())});
+        }
+
+        for (int hand = 0; hand < OXR_HAND_NUM; hand ++)
+        {
+            XrActionStateGetInfo &info = table.getInfo[i * OXR_HAND_NUM + hand];
+            info.action        = table.action[i];
+            info.subactionPath = desc[i].per_hand ? table.handPath[hand] : XR_NULL_PATH;
+        }
+    }
+
+    oxr_bind_interaction (instance, profile, bindings);
+
+    /* attach actions bound to the device. */
+    oxr_attach_actionsets (session, table.actionSet);
+
+    /* action spaces of POSE actions */
+    for (int i = 0; i < num; i ++)
+    {
+        if (desc[i].type != XR_ACTION_TYPE_POSE_INPUT)
+            continue;
+
+        for (int hand = 0; hand < OXR_HAND_NUM; hand ++)
+        {
+            XrPath subpath = desc[i].per_hand ? table.handPath[hand] : XR_NULL_PATH;
+            table.space[i * OXR_HAND_NUM + hand] = oxr_create_action_space (session, table.action[i], subpath);
+        }
+    }
+
+    return 0;
+}
+
+
+XrSpace
+oxr_get_action_table_space (oxr_action_table_t &table, int act, int hand)
+{
+    return table.space[act * OXR_HAND_NUM + hand];
+}
+
+
+/* store (val) to base[idx]. returns true if it differs from the previous one. */
+template <typename T> static bool
+store_action_value (char *base, int idx, const T &val)
+{
+    T *dst = (T *)base + idx;
+    if (memcmp (dst, &val, sizeof (T)) == 0)
+        return false;
+
+    *dst = val;
+    return true;
+}
+
+
+uint64_t
+oxr_poll_action_table (XrSession session, oxr_action_table_t &table, void *snapshot)
+{
+    uint64_t changed = 0;
+
+    oxr_sync_actions (session, table.actionSet);
+
+    for (int i = 0; i < table.num; i ++)
+    {
+        const oxr_action_desc_t &desc = table.desc[i];
+        if (desc.offset < 0)
+            continue;
+
+        char *dst      = (char *)snapshot + desc.offset;
+        int   hand_num = desc.per_hand ? OXR_HAND_NUM : 1;
+
+        for (int hand = 0; hand < hand_num; hand ++)
+        {
+            const XrActionStateGetInfo *info = &table.getInfo[i * OXR_HAND_NUM + hand];
+            bool is_changed = false;
+
+            switch (desc.type)
+            {
+            case XR_ACTION_TYPE_BOOLEAN_INPUT:
+            {
+                XrActionStateBoolean stat {XR_TYPE_ACTION_STATE_BOOLEAN};
+                xrGetActionStateBoolean (session, info, &stat);
+                if (stat.isActive)
+                    is_changed = store_action_value (dst, hand, (bool)stat.currentState);
+                break;
+            }
+            case XR_ACTION_TYPE_FLOAT_INPUT:
+            {
+                XrActionStateFloat stat {XR_TYPE_ACTION_STATE_FLOAT};
+                xrGetActionStateFloat (session, info, &stat);
+                if (stat.isActive)
+                    is_changed = store_action_value (dst, hand, stat.currentState);
+                break;
+            }
+            case XR_ACTION_TYPE_VECTOR2F_INPUT:
+            {
+                XrActionStateVector2f stat {XR_TYPE_ACTION_STATE_VECTOR2F};
+                xrGetActionStateVector2f (session, info, &stat);
+                if (stat.isActive)
+                    is_changed = store_action_value (dst, hand, stat.currentState);
+                break;
+            }
+            case XR_ACTION_TYPE_POSE_INPUT:
+            {
+                XrActionStatePose stat {XR_TYPE_ACTION_STATE_POSE};
+                xrGetActionStatePose (session, info, &stat);
+                is_changed = store_action_value (dst, hand, stat.isActive);
+                break;
+            }
+            default:
+                break;
+            }
+
+            if (is_changed)
+                changed |= OXR_ACTION_BIT (i, hand);
+        }
+    }
+
+    return changed;
+}
+
 /* ---------------------------------------------------------------------------- *
  *  Session operation
  * ---------------------------------------------------------------------------- */
@@ -696,6 +1471,22 @@ oxr_begin_session (XrSession session)
     return 0;
 }
 
+
+/*
+ *  (func) is called right before xrEndSession, so that the pipelined frame
+ *  loop can finish the frames in flight on the render thread.
+ */
+static void (*s_session_stop_cb)(void *arg);
+static void *s_session_stop_arg;
+
+void
+oxr_set_session_stop_callback (void (*func)(void *arg), void *arg)
+{
+    s_session_stop_cb  = func;
+    s_session_stop_arg = arg;
+}
+
+
 int
 oxr_handle_session_state_changed (XrSession session, XrEventDataSessionStateChanged &ev,
                                   bool *exitLoop, bool *reqRestart)
@@ -721,7 +1512,10 @@ oxr_handle_session_state_changed (XrSession session, XrEventDataSessionStateChan
         break;
 
     case XR_SESSION_STATE_STOPPING:
+        if (s_session_stop_cb)
+            s_session_stop_cb (s_session_stop_arg);
         xrEndSession (session);
+        oxr_reset_frame_budget ();
         s_session_running = false;
         break;
 
@@ -825,99 +1619,100 @@ int
 oxr_create_handtrackers (XrInstance instance, XrSession session,
                          std::array<XrHandTrackerEXT, 2> &handTracker)
 {
-    PFN_xrCreateHandTrackerEXT xrCreateHandTrackerEXT;
-    xrGetInstanceProcAddr (instance, "xrCreateHandTrackerEXT",
-                           (PFN_xrVoidFunction *)&xrCreateHandTrackerEXT);
+    const oxr_ext_dispatch_t &ext = oxr_get_ext_dispatch (instance);
 
     XrHandTrackerCreateInfoEXT ci = {XR_TYPE_HAND_TRACKER_CREATE_INFO_EXT};
     ci.handJointSet = XR_HAND_JOINT_SET_DEFAULT_EXT;
 
     ci.hand = XR_HAND_LEFT_EXT;
-    OXR_CHECK (xrCreateHandTrackerEXT (session, &ci, &handTracker[0]));
+    OXR_CHECK (ext.xrCreateHandTrackerEXT (session, &ci, &handTracker[0]));
 
     ci.hand = XR_HAND_RIGHT_EXT;
-    OXR_CHECK (xrCreateHandTrackerEXT (session, &ci, &handTracker[1]));
+    OXR_CHECK (ext.xrCreateHandTrackerEXT (session, &ci, &handTracker[1]));
 
     return 0;
 }
 
 
-XrHandJointLocationsEXT *
-oxr_create_handjoint_loc ()
-{
-    XrHandTrackingScaleFB         *scale    = new XrHandTrackingScaleFB {};
-    XrHandTrackingCapsulesStateFB *capsule  = new XrHandTrackingCapsulesStateFB {};
-    XrHandTrackingAimStateFB      *aim      = new XrHandTrackingAimStateFB {};
-    XrHandJointVelocitiesEXT      *vel      = new XrHandJointVelocitiesEXT {};
-    XrHandJointVelocityEXT        *vel_data = new XrHandJointVelocityEXT[XR_HAND_JOINT_COUNT_EXT] {};
-    XrHandJointLocationsEXT       *loc      = new XrHandJointLocationsEXT {};
-    XrHandJointLocationEXT        *loc_data = new XrHandJointLocationEXT[XR_HAND_JOINT_COUNT_EXT] {};
-
-    scale->type               = XR_TYPE_HAND_TRACKING_SCALE_FB;
-    scale->next               = nullptr;
-    scale->sensorOutput       = 1.0f;
-    scale->currentOutput      = 1.0f;
-    scale->overrideValueInput = 1.0f;
-    scale->overrideHandScale  = XR_FALSE;
-
-    capsule->type             = XR_TYPE_HAND_TRACKING_CAPSULES_STATE_FB;
-    capsule->next             = scale;
-
-    aim->type                 = XR_TYPE_HAND_TRACKING_AIM_STATE_FB;
-    aim->next                 = capsule;
-
-    vel->type                 = XR_TYPE_HAND_JOINT_VELOCITIES_EXT;
-    vel->next                 = aim;
-    vel->jointCount           = XR_HAND_JOINT_COUNT_EXT;
-    vel->jointVelocities      = vel_data;
-
-    loc->type                 = XR_TYPE_HAND_JOINT_LOCATIONS_EXT;
-    loc->next                 = vel;
-    loc->jointCount           = XR_HAND_JOINT_COUNT_EXT;
-    loc->jointLocations       = loc_data;
-
-    return loc;
-}
-
+static_assert (HAND_JOINT_NUM == XR_HAND_JOINT_COUNT_EXT, "HAND_JOINT_NUM != XR_HAND_JOINT_COUNT_EXT");
 
+/*
+ *  locate the joints of a hand at (time), and store them into (dst)
+ *  (e.g. HandJointStore::back()). No heap allocation.
+ */
 int
 oxr_locate_handjoints (XrInstance instance, XrHandTrackerEXT handTracker,
                        XrSpace bspace, XrTime time,
-                       XrHandJointLocationsEXT *loc)
+                       hand_joint_set_t *dst)
 {
-    PFN_xrLocateHandJointsEXT xrLocateHandJointsEXT;
-    xrGetInstanceProcAddr (instance, "xrLocateHandJointsEXT",
-                           (PFN_xrVoidFunction *)&xrLocateHandJointsEXT);
+    const oxr_ext_dispatch_t &ext = oxr_get_ext_dispatch (instance);
+
+    XrHandJointVelocityEXT   vel_data[XR_HAND_JOINT_COUNT_EXT];
+    XrHandJointLocationEXT   loc_data[XR_HAND_JOINT_COUNT_EXT];
+
+    XrHandJointVelocitiesEXT vel = {XR_TYPE_HAND_JOINT_VELOCITIES_EXT};
+    vel.jointCount          = XR_HAND_JOINT_COUNT_EXT;
+    vel.jointVelocities     = vel_data;
+
+    XrHandJointLocationsEXT  loc = {XR_TYPE_HAND_JOINT_LOCATIONS_EXT};
+    loc.next                = &vel;
+    loc.jointCount          = XR_HAND_JOINT_COUNT_EXT;
+    loc.jointLocations      = loc_data;
 
     XrHandJointsLocateInfoEXT info = {XR_TYPE_HAND_JOINTS_LOCATE_INFO_EXT};
     info.baseSpace = bspace;
     info.time      = time;
 
-    OXR_CHECK (xrLocateHandJointsEXT (handTracker, &info, loc));
+    dst->time   = time;
+    dst->active = false;
 
-    if (loc->isActive)
-    {
-        LOGI ("Active\n");
-        XrHandJointLocationEXT *loc_array = loc->jointLocations;
-        XrSpaceLocationFlags isValid =
-                XR_SPACE_LOCATION_ORIENTATION_VALID_BIT | XR_SPACE_LOCATION_POSITION_VALID_BIT;
+    XrResult ret = ext.xrLocateHandJointsEXT (handTracker, &info, &loc);
+    OXR_CHECK (ret);
+    if (XR_FAILED (ret))
+        return -1;
 
-        for (int i = 0; i < XR_HAND_JOINT_COUNT_EXT; i++)
-        {
-            if ((loc_array[i].locationFlags & isValid))
-            {
-                const XrPosef pose = loc_array[i].pose;
-                const float   rad  = loc_array[i].radius;
-                LOGI ("Joint[%d/%d]: POS(%f, %f, %f), RAD(%f)\n",
-                    i, XR_HAND_JOINT_COUNT_EXT,
-                    pose.position.x, pose.position.y, pose.position.z,
-                    rad);
-            }
-        }
+    dst->active = loc.isActive;
+    if (!loc.isActive)
+    {
+        LOGV ("inActive\n");
+        return 0;
     }
-    else
+
+    const XrSpaceLocationFlags poseValid =
+            XR_SPACE_LOCATION_ORIENTATION_VALID_BIT | XR_SPACE_LOCATION_POSITION_VALID_BIT;
+    const XrSpaceVelocityFlags velValid  =
+            XR_SPACE_VELOCITY_LINEAR_VALID_BIT | XR_SPACE_VELOCITY_ANGULAR_VALID_BIT;
+
+    for (int i = 0; i < XR_HAND_JOINT_COUNT_EXT; i++)
     {
-        LOGI ("inActive\n");
+        const XrPosef                &pose = loc_data[i].pose;
+        const XrHandJointVelocityEXT &v    = vel_data[i];
+
+        dst->pos[3 * i + 0]    = pose.position.x;
+        dst->pos[3 * i + 1]    = pose.position.y;
+        dst->pos[3 * i + 2]    = pose.position.z;
+        dst->qtn[4 * i + 0]    = pose.orientation.x;
+        dst->qtn[4 * i + 1]    = pose.orientation.y;
+        dst->qtn[4 * i + 2]    = pose.orientation.z;
+        dst->qtn[4 * i + 3]    = pose.orientation.w;
+        dst->linvel[3 * i + 0] = v.linearVelocity.x;
+        dst->linvel[3 * i + 1] = v.linearVelocity.y;
+        dst->linvel[3 * i + 2] = v.linearVelocity.z;
+        dst->angvel[3 * i + 0] = v.angularVelocity.x;
+        dst->angvel[3 * i + 1] = v.angularVelocity.y;
+        dst->angvel[3 * i + 2] = v.angularVelocity.z;
+        dst->radius[i]         = loc_data[i].radius;
+
+        uint32_t flags = 0;
+        if ((loc_data[i].locationFlags & poseValid) == poseValid)
+            flags |= HAND_JOINT_POSE_VALID;
+        if ((v.velocityFlags & velValid) == velValid)
+            flags |= HAND_JOINT_VELOCITY_VALID;
+        dst->flags[i] = flags;
+
+        LOGV ("Joint[%d/%d]: POS(%f, %f, %f), RAD(%f)\n",
+              i, XR_HAND_JOINT_COUNT_EXT,
+              pose.position.x, pose.position.y, pose.position.z, loc_data[i].radius);
     }
     return 0;
 }
@@ -935,24 +1730,18 @@ oxr_create_passthrough_layer (XrInstance instance, XrSession session,
                               XrPassthroughFB &passthrough,
                               XrPassthroughLayerFB &ptLayer)
 {
-    PFN_xrCreatePassthroughFB xrCreatePassthroughFB;
-    xrGetInstanceProcAddr (instance, "xrCreatePassthroughFB",
-                           (PFN_xrVoidFunction *)&xrCreatePassthroughFB);
-
-    PFN_xrCreatePassthroughLayerFB xrCreatePassthroughLayerFB;
-    xrGetInstanceProcAddr (instance, "xrCreatePassthroughLayerFB",
-                           (PFN_xrVoidFunction *)&xrCreatePassthroughLayerFB);
+    const oxr_ext_dispatch_t &ext = oxr_get_ext_dispatch (instance);
 
     {
         XrPassthroughCreateInfoFB ci = {XR_TYPE_PASSTHROUGH_CREATE_INFO_FB};
-        OXR_CHECK (xrCreatePassthroughFB (session, &ci, &passthrough));
+        OXR_CHECK (ext.xrCreatePassthroughFB (session, &ci, &passthrough));
     }
 
     {
         XrPassthroughLayerCreateInfoFB ci = {XR_TYPE_PASSTHROUGH_LAYER_CREATE_INFO_FB};
         ci.passthrough = passthrough;
         ci.purpose     = XR_PASSTHROUGH_LAYER_PURPOSE_RECONSTRUCTION_FB;
-        OXR_CHECK (xrCreatePassthroughLayerFB (session, &ci, &ptLayer));
+        OXR_CHECK (ext.xrCreatePassthroughLayerFB (session, &ci, &ptLayer));
     }
 
     return 0;
@@ -962,11 +1751,9 @@ oxr_create_passthrough_layer (XrInstance instance, XrSession session,
 int
 oxr_start_passthrough (XrInstance instance, XrPassthroughFB passthrough)
 {
-    PFN_xrPassthroughStartFB xrPassthroughStartFB;
-    xrGetInstanceProcAddr (instance, "xrPassthroughStartFB",
-                           (PFN_xrVoidFunction *)&xrPassthroughStartFB);
+    const oxr_ext_dispatch_t &ext = oxr_get_ext_dispatch (instance);
 
-    OXR_CHECK (xrPassthroughStartFB (passthrough));
+    OXR_CHECK (ext.xrPassthroughStartFB (passthrough));
 
     return 0;
 }
@@ -976,20 +1763,14 @@ int
 oxr_resume_passthrough_layer (XrInstance instance,
                               XrPassthroughLayerFB ptLayer)
 {
-    PFN_xrPassthroughLayerResumeFB xrPassthroughLayerResumeFB;
-    xrGetInstanceProcAddr (instance, "xrPassthroughLayerResumeFB",
-                           (PFN_xrVoidFunction *)&xrPassthroughLayerResumeFB);
-
-    PFN_xrPassthroughLayerSetStyleFB xrPassthroughLayerSetStyleFB;
-    xrGetInstanceProcAddr (instance, "xrPassthroughLayerSetStyleFB",
-                           (PFN_xrVoidFunction *)&xrPassthroughLayerSetStyleFB);
+    const oxr_ext_dispatch_t &ext = oxr_get_ext_dispatch (instance);
 
-    OXR_CHECK (xrPassthroughLayerResumeFB (ptLayer));
+    OXR_CHECK (ext.xrPassthroughLayerResumeFB (ptLayer));
 
     XrPassthroughStyleFB style = {XR_TYPE_PASSTHROUGH_STYLE_FB};
     style.textureOpacityFactor = 0.5f;
     style.edgeColor            = {0.0f, 0.0f, 0.0f, 0.0f};
-    OXR_CHECK (xrPassthroughLayerSetStyleFB (ptLayer, &style));
+    OXR_CHECK (ext.xrPassthroughLayerSetStyleFB (ptLayer, &style));
 
     return 0;
 }
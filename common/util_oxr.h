@@ -16,21 +16,66 @@
 #include <GLES3/gl31.h>
 #include "util_egl.h"
 
+/* xrConvertTimespecTimeToTimeKHR: the CPU profiler runs on the XrTime clock */
+#if !defined (XR_USE_TIMESPEC)
+#define XR_USE_TIMESPEC
+#endif
+
 #include <openxr/openxr.h>
 #include <openxr/openxr_platform.h>
 #include <openxr/openxr_reflection.h>
 #include <vector>
 #include <array>
+#include <cassert>
 
 #include "util_log.h"
 #include "util_render_target.h"
+#include "util_hand_joint.h"
+#include "util_foveation.h"
+#include "util_dynres.h"
+#include "util_cpu_profiler.h"
+
+
+/*
+ *  Swapchain configuration of oxr_create_viewsurface().
+ *    color_formats : candidates in the order of preference, negotiated with
+ *                    xrEnumerateSwapchainFormats(). NULL: GL_RGBA8 (or
+ *                    GL_SRGB8_ALPHA8 first if (srgb) is set).
+ *    sample_count  : >1 renders with MSAA via GL_EXT_multisampled_render_to_texture.
+ *                    the swapchain itself stays single sampled.
+ *    depth_format  : GL_DEPTH_COMPONENT24, GL_DEPTH24_STENCIL8, ... 0: no depth.
+ *    share_depth   : one depth per view (or per view array) shared by all the
+ *                    swapchain images, instead of one per image. the images
+ *                    are rendered one at a time and depth is invalidated at
+ *                    the release, so nothing is carried between them.
+ *    foveation_level   : FOVEATION_LEVEL_xxx set with oxr_set_foveation() once
+ *    foveation_dynamic   the swapchains are created. NONE/false: left untouched.
+ */
+typedef struct oxr_swapchain_config_t
+{
+    const int64_t   *color_formats;
+    uint32_t        color_format_num;
+    bool            srgb;
+    uint32_t        sample_count;
+    GLenum          depth_format;
+    bool            share_depth;
+    int             foveation_level;
+    bool            foveation_dynamic;
+} oxr_swapchain_config_t;
+
+#define OXR_SWAPCHAIN_CONFIG_DEFAULT    {NULL, 0, false, 1, GL_DEPTH_COMPONENT24, true, FOVEATION_LEVEL_NONE, false}
 
 
 typedef struct viewsurface_t
 {
     uint32_t    width;
     uint32_t    height;
+    uint32_t    array_size;     /* 1: per-eye swapchain, N: multiview swapchain of N layers */
+    int64_t     format;         /* negotiated color format */
+    uint32_t    sample_count;   /* MSAA samples actually used */
     XrSwapchain swapchain;
+    uint32_t    acquired_idx;   /* index of rtarget_array acquired last */
+    float       render_scale;   /* imageRect = (width, height) * render_scale. see DynamicResolution */
     std::vector<render_target_t> rtarget_array;
 } viewsurface_t;
 
@@ -41,6 +86,7 @@ int         oxr_initialize_loader (void *appVM, void *appCtx);
 
 /* Create OpenXR Instance with Android/OpenGLES binding */
 XrInstance  oxr_create_instance   (void *appVM, void *appCtx);
+bool        oxr_is_instance_ext_supported (const char *name);
 std::string oxr_get_runtime_name (XrInstance instance);
 
 /*  Get OpenXR Sysem */
@@ -57,20 +103,69 @@ int         oxr_locate_views (XrSession session, XrTime dpy_time, XrSpace space,
 
 /* Swapchain operation */
 std::vector<viewsurface_t>
-            oxr_create_viewsurface (XrInstance instance, XrSystemId sysid, XrSession session);
+            oxr_create_viewsurface (XrInstance instance, XrSystemId sysid, XrSession session,
+                                    const oxr_swapchain_config_t *config = NULL);
 int         oxr_acquire_viewsurface (viewsurface_t &viewSurface, render_target_t &rtarget, XrSwapchainSubImage &subImg);
+std::vector<viewsurface_t>
+            oxr_create_viewsurface_multiview (XrInstance instance, XrSystemId sysid, XrSession session,
+                                              const oxr_swapchain_config_t *config = NULL);
+int         oxr_acquire_viewsurface_multiview (viewsurface_t &viewSurface, render_target_t &rtarget, XrSwapchainSubImage *subImg);
 int         oxr_release_viewsurface (viewsurface_t &viewSurface);
 
+/* Foveation: (level) is FOVEATION_LEVEL_xxx. returns -1 without XR_FB_foveation. */
+bool        oxr_is_foveation_supported (XrInstance instance);
+int         oxr_set_foveation (XrInstance instance, XrSession session, std::vector<viewsurface_t> &sfcArray,
+                               int level, bool dynamic);
+
 
 /* Frame operation */
 int         oxr_begin_frame (XrSession session, XrTime *dpyTime);
 int         oxr_end_frame   (XrSession session, XrTime dpyTime, std::vector<XrCompositionLayerBaseHeader*> &layers);
+int         oxr_wait_frame  (XrSession session, XrFrameState *frameState);
+int         oxr_begin_frame_nowait (XrSession session);
+bool        oxr_is_cpu_budget_exceeded ();
+float       oxr_get_display_period_ms ();
 
 
 /* Space operation */
 XrSpace     oxr_create_ref_space    (XrSession session, XrReferenceSpaceType ref_space_type);
 XrSpace     oxr_create_action_space (XrSession session, XrAction action, XrPath subpath);
 
+/*
+ *  Per-frame space location cache.
+ *
+ *    Register the spaces once with add(), then locate() all of them relative
+ *    to (baseSpace) at a display time in one batch (xrLocateSpacesKHR when
+ *    the runtime has XR_KHR_locate_spaces, or one xrLocateSpace per space).
+ *    The results are kept until locate() is called with another time, so
+ *    every module of the frame reads get() without calling the runtime.
+ *    A space added twice gets two ids, so that the apps can index get()
+ *    with their own enum. A space not located is returned without the
+ *    XR_SPACE_LOCATION_*_VALID_BIT flags.
+ */
+class SpaceLocator {
+public:
+    void    init   (XrInstance instance, XrSession session, XrSpace baseSpace);
+    int     add    (XrSpace space);         /* returns the id for get(): 0, 1, 2.. in the order of add() */
+    int     locate (XrTime time);
+    const XrSpaceLocation &get (int id) const
+    {
+        assert (id >= 0 && id < (int)m_loc.size ());
+        return m_loc[id];
+    }
+
+private:
+    XrInstance                      m_instance  = XR_NULL_HANDLE;
+    XrSession                       m_session   = XR_NULL_HANDLE;
+    XrSpace                         m_baseSpace = XR_NULL_HANDLE;
+    XrTime                          m_time      = 0;    /* time of m_loc. 0: not located */
+    std::vector<XrSpace>            m_space;
+    std::vector<XrSpaceLocation>    m_loc;
+#if defined (XR_KHR_locate_spaces)
+    std::vector<XrSpaceLocationDataKHR> m_locData;
+#endif
+};
+
 
 /* Action operation */
 XrActionSet oxr_create_actionset (XrInstance instance, const char *name, const char *local_name, int priority);
@@ -95,12 +190,64 @@ int         oxr_apply_haptic_feedback_vibrate (XrSession session, XrAction actio
                                                XrDuration dura, float freq, float amp);
 
 
+/*
+ *  Declarative action table.
+ *
+ *    An app declares its actions once as an array of oxr_action_desc_t.
+ *    oxr_create_action_table() creates the actions with their subaction paths,
+ *    suggests the bindings and creates the action spaces of POSE actions.
+ *    oxr_poll_action_table() syncs and reads every action in one loop with
+ *    prebuilt XrActionStateGetInfo, and stores the values into the input
+ *    snapshot of the app at (offset):
+ *
+ *      BOOLEAN_INPUT  : bool           FLOAT_INPUT   : float
+ *      VECTOR2F_INPUT : XrVector2f     POSE_INPUT    : XrBool32 (isActive)
+ *
+ *    A per-hand action stores [OXR_HAND_NUM] values at (offset).
+ *    The value is kept while the action is inactive (except POSE).
+ *    It returns OXR_ACTION_BIT() of the values changed since the last poll.
+ */
+#define OXR_HAND_LEFT           0
+#define OXR_HAND_RIGHT          1
+#define OXR_HAND_NUM            2
+#define OXR_ACTION_MAX          32
+
+#define OXR_ACTION_BIT(act, hand)   (1ULL << ((act) * OXR_HAND_NUM + (hand)))
+
+typedef struct oxr_action_desc_t
+{
+    XrActionType    type;
+    const char      *name;
+    const char      *local_name;
+    bool            per_hand;                   /* subaction paths: /user/hand/left, /user/hand/right */
+    const char      *binding[OXR_HAND_NUM];     /* under /user/hand/{left,right}. e.g. "/input/a/click" */
+    int             offset;                     /* in the snapshot. -1: not stored (e.g. VIBRATION_OUTPUT) */
+} oxr_action_desc_t;
+
+typedef struct oxr_action_table_t
+{
+    XrActionSet                         actionSet;
+    XrPath                              handPath[OXR_HAND_NUM];
+    const oxr_action_desc_t             *desc;
+    int                                 num;
+    std::vector<XrAction>               action;     /* [num]                */
+    std::vector<XrSpace>                space;      /* [num * OXR_HAND_NUM] */
+    std::vector<XrActionStateGetInfo>   getInfo;    /* [num * OXR_HAND_NUM] */
+} oxr_action_table_t;
+
+int         oxr_create_action_table (XrInstance instance, XrSession session, const char *profile,
+                                     const oxr_action_desc_t *desc, int num, oxr_action_table_t &table);
+uint64_t    oxr_poll_action_table   (XrSession session, oxr_action_table_t &table, void *snapshot);
+XrSpace     oxr_get_action_table_space (oxr_action_table_t &table, int act, int hand);
+
+
 /* Session operation */
 XrSession   oxr_create_session (XrInstance instance, XrSystemId sysid);
 int         oxr_begin_session (XrSession session);
 int         oxr_handle_session_state_changed (XrSession session, XrEventDataSessionStateChanged &ev,
                                               bool *exitLoop, bool *reqRestart);
 bool        oxr_is_session_running ();
+void        oxr_set_session_stop_callback (void (*func)(void *arg), void *arg);
 
 int         oxr_poll_events (XrInstance instance, XrSession session, bool *exit_loop, bool *req_restart);
 
@@ -108,10 +255,8 @@ int         oxr_poll_events (XrInstance instance, XrSession session, bool *exit_
 #if defined (USE_OXR_HANDTRACK)
 int         oxr_create_handtrackers (XrInstance instance, XrSession session,
                                      std::array<XrHandTrackerEXT, 2> &handTracker);
-XrHandJointLocationsEXT *
-            oxr_create_handjoint_loc ();
 int         oxr_locate_handjoints (XrInstance instance, XrHandTrackerEXT handTracker,
-                                   XrSpace bspace, XrTime time, XrHandJointLocationsEXT *loc);
+                                   XrSpace bspace, XrTime time, hand_joint_set_t *dst);
 #endif
 
 
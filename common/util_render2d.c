@@ -3,11 +3,14 @@
  * Copyright (c) 2019 terryky1220@gmail.com
  * ------------------------------------------------ */
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 #include <math.h>
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
 #include "assertgl.h"
+#include "util_gl_state.h"
 #include "util_shader.h"
 #include "util_matrix.h"
 #include "util_render2d.h"
@@ -19,20 +22,23 @@
 static char vs_fill[] = "                             \n\
                                                       \n\
 attribute    vec4    a_Vertex;                        \n\
+attribute    vec4    a_Color;                         \n\
+varying      vec4    v_Color;                         \n\
 uniform      mat4    u_PMVMatrix;                     \n\
 void main (void)                                      \n\
 {                                                     \n\
     gl_Position = u_PMVMatrix * a_Vertex;             \n\
+    v_Color     = a_Color;                            \n\
 }                                                     ";
 
 static char fs_fill[] = "                             \n\
                                                       \n\
 precision mediump float;                              \n\
-uniform      vec4    u_Color;                         \n\
+varying      vec4    v_Color;                         \n\
                                                       \n\
 void main (void)                                      \n\
 {                                                     \n\
-    gl_FragColor = u_Color;                           \n\
+    gl_FragColor = v_Color;                           \n\
 }                                                       ";
 
 /* ------------------------------------------------------ *
@@ -40,6 +46,8 @@ void main (void)                                      \n\
  * ------------------------------------------------------ */
 static char vs_tex[] = "                              \n\
 attribute    vec4    a_Vertex;                        \n\
+attribute    vec4    a_Color;                         \n\
+varying      vec4    v_Color;                         \n\
 attribute    vec2    a_TexCoord;                      \n\
 varying      vec2    v_TexCoord;                      \n\
 uniform      mat4    u_PMVMatrix;                     \n\
@@ -47,6 +55,7 @@ uniform      mat4    u_PMVMatrix;                     \n\
 void main (void)                                      \n\
 {                                                     \n\
     gl_Position = u_PMVMatrix * a_Vertex;             \n\
+    v_Color     = a_Color;                            \n\
     v_TexCoord  = a_TexCoord;                         \n\
 }                                                     \n";
 
@@ -54,12 +63,12 @@ static char fs_tex[] = "                              \n\
 precision mediump float;                              \n\
 varying     vec2      v_TexCoord;                     \n\
 uniform     sampler2D u_sampler;                      \n\
-uniform     vec4      u_Color;                        \n\
+varying     vec4      v_Color;                        \n\
                                                       \n\
 void main (void)                                      \n\
 {                                                     \n\
     gl_FragColor = texture2D (u_sampler, v_TexCoord); \n\
-    gl_FragColor *= u_Color;                          \n\
+    gl_FragColor *= v_Color;                          \n\
 }                                                     \n";
 
 /* ------------------------------------------------------ *
@@ -70,12 +79,12 @@ static char fs_extex[] = "                            \n\
 precision mediump float;                              \n\
 varying     vec2      v_TexCoord;                     \n\
 uniform     sampler2D u_sampler;                      \n\
-uniform     vec4      u_Color;                        \n\
+varying     vec4      v_Color;                        \n\
                                                       \n\
 void main (void)                                      \n\
 {                                                     \n\
     gl_FragColor = texture2D (u_sampler, v_TexCoord); \n\
-    gl_FragColor *= u_Color;                          \n\
+    gl_FragColor *= v_Color;                          \n\
 }                                                     \n";
 #else
 static char fs_extex[] = "                            \n\
@@ -84,12 +93,12 @@ static char fs_extex[] = "                            \n\
 precision mediump float;                              \n\
 varying     vec2     v_TexCoord;                      \n\
 uniform samplerExternalOES u_sampler;                 \n\
-uniform     vec4      u_Color;                        \n\
+varying     vec4      v_Color;                        \n\
                                                       \n\
 void main (void)                                      \n\
 {                                                     \n\
     gl_FragColor = texture2D (u_sampler, v_TexCoord); \n\
-    gl_FragColor *= u_Color;                          \n\
+    gl_FragColor *= v_Color;                          \n\
 }                                                     \n";
 #endif
 
@@ -100,7 +109,7 @@ static char fs_cmap_jet[] ="                          \n\
 precision mediump float;                              \n\
 varying     vec2      v_TexCoord;                     \n\
 uniform     sampler2D u_sampler;                      \n\
-uniform     vec4      u_Color;                        \n\
+varying     vec4      v_Color;                        \n\
                                                       \n\
 float cmap_jet_red(float x) {                         \n\
     if (x < 0.7) {                                    \n\
@@ -137,7 +146,7 @@ void main (void)                                      \n\
 {                                                     \n\
     vec4 src_col = texture2D (u_sampler, v_TexCoord); \n\
     gl_FragColor = colormap_jet (src_col.r);          \n\
-    gl_FragColor *= u_Color;                          \n\
+    gl_FragColor *= v_Color;                          \n\
 }                                                     \n";
 
 
@@ -151,6 +160,8 @@ void main (void)                                      \n\
  * ------------------------------------------------------ */
 static char vs_tex_yuyv[] = "                         \n\
 attribute    vec4    a_Vertex;                        \n\
+attribute    vec4    a_Color;                         \n\
+varying      vec4    v_Color;                         \n\
 attribute    vec2    a_TexCoord;                      \n\
 varying      vec2    v_TexCoord;                      \n\
 varying      vec2    v_TexCoordPix;                   \n\
@@ -160,6 +171,7 @@ uniform      vec2    u_TexDim;                        \n\
 void main (void)                                      \n\
 {                                                     \n\
     gl_Position   = u_PMVMatrix * a_Vertex;           \n\
+    v_Color       = a_Color;                          \n\
     v_TexCoord    = a_TexCoord;                       \n\
     v_TexCoordPix = a_TexCoord * u_TexDim;            \n\
 }                                                     \n";
@@ -169,7 +181,7 @@ precision mediump float;                              \n\
 varying     vec2      v_TexCoord;                     \n\
 varying     vec2      v_TexCoordPix;                  \n\
 uniform     sampler2D u_sampler;                      \n\
-uniform     vec4      u_Color;                        \n\
+varying     vec4      v_Color;                        \n\
                                                       \n\
 void main (void)                                      \n\
 {                                                     \n\
@@ -193,7 +205,7 @@ void main (void)                                      \n\
                     0, -0.34413, 1.772,               \n\
                 1.402, -0.71414,     0) * yuv;        \n\
     gl_FragColor = vec4(rgb, 1.0);                    \n\
-    gl_FragColor *= u_Color;                          \n\
+    gl_FragColor *= v_Color;                          \n\
 }                                                     \n";
 
 
@@ -207,6 +219,8 @@ void main (void)                                      \n\
  * ------------------------------------------------------ */
 static char vs_tex_uyvy[] = "                         \n\
 attribute    vec4    a_Vertex;                        \n\
+attribute    vec4    a_Color;                         \n\
+varying      vec4    v_Color;                         \n\
 attribute    vec2    a_TexCoord;                      \n\
 varying      vec2    v_TexCoord;                      \n\
 varying      vec2    v_TexCoordPix;                   \n\
@@ -216,6 +230,7 @@ uniform      vec2    u_TexDim;                        \n\
 void main (void)                                      \n\
 {                                                     \n\
     gl_Position   = u_PMVMatrix * a_Vertex;           \n\
+    v_Color       = a_Color;                          \n\
     v_TexCoord    = a_TexCoord;                       \n\
     v_TexCoordPix = a_TexCoord * u_TexDim;            \n\
 }                                                     \n";
@@ -225,7 +240,7 @@ precision mediump float;                              \n\
 varying     vec2      v_TexCoord;                     \n\
 varying     vec2      v_TexCoordPix;                  \n\
 uniform     sampler2D u_sampler;                      \n\
-uniform     vec4      u_Color;                        \n\
+varying     vec4      v_Color;                        \n\
                                                       \n\
 void main (void)                                      \n\
 {                                                     \n\
@@ -249,7 +264,7 @@ void main (void)                                      \n\
                     0, -0.34413, 1.772,               \n\
                 1.402, -0.71414,     0) * yuv;        \n\
     gl_FragColor = vec4(rgb, 1.0);                    \n\
-    gl_FragColor *= u_Color;                          \n\
+    gl_FragColor *= v_Color;                          \n\
 }                                                     \n";
 
 enum shader_type {
@@ -276,7 +291,6 @@ static char *s_shader[SHADER_NUM * 2] =
 
 static shader_obj_t s_sobj[SHADER_NUM];
 static int s_loc_mtx[SHADER_NUM];
-static int s_loc_color[SHADER_NUM];
 static int s_loc_texdim[SHADER_NUM];
 
 static float varray[] =
@@ -285,6 +299,98 @@ static float varray[] =
     1.0, 0.0,
     1.0, 1.0 };
 
+
+/* ------------------------------------------------------ *
+ *  Retained-mode batch
+ *
+ *    Every draw_2d_xxx() records its primitives into a CPU vertex
+ *    stream instead of drawing them. Primitives which share the same
+ *    program, texture, blend function and line width go into the same
+ *    batch, and a batch is drawn with one glDrawArrays().
+ *
+ *    A primitive may join an earlier batch of the same state only if it
+ *    does not overlap any batch recorded after that one, so the result
+ *    is identical to drawing them in the order of the calls.
+ *
+ *    Outside of begin_2d_batch()/end_2d_batch(), every call is flushed
+ *    immediately as before.
+ * ------------------------------------------------------ */
+typedef struct _r2d_vtx_t
+{
+    float   x, y;
+    float   u, v;
+    GLubyte rgba[4];
+} r2d_vtx_t;
+
+typedef struct _r2d_key_t
+{
+    int          textype;
+    int          texid;
+    int          texw, texh;
+    GLenum       prim;              /* GL_TRIANGLES or GL_LINES */
+    float        line_width;
+    unsigned int blendfunc[4];      /* src_rgb, dst_rgb, src_alpha, dst_alpha */
+} r2d_key_t;
+
+typedef struct _r2d_batch_t
+{
+    r2d_key_t   key;
+    float       bbox[4];            /* x0, y0, x1, y1 */
+    int         vtx_num;
+} r2d_batch_t;
+
+typedef struct _r2d_cmd_t
+{
+    int         batch;
+    int         vtx_first;
+    int         vtx_num;
+} r2d_cmd_t;
+
+#define BATCH_LOOKBACK      8       /* how many batches a primitive can move back over */
+
+static GLuint       s_vbo;
+static GLsizeiptr   s_vbo_size;
+static int          s_batch_depth;
+static int          s_reordered;
+
+static r2d_vtx_t    *s_vtx;
+static r2d_vtx_t    *s_vtx_sorted;
+static int          s_vtx_sorted_max;
+static int          s_vtx_num, s_vtx_max;
+static r2d_cmd_t    *s_cmd;
+static int          s_cmd_num, s_cmd_max;
+static r2d_batch_t  *s_batch;
+static int          s_batch_num, s_batch_max;
+
+static int flush_2d_batch_in (void);
+
+
+static int
+grow_array (void **buf, int *max, int need, int elem_size)
+{
+    int  new_max;
+    void *new_buf;
+
+    if (need <= *max)
+        return 0;
+
+    new_max = (*max > 0) ? *max : 64;
+    while (new_max < need)
+        new_max *= 2;
+
+    new_buf = realloc (*buf, (size_t)new_max * elem_size);
+    if (new_buf == NULL)
+    {
+        fprintf (stderr, "ERR: %s(%d)\n", __FILE__, __LINE__);
+        return -1;
+    }
+
+    *buf = new_buf;
+    *max = new_max;
+    return 0;
+}
+
+
 static float s_matprj[16];
 int
 set_2d_projection_matrix (int w, int h)
@@ -299,6 +405,10 @@ set_2d_projection_matrix (int w, int h)
     mat_proj[0] =  2.0f / (float)w;
     mat_proj[5] = -2.0f / (float)h;
 
+    /* the recorded primitives belong to the previous projection */
+    if (memcmp (s_matprj, mat_proj, sizeof (mat_proj)) != 0)
+        flush_2d_batch_in ();
+
     memcpy (s_matprj, mat_proj, 16*sizeof(float));
 
     GLASSERT ();
@@ -321,15 +431,360 @@ init_2d_renderer (int w, int h)
         }
 
         s_loc_mtx[i]    = glGetUniformLocation(s_sobj[i].program, "u_PMVMatrix");
-        s_loc_color[i]  = glGetUniformLocation(s_sobj[i].program, "u_Color");
         s_loc_texdim[i] = glGetUniformLocation(s_sobj[i].program, "u_TexDim");
     }
 
+    glGenBuffers (1, &s_vbo);
+    s_vbo_size    = 0;
+    s_batch_depth = 0;
+    s_vtx_num     = 0;
+    s_cmd_num     = 0;
+    s_batch_num   = 0;
+
     set_2d_projection_matrix (w, h);
 
     return 0;
 }
 
+
+static int
+overlap_bbox (float *a, float *b)
+{
+    if (a[2] < b[0] || b[2] < a[0])
+        return 0;
+    if (a[3] < b[1] || b[3] < a[1])
+        return 0;
+    return 1;
+}
+
+/*
+ *  begin_prim() reserves (num) vertices for a primitive, and end_prim()
+ *  adds the filled vertices to the batch of state (key).
+ */
+static r2d_vtx_t *
+begin_prim (int num)
+{
+    if (grow_array ((void **)&s_vtx, &s_vtx_max, s_vtx_num + num, sizeof (r2d_vtx_t)) < 0)
+        return NULL;
+
+    return &s_vtx[s_vtx_num];
+}
+
+static int
+end_prim (r2d_key_t *key, int num)
+{
+    r2d_vtx_t *vtx = &s_vtx[s_vtx_num];
+    float bbox[4];
+    int   ibatch = -1;
+
+    /* screen space bounds of the primitive, widened by the line width */
+    bbox[0] = bbox[2] = vtx[0].x;
+    bbox[1] = bbox[3] = vtx[0].y;
+    for (int i = 1; i < num; i ++)
+    {
+        if (vtx[i].x < bbox[0]) bbox[0] = vtx[i].x;
+        if (vtx[i].y < bbox[1]) bbox[1] = vtx[i].y;
+        if (vtx[i].x > bbox[2]) bbox[2] = vtx[i].x;
+        if (vtx[i].y > bbox[3]) bbox[3] = vtx[i].y;
+    }
+    bbox[0] -= key->line_width + 1.0f;
+    bbox[1] -= key->line_width + 1.0f;
+    bbox[2] += key->line_width + 1.0f;
+    bbox[3] += key->line_width + 1.0f;
+
+    /* join the latest batch of the same state unless a batch after it overlaps */
+    for (int i = s_batch_num - 1; i >= 0 && i >= s_batch_num - BATCH_LOOKBACK; i --)
+    {
+        r2d_batch_t *batch = &s_batch[i];
+
+        if (memcmp (&batch->key, key, sizeof (r2d_key_t)) == 0)
+        {
+            ibatch = i;
+            break;
+        }
+        if (overlap_bbox (batch->bbox, bbox))
+            break;
+    }
+
+    if (ibatch < 0)
+    {
+        if (grow_array ((void **)&s_batch, &s_batch_max, s_batch_num + 1, sizeof (r2d_batch_t)) < 0)
+            return -1;
+
+        ibatch = s_batch_num ++;
+        s_batch[ibatch].key     = *key;
+        s_batch[ibatch].vtx_num = 0;
+        memcpy (s_batch[ibatch].bbox, bbox, sizeof (bbox));
+    }
+    else
+    {
+        r2d_batch_t *batch = &s_batch[ibatch];
+        if (bbox[0] < batch->bbox[0]) batch->bbox[0] = bbox[0];
+        if (bbox[1] < batch->bbox[1]) batch->bbox[1] = bbox[1];
+        if (bbox[2] > batch->bbox[2]) batch->bbox[2] = bbox[2];
+        if (bbox[3] > batch->bbox[3]) batch->bbox[3] = bbox[3];
+
+        if (ibatch != s_batch_num - 1)
+            s_reordered = 1;
+    }
+
+    /* consecutive primitives of the same batch share one command */
+    if (s_cmd_num > 0 && s_cmd[s_cmd_num - 1].batch == ibatch)
+    {
+        s_cmd[s_cmd_num - 1].vtx_num += num;
+    }
+    else
+    {
+        if (grow_array ((void **)&s_cmd, &s_cmd_max, s_cmd_num + 1, sizeof (r2d_cmd_t)) < 0)
+            return -1;
+
+        s_cmd[s_cmd_num].batch     = ibatch;
+        s_cmd[s_cmd_num].vtx_first = s_vtx_num;
+        s_cmd[s_cmd_num].vtx_num   = num;
+        s_cmd_num ++;
+    }
+
+    s_batch[ibatch].vtx_num += num;
+    s_vtx_num += num;
+
+    if (s_batch_depth == 0)
+        return flush_2d_batch_in ();
+
+    return 0;
+}
+
+
+static void
+set_vtx (r2d_vtx_t *vtx, float x, float y, float u, float v, GLubyte *rgba)
+{
+    vtx->x = x;
+    vtx->y = y;
+    vtx->u = u;
+    vtx->v = v;
+    memcpy (vtx->rgba, rgba, 4);
+}
+
+static void
+color_to_rgba (float *color, GLubyte *rgba)
+{
+    for (int i = 0; i < 4; i ++)
+    {
+        float val = color[i];
+        if (val <= 0.0f)
+            rgba[i] = 0;
+        else if (val >= 1.0f)
+            rgba[i] = 255;
+        else
+            rgba[i] = (GLubyte)(val * 255.0f + 0.5f);
+    }
+}
+
+static void
+init_key (r2d_key_t *key, int textype, GLenum prim, float line_width)
+{
+    memset (key, 0, sizeof (r2d_key_t));
+    key->textype      = textype;
+    key->prim         = prim;
+    key->line_width   = (prim == GL_LINES) ? line_width : 0.0f;
+    key->blendfunc[0] = GL_SRC_ALPHA;
+    key->blendfunc[1] = GL_ONE_MINUS_SRC_ALPHA;
+    key->blendfunc[2] = GL_ONE;
+    key->blendfunc[3] = GL_ONE_MINUS_SRC_ALPHA;
+}
+
+
+/*
+ *  draw all the recorded primitives, one glDrawArrays() per batch.
+ */
+static int
+flush_2d_batch_in (void)
+{
+    r2d_vtx_t *vtx = s_vtx;
+    char *base;
+    int cur_ttype = -1;
+    int cur_texid = -1;
+    int first = 0;
+
+    if (s_vtx_num == 0)
+        return 0;
+
+    /* gather the vertices of every batch together */
+    if (s_reordered)
+    {
+        int ofst = 0;
+
+        if (grow_array ((void **)&s_vtx_sorted, &s_vtx_sorted_max, s_vtx_num, sizeof (r2d_vtx_t)) < 0)
+            return -1;
+
+        for (int i = 0; i < s_batch_num; i ++)
+        {
+            int num = s_batch[i].vtx_num;
+            s_batch[i].vtx_num = ofst;  /* reuse as write cursor */
+            ofst += num;
+        }
+        for (int i = 0; i < s_cmd_num; i ++)
+        {
+            r2d_cmd_t   *cmd   = &s_cmd[i];
+            r2d_batch_t *batch = &s_batch[cmd->batch];
+            memcpy (&s_vtx_sorted[batch->vtx_num], &s_vtx[cmd->vtx_first], cmd->vtx_num * sizeof (r2d_vtx_t));
+            batch->vtx_num += cmd->vtx_num;
+        }
+        for (int i = s_batch_num - 1; i > 0; i --)
+            s_batch[i].vtx_num -= s_batch[i - 1].vtx_num;
+
+        vtx = s_vtx_sorted;
+    }
+
+    /*
+     *  a single immediate primitive is drawn from client memory as before.
+     *  a batch is uploaded to the VBO, orphaned so that the previous flush
+     *  does not stall us.
+     */
+    glstate_bind_vertex_array (0);
+    if (s_batch_depth == 0)
+    {
+        glstate_bind_buffer (GL_ARRAY_BUFFER, 0);
+        base = (char *)vtx;
+    }
+    else
+    {
+        glstate_bind_buffer (GL_ARRAY_BUFFER, s_vbo);
+        if (s_vtx_num * (GLsizeiptr)sizeof (r2d_vtx_t) > s_vbo_size)
+            s_vbo_size = s_vtx_max * sizeof (r2d_vtx_t);
+        glBufferData (GL_ARRAY_BUFFER, s_vbo_size, NULL, GL_STREAM_DRAW);
+        glBufferSubData (GL_ARRAY_BUFFER, 0, s_vtx_num * sizeof (r2d_vtx_t), vtx);
+        base = NULL;
+    }
+    glstate_bind_buffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    glstate_disable (GL_DEPTH_TEST);
+    glstate_disable (GL_CULL_FACE);
+    glstate_enable (GL_BLEND);
+    glstate_active_texture (GL_TEXTURE0);
+
+    for (int i = 0; i < s_batch_num; i ++)
+    {
+        r2d_key_t    *key  = &s_batch[i].key;
+        int           ttype = key->textype;
+        shader_obj_t *sobj = &s_sobj[ttype];
+
+        if (ttype != cur_ttype)
+        {
+            glstate_use_program (sobj->program);
+            glUniform1i (sobj->loc_tex, 0);
+            glUniformMatrix4fv (s_loc_mtx[ttype], 1, GL_FALSE, s_matprj);
+
+            if (sobj->loc_vtx >= 0)
+            {
+                glstate_enable_vertex_attrib_array (sobj->loc_vtx);
+                glVertexAttribPointer (sobj->loc_vtx, 2, GL_FLOAT, GL_FALSE, sizeof (r2d_vtx_t),
+                                       base + offsetof (r2d_vtx_t, x));
+            }
+            if (sobj->loc_uv >= 0)
+            {
+                glstate_enable_vertex_attrib_array (sobj->loc_uv);
+                glVertexAttribPointer (sobj->loc_uv, 2, GL_FLOAT, GL_FALSE, sizeof (r2d_vtx_t),
+                                       base + offsetof (r2d_vtx_t, u));
+            }
+            if (sobj->loc_clr >= 0)
+            {
+                glstate_enable_vertex_attrib_array (sobj->loc_clr);
+                glVertexAttribPointer (sobj->loc_clr, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof (r2d_vtx_t),
+                                       base + offsetof (r2d_vtx_t, rgba));
+            }
+            cur_ttype = ttype;
+            cur_texid = -1;
+        }
+
+        if (key->texid != cur_texid)
+        {
+            switch (ttype)
+            {
+            case SHADER_TYPE_FILL:
+                break;
+            case SHADER_TYPE_EXTEX:
+                glstate_bind_texture (GL_TEXTURE_EXTERNAL_OES, key->texid);
+                break;
+            default:
+                glstate_bind_texture (GL_TEXTURE_2D, key->texid);
+                break;
+            }
+            cur_texid = key->texid;
+        }
+
+        if (s_loc_texdim[ttype] >= 0)
+        {
+            float texdim[2];
+            texdim[0] = key->texw;
+            texdim[1] = key->texh;
+            glUniform2fv (s_loc_texdim[ttype], 1, texdim);
+        }
+
+        glstate_blend_func_separate (key->blendfunc[0], key->blendfunc[1],
+                             key->blendfunc[2], key->blendfunc[3]);
+
+        if (key->prim == GL_LINES)
+            glLineWidth (key->line_width);
+
+        glDrawArrays (key->prim, first, s_batch[i].vtx_num);
+        first += s_batch[i].vtx_num;
+    }
+
+    glLineWidth (1);
+
+    /*
+     *  the arrays may point to the client memory: none is left enabled on
+     *  the default VAO, so that its next user can't read through them.
+     */
+    for (int i = 0; i < SHADER_NUM; i ++)
+    {
+        if (s_sobj[i].loc_vtx >= 0) glstate_disable_vertex_attrib_array (s_sobj[i].loc_vtx);
+        if (s_sobj[i].loc_uv  >= 0) glstate_disable_vertex_attrib_array (s_sobj[i].loc_uv);
+        if (s_sobj[i].loc_clr >= 0) glstate_disable_vertex_attrib_array (s_sobj[i].loc_clr);
+    }
+
+    s_vtx_num   = 0;
+    s_cmd_num   = 0;
+    s_batch_num = 0;
+    s_reordered = 0;
+
+    GLASSERT ();
+    return 0;
+}
+
+
+/*
+ *  Between begin_2d_batch() and end_2d_batch(), draw_2d_xxx() only record
+ *  the primitives. The textures given to them must stay alive until the
+ *  batch is flushed. Calls can be nested.
+ */
+int
+begin_2d_batch (void)
+{
+    s_batch_depth ++;
+    return 0;
+}
+
+int
+end_2d_batch (void)
+{
+    if (s_batch_depth > 0)
+        s_batch_depth --;
+
+    if (s_batch_depth == 0)
+        return flush_2d_batch_in ();
+
+    return 0;
+}
+
+/* draw the recorded primitives now, e.g. before drawing something else on top. */
+int
+flush_2d_batch (void)
+{
+    return flush_2d_batch_in ();
+}
+
+
 typedef struct _texparam
 {
     int          textype;
@@ -368,14 +823,12 @@ flip_texcoord (float *uv, unsigned int flip_mode)
 static int
 draw_2d_texture_in (texparam_t *tparam)
 {
-    int ttype = tparam->textype;  
-    int texid = tparam->texid;
+    int ttype = tparam->textype;
     float x   = tparam->x;
     float y   = tparam->y;
     float w   = tparam->w;
     float h   = tparam->h;
     float rot = tparam->rot;
-    shader_obj_t *sobj = &s_sobj[ttype];
     float matrix[16];
     float tarray[] = {
         0.0, 0.0,
@@ -383,29 +836,20 @@ draw_2d_texture_in (texparam_t *tparam)
         1.0, 0.0,
         1.0, 1.0 };
     float *uv = tarray;
+    float pos[8];
+    GLubyte rgba[4];
+    r2d_key_t key;
 
-    glBindBuffer (GL_ARRAY_BUFFER, 0);
-    glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
-
-    glUseProgram (sobj->program);
-    glActiveTexture (GL_TEXTURE0);
-    glUniform1i(sobj->loc_tex, 0);
-
-    switch (ttype)
+    init_key (&key, ttype, GL_TRIANGLES, 0.0f);
+    if (ttype != SHADER_TYPE_FILL)
+        key.texid = tparam->texid;
+    if (s_loc_texdim[ttype] >= 0)
     {
-    case SHADER_TYPE_FILL:
-        break;
-    case SHADER_TYPE_TEX:
-    case SHADER_TYPE_TEX_YUYV:
-    case SHADER_TYPE_TEX_UYVY:
-        glBindTexture (GL_TEXTURE_2D, texid);
-        break;
-    case SHADER_TYPE_EXTEX:
-        glBindTexture (GL_TEXTURE_EXTERNAL_OES, texid);
-        break;
-    default:
-        break;
+        key.texw = tparam->texw;
+        key.texh = tparam->texh;
     }
+    if (tparam->blendfunc_en)
+        memcpy (key.blendfunc, tparam->blendfunc, sizeof (key.blendfunc));
 
     flip_texcoord (uv, tparam->upsidedown);
 
@@ -414,25 +858,6 @@ draw_2d_texture_in (texparam_t *tparam)
         uv = tparam->user_texcoord;
     }
 
-    if (sobj->loc_uv >= 0)
-    {
-        glEnableVertexAttribArray (sobj->loc_uv);
-        glVertexAttribPointer (sobj->loc_uv, 2, GL_FLOAT, GL_FALSE, 0, uv);
-    }
-
-    glEnable (GL_BLEND);
-
-    if (tparam->blendfunc_en)
-    {
-        glBlendFuncSeparate (tparam->blendfunc[0], tparam->blendfunc[1],
-                   tparam->blendfunc[2], tparam->blendfunc[3]);
-    }
-    else
-    {
-        glBlendFuncSeparate (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA,
-                   GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
-    }
-
     matrix_identity (matrix);
     matrix_translate (matrix, x, y, 0.0f);
     if (rot != 0)
@@ -444,32 +869,30 @@ draw_2d_texture_in (texparam_t *tparam)
         matrix_translate (matrix, -px, -py, 0.0f);
     }
     matrix_scale (matrix, w, h, 1.0f);
-    matrix_mult (matrix, s_matprj, matrix);
-
-    glUniformMatrix4fv (s_loc_mtx[ttype], 1, GL_FALSE, matrix);
-    glUniform4fv (s_loc_color[ttype], 1, tparam->color);
 
-    if (s_loc_texdim[ttype] >= 0)
+    for (int i = 0; i < 4; i ++)
     {
-        float texdim[2];
-        texdim[0] = tparam->texw;
-        texdim[1] = tparam->texh;
-        glUniform2fv (s_loc_texdim[ttype], 1, texdim);
+        float vx = varray[2 * i + 0];
+        float vy = varray[2 * i + 1];
+        pos[2 * i + 0] = matrix[0] * vx + matrix[4] * vy + matrix[12];
+        pos[2 * i + 1] = matrix[1] * vx + matrix[5] * vy + matrix[13];
     }
 
-    if (sobj->loc_vtx >= 0)
+    color_to_rgba (tparam->color, rgba);
+
+    /* triangle strip (0, 1, 2, 3) as a triangle list */
+    static const int s_idx[6] = {0, 1, 2, 2, 1, 3};
+    r2d_vtx_t *vtx = begin_prim (6);
+    if (vtx == NULL)
+        return -1;
+
+    for (int i = 0; i < 6; i ++)
     {
-        glEnableVertexAttribArray (sobj->loc_vtx);
-        glVertexAttribPointer (sobj->loc_vtx, 2, GL_FLOAT, GL_FALSE, 0, varray);
+        int j = s_idx[i];
+        set_vtx (&vtx[i], pos[2 * j], pos[2 * j + 1], uv[2 * j], uv[2 * j + 1], rgba);
     }
 
-    glDrawArrays (GL_TRIANGLE_STRIP, 0, 4);
-
-    glDisable (GL_BLEND);
-    
-    GLASSERT ();
-    return 0;
-    
+    return end_prim (&key, 6);
 }
 
 
@@ -698,46 +1121,56 @@ draw_2d_fillrect (int x, int y, int w, int h, float *color)
 }
 
 
-int
-draw_2d_rect (int x, int y, int w, int h, float *color, float line_width)
+/* line strip of (num) points as GL_LINES. (matrix) may be NULL. */
+static int
+add_line_strip (float *pts, int num, float *matrix, float *color, float line_width)
 {
-    int ttype = SHADER_TYPE_FILL;
-    shader_obj_t *sobj = &s_sobj[ttype];
-    float matrix[16];
+    GLubyte rgba[4];
+    r2d_key_t key;
+    int nvtx = (num - 1) * 2;
 
-    glBindBuffer (GL_ARRAY_BUFFER, 0);
-    glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+    init_key (&key, SHADER_TYPE_FILL, GL_LINES, line_width);
+    color_to_rgba (color, rgba);
 
-    glUseProgram (sobj->program);
-    glUniform4fv (s_loc_color[ttype], 1, color);
+    r2d_vtx_t *vtx = begin_prim (nvtx);
+    if (vtx == NULL)
+        return -1;
 
-    glEnable (GL_BLEND);
-    glBlendFuncSeparate (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, 
-               GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    for (int i = 0; i < num - 1; i ++)
+    {
+        for (int j = 0; j < 2; j ++)
+        {
+            float x = pts[2 * (i + j) + 0];
+            float y = pts[2 * (i + j) + 1];
+            if (matrix)
+            {
+                float tx = matrix[0] * x + matrix[4] * y + matrix[12];
+                float ty = matrix[1] * x + matrix[5] * y + matrix[13];
+                x = tx;
+                y = ty;
+            }
+            set_vtx (&vtx[2 * i + j], x, y, 0.0f, 0.0f, rgba);
+        }
+    }
+
+    return end_prim (&key, nvtx);
+}
 
-    matrix_identity (matrix);
-    matrix_mult (matrix, s_matprj, matrix);
-    glUniformMatrix4fv (s_loc_mtx[ttype], 1, GL_FALSE, matrix);
 
-    glLineWidth (line_width);
+int
+draw_2d_rect (int x, int y, int w, int h, float *color, float line_width)
+{
     float x1 = x;
     float x2 = x + w;
     float y1 = y;
     float y2 = y + h;
-    if (sobj->loc_vtx >= 0)
-    {
-        float vtx[] = {x1, y1,
-                       x2, y1,
-                       x2, y2,
-                       x1, y2,
-                       x1, y1};
-
-        glEnableVertexAttribArray (sobj->loc_vtx);
-        glVertexAttribPointer (sobj->loc_vtx, 2, GL_FLOAT, GL_FALSE, 0, vtx);
-        glDrawArrays (GL_LINE_STRIP, 0, 5);
-    }
+    float vtx[] = {x1, y1,
+                   x2, y1,
+                   x2, y2,
+                   x1, y2,
+                   x1, y1};
 
-    glDisable (GL_BLEND);
+    add_line_strip (vtx, 5, NULL, color, line_width);
 
     GLASSERT ();
     return 0;
@@ -747,19 +1180,16 @@ int
 draw_2d_rect_rot (int x, int y, int w, int h, float *color, float line_width,
                   int px, int py, float rot_degree)
 {
-    int ttype = SHADER_TYPE_FILL;
-    shader_obj_t *sobj = &s_sobj[ttype];
     float matrix[16];
-
-    glBindBuffer (GL_ARRAY_BUFFER, 0);
-    glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
-
-    glUseProgram (sobj->program);
-    glUniform4fv (s_loc_color[ttype], 1, color);
-
-    glEnable (GL_BLEND);
-    glBlendFuncSeparate (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA,
-               GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    float x1 = x;
+    float x2 = x + w;
+    float y1 = y;
+    float y2 = y + h;
+    float vtx[10] = {x1, y1,
+                     x2, y1,
+                     x2, y2,
+                     x1, y2,
+                     x1, y1};
 
     matrix_identity (matrix);
     if (rot_degree != 0)
@@ -769,28 +1199,7 @@ draw_2d_rect_rot (int x, int y, int w, int h, float *color, float line_width,
         matrix_translate (matrix, -px, -py, 0);
     }
 
-    matrix_mult (matrix, s_matprj, matrix);
-    glUniformMatrix4fv (s_loc_mtx[ttype], 1, GL_FALSE, matrix);
-
-    glLineWidth (line_width);
-    float x1 = x;
-    float x2 = x + w;
-    float y1 = y;
-    float y2 = y + h;
-    if (sobj->loc_vtx >= 0)
-    {
-        float vtx[10] = {x1, y1,
-                         x2, y1,
-                         x2, y2,
-                         x1, y2,
-                         x1, y1};
-
-        glEnableVertexAttribArray (sobj->loc_vtx);
-        glVertexAttribPointer (sobj->loc_vtx, 2, GL_FLOAT, GL_FALSE, 0, vtx);
-        glDrawArrays (GL_LINE_STRIP, 0, 5);
-    }
-
-    glDisable (GL_BLEND);
+    add_line_strip (vtx, 5, matrix, color, line_width);
 
     GLASSERT ();
     return 0;
@@ -802,30 +1211,8 @@ draw_2d_line (int x0, int y0, int x1, int y1, float *color, float line_width)
 {
     if (line_width == 1.0f)
     {
-        int ttype = 0;
-        shader_obj_t *sobj = &s_sobj[ttype];
-        float matrix[16];
-
-        glUseProgram (sobj->program);
-        glUniform4fv (s_loc_color[ttype], 1, color);
-
-        glEnable (GL_BLEND);
-        glBlendFuncSeparate (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA,
-                   GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
-
-        matrix_identity (matrix);
-        matrix_mult (matrix, s_matprj, matrix);
-        glUniformMatrix4fv (s_loc_mtx[ttype], 1, GL_FALSE, matrix);
-
-        glLineWidth (line_width);
-        if (sobj->loc_vtx >= 0)
-        {
-            float vtx[] = {x0, y0, x1, y1};
-            glEnableVertexAttribArray (sobj->loc_vtx);
-            glVertexAttribPointer (sobj->loc_vtx, 2, GL_FLOAT, GL_FALSE, 0, vtx);
-            glDrawArrays (GL_LINE_STRIP, 0, 2);
-        }
-        glDisable (GL_BLEND);
+        float vtx[] = {x0, y0, x1, y1};
+        add_line_strip (vtx, 2, NULL, color, line_width);
     }
     else
     {
@@ -861,44 +1248,34 @@ draw_2d_line (int x0, int y0, int x1, int y1, float *color, float line_width)
 int
 draw_2d_fillcircle (int x, int y, int radius, float *color)
 {
-    int ttype = SHADER_TYPE_FILL;
-    shader_obj_t *sobj = &s_sobj[ttype];
-    float matrix[16];
-    float vtx[(CIRCLE_DIVNUM+2) * 2];
+    GLubyte rgba[4];
+    r2d_key_t key;
+    float rim[(CIRCLE_DIVNUM + 1) * 2];
 
-    glBindBuffer (GL_ARRAY_BUFFER, 0);
-    glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+    init_key (&key, SHADER_TYPE_FILL, GL_TRIANGLES, 0.0f);
+    color_to_rgba (color, rgba);
 
-    glUseProgram (sobj->program);
-    glUniform4fv (s_loc_color[ttype], 1, color);
+    for (int i = 0; i <= CIRCLE_DIVNUM; i ++)
+    {
+        float delta = 2 * M_PI / (float)CIRCLE_DIVNUM;
+        float theta = delta * i;
 
-    glEnable (GL_BLEND);
-    glBlendFuncSeparate (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA,
-               GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        rim[i * 2 + 0] = radius * cos (theta) + x;
+        rim[i * 2 + 1] = radius * sin (theta) + y;
+    }
 
-    matrix_identity (matrix);
-    matrix_mult (matrix, s_matprj, matrix);
-    glUniformMatrix4fv (s_loc_mtx[ttype], 1, GL_FALSE, matrix);
+    /* triangle fan as a triangle list */
+    r2d_vtx_t *vtx = begin_prim (CIRCLE_DIVNUM * 3);
+    if (vtx == NULL)
+        return -1;
 
-    if (sobj->loc_vtx >= 0)
+    for (int i = 0; i < CIRCLE_DIVNUM; i ++)
     {
-        vtx[0] = x;
-        vtx[1] = y;
-        for (int i = 0; i <= CIRCLE_DIVNUM; i ++)
-        {
-            float delta = 2 * M_PI / (float)CIRCLE_DIVNUM;
-            float theta = delta * i;
-
-            vtx[(i+1) * 2 + 0] = radius * cos (theta) + x;
-            vtx[(i+1) * 2 + 1] = radius * sin (theta) + y;
-        }
-
-        glEnableVertexAttribArray (sobj->loc_vtx);
-        glVertexAttribPointer (sobj->loc_vtx, 2, GL_FLOAT, GL_FALSE, 0, vtx);
-        glDrawArrays (GL_TRIANGLE_FAN, 0, CIRCLE_DIVNUM + 2);
+        set_vtx (&vtx[3 * i + 0], x, y, 0.0f, 0.0f, rgba);
+        set_vtx (&vtx[3 * i + 1], rim[2 * i + 0], rim[2 * i + 1], 0.0f, 0.0f, rgba);
+        set_vtx (&vtx[3 * i + 2], rim[2 * i + 2], rim[2 * i + 3], 0.0f, 0.0f, rgba);
     }
-
-    glDisable (GL_BLEND);
+    end_prim (&key, CIRCLE_DIVNUM * 3);
 
     GLASSERT ();
     return 0;
@@ -907,46 +1284,19 @@ draw_2d_fillcircle (int x, int y, int radius, float *color)
 int
 draw_2d_circle (int x, int y, int radius, int ndiv, float *color, float line_width)
 {
-    int ttype = SHADER_TYPE_FILL;
-    shader_obj_t *sobj = &s_sobj[ttype];
-    float matrix[16];
-    float vtx[(ndiv+2) * 2];
-
-    glBindBuffer (GL_ARRAY_BUFFER, 0);
-    glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
-
-    glUseProgram (sobj->program);
-    glUniform4fv (s_loc_color[ttype], 1, color);
-
-    glEnable (GL_BLEND);
-    glBlendFuncSeparate (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA,
-               GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    float vtx[(ndiv+1) * 2];
 
-    matrix_identity (matrix);
-    matrix_mult (matrix, s_matprj, matrix);
-    glUniformMatrix4fv (s_loc_mtx[ttype], 1, GL_FALSE, matrix);
-
-    glLineWidth (line_width);
-    if (sobj->loc_vtx >= 0)
+    for (int i = 0; i <= ndiv; i ++)
     {
-        for (int i = 0; i <= ndiv; i ++)
-        {
-            float delta = 2 * M_PI / (float)ndiv;
-            float theta = delta * i;
+        float delta = 2 * M_PI / (float)ndiv;
+        float theta = delta * i;
 
-            vtx[i * 2 + 0] = radius * cos (theta) + x;
-            vtx[i * 2 + 1] = radius * sin (theta) + y;
-        }
-
-        glEnableVertexAttribArray (sobj->loc_vtx);
-        glVertexAttribPointer (sobj->loc_vtx, 2, GL_FLOAT, GL_FALSE, 0, vtx);
-        glDrawArrays (GL_LINE_STRIP, 0, ndiv + 1);
+        vtx[i * 2 + 0] = radius * cos (theta) + x;
+        vtx[i * 2 + 1] = radius * sin (theta) + y;
     }
-    glLineWidth (1);
 
-    glDisable (GL_BLEND);
+    add_line_strip (vtx, ndiv + 1, NULL, color, line_width);
 
     GLASSERT ();
     return 0;
 }
-
@@ -16,6 +16,10 @@ extern "C" {
 int init_2d_renderer (int w, int h);
 int set_2d_projection_matrix (int w, int h);
 
+int begin_2d_batch (void);
+int end_2d_batch (void);
+int flush_2d_batch (void);
+
 int draw_2d_fillrect (int x, int y, int w, int h, float *color);
 int draw_2d_texture (int texid, int x, int y, int w, int h, int upsidedown);
 int draw_2d_texture_ex (texture_2d_t *tex, int x, int y, int w, int h, int upsidedown);
@@ -0,0 +1,326 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <GLES2/gl2.h>
+#include "assertgl.h"
+#include "util_gl_state.h"
+#include "util_shader.h"
+#include "util_matrix.h"
+#include "util_render_line.h"
+
+/* ------------------------------------------------------ *
+ *  shader for per-vertex colored lines
+ * ------------------------------------------------------ */
+static char vs_line[] = "                             \n\
+                                                      \n\
+attribute    vec4    a_Vertex;                        \n\
+attribute    vec4    a_Color;                         \n\
+varying      vec4    v_Color;                         \n\
+uniform      mat4    u_PMVMatrix;                     \n\
+void main (void)                                      \n\
+{                                                     \n\
+    gl_Position = u_PMVMatrix * a_Vertex;             \n\
+    v_Color     = a_Color;                            \n\
+}                                                     ";
+
+static char fs_line[] = "                             \n\
+                                                      \n\
+precision mediump float;                              \n\
+varying      vec4    v_Color;                         \n\
+                                                      \n\
+void main (void)                                      \n\
+{                                                     \n\
+    gl_FragColor = v_Color;                           \n\
+}                                                     ";
+
+
+/* the same shader for GL_OVR_multiview2: one matrix per view */
+static char vs_line_mv[] = "#version 300 es           \n\
+#extension GL_OVR_multiview2 : require                \n\
+layout(num_views = 2) in;                             \n\
+in           vec4    a_Vertex;                        \n\
+in           vec4    a_Color;                         \n\
+out          vec4    v_Color;                         \n\
+uniform      mat4    u_PMVMatrix[2];                  \n\
+void main (void)                                      \n\
+{                                                     \n\
+    gl_Position = u_PMVMatrix[gl_ViewID_OVR] * a_Vertex;\n\
+    v_Color     = a_Color;                            \n\
+}                                                     ";
+
+static char fs_line_mv[] = "#version 300 es           \n\
+precision mediump float;                              \n\
+in           vec4    v_Color;                         \n\
+out          vec4    o_FragColor;                     \n\
+                                                      \n\
+void main (void)                                      \n\
+{                                                     \n\
+    o_FragColor = v_Color;                            \n\
+}                                                     ";
+
+
+typedef struct _line_vtx_t
+{
+    float   x, y, z;
+    GLubyte rgba[4];
+} line_vtx_t;
+
+#define LINE_VTX_INIT_NUM   1024
+
+static shader_obj_t s_sobj;
+static shader_obj_t s_sobj_mv;
+static GLuint       s_vbo;
+static GLsizeiptr   s_vbo_size;
+
+static line_vtx_t   *s_vtx;
+static int          s_vtx_num;
+static int          s_vtx_max;
+
+
+int
+init_line_renderer (void)
+{
+    if (generate_shader (&s_sobj, vs_line, fs_line) < 0)
+    {
+        fprintf (stderr, "ERR: %s(%d)\n", __FILE__, __LINE__);
+        return -1;
+    }
+
+    glGenBuffers (1, &s_vbo);
+    s_vbo_size = 0;
+
+    line_batch_clear ();
+
+    GLASSERT ();
+    return 0;
+}
+
+
+/* build the stereo multiview shader used by line_batch_flush_multiview(). */
+int
+init_line_renderer_multiview (void)
+{
+    if (generate_shader (&s_sobj_mv, vs_line_mv, fs_line_mv) < 0)
+    {
+        fprintf (stderr, "ERR: %s(%d)\n", __FILE__, __LINE__);
+        return -1;
+    }
+
+    GLASSERT ();
+    return 0;
+}
+
+
+void
+line_batch_clear (void)
+{
+    s_vtx_num = 0;
+}
+
+
+int
+line_batch_get_num (void)
+{
+    return s_vtx_num / 2;
+}
+
+
+static line_vtx_t *
+alloc_vtx (int num)
+{
+    if (s_vtx_num + num > s_vtx_max)
+    {
+        int new_max = (s_vtx_max > 0) ? s_vtx_max : LINE_VTX_INIT_NUM;
+        while (new_max < s_vtx_num + num)
+            new_max *= 2;
+
+        line_vtx_t *new_vtx = (line_vtx_t *)realloc (s_vtx, new_max * sizeof (line_vtx_t));
+        if (new_vtx == NULL)
+        {
+            fprintf (stderr, "ERR: %s(%d)\n", __FILE__, __LINE__);
+            return NULL;
+        }
+        s_vtx     = new_vtx;
+        s_vtx_max = new_max;
+    }
+
+    line_vtx_t *vtx = &s_vtx[s_vtx_num];
+    s_vtx_num += num;
+    return vtx;
+}
+
+
+static GLubyte
+float_to_ubyte (float val)
+{
+    if (val <= 0.0f) return 0;
+    if (val >= 1.0f) return 255;
+    return (GLubyte)(val * 255.0f + 0.5f);
+}
+
+
+static void
+set_vtx (line_vtx_t *vtx, float *matM, float *pos, GLubyte *rgba)
+{
+    if (matM)
+    {
+        float vec[4] = {pos[0], pos[1], pos[2], 1.0f};
+        matrix_multvec3 (matM, vec, vec);
+        vtx->x = vec[0];
+        vtx->y = vec[1];
+        vtx->z = vec[2];
+    }
+    else
+    {
+        vtx->x = pos[0];
+        vtx->y = pos[1];
+        vtx->z = pos[2];
+    }
+    memcpy (vtx->rgba, rgba, 4);
+}
+
+
+int
+line_batch_add (float *matM, float *p0, float *p1, float *color)
+{
+    GLubyte rgba[4];
+    line_vtx_t *vtx = alloc_vtx (2);
+    if (vtx == NULL)
+        return -1;
+
+    for (int i = 0; i < 4; i ++)
+        rgba[i] = float_to_ubyte (color[i]);
+
+    set_vtx (&vtx[0], matM, p0, rgba);
+    set_vtx (&vtx[1], matM, p1, rgba);
+
+    return 0;
+}
+
+
+/* (pts) are (num) xyz points of a polyline, drawn as (num - 1) segments. */
+int
+line_batch_add_strip (float *matM, float *pts, int num, float *color)
+{
+    GLubyte rgba[4];
+
+    if (num < 2)
+        return 0;
+
+    line_vtx_t *vtx = alloc_vtx ((num - 1) * 2);
+    if (vtx == NULL)
+        return -1;
+
+    for (int i = 0; i < 4; i ++)
+        rgba[i] = float_to_ubyte (color[i]);
+
+    set_vtx (&vtx[0], matM, &pts[0], rgba);
+    for (int i = 1; i < num - 1; i ++)
+    {
+        set_vtx (&vtx[2 * i - 1], matM, &pts[3 * i], rgba);
+        vtx[2 * i] = vtx[2 * i - 1];
+    }
+    set_vtx (&vtx[2 * num - 3], matM, &pts[3 * (num - 1)], rgba);
+
+    return 0;
+}
+
+
+/* axis aligned (in the space of matM) bounding box: 12 edges. */
+int
+line_batch_add_box (float *matM, float *vmin, float *vmax, float *color)
+{
+    static const int s_edge[12][2] = {
+        {0, 1}, {1, 3}, {3, 2}, {2, 0},     /* z = min */
+        {4, 5}, {5, 7}, {7, 6}, {6, 4},     /* z = max */
+        {0, 4}, {1, 5}, {2, 6}, {3, 7}};
+    line_vtx_t corner[8];
+    GLubyte rgba[4];
+
+    line_vtx_t *vtx = alloc_vtx (24);
+    if (vtx == NULL)
+        return -1;
+
+    for (int i = 0; i < 4; i ++)
+        rgba[i] = float_to_ubyte (color[i]);
+
+    for (int i = 0; i < 8; i ++)
+    {
+        float pos[3];
+        pos[0] = (i & 1) ? vmax[0] : vmin[0];
+        pos[1] = (i & 2) ? vmax[1] : vmin[1];
+        pos[2] = (i & 4) ? vmax[2] : vmin[2];
+        set_vtx (&corner[i], matM, pos, rgba);
+    }
+
+    for (int i = 0; i < 12; i ++)
+    {
+        vtx[2 * i + 0] = corner[s_edge[i][0]];
+        vtx[2 * i + 1] = corner[s_edge[i][1]];
+    }
+
+    return 0;
+}
+
+
+/*
+ *  draw all the accumulated lines with one draw call, then clear the batch.
+ *  The VBO is orphaned every flush so that the driver does not stall on
+ *  the buffer still referenced by the previous eye/frame.
+ */
+static int
+flush_lines (shader_obj_t *sobj, float *matPV, int num_mtx)
+{
+    GLsizeiptr size = s_vtx_num * sizeof (line_vtx_t);
+
+    if (s_vtx_num == 0)
+        return 0;
+
+    glstate_bind_vertex_array (0);
+    glstate_bind_buffer (GL_ARRAY_BUFFER, s_vbo);
+    if (size > s_vbo_size)
+        s_vbo_size = s_vtx_max * sizeof (line_vtx_t);
+    glBufferData (GL_ARRAY_BUFFER, s_vbo_size, NULL, GL_STREAM_DRAW);
+    glBufferSubData (GL_ARRAY_BUFFER, 0, size, s_vtx);
+
+    glstate_use_program (sobj->program);
+
+    glstate_enable_vertex_attrib_array (sobj->loc_vtx);
+    glVertexAttribPointer (sobj->loc_vtx, 3, GL_FLOAT, GL_FALSE, sizeof (line_vtx_t),
+                           (void *)offsetof (line_vtx_t, x));
+
+    glstate_enable_vertex_attrib_array (sobj->loc_clr);
+    glVertexAttribPointer (sobj->loc_clr, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof (line_vtx_t),
+                           (void *)offsetof (line_vtx_t, rgba));
+
+    glUniformMatrix4fv (sobj->loc_mtx, num_mtx, GL_FALSE, matPV);
+
+    glstate_enable (GL_DEPTH_TEST);
+    glstate_disable (GL_BLEND);
+    glDrawArrays (GL_LINES, 0, s_vtx_num);
+
+    line_batch_clear ();
+
+    GLASSERT ();
+    return 0;
+}
+
+
+int
+line_batch_flush (float *matPV)
+{
+    return flush_lines (&s_sobj, matPV, 1);
+}
+
+
+/* (matPV) is the array of 2 matrices, [0]: left eye, [1]: right eye. */
+int
+line_batch_flush_multiview (float *matPV)
+{
+    return flush_lines (&s_sobj_mv, matPV, 2);
+}
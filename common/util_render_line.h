@@ -0,0 +1,40 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef _UTIL_RENDER_LINE_H_
+#define _UTIL_RENDER_LINE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ *  Batched 3D line renderer.
+ *
+ *    line_batch_add*() accumulate line segments with their colors.
+ *    line_batch_flush() draws all of them with one glDrawArrays(GL_LINES)
+ *    and empties the batch.
+ *
+ *    (matM) transforms the points into the space of (matPV) given to
+ *    line_batch_flush(), so that lines of different spaces (e.g. stage
+ *    floor and hand aim beams) go into the same draw. NULL means identity.
+ *
+ *    line_batch_flush_multiview() draws the batch into both layers of a
+ *    GL_OVR_multiview2 render target. (matPV) is float[2][16].
+ */
+int  init_line_renderer (void);
+int  init_line_renderer_multiview (void);
+
+void line_batch_clear     (void);
+int  line_batch_add       (float *matM, float *p0, float *p1, float *color);
+int  line_batch_add_strip (float *matM, float *pts, int num, float *color);
+int  line_batch_add_box   (float *matM, float *vmin, float *vmax, float *color);
+int  line_batch_get_num   (void);
+int  line_batch_flush     (float *matPV);
+int  line_batch_flush_multiview (float *matPV);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _UTIL_RENDER_LINE_H_ */
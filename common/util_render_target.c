@@ -7,13 +7,156 @@
 #include <math.h>
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
+#include <GLES3/gl3.h>
 #include "assertgl.h"
+#include "util_gl_state.h"
 #include "util_render_target.h"
 #include "util_egl.h"
+#include "util_log.h"
 
 #define UNUSED(x) (void)(x)
 
 
+
+/* ------------------------------------------------------------------------ *
+ *  GPU memory accounting
+ *    every render target created/attached here is registered, so that
+ *    report_render_target_memory() can list them with their bytes.
+ * ------------------------------------------------------------------------ */
+#define RTARGET_REGISTRY_MAX    64
+
+typedef struct _rtarget_entry_t
+{
+    GLuint  fbo_id;
+    GLuint  texz_id;
+    int     width;
+    int     height;
+    int     layers;
+    int     samples;
+    GLenum  color_format;       /* 0: no color */
+    GLenum  depth_format;       /* 0: no depth */
+    int     depth_is_rb;        /* depth is a renderbuffer, not a texture */
+    int     depth_shared;       /* depth is owned by another render target */
+} rtarget_entry_t;
+
+static rtarget_entry_t s_rtarget_entry[RTARGET_REGISTRY_MAX];
+static int             s_rtarget_entry_num;
+
+
+static int
+get_format_bytes (GLenum format)
+{
+    switch (format)
+    {
+    case 0:                         return 0;
+    case GL_DEPTH_COMPONENT16:      return 2;
+    case GL_RGBA16F:                return 8;
+    case GL_DEPTH32F_STENCIL8:      return 8;
+    default:                        return 4;   /* RGBA8, SRGB8_ALPHA8, RGB10_A2, DEPTH24(_STENCIL8), ... */
+    }
+}
+
+static size_t
+get_entry_color_bytes (const rtarget_entry_t *e)
+{
+    return (size_t)e->width * e->height * e->layers * get_format_bytes (e->color_format);
+}
+
+/* multisampled depth is counted at full size, as an upper bound */
+static size_t
+get_entry_depth_bytes (const rtarget_entry_t *e)
+{
+    if (e->depth_shared)
+        return 0;
+    return (size_t)e->width * e->height * e->layers * e->samples * get_format_bytes (e->depth_format);
+}
+
+static void
+register_render_target (const render_target_t *rtarget, int layers, int samples,
+                        GLenum color_format, GLenum depth_format, int depth_is_rb, int depth_shared)
+{
+    if (rtarget->fbo_id == 0)
+        return;
+
+    if (s_rtarget_entry_num >= RTARGET_REGISTRY_MAX)
+    {
+        LOGW ("render target registry is full. FBO:%d is not accounted.\n", rtarget->fbo_id);
+        return;
+    }
+
+    rtarget_entry_t *e = &s_rtarget_entry[s_rtarget_entry_num ++];
+    e->fbo_id       = rtarget->fbo_id;
+    e->texz_id      = rtarget->texz_id;
+    e->width        = rtarget->width;
+    e->height       = rtarget->height;
+    e->layers       = layers;
+    e->samples      = samples;
+    e->color_format = color_format;
+    e->depth_format = rtarget->texz_id ? depth_format : 0;
+    e->depth_is_rb  = depth_is_rb;
+    e->depth_shared = depth_shared;
+}
+
+static rtarget_entry_t *
+find_render_target (GLuint fbo_id)
+{
+    for (int i = 0; i < s_rtarget_entry_num; i ++)
+    {
+        if (s_rtarget_entry[i].fbo_id == fbo_id)
+            return &s_rtarget_entry[i];
+    }
+    return NULL;
+}
+
+static void
+unregister_render_target (GLuint fbo_id)
+{
+    rtarget_entry_t *e = find_render_target (fbo_id);
+    if (e == NULL)
+        return;
+
+    *e = s_rtarget_entry[-- s_rtarget_entry_num];
+}
+
+
+size_t
+get_render_target_memory (void)
+{
+    size_t total = 0;
+    for (int i = 0; i < s_rtarget_entry_num; i ++)
+        total += get_entry_color_bytes (&s_rtarget_entry[i]) + get_entry_depth_bytes (&s_rtarget_entry[i]);
+
+    return total;
+}
+
+
+void
+report_render_target_memory (void)
+{
+    size_t color_total = 0;
+    size_t depth_total = 0;
+
+    LOGI ("---- render target memory (%d targets) ----\n", s_rtarget_entry_num);
+    for (int i = 0; i < s_rtarget_entry_num; i ++)
+    {
+        const rtarget_entry_t *e = &s_rtarget_entry[i];
+        size_t color_bytes = get_entry_color_bytes (e);
+        size_t depth_bytes = get_entry_depth_bytes (e);
+
+        LOGI ("FBO:%3d WH(%4d, %4d)x%d MSAA(%d) color(0x%04x):%8zu depth(0x%04x):%8zu%s\n",
+              e->fbo_id, e->width, e->height, e->layers, e->samples,
+              e->color_format, color_bytes, e->depth_format, depth_bytes,
+              e->depth_shared ? " (shared)" : "");
+
+        color_total += color_bytes;
+        depth_total += depth_bytes;
+    }
+    LOGI ("total: color %.1f MB + depth %.1f MB = %.1f MB\n",
+          color_total / (1024.0 * 1024.0), depth_total / (1024.0 * 1024.0),
+          (color_total + depth_total) / (1024.0 * 1024.0));
+}
+
+
 int
 create_render_target (render_target_t *rtarget, int w, int h, unsigned int flags)
 {
@@ -22,7 +165,7 @@ create_render_target (render_target_t *rtarget, int w, int h, unsigned int flags
     if (flags & RTARGET_COLOR)
     {
         glGenTextures (1, &tex_c);
-        glBindTexture (GL_TEXTURE_2D, tex_c);
+        glstate_bind_texture (GL_TEXTURE_2D, tex_c);
         glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -35,7 +178,7 @@ create_render_target (render_target_t *rtarget, int w, int h, unsigned int flags
     if (flags & RTARGET_DEPTH)
     {
         glGenTextures (1, &tex_z);
-        glBindTexture (GL_TEXTURE_2D, tex_z);
+        glstate_bind_texture (GL_TEXTURE_2D, tex_z);
         glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
         glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
         glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -43,7 +186,7 @@ create_render_target (render_target_t *rtarget, int w, int h, unsigned int flags
         glTexImage2D (GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, w, h, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
     }
 
-    glBindTexture (GL_TEXTURE_2D, 0);
+    glstate_bind_texture (GL_TEXTURE_2D, 0);
 
     GLuint fbo = 0;
     if (flags)
@@ -63,6 +206,8 @@ create_render_target (render_target_t *rtarget, int w, int h, unsigned int flags
     rtarget->width   = w;
     rtarget->height  = h;
 
+    register_render_target (rtarget, 1, 1, tex_c ? GL_RGBA8 : 0, GL_DEPTH_COMPONENT, 0, 0);
+
     GLASSERT();
 
     return 0;
@@ -72,8 +217,35 @@ create_render_target (render_target_t *rtarget, int w, int h, unsigned int flags
 int
 destroy_render_target (render_target_t *rtarget)
 {
-    glDeleteTextures (1, &rtarget->texc_id);
-    glDeleteTextures (1, &rtarget->texz_id);
+    unregister_render_target (rtarget->fbo_id);
+
+    glstate_delete_textures (1, &rtarget->texc_id);
+    glstate_delete_textures (1, &rtarget->texz_id);
+    glDeleteFramebuffers (1, &rtarget->fbo_id);
+    memset (rtarget, 0, sizeof (*rtarget));
+
+    GLASSERT();
+
+    return 0;
+}
+
+/*
+ *  delete what attach_render_target*() created: the FBO, and the depth
+ *  unless it is shared. the color texture is left to its owner.
+ */
+int
+detach_render_target (render_target_t *rtarget)
+{
+    rtarget_entry_t *e = find_render_target (rtarget->fbo_id);
+    if (e && !e->depth_shared && e->texz_id)
+    {
+        if (e->depth_is_rb)
+            glDeleteRenderbuffers (1, &e->texz_id);
+        else
+            glstate_delete_textures (1, &e->texz_id);
+    }
+    unregister_render_target (rtarget->fbo_id);
+
     glDeleteFramebuffers (1, &rtarget->fbo_id);
     memset (rtarget, 0, sizeof (*rtarget));
 
@@ -140,3 +312,231 @@ get_render_target (render_target_t *rtarget)
     return 0;
 }
 
+
+
+/* ------------------------------------------------------------------------ *
+ *  Render target on an existing 2D color texture
+ *  (MSAA via GL_EXT_multisampled_render_to_texture)
+ * ------------------------------------------------------------------------ */
+static PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXTPROC s_glFramebufferTexture2DMultisampleEXT;
+static PFNGLRENDERBUFFERSTORAGEMULTISAMPLEEXTPROC  s_glRenderbufferStorageMultisampleEXT;
+
+int
+get_msaa_rtt_max_samples (void)
+{
+    static int s_checked     = 0;
+    static int s_max_samples = 1;
+
+    if (s_checked)
+        return s_max_samples;
+    s_checked = 1;
+
+    const char *ext = (const char *)glGetString (GL_EXTENSIONS);
+    if (ext == NULL || strstr (ext, "GL_EXT_multisampled_render_to_texture") == NULL)
+        return 1;
+
+    s_glFramebufferTexture2DMultisampleEXT = (PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXTPROC)
+        eglGetProcAddress ("glFramebufferTexture2DMultisampleEXT");
+    s_glRenderbufferStorageMultisampleEXT = (PFNGLRENDERBUFFERSTORAGEMULTISAMPLEEXTPROC)
+        eglGetProcAddress ("glRenderbufferStorageMultisampleEXT");
+    if (s_glFramebufferTexture2DMultisampleEXT == NULL || s_glRenderbufferStorageMultisampleEXT == NULL)
+        return 1;
+
+    GLint max_samples = 1;
+    glGetIntegerv (GL_MAX_SAMPLES_EXT, &max_samples);
+    s_max_samples = (max_samples > 1) ? max_samples : 1;
+
+    return s_max_samples;
+}
+
+
+int
+attach_render_target (render_target_t *rtarget, GLuint tex_c, GLenum color_format, int w, int h,
+                      GLenum depth_format, int num_samples, GLuint shared_z)
+{
+    if (num_samples > get_msaa_rtt_max_samples ())
+        num_samples = get_msaa_rtt_max_samples ();
+
+    GLenum depth_attachment = GL_DEPTH_ATTACHMENT;
+    if (depth_format == GL_DEPTH24_STENCIL8 || depth_format == GL_DEPTH32F_STENCIL8)
+        depth_attachment = GL_DEPTH_STENCIL_ATTACHMENT;
+
+    /* depth renderbuffer. with MSAA, it is never stored to memory either. */
+    GLuint tex_z = shared_z;
+    if (depth_format && tex_z == 0)
+    {
+        glGenRenderbuffers (1, &tex_z);
+        glBindRenderbuffer (GL_RENDERBUFFER, tex_z);
+        if (num_samples > 1)
+            s_glRenderbufferStorageMultisampleEXT (GL_RENDERBUFFER, num_samples, depth_format, w, h);
+        else
+            glRenderbufferStorage (GL_RENDERBUFFER, depth_format, w, h);
+        glBindRenderbuffer (GL_RENDERBUFFER, 0);
+    }
+
+    GLuint fbo = 0;
+    glGenFramebuffers (1, &fbo);
+    glBindFramebuffer (GL_FRAMEBUFFER, fbo);
+    if (num_samples > 1)
+        s_glFramebufferTexture2DMultisampleEXT (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex_c, 0, num_samples);
+    else
+        glFramebufferTexture2D (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex_c, 0);
+    if (tex_z)
+        glFramebufferRenderbuffer (GL_FRAMEBUFFER, depth_attachment, GL_RENDERBUFFER, tex_z);
+
+    GLenum stat = glCheckFramebufferStatus (GL_FRAMEBUFFER);
+    glBindFramebuffer (GL_FRAMEBUFFER, 0);
+    if (stat != GL_FRAMEBUFFER_COMPLETE)
+    {
+        fprintf (stderr, "ERR: %s(%d): FBO incomplete (0x%x)\n", __FILE__, __LINE__, stat);
+        glDeleteFramebuffers (1, &fbo);
+        if (tex_z != shared_z)
+            glDeleteRenderbuffers (1, &tex_z);
+        return -1;
+    }
+
+    memset (rtarget, 0, sizeof (*rtarget));
+    rtarget->texc_id = tex_c;
+    rtarget->texz_id = tex_z;
+    rtarget->fbo_id  = fbo;
+    rtarget->width   = w;
+    rtarget->height  = h;
+
+    register_render_target (rtarget, 1, num_samples > 1 ? num_samples : 1,
+                            color_format, depth_format, 1, shared_z != 0);
+
+    GLASSERT();
+
+    return 0;
+}
+
+
+/*
+ *  depth/stencil are not needed after the pass.
+ *  tell the tiler not to store them back to memory.
+ */
+int
+invalidate_render_target_depth (render_target_t *rtarget)
+{
+    static const GLenum attachments[] = {GL_DEPTH_ATTACHMENT, GL_STENCIL_ATTACHMENT};
+
+    if (rtarget->texz_id == 0)
+        return 0;
+
+    glBindFramebuffer (GL_FRAMEBUFFER, rtarget->fbo_id);
+    glInvalidateFramebuffer (GL_FRAMEBUFFER, 2, attachments);
+
+    GLASSERT();
+
+    return 0;
+}
+
+
+
+/* ------------------------------------------------------------------------ *
+ *  Multiview render target (GL_OVR_multiview2)
+ * ------------------------------------------------------------------------ */
+static PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC s_glFramebufferTextureMultiviewOVR;
+
+int
+is_multiview_supported (void)
+{
+    static int s_checked   = 0;
+    static int s_supported = 0;
+
+    if (s_checked)
+        return s_supported;
+    s_checked = 1;
+
+    const char *ext = (const char *)glGetString (GL_EXTENSIONS);
+    if (ext == NULL || strstr (ext, "GL_OVR_multiview2") == NULL)
+        return 0;
+
+    s_glFramebufferTextureMultiviewOVR = (PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC)
+        eglGetProcAddress ("glFramebufferTextureMultiviewOVR");
+    if (s_glFramebufferTextureMultiviewOVR == NULL)
+        return 0;
+
+    s_supported = 1;
+    return s_supported;
+}
+
+
+int
+attach_render_target_multiview (render_target_t *rtarget, GLuint tex_c, GLenum color_format, int w, int h,
+                                int num_views, GLenum depth_format, GLuint shared_z)
+{
+    if (!is_multiview_supported ())
+        return -1;
+
+    GLenum depth_attachment = GL_DEPTH_ATTACHMENT;
+    if (depth_format == GL_DEPTH24_STENCIL8 || depth_format == GL_DEPTH32F_STENCIL8)
+        depth_attachment = GL_DEPTH_STENCIL_ATTACHMENT;
+
+    /* depth array of the same size as the color array */
+    GLuint tex_z = shared_z;
+    if (depth_format && tex_z == 0)
+    {
+        glGenTextures (1, &tex_z);
+        glstate_bind_texture (GL_TEXTURE_2D_ARRAY, tex_z);
+        glTexStorage3D (GL_TEXTURE_2D_ARRAY, 1, depth_format, w, h, num_views);
+        glstate_bind_texture (GL_TEXTURE_2D_ARRAY, 0);
+    }
+
+    GLuint fbo = 0;
+    glGenFramebuffers (1, &fbo);
+    glBindFramebuffer (GL_FRAMEBUFFER, fbo);
+    s_glFramebufferTextureMultiviewOVR (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, tex_c, 0, 0, num_views);
+    if (tex_z)
+        s_glFramebufferTextureMultiviewOVR (GL_FRAMEBUFFER, depth_attachment, tex_z, 0, 0, num_views);
+
+    GLenum stat = glCheckFramebufferStatus (GL_FRAMEBUFFER);
+    glBindFramebuffer (GL_FRAMEBUFFER, 0);
+    if (stat != GL_FRAMEBUFFER_COMPLETE)
+    {
+        fprintf (stderr, "ERR: %s(%d): FBO incomplete (0x%x)\n", __FILE__, __LINE__, stat);
+        glDeleteFramebuffers (1, &fbo);
+        if (tex_z != shared_z)
+            glstate_delete_textures (1, &tex_z);
+        return -1;
+    }
+
+    memset (rtarget, 0, sizeof (*rtarget));
+    rtarget->texc_id = tex_c;
+    rtarget->texz_id = tex_z;
+    rtarget->fbo_id  = fbo;
+    rtarget->width   = w;
+    rtarget->height  = h;
+
+    register_render_target (rtarget, num_views, 1, color_format, depth_format, 0, shared_z != 0);
+
+    GLASSERT();
+
+    return 0;
+}
+
+
+int
+create_render_target_multiview (render_target_t *rtarget, int w, int h, int num_views)
+{
+    if (!is_multiview_supported ())
+        return -1;
+
+    GLuint tex_c = 0;
+    glGenTextures (1, &tex_c);
+    glstate_bind_texture (GL_TEXTURE_2D_ARRAY, tex_c);
+    glTexParameteri (GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri (GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri (GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri (GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexStorage3D (GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8, w, h, num_views);
+    glstate_bind_texture (GL_TEXTURE_2D_ARRAY, 0);
+
+    if (attach_render_target_multiview (rtarget, tex_c, GL_RGBA8, w, h, num_views, GL_DEPTH_COMPONENT24, 0) < 0)
+    {
+        glstate_delete_textures (1, &tex_c);
+        return -1;
+    }
+
+    return 0;
+}
@@ -31,6 +31,45 @@ int set_render_target (render_target_t *rtarget);
 int get_render_target (render_target_t *rtarget);
 int blit_render_target (render_target_t *rtarget_src, int x, int y, int w, int h);
 
+/*
+ *  Render target on an existing 2D color texture (e.g. an OpenXR swapchain image).
+ *    (color_format) : format of (tex_c), used only for the memory accounting.
+ *    (depth_format) : GL_DEPTH_COMPONENT24, GL_DEPTH24_STENCIL8, ... 0 for no depth.
+ *    (num_samples)  : >1 renders with MSAA through GL_EXT_multisampled_render_to_texture.
+ *                     the samples are resolved into (tex_c) on the tile, and clamped
+ *                     to get_msaa_rtt_max_samples(), which is 1 without the extension.
+ *    (shared_z)     : depth of another render target to attach instead of a new one,
+ *                     (texz_id) of a target created with the same size and format.
+ *                     0 allocates a new depth.
+ *  invalidate_render_target_depth() discards depth/stencil at the end of a pass.
+ *  detach_render_target() deletes the FBO and the owned depth, but not (tex_c).
+ */
+int get_msaa_rtt_max_samples (void);
+int attach_render_target (render_target_t *rtarget, GLuint tex_c, GLenum color_format, int w, int h,
+                          GLenum depth_format, int num_samples, GLuint shared_z);
+int detach_render_target (render_target_t *rtarget);
+int invalidate_render_target_depth (render_target_t *rtarget);
+
+/*
+ *  Multiview (GL_OVR_multiview2) render target.
+ *    color and depth are 2D array textures of (num_views) layers, and the
+ *    layers are attached with glFramebufferTextureMultiviewOVR, so that one
+ *    draw call renders into every layer.
+ *    attach_render_target_multiview() wraps an existing color array (e.g. an
+ *    OpenXR swapchain image) with a depth array of (depth_format) and a new FBO.
+ */
+int is_multiview_supported (void);
+int create_render_target_multiview (render_target_t *rtarget, int w, int h, int num_views);
+int attach_render_target_multiview (render_target_t *rtarget, GLuint tex_c, GLenum color_format, int w, int h,
+                                    int num_views, GLenum depth_format, GLuint shared_z);
+
+/*
+ *  GPU memory of all the live render targets (color + depth).
+ *  a shared depth is counted once, by the render target that owns it.
+ */
+size_t get_render_target_memory (void);
+void   report_render_target_memory (void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -7,6 +7,7 @@
 #include <GLES2/gl2.h>
 #include "util_texture.h"
 #include "assertgl.h"
+#include "util_gl_state.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
@@ -26,7 +27,7 @@ create_2d_texture (void *imgbuf, int width, int height)
     GLuint texid;
 
     glGenTextures (1, &texid );
-    glBindTexture (GL_TEXTURE_2D, texid);
+    glstate_bind_texture (GL_TEXTURE_2D, texid);
 
     glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -53,7 +54,7 @@ create_2d_texture_ex (texture_2d_t *tex2d, void *imgbuf, int width, int height,
     GLuint texid;
 
     glGenTextures (1, &texid);
-    glBindTexture (GL_TEXTURE_2D, texid);
+    glstate_bind_texture (GL_TEXTURE_2D, texid);
 
     glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -158,7 +159,7 @@ load_png_cube_texture (char *name[], int *lpTexID)
     };
 
     glGenTextures(1, &texID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, texID);
+    glstate_bind_texture(GL_TEXTURE_CUBE_MAP, texID);
 
     glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
@@ -242,7 +243,7 @@ update_capture_texture (texture_2d_t *captex)
             break;
         }
 
-        glBindTexture (GL_TEXTURE_2D, captex->texid);
+        glstate_bind_texture (GL_TEXTURE_2D, captex->texid);
         glTexSubImage2D (GL_TEXTURE_2D, 0, 0, 0, texw, texh, texfmt, GL_UNSIGNED_BYTE, cap_buf);
     }
 }
@@ -293,7 +294,7 @@ update_video_texture (texture_2d_t *vidtex)
             break;
         }
 
-        glBindTexture (GL_TEXTURE_2D, vidtex->texid);
+        glstate_bind_texture (GL_TEXTURE_2D, vidtex->texid);
         glTexSubImage2D (GL_TEXTURE_2D, 0, 0, 0, texw, texh, texfmt, GL_UNSIGNED_BYTE, video_buf);
     }
 }
@@ -77,7 +77,14 @@ AppEngine::RenderFrame()
     std::vector<XrCompositionLayerBaseHeader*> all_layers;
 
     XrTime dpy_time;
-    oxr_begin_frame (m_session, &dpy_time);
+    int should_render = oxr_begin_frame (m_session, &dpy_time);
+
+    /* The runtime will not show this frame: skip swapchain acquire and rendering */
+    if (!should_render)
+    {
+        oxr_end_frame (m_session, dpy_time, all_layers);
+        return;
+    }
 
     std::vector<XrCompositionLayerProjectionView> projLayerViews;
     XrCompositionLayerProjection                  projLayer;
@@ -19,6 +19,9 @@ draw_grid_lefttop (int win_w, int win_h)
 
     set_2d_projection_matrix (win_w, win_h);
 
+    /* lines and circles in a few draw calls */
+    begin_2d_batch ();
+
     col = col_gray;
     for (int y = 0; y < win_h; y += 10)
         draw_2d_line (0, y, win_w, y, col, 1.0f);
@@ -50,6 +53,8 @@ draw_grid_lefttop (int win_w, int win_h)
 
     for (int r = 0; r < radius; r += 500)
         draw_2d_circle (cx, cy, r, 50, col_red, 1.0f);
+
+    end_2d_batch ();
 }
 
 
@@ -66,6 +71,9 @@ draw_grid (int win_w, int win_h)
 
     set_2d_projection_matrix (win_w, win_h);
 
+    /* lines and circles in a few draw calls */
+    begin_2d_batch ();
+
     col = col_gray;
     for (int y = 0; y < cy; y += 10)
     {
@@ -113,6 +121,8 @@ draw_grid (int win_w, int win_h)
     for (int r = 0; r < radius; r += 500)
         draw_2d_circle (cx, cy, r, 50, col_red, 1.0f);
 
+    end_2d_batch ();
+
 
     /* strings */
     update_dbgstr_winsize (win_w, win_h);
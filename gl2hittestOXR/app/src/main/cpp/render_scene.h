@@ -17,6 +17,7 @@ typedef struct scene_data_t
     XrRect2Di           viewport;
     std::vector<XrView> views;
     uint32_t            viewID;
+    bool                cpu_budget_exceeded;  /* drop optional passes (UI refresh) */
     std::array<XrSpaceLocation, 2> handLoc;
     std::array<XrSpaceLocation, 2> aimLoc;
 
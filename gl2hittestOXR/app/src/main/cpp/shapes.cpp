@@ -6,10 +6,16 @@
 #include <stdlib.h>
 #include <string.h>
 #include <EGL/egl.h>
-#include <GLES2/gl2.h>
+#include <GLES3/gl3.h>
 #include <math.h>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+#include <chrono>
 #include "shapes.h"
 #include "assertgl.h"
+#include "util_log.h"
+#include "util_mesh.h"
 
 
 #ifdef WIN32 
@@ -67,189 +73,352 @@ get_num_faces (int nDivU, int nDivV )
     return (nDivU - 1) * (nDivV - 1) * 2;
 }
 
+
+/* -------------------------------------------------------------------------- *
+ *  the generated grid, kept in the cache by (type, nDivU, nDivV).
+ *    the attribute arrays and the indices share one allocation at (vtx).
+ * -------------------------------------------------------------------------- */
+#define SHAPE_CACHE_MAX         16
+#define SHAPE_FILE_MAGIC        0x31504853      /* "SHP1" */
+#define SHAPE_FILE_VERSION      1               /* bump when the generator changes */
+#define SHAPE_THREAD_MAX        8
+#define SHAPE_PARALLEL_MIN_VTX  4096            /* smaller grids are generated inline */
+#define SHAPE_FILE_MIN_VTX      65536           /* smaller grids generate faster than a file read */
+
+typedef struct shape_geom_t
+{
+    int     type, nDivU, nDivV;
+    int     num_vtx;
+    int     num_idx;
+    int     idx_size;           /* 2: GL_UNSIGNED_SHORT, 4: GL_UNSIGNED_INT */
+    float   *vtx, *nrm, *uv, *tng, *clr;
+    void    *idx;
+    size_t  size;
+    unsigned int last_use;
+} shape_geom_t;
+
+typedef struct shape_file_hdr_t
+{
+    uint32_t    magic;
+    uint32_t    version;
+    int32_t     type, nDivU, nDivV;
+    int32_t     num_vtx, num_idx, idx_size;
+} shape_file_hdr_t;
+
+static shape_geom_t s_cache[SHAPE_CACHE_MAX];
+static int          s_cache_num;
+static unsigned int s_cache_clock;
+static char         s_cache_dir[256];
+
+
 static int
-gen_shape_buffers (int nDivU, int nDivV, shape_obj_t *pshape)
+alloc_shape_geom (shape_geom_t *geom, int type, int nDivU, int nDivV)
 {
-    int bufSize = sizeof(unsigned short) * get_num_faces (nDivU, nDivV) * 3;
-    unsigned short *pIndex = (unsigned short *)malloc (bufSize);
-    if (pIndex == NULL)
+    int nVertex = nDivU * nDivV;
+
+    geom->type     = type;
+    geom->nDivU    = nDivU;
+    geom->nDivV    = nDivV;
+    geom->num_vtx  = nVertex;
+    geom->num_idx  = get_num_faces (nDivU, nDivV) * 3;
+    geom->idx_size = (nVertex > 65536) ? 4 : 2;
+    geom->size     = sizeof(float) * nVertex * (3 + 3 + 2 + 3 + 3) +
+                     (size_t)geom->idx_size * geom->num_idx;
+
+    geom->vtx = (float *)malloc (geom->size);
+    if (geom->vtx == NULL)
         return -1;
 
-    glGenBuffers (1, &pshape->vbo_vtx);
-    glGenBuffers (1, &pshape->vbo_col);
-    glGenBuffers (1, &pshape->vbo_nrm);
-    glGenBuffers (1, &pshape->vbo_tng);
-    glGenBuffers (1, &pshape->vbo_uv );
-    glGenBuffers (1, &pshape->vbo_idx);
+    geom->nrm = geom->vtx + nVertex * 3;
+    geom->uv  = geom->nrm + nVertex * 3;
+    geom->tng = geom->uv  + nVertex * 2;
+    geom->clr = geom->tng + nVertex * 3;
+    geom->idx = geom->clr + nVertex * 3;
+    return 0;
+}
+
+
+/*
+ *  run func(j0, j1) over the rows [0, num_rows) split across the threads.
+ *  the calling thread takes the first range.
+ */
+template <typename F> static void
+parallel_rows (int num_rows, int num_vtx, F func)
+{
+    int num_threads = (int)std::thread::hardware_concurrency ();
 
-    for (int i = 0; i < nDivU - 1; i ++)
+    if (num_threads > SHAPE_THREAD_MAX) num_threads = SHAPE_THREAD_MAX;
+    if (num_threads > num_rows)         num_threads = num_rows;
+
+    if (num_vtx < SHAPE_PARALLEL_MIN_VTX || num_threads < 2)
     {
-        for (int j = 0; j < nDivV - 1; j ++)
-        {
-            int idx = (j * (nDivU - 1) + i) * 6;
-
-            pIndex[idx + 0] = ( j ) * nDivU + ( i );
-            pIndex[idx + 1] = ( j ) * nDivU + (i+1);
-            pIndex[idx + 2] = (j+1) * nDivU + (i+1);
-            pIndex[idx + 3] = ( j ) * nDivU + ( i );
-            pIndex[idx + 4] = (j+1) * nDivU + (i+1);
-            pIndex[idx + 5] = (j+1) * nDivU + ( i );
-        }
+        func (0, num_rows);
+        return;
     }
 
-    glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, pshape->vbo_idx);
-    glBufferData (GL_ELEMENT_ARRAY_BUFFER, bufSize, pIndex, GL_STATIC_DRAW);
-    glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+    std::vector<std::thread> threads;
+    for (int t = 1; t < num_threads; t ++)
+        threads.emplace_back (func, num_rows * t / num_threads, num_rows * (t + 1) / num_threads);
 
-    return 0;
+    func (0, num_rows / num_threads);
+
+    for (std::thread &th : threads)
+        th.join ();
 }
 
-static void
-generate_shape (PFUNCTION function, shape_param_t *sparam, shape_obj_t *shape)
-{
-    int   i, j;
-    float *pVertex, *pColor, *pUV, *pNormal, *pTangent;
-    int   nSampleU = sparam->nDivU;
-    int   nSampleV = sparam->nDivV;
-    int   nVertex = nSampleU * nSampleV;
-    float fMinU = sparam->min_u;
-    float fMinV = sparam->min_v;
-    float fMaxU = sparam->max_u;
-    float fMaxV = sparam->max_v;
-
-    gen_shape_buffers (nSampleU, nSampleV, shape);
-
-    pVertex = (float *)malloc (sizeof(float) * nVertex * 3);
-    pColor  = (float *)malloc (sizeof(float) * nVertex * 3);
-    pNormal = (float *)malloc (sizeof(float) * nVertex * 3);
-    pUV     = (float *)malloc (sizeof(float) * nVertex * 2);
-    pTangent= (float *)malloc (sizeof(float) * nVertex * 3);
-
-    for (i = 0; i < nSampleU; i ++)
+
+static inline const float *
+grid_pos (const shape_geom_t *geom, int i, int j)
+{
+    return &geom->vtx[(j * geom->nDivU + i) * 3];
+}
+
+static inline bool
+same_pos (const float *p0, const float *p1)
+{
+    float d[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+    float s = 1.0f + p0[0] * p0[0] + p0[1] * p0[1] + p0[2] * p0[2];
+    return (d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) < 1e-10f * s;
+}
+
+static inline float
+diff_len2 (const float *p0, const float *p1, float *d)
+{
+    d[0] = p1[0] - p0[0];
+    d[1] = p1[1] - p0[1];
+    d[2] = p1[2] - p0[2];
+    return d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+}
+
+/*
+ *  the central difference along U at (i, j). the seam of a closed surface
+ *  is wrapped: its first and last columns are at the same position.
+ */
+static float
+diff_u (const shape_geom_t *geom, int i, int j, float *du)
+{
+    int nU = geom->nDivU;
+    int iL = i - 1, iR = i + 1;
+
+    if (i == 0 || i == nU - 1)
     {
-        for (j = 0; j < nSampleV; j ++)
-        {
-            float u = fMinU + i * (fMaxU-fMinU) / (float)(nSampleU-1);
-            float v = fMinV + j * (fMaxV-fMinV) / (float)(nSampleV-1);
-            float x,y,z;
+        bool wrap = same_pos (grid_pos (geom, 0, j), grid_pos (geom, nU - 1, j));
+        if (i == 0)      iL = wrap ? nU - 2 : 0;
+        if (i == nU - 1) iR = wrap ? 1      : nU - 1;
+    }
+    return diff_len2 (grid_pos (geom, iL, j), grid_pos (geom, iR, j), du);
+}
 
-            function (u, v, &x, &y, &z);
+static float
+diff_v (const shape_geom_t *geom, int i, int j, float *dv)
+{
+    int nV = geom->nDivV;
+    int jL = j - 1, jR = j + 1;
 
-            pVertex[(j*nSampleU+i)*3 + 0] = x;
-            pVertex[(j*nSampleU+i)*3 + 1] = y;
-            pVertex[(j*nSampleU+i)*3 + 2] = z;
-        }
+    if (j == 0 || j == nV - 1)
+    {
+        bool wrap = same_pos (grid_pos (geom, i, 0), grid_pos (geom, i, nV - 1));
+        if (j == 0)      jL = wrap ? nV - 2 : 0;
+        if (j == nV - 1) jR = wrap ? 1      : nV - 1;
     }
+    return diff_len2 (grid_pos (geom, i, jL), grid_pos (geom, i, jR), dv);
+}
+
+
+/* positions, UVs, colors, and the indices of the quads below the rows */
+static void
+eval_rows (PFUNCTION function, const shape_param_t *sparam, shape_geom_t *geom, int j0, int j1)
+{
+    int nU = geom->nDivU;
+    int nV = geom->nDivV;
 
-    for (i = 0; i < nSampleU; i ++)
+    for (int j = j0; j < j1; j ++)
     {
-        for (j = 0; j < nSampleV; j ++)
+        float v = sparam->min_v + j * (sparam->max_v - sparam->min_v) / (float)(nV - 1);
+
+        for (int i = 0; i < nU; i ++)
         {
-            pUV[(j*nSampleU+i)*2 + 0] = (float)i / (float)(nSampleU-1);
-            pUV[(j*nSampleU+i)*2 + 1] = (float)j / (float)(nSampleV-1);
+            float u = sparam->min_u + i * (sparam->max_u - sparam->min_u) / (float)(nU - 1);
+            int   n = j * nU + i;
+
+            function (u, v, &geom->vtx[n * 3 + 0], &geom->vtx[n * 3 + 1], &geom->vtx[n * 3 + 2]);
+
+            geom->uv [n * 2 + 0] = (float)i / (float)(nU - 1);
+            geom->uv [n * 2 + 1] = (float)j / (float)(nV - 1);
+
+            geom->clr[n * 3 + 0] =        (float)i / (float)(nU - 1);
+            geom->clr[n * 3 + 1] = 1.0f - (float)i / (float)(nU - 1);
+            geom->clr[n * 3 + 2] =        (float)j / (float)(nV - 1);
         }
-    }
 
-    for (i = 0; i < nSampleU; i ++)
-    {
-        for (j = 0; j < nSampleV; j ++)
+        if (j == nV - 1)
+            continue;
+
+        for (int i = 0; i < nU - 1; i ++)
         {
-            pColor[(j*nSampleU+i)*3 + 0] =        (float)i / (float)(nSampleU-1);
-            pColor[(j*nSampleU+i)*3 + 1] = 1.0f - (float)i / (float)(nSampleU-1);
-            pColor[(j*nSampleU+i)*3 + 2] =        (float)j / (float)(nSampleV-1);
+            unsigned int q[6];
+            int idx = (j * (nU - 1) + i) * 6;
+
+            q[0] = ( j ) * nU + ( i );
+            q[1] = ( j ) * nU + (i+1);
+            q[2] = (j+1) * nU + (i+1);
+            q[3] = ( j ) * nU + ( i );
+            q[4] = (j+1) * nU + (i+1);
+            q[5] = (j+1) * nU + ( i );
+
+            for (int k = 0; k < 6; k ++)
+            {
+                if (geom->idx_size == 4)
+                    ((unsigned int   *)geom->idx)[idx + k] = q[k];
+                else
+                    ((unsigned short *)geom->idx)[idx + k] = (unsigned short)q[k];
+            }
         }
     }
+}
 
-    for ( i = 0; i < nSampleU-1; i ++ )
+
+/*
+ *  smooth normals and tangents from the central differences of the grid.
+ *  at a pole, where the U difference vanishes, the next row towards the
+ *  middle gives the U direction.
+ */
+static void
+normal_rows (shape_geom_t *geom, int j0, int j1)
+{
+    int nU = geom->nDivU;
+    int nV = geom->nDivV;
+
+    for (int j = j0; j < j1; j ++)
     {
-        for ( j = 0; j < nSampleV-1; j ++ )
+        for (int i = 0; i < nU; i ++)
         {
-            float ptA[3], ptB[3], ptC[3], AB[3], AC[3], normal[3];
-
-            ptA[0] = pVertex[(  j  *nSampleU+i  )*3+0];
-            ptA[1] = pVertex[(  j  *nSampleU+i  )*3+1];
-            ptA[2] = pVertex[(  j  *nSampleU+i  )*3+2];
-            ptB[0] = pVertex[(  j  *nSampleU+i+1)*3+0];
-            ptB[1] = pVertex[(  j  *nSampleU+i+1)*3+1];
-            ptB[2] = pVertex[(  j  *nSampleU+i+1)*3+2];
-            ptC[0] = pVertex[((j+1)*nSampleU+i  )*3+0];
-            ptC[1] = pVertex[((j+1)*nSampleU+i  )*3+1];
-            ptC[2] = pVertex[((j+1)*nSampleU+i  )*3+2];
-
-            AB [0] = ptB[0] - ptA[0];
-            AB [1] = ptB[1] - ptA[1];
-            AB [2] = ptB[2] - ptA[2];
-            AC [0] = ptC[0] - ptA[0];
-            AC [1] = ptC[1] - ptA[1];
-            AC [2] = ptC[2] - ptA[2];
-
-            cross (AB, AC, normal);
-            normalize (normal);
-
-            pNormal[(j*nSampleU+i)*3 + 0] = -normal[0];
-            pNormal[(j*nSampleU+i)*3 + 1] = -normal[1];
-            pNormal[(j*nSampleU+i)*3 + 2] = -normal[2];
-
-            normalize (AB);
-            pTangent[(j*nSampleU+i)*3 + 0] = -AB[0];
-            pTangent[(j*nSampleU+i)*3 + 1] = -AB[1];
-            pTangent[(j*nSampleU+i)*3 + 2] = -AB[2];
+            float du[3], dv[3], nrm[3];
+            float *pN = &geom->nrm[(j * nU + i) * 3];
+            float *pT = &geom->tng[(j * nU + i) * 3];
+            const float *p = grid_pos (geom, i, j);
+            float eps = 1e-10f * (1.0f + p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+            int   jj  = j;
+
+            /* the positions of a pole differ in the rounding errors only */
+            while (diff_u (geom, i, jj, du) < eps)
+            {
+                jj += (j < nV / 2) ? 1 : -1;
+                if (jj < 0 || jj >= nV)
+                    break;
+            }
+            diff_v (geom, i, j, dv);
+
+            cross (du, dv, nrm);
+            if (length (nrm) > 0.0f)
+                normalize (nrm);
+            else
+                nrm[0] = nrm[1] = 0.0f, nrm[2] = -1.0f;
+
+            pN[0] = -nrm[0];
+            pN[1] = -nrm[1];
+            pN[2] = -nrm[2];
+
+            if (length (du) > 0.0f)
+                normalize (du);
+            pT[0] = -du[0];
+            pT[1] = -du[1];
+            pT[2] = -du[2];
         }
     }
+}
 
-    for (i = 0; i < nSampleU - 1; i ++)
-    {
-        pNormal[((nSampleV-1)*nSampleU+i)*3+0] = pNormal[(i)*3+0];
-        pNormal[((nSampleV-1)*nSampleU+i)*3+1] = pNormal[(i)*3+1];
-        pNormal[((nSampleV-1)*nSampleU+i)*3+2] = pNormal[(i)*3+2];
 
-        pTangent[((nSampleV-1)*nSampleU+i)*3+0] = pTangent[(i)*3+0];
-        pTangent[((nSampleV-1)*nSampleU+i)*3+1] = pTangent[(i)*3+1];
-        pTangent[((nSampleV-1)*nSampleU+i)*3+2] = pTangent[(i)*3+2];
-    }
+static int
+generate_shape (PFUNCTION function, const shape_param_t *sparam, shape_geom_t *geom)
+{
+    int nV = sparam->nDivV;
 
-    for (j = 0; j < nSampleV - 1; j ++)
-    {
-        pNormal[(j*nSampleU+nSampleU-1)*3+0] = pNormal[(j*nSampleU)*3+0];
-        pNormal[(j*nSampleU+nSampleU-1)*3+1] = pNormal[(j*nSampleU)*3+1];
-        pNormal[(j*nSampleU+nSampleU-1)*3+2] = pNormal[(j*nSampleU)*3+2];
+    parallel_rows (nV, geom->num_vtx, [&] (int j0, int j1) {
+        eval_rows (function, sparam, geom, j0, j1);
+    });
 
-        pTangent[(j*nSampleU+nSampleU-1)*3+0] = pTangent[(j*nSampleU)*3+0];
-        pTangent[(j*nSampleU+nSampleU-1)*3+1] = pTangent[(j*nSampleU)*3+1];
-        pTangent[(j*nSampleU+nSampleU-1)*3+2] = pTangent[(j*nSampleU)*3+2];
-    }
+    /* the normals read the positions of the neighbor rows */
+    parallel_rows (nV, geom->num_vtx, [&] (int j0, int j1) {
+        normal_rows (geom, j0, j1);
+    });
 
-    pNormal[((nSampleV-1)*nSampleU + (nSampleU-1))*3+0] = pNormal[((nSampleV-2)*nSampleU + (nSampleU-2))*3+0];
-    pNormal[((nSampleV-1)*nSampleU + (nSampleU-1))*3+1] = pNormal[((nSampleV-2)*nSampleU + (nSampleU-2))*3+1];
-    pNormal[((nSampleV-1)*nSampleU + (nSampleU-1))*3+2] = pNormal[((nSampleV-2)*nSampleU + (nSampleU-2))*3+2];
+    return 0;
+}
 
-    pTangent[((nSampleV-1)*nSampleU + (nSampleU-1))*3+0]= pTangent[((nSampleV-2)*nSampleU + (nSampleU-2))*3+0];
-    pTangent[((nSampleV-1)*nSampleU + (nSampleU-1))*3+1]= pTangent[((nSampleV-2)*nSampleU + (nSampleU-2))*3+1];
-    pTangent[((nSampleV-1)*nSampleU + (nSampleU-1))*3+2]= pTangent[((nSampleV-2)*nSampleU + (nSampleU-2))*3+2];
 
-    glBindBuffer (GL_ARRAY_BUFFER, shape->vbo_vtx );
-    glBufferData (GL_ARRAY_BUFFER, nVertex * 3 * sizeof(float), pVertex, GL_STATIC_DRAW);
+/* -------------------------------------------------------------------------- *
+ *  file cache: <dir>/shape_<type>_<nDivU>x<nDivV>.bin
+ * -------------------------------------------------------------------------- */
+static void
+get_cache_path (const shape_geom_t *geom, char *path, size_t len)
+{
+    snprintf (path, len, "%s/shape_%d_%dx%d.bin", s_cache_dir, geom->type, geom->nDivU, geom->nDivV);
+}
 
-    glBindBuffer (GL_ARRAY_BUFFER, shape->vbo_col );
-    glBufferData (GL_ARRAY_BUFFER, nVertex * 3 * sizeof(float), pColor,  GL_STATIC_DRAW);
+static int
+load_shape_geom (shape_geom_t *geom)
+{
+    char path[320];
+    shape_file_hdr_t hdr;
+    int ret = -1;
 
-    glBindBuffer (GL_ARRAY_BUFFER, shape->vbo_uv );
-    glBufferData (GL_ARRAY_BUFFER, nVertex * 2 * sizeof(float), pUV,     GL_STATIC_DRAW);
+    get_cache_path (geom, path, sizeof (path));
+    FILE *fp = fopen (path, "rb");
+    if (fp == NULL)
+        return -1;
 
-    glBindBuffer (GL_ARRAY_BUFFER, shape->vbo_nrm );
-    glBufferData (GL_ARRAY_BUFFER, nVertex * 3 * sizeof(float), pNormal, GL_STATIC_DRAW);
+    if (fread (&hdr, sizeof (hdr), 1, fp) == 1 &&
+        hdr.magic    == SHAPE_FILE_MAGIC   && hdr.version == SHAPE_FILE_VERSION &&
+        hdr.type     == geom->type         && hdr.nDivU   == geom->nDivU && hdr.nDivV == geom->nDivV &&
+        hdr.num_vtx  == geom->num_vtx      && hdr.num_idx == geom->num_idx &&
+        hdr.idx_size == geom->idx_size &&
+        fread (geom->vtx, 1, geom->size, fp) == geom->size)
+    {
+        ret = 0;
+    }
 
-    glBindBuffer (GL_ARRAY_BUFFER, shape->vbo_tng );
-    glBufferData (GL_ARRAY_BUFFER, nVertex * 3 * sizeof(float), pTangent, GL_STATIC_DRAW);
+    fclose (fp);
+    return ret;
+}
 
-    glBindBuffer (GL_ARRAY_BUFFER, 0 );
+/* written to a temporary file first: a killed app leaves no broken cache */
+static int
+save_shape_geom (const shape_geom_t *geom)
+{
+    char path[320], path_tmp[330];
+    shape_file_hdr_t hdr;
+
+    hdr.magic    = SHAPE_FILE_MAGIC;
+    hdr.version  = SHAPE_FILE_VERSION;
+    hdr.type     = geom->type;
+    hdr.nDivU    = geom->nDivU;
+    hdr.nDivV    = geom->nDivV;
+    hdr.num_vtx  = geom->num_vtx;
+    hdr.num_idx  = geom->num_idx;
+    hdr.idx_size = geom->idx_size;
+
+    get_cache_path (geom, path, sizeof (path));
+    snprintf (path_tmp, sizeof (path_tmp), "%s.tmp", path);
+
+    FILE *fp = fopen (path_tmp, "wb");
+    if (fp == NULL)
+    {
+        LOGW ("%s: can't open %s\n", __FUNCTION__, path_tmp);
+        return -1;
+    }
 
-    shape->num_faces = get_num_faces(nSampleU, nSampleV);
+    bool ok = fwrite (&hdr, sizeof (hdr), 1, fp) == 1 &&
+              fwrite (geom->vtx, 1, geom->size, fp) == geom->size;
+    ok = (fclose (fp) == 0) && ok;
 
-    free (pVertex);
-    free (pColor );
-    free (pNormal);
-    free (pUV    );
+    if (!ok || rename (path_tmp, path) != 0)
+    {
+        LOGW ("%s: can't write %s\n", __FUNCTION__, path);
+        remove (path_tmp);
+        return -1;
+    }
+    return 0;
 }
 
 static void func_Plan(float u,float v, float* x,float* y,float* z)
@@ -349,11 +518,8 @@ static void func_Cone(float u,float v, float* x,float* y,float* z)
     *z = -v * 2;
 }
 
-/* -------------------------------------------------------------------------- *
- *  generate parametric shapes.
- * -------------------------------------------------------------------------- */
-int
-shape_create (int type, int nDivU, int nDivV, shape_obj_t *pshape)
+static void
+get_shape_param (int type, int nDivU, int nDivV, PFUNCTION *pfunc, shape_param_t *psparam)
 {
     PFUNCTION func;
     shape_param_t sparam = {};
@@ -410,7 +576,148 @@ shape_create (int type, int nDivU, int nDivV, shape_obj_t *pshape)
         func = func_Plan;
     }
 
-    generate_shape (func, &sparam, pshape);
+    *pfunc    = func;
+    *psparam  = sparam;
+}
+
 
-    return 0;
+/*
+ *  the grid of (type, nDivU, nDivV): from the memory cache, the file cache,
+ *  or generated. the least recently used one is evicted from a full cache.
+ */
+static shape_geom_t *
+get_shape_geom (int type, int nDivU, int nDivV)
+{
+    shape_geom_t *geom = NULL;
+    const char *from = "generated";
+
+    for (int i = 0; i < s_cache_num; i ++)
+    {
+        shape_geom_t *g = &s_cache[i];
+        if (g->type == type && g->nDivU == nDivU && g->nDivV == nDivV)
+        {
+            g->last_use = ++ s_cache_clock;
+            return g;
+        }
+    }
+
+    if (s_cache_num < SHAPE_CACHE_MAX)
+    {
+        geom = &s_cache[s_cache_num ++];
+    }
+    else
+    {
+        geom = &s_cache[0];
+        for (int i = 1; i < SHAPE_CACHE_MAX; i ++)
+        {
+            if (s_cache[i].last_use < geom->last_use)
+                geom = &s_cache[i];
+        }
+        free (geom->vtx);
+    }
+
+    auto t0 = std::chrono::steady_clock::now ();
+
+    if (alloc_shape_geom (geom, type, nDivU, nDivV) < 0)
+    {
+        LOGE ("%s: can't allocate %dx%d\n", __FUNCTION__, nDivU, nDivV);
+        *geom = s_cache[-- s_cache_num];    /* drop the slot */
+        return NULL;
+    }
+
+    bool use_file = s_cache_dir[0] && geom->num_vtx >= SHAPE_FILE_MIN_VTX;
+
+    if (use_file && load_shape_geom (geom) == 0)
+    {
+        from = "loaded";
+    }
+    else
+    {
+        PFUNCTION func;
+        shape_param_t sparam;
+
+        get_shape_param (type, nDivU, nDivV, &func, &sparam);
+        generate_shape (func, &sparam, geom);
+
+        if (use_file)
+            save_shape_geom (geom);
+    }
+
+    auto t1 = std::chrono::steady_clock::now ();
+    LOGI ("shape(%d, %dx%d): %s in %.2f ms\n", type, nDivU, nDivV, from,
+          std::chrono::duration<double, std::milli> (t1 - t0).count ());
+
+    geom->last_use = ++ s_cache_clock;
+    return geom;
+}
+
+
+/* -------------------------------------------------------------------------- *
+ *  generate parametric shapes.
+ *    (attr_mask): (1 << MESH_ATTR_xxx) to store, (format): MESH_FMT_xxx.
+ *    32bit indices are used over 65536 vertices.
+ * -------------------------------------------------------------------------- */
+int
+shape_create_ex (int type, int nDivU, int nDivV, unsigned int attr_mask,
+                 unsigned int format, shape_obj_t *pshape)
+{
+    if (nDivU < 2 || nDivV < 2)
+    {
+        LOGE ("%s: invalid division (%d, %d)\n", __FUNCTION__, nDivU, nDivV);
+        return -1;
+    }
+
+    shape_geom_t *geom = get_shape_geom (type, nDivU, nDivV);
+    if (geom == NULL)
+        return -1;
+
+    /* one interleaved buffer of the attributes asked for */
+    mesh_src_t src = {};
+    src.num_vtx  = geom->num_vtx;
+    src.vtx      = geom->vtx;
+    src.nrm      = (attr_mask & (1 << MESH_ATTR_NRM)) ? geom->nrm : NULL;
+    src.uv       = (attr_mask & (1 << MESH_ATTR_UV )) ? geom->uv  : NULL;
+    src.tng      = (attr_mask & (1 << MESH_ATTR_TNG)) ? geom->tng : NULL;
+    src.clr      = (attr_mask & (1 << MESH_ATTR_CLR)) ? geom->clr : NULL;
+    src.num_idx  = geom->num_idx;
+    src.idx      = geom->idx;
+    src.idx_type = (geom->idx_size == 4) ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+    src.prim     = GL_TRIANGLES;
+
+    pshape->num_faces = get_num_faces (nDivU, nDivV);
+    return mesh_create (&pshape->mesh, &src, format);
+}
+
+/* all the attributes in float */
+int
+shape_create (int type, int nDivU, int nDivV, shape_obj_t *pshape)
+{
+    unsigned int attr_mask = (1 << MESH_ATTR_VTX) | (1 << MESH_ATTR_NRM) |
+                             (1 << MESH_ATTR_UV ) | (1 << MESH_ATTR_TNG) |
+                             (1 << MESH_ATTR_CLR);
+
+    return shape_create_ex (type, nDivU, nDivV, attr_mask, MESH_FMT_FLOAT, pshape);
+}
+
+void
+shape_destroy (shape_obj_t *pshape)
+{
+    mesh_destroy (&pshape->mesh);
+}
+
+
+/* (dir): where the generated shapes are stored. NULL: memory cache only */
+void
+shape_set_cache_dir (const char *dir)
+{
+    snprintf (s_cache_dir, sizeof (s_cache_dir), "%s", dir ? dir : "");
+}
+
+void
+shape_clear_cache ()
+{
+    for (int i = 0; i < s_cache_num; i ++)
+        free (s_cache[i].vtx);
+
+    s_cache_num = 0;
 }
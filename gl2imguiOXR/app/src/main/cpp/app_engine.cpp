@@ -1,5 +1,6 @@
 #include "util_egl.h"
 #include "util_oxr.h"
+#include "util_gpu_profiler.h"
 #include "app_engine.h"
 #include "render_scene.h"
 
@@ -42,13 +43,26 @@ AppEngine::InitOpenXR_GLES ()
     oxr_confirm_gfx_requirements (m_instance, m_systemId);
 
     init_gles_scene ();
+    init_gpu_profiler ();
 
     m_session    = oxr_create_session (m_instance, m_systemId);
     m_appSpace   = oxr_create_ref_space (m_session, XR_REFERENCE_SPACE_TYPE_LOCAL);
     m_stageSpace = oxr_create_ref_space (m_session, XR_REFERENCE_SPACE_TYPE_STAGE);
     m_viewSpace  = oxr_create_ref_space (m_session, XR_REFERENCE_SPACE_TYPE_VIEW);
 
-    m_viewSurface = oxr_create_viewsurface (m_instance, m_systemId, m_session);
+    /* spaces located at every frame, in the order of LocatedSpace */
+    m_spaces.init (m_instance, m_session, m_appSpace);
+    m_spaces.add (m_stageSpace);
+    m_spaces.add (m_viewSpace);
+
+    /*
+     *  the imgui planes make it fill-rate bound. MEDIUM at most, to keep
+     *  the text at the periphery readable.
+     */
+    oxr_swapchain_config_t sc_config = OXR_SWAPCHAIN_CONFIG_DEFAULT;
+    sc_config.foveation_level   = FOVEATION_LEVEL_MEDIUM;
+    sc_config.foveation_dynamic = true;
+    m_viewSurface = oxr_create_viewsurface (m_instance, m_systemId, m_session, &sc_config);
 
     m_runtime_name = oxr_get_runtime_name (m_instance);
     m_system_name  = oxr_get_system_name (m_instance, m_systemId);
@@ -82,7 +96,14 @@ AppEngine::RenderFrame()
     std::vector<XrCompositionLayerBaseHeader*> all_layers;
 
     XrTime dpy_time, elapsed_us;
-    oxr_begin_frame (m_session, &dpy_time);
+    int should_render = oxr_begin_frame (m_session, &dpy_time);
+
+    /* The runtime will not show this frame: skip swapchain acquire and rendering */
+    if (!should_render)
+    {
+        oxr_end_frame (m_session, dpy_time, all_layers);
+        return;
+    }
 
     static XrTime init_time = -1;
     if (init_time < 0)
@@ -91,9 +112,11 @@ AppEngine::RenderFrame()
 
     std::vector<XrCompositionLayerProjectionView> projLayerViews;
     XrCompositionLayerProjection                  projLayer;
+    gpu_profiler_begin_frame ();
     RenderLayer (dpy_time, elapsed_us, projLayerViews, projLayer);
 
     all_layers.push_back(reinterpret_cast<XrCompositionLayerBaseHeader*>(&projLayer));
+    gpu_profiler_end_frame ();
 
     /* Compose all layers */
     oxr_end_frame (m_session, dpy_time, all_layers);
@@ -113,11 +136,11 @@ AppEngine::RenderLayer(XrTime dpy_time,
 
     layerViews.resize (viewCount);
 
-    /* Acquire Stage Location, View Location (rerative to the View Location) */
-    XrSpaceLocation stageLoc {XR_TYPE_SPACE_LOCATION};
-    XrSpaceLocation viewLoc  {XR_TYPE_SPACE_LOCATION};
-    xrLocateSpace (m_stageSpace, m_appSpace, dpy_time, &stageLoc);
-    xrLocateSpace (m_viewSpace,  m_appSpace, dpy_time, &viewLoc);
+    /* Acquire all the registered Space Locations (rerative to the App Space) at once */
+    m_spaces.locate (dpy_time);
+
+    XrSpaceLocation stageLoc = m_spaces.get (LOC_STAGE);
+    XrSpaceLocation viewLoc  = m_spaces.get (LOC_VIEW);
 
 
     /* Render each view */
@@ -137,8 +160,11 @@ AppEngine::RenderLayer(XrTime dpy_time,
         sceneData.system_name   = m_system_name;
         sceneData.elapsed_us    = elapsed_us;
         sceneData.viewID        = i;
+        sceneData.cpu_budget_exceeded = oxr_is_cpu_budget_exceeded ();
         sceneData.views         = views;
+        gpu_profiler_begin_pass (i == 0 ? "eye0" : "eye1");
         render_gles_scene (layerViews[i], rtarget, viewLoc.pose, stageLoc.pose, sceneData);
+        gpu_profiler_end_pass ();
 
         oxr_release_viewsurface (m_viewSurface[i]);
     }
@@ -5,6 +5,13 @@
 #include "util_oxr.h"
 
 
+/* spaces of AppEngine::m_spaces, in the order of registration */
+enum LocatedSpace {
+    LOC_STAGE = 0,
+    LOC_VIEW,
+    LOC_NUM
+};
+
 class AppEngine {
 public:
     explicit AppEngine(android_app* app);
@@ -26,6 +33,7 @@ private:
     XrSpace             m_appSpace;
     XrSpace             m_stageSpace;
     XrSpace             m_viewSpace;
+    SpaceLocator        m_spaces;       /* located relative to m_appSpace once a frame */
 
     XrSystemId          m_systemId;
     std::vector<viewsurface_t> m_viewSurface;
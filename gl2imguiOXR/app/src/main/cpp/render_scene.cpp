@@ -6,48 +6,26 @@
 #include "util_matrix.h"
 #include "util_debugstr.h"
 #include "util_render_target.h"
+#include "util_render_line.h"
+#include "util_gpu_profiler.h"
 #include "teapot.h"
 #include "render_scene.h"
 #include "render_texplate.h"
 #include "render_imgui.h"
 #include "assertgl.h"
+#include "util_gl_state.h"
 
 
-static shader_obj_t     s_sobj;
 static render_target_t  s_rtarget;
 
 #define UI_WIN_W 300
 #define UI_WIN_H 350
 
 
-static char s_strVS[] = "                                   \n\
-                                                            \n\
-attribute vec4  a_Vertex;                                   \n\
-attribute vec4  a_Color;                                    \n\
-varying   vec4  v_color;                                    \n\
-uniform   mat4  u_PMVMatrix;                                \n\
-                                                            \n\
-void main(void)                                             \n\
-{                                                           \n\
-    gl_Position = u_PMVMatrix * a_Vertex;                   \n\
-    v_color     = a_Color;                                  \n\
-}                                                           ";
-
-static char s_strFS[] = "                                   \n\
-precision mediump float;                                    \n\
-varying   vec4  v_color;                                    \n\
-                                                            \n\
-void main(void)                                             \n\
-{                                                           \n\
-    gl_FragColor = v_color;                                 \n\
-}                                                           ";
-
-
-
 int
 init_gles_scene ()
 {
-    generate_shader (&s_sobj, s_strVS, s_strFS);
+    init_line_renderer ();
     init_teapot ();
     init_texplate ();
     init_dbgstr (0, 0);
@@ -59,33 +37,6 @@ init_gles_scene ()
 }
 
 
-int
-draw_line (float *mtxPV, float *p0, float *p1, float *color)
-{
-    GLfloat floor_vtx[6];
-    for (int i = 0; i < 3; i ++)
-    {
-        floor_vtx[0 + i] = p0[i];
-        floor_vtx[3 + i] = p1[i];
-    }
-
-    shader_obj_t *sobj = &s_sobj;
-    glUseProgram (sobj->program);
-
-    glEnableVertexAttribArray (sobj->loc_vtx);
-    glVertexAttribPointer (sobj->loc_vtx, 3, GL_FLOAT, GL_FALSE, 0, floor_vtx);
-
-    glDisableVertexAttribArray (sobj->loc_clr);
-    glVertexAttrib4fv (sobj->loc_clr, color);
-
-    glUniformMatrix4fv (sobj->loc_mtx,  1, GL_FALSE, mtxPV);
-
-    glEnable (GL_DEPTH_TEST);
-    glDrawArrays (GL_LINES, 0, 2);
-
-    return 0;
-}
-
 int
 draw_stage (float *matStage)
 {
@@ -101,17 +52,17 @@ draw_stage (float *matStage)
         float *col = (x == 0) ? col_b : col_gray;
         float p0[3]  = {1.0f * x, 0.0f, -10.0f};
         float p1[3]  = {1.0f * x, 0.0f,  10.0f};
-        draw_line (matStage, p0, p1, col);
+        line_batch_add (matStage, p0, p1, col);
     }
     for (int z = -10; z <= 10; z ++)
     {
         float *col = (z == 0) ? col_r : col_gray;
         float p0[3]  = {-10.0f, 0.0f, 1.0f * z};
         float p1[3]  = { 10.0f, 0.0f, 1.0f * z};
-        draw_line (matStage, p0, p1, col);
+        line_batch_add (matStage, p0, p1, col);
     }
 
-    draw_line (matStage, p0, py, col_g);
+    line_batch_add (matStage, p0, py, col_g);
     GLASSERT();
 
     return 0;
@@ -123,34 +74,40 @@ draw_uiplane (float *matPVMbase,
               XrCompositionLayerProjectionView &layerView,
               scene_data_t &sceneData)
 {
-    /* save current FBO */
-    render_target_t rtarget0;
-    get_render_target (&rtarget0);
+    /* CPU budget exceeded: skip the UI refresh, and show the UI texture of the previous frame */
+    if (!sceneData.cpu_budget_exceeded)
+    {
+        /* save current FBO */
+        render_target_t rtarget0;
+        get_render_target (&rtarget0);
 
-    /* render to UIPlane-FBO */
-    set_render_target (&s_rtarget);
-    glClearColor (0.0f, 0.0f, 0.0f, 0.0f);
-    glClear (GL_COLOR_BUFFER_BIT);
+        /* render to UIPlane-FBO */
+        gpu_profiler_begin_pass ("imgui");
+        set_render_target (&s_rtarget);
+        glClearColor (0.0f, 0.0f, 0.0f, 0.0f);
+        glClear (GL_COLOR_BUFFER_BIT);
 
-    {
-        static uint32_t prev_us = 0;
-        if (sceneData.viewID == 0)
         {
-            sceneData.interval_ms = (sceneData.elapsed_us - prev_us) / 1000.0f;
-            prev_us = sceneData.elapsed_us;
+            static uint32_t prev_us = 0;
+            if (sceneData.viewID == 0)
+            {
+                sceneData.interval_ms = (sceneData.elapsed_us - prev_us) / 1000.0f;
+                prev_us = sceneData.elapsed_us;
+            }
+
+            sceneData.gl_version = glGetString (GL_VERSION);
+            sceneData.gl_vendor  = glGetString (GL_VENDOR);
+            sceneData.gl_render  = glGetString (GL_RENDERER);
+            sceneData.viewport   = layerView.subImage.imageRect;
+            invoke_imgui (&sceneData);
         }
+        gpu_profiler_end_pass ();
 
-        sceneData.gl_version = glGetString (GL_VERSION);
-        sceneData.gl_vendor  = glGetString (GL_VENDOR);
-        sceneData.gl_render  = glGetString (GL_RENDERER);
-        sceneData.viewport   = layerView.subImage.imageRect;
-        invoke_imgui (&sceneData);
+        /* restore FBO */
+        set_render_target (&rtarget0);
     }
 
-    /* restore FBO */
-    set_render_target (&rtarget0);
-
-    glEnable (GL_DEPTH_TEST);
+    glstate_enable (GL_DEPTH_TEST);
 
     {
         float matPVM[16], matT[16];
@@ -189,14 +146,13 @@ render_gles_scene (XrCompositionLayerProjectionView &layerView,
 
     glClearColor (0.1f, 0.1f, 0.1f, 1.0f);
     glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glEnable (GL_DEPTH_TEST);
+    glstate_enable (GL_DEPTH_TEST);
 
     /* ------------------------------------------- *
      *  Matrix Setup
      *    (matPV)  = (proj) x (view)
-     *    (matPVM) = (proj) x (view) x (model)
      * ------------------------------------------- */
-    XrMatrix4x4f matP, matV, matC, matM, matPV, matPVM;
+    XrMatrix4x4f matP, matV, matC, matM, matPV;
 
     /* Projection Matrix */
     XrMatrix4x4f_CreateProjectionFov (&matP, GRAPHICS_OPENGL_ES, layerView.fov, 0.05f, 100.0f);
@@ -211,23 +167,26 @@ render_gles_scene (XrCompositionLayerProjectionView &layerView,
     XrMatrix4x4f_CreateTranslationRotationScale (&matM, &stagePose.position, &stagePose.orientation, &scale);
 
     XrMatrix4x4f_Multiply (&matPV, &matP, &matV);
-    XrMatrix4x4f_Multiply (&matPVM, &matPV, &matM);
 
 
     /* ------------------------------------------- *
      *  Render
      * ------------------------------------------- */
-    float *matStage = reinterpret_cast<float*>(&matPVM);
-
-    draw_stage (matStage);
+    gpu_profiler_begin_pass ("stage");
+    draw_stage ((float *)&matM);
+    line_batch_flush ((float *)&matPV);
+    gpu_profiler_end_pass ();
 
 
     /* teapot */
+    gpu_profiler_begin_pass ("teapot");
     float col[] = {1.0f, 0.0f, 0.0f};
     draw_teapot (sceneData.elapsed_us / 1000, col, (float *)&matP, (float *)&matV);
+    gpu_profiler_end_pass ();
 
 
     /* UI plane always view front */
+    gpu_profiler_begin_pass ("uiplane");
     {
         XrVector3f    scale = {1.0f, 1.0f, 1.0f};
         XrVector3f    &pos  = viewPose.position;
@@ -239,7 +198,9 @@ render_gles_scene (XrCompositionLayerProjectionView &layerView,
 
         draw_uiplane ((float *)&matPVM, layerView, sceneData);
     }
+    gpu_profiler_end_pass ();
 
+    gpu_profiler_begin_pass ("debug text");
     {
         XrVector3f    &pos = layerView.pose.position;
         XrQuaternionf &rot = layerView.pose.orientation;
@@ -259,7 +220,10 @@ render_gles_scene (XrCompositionLayerProjectionView &layerView,
         sprintf (strbuf, "VIEWFOV(%6.4f, %6.4f, %6.4f, %6.4f)",
             fov.angleLeft, fov.angleRight, fov.angleUp, fov.angleDown);
         draw_dbgstr(strbuf, x, y); y += 22;
+
+        draw_gpu_profiler (x, y);
     }
+    gpu_profiler_end_pass ();
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
@@ -16,6 +16,7 @@ typedef struct scene_data_t
     XrRect2Di           viewport;
     std::vector<XrView> views;
     uint32_t            viewID;
+    bool                cpu_budget_exceeded;  /* drop optional passes (UI refresh) */
 } scene_data_t;
 
 
@@ -3,23 +3,34 @@
  * Copyright (c) 2019 terryky1220@gmail.com
  * ------------------------------------------------ */
 #include <stdio.h>
+#include <stdlib.h>
 #include <GLES2/gl2.h>
 #include "assertgl.h"
+#include "util_log.h"
+#include "util_gl_state.h"
 #include "util_shader.h"
 #include "util_matrix.h"
+#include "util_mesh.h"
 
-static shader_obj_t s_sobj;
-static GLuint s_vtx_id, s_nrm_id, g_idx_id;
-static GLint  s_loc_mtx_mv;
-static GLint  s_loc_mtx_pmv;
-static GLint  s_loc_mtx_nrm;
-static GLint  s_loc_color;
+typedef struct _teapot_shader_t
+{
+    shader_obj_t sobj;
+    GLint  loc_mtx_mv;
+    GLint  loc_mtx_pmv;
+    GLint  loc_mtx_nrm;
+    GLint  loc_color;
+} teapot_shader_t;
+
+static teapot_shader_t s_shader;
+static teapot_shader_t s_shader_mv;     /* GL_OVR_multiview2 */
+static mesh_obj_t s_teapot;
 
 
+/* the teapot is stored in MESH_FMT_COMPACT: a_Normal is octahedral */
 static char s_strVS[] = "                                   \n\
                                                             \n\
 attribute vec4  a_Vertex;                                   \n\
-attribute vec3  a_Normal;                                   \n\
+attribute vec2  a_Normal;                                   \n\
 uniform   mat4  u_PMVMatrix;                                \n\
 uniform   mat4  u_MVMatrix;                                 \n\
 uniform   mat3  u_ModelViewIT;                              \n\
@@ -42,12 +53,12 @@ void DirectionalLight (vec3 normal, vec3 eyePos)            \n\
                                                             \n\
     v_diffuse += dVP * LightCol;                            \n\
     v_specular+= pf  * LightCol;                            \n\
-}                                                           \n\
-                                                            \n\
+}                                                           \n"
+MESH_GLSL_OCT_DECODE "                                      \n\
 void main(void)                                             \n\
 {                                                           \n\
     gl_Position = u_PMVMatrix * a_Vertex;                   \n\
-    vec3 normal = normalize(u_ModelViewIT * a_Normal);      \n\
+    vec3 normal = normalize(u_ModelViewIT * oct_decode (a_Normal));\n\
     vec3 eyePos = vec3(u_MVMatrix * a_Vertex);              \n\
                                                             \n\
     v_diffuse  = vec3(0.0);                                 \n\
@@ -69,6 +80,63 @@ void main(void)                                             \n\
     gl_FragColor = vec4(color, 1.0);                        \n\
 }                                                           ";
 
+/* the same shader for GL_OVR_multiview2: the matrices are indexed by the view */
+static char s_strVS_mv[] = "#version 300 es                    \n\
+#extension GL_OVR_multiview2 : require                      \n\
+layout(num_views = 2) in;                                   \n\
+in        vec4  a_Vertex;                                   \n\
+in        vec2  a_Normal;                                   \n\
+uniform   mat4  u_PMVMatrix[2];                             \n\
+uniform   mat4  u_MVMatrix[2];                              \n\
+uniform   mat3  u_ModelViewIT[2];                           \n\
+out       vec3  v_diffuse;                                  \n\
+out       vec3  v_specular;                                 \n\
+const     float shiness = 16.0;                             \n\
+const     vec3  LightPos = vec3(4.0, 4.0, 4.0);             \n\
+const     vec3  LightCol = vec3(1.0, 1.0, 1.0);             \n\
+                                                            \n\
+void DirectionalLight (vec3 normal, vec3 eyePos)            \n\
+{                                                           \n\
+    vec3  lightDir = normalize (LightPos);                  \n\
+    vec3  halfV    = normalize (LightPos - eyePos);         \n\
+    float dVP      = max(dot(normal, lightDir), 0.0);       \n\
+    float dHV      = max(dot(normal, halfV   ), 0.0);       \n\
+                                                            \n\
+    float pf = 0.0;                                         \n\
+    if(dVP > 0.0)                                           \n\
+        pf = pow(dHV, shiness);                             \n\
+                                                            \n\
+    v_diffuse += dVP * LightCol;                            \n\
+    v_specular+= pf  * LightCol;                            \n\
+}                                                           \n"
+MESH_GLSL_OCT_DECODE "                                      \n\
+void main(void)                                             \n\
+{                                                           \n\
+    uint vid = gl_ViewID_OVR;                               \n\
+    gl_Position = u_PMVMatrix[vid] * a_Vertex;              \n\
+    vec3 normal = normalize(u_ModelViewIT[vid] * oct_decode (a_Normal));\n\
+    vec3 eyePos = vec3(u_MVMatrix[vid] * a_Vertex);         \n\
+                                                            \n\
+    v_diffuse  = vec3(0.0);                                 \n\
+    v_specular = vec3(0.0);                                 \n\
+    DirectionalLight(normal, eyePos);                       \n\
+}                                                           ";
+
+static char s_strFS_mv[] = "#version 300 es                    \n\
+precision mediump float;                                    \n\
+                                                            \n\
+uniform vec3    u_color;                                    \n\
+in      vec3    v_diffuse;                                  \n\
+in      vec3    v_specular;                                 \n\
+out     vec4    o_FragColor;                                \n\
+void main(void)                                             \n\
+{                                                           \n\
+    vec3 color = u_color * 0.1;                             \n\
+    color += (u_color * v_diffuse);                         \n\
+    color += v_specular;                                    \n\
+    o_FragColor = vec4(color, 1.0);                         \n\
+}                                                           ";
+
 
 
 
@@ -3777,233 +3845,122 @@ static GLushort teapotIndices[] = {
 };
 
 
-static void
-draw_teapot_vbo (float col[3])
+// the strips in teapotIndices: {first, count}.
+// a strip of 3 indices is a single triangle.
+static mesh_strip_t teapotStrips[] = {
+	{0, 12}, {12, 78}, {90, 35}, {125, 70}, {195, 65}, {260, 37}, {297, 35}, {332, 32},
+	{364, 56}, {420, 45}, {465, 41}, {506, 37}, {543, 33}, {576, 29}, {605, 25}, {630, 21},
+	{651, 17}, {668, 13}, {681, 9}, {690, 27}, {717, 16}, {733, 22}, {755, 50}, {805, 42},
+	{847, 43}, {890, 4}, {894, 143}, {1037, 234}, {1271, 224}, {1495, 71}, {1566, 69}, {1635, 67},
+	{1702, 65}, {1767, 63}, {1830, 61}, {1891, 59}, {1950, 57}, {2007, 55}, {2062, 53}, {2115, 51},
+	{2166, 3}, {2169, 50}, {2219, 48}, {2267, 46}, {2313, 44}, {2357, 42}, {2399, 40}, {2439, 38},
+	{2477, 36}, {2513, 34}, {2547, 32}, {2579, 30}, {2609, 28}, {2637, 26}, {2663, 24}, {2687, 22},
+	{2709, 20}, {2729, 18}, {2747, 16}, {2763, 14}, {2777, 12}, {2789, 10}, {2799, 8}, {2807, 6},
+	{2813, 3}, {2816, 3}, {2819, 200}, {3019, 3}, {3022, 66}, {3088, 3}, {3091, 209}, {3300, 3},
+	{3303, 3}, {3306, 3}, {3309, 38}, {3347, 15}, {3362, 3}, {3365, 26}, {3391, 9}, {3400, 3},
+	{3403, 14}, {3417, 3}, {3420, 115}, {3535, 3}, {3538, 3}, {3541, 39}, {3580, 3}, {3583, 91},
+	{3674, 3}, {3677, 3}, {3680, 31}, {3711, 3}, {3714, 67}, {3781, 3}, {3784, 3}, {3787, 23},
+	{3810, 3}, {3813, 45}, {3858, 3}, {3861, 3}, {3864, 3}, {3867, 32}, {3899, 38}, {3937, 15},
+	{3952, 3}, {3955, 26}, {3981, 9}, {3990, 3}, {3993, 14}, {4007, 3}, {4010, 135}, {4145, 3},
+	{4148, 76}, {4224, 3}, {4227, 60}, {4287, 3}, {4290, 23}, {4313, 3}, {4316, 26}, {4342, 3},
+	{4345, 6}, {4351, 947}, {5298, 35}, {5333, 31}, {5364, 27}, {5391, 23}, {5414, 20}, {5434, 24},
+	{5458, 3}, {5461, 28}, {5489, 32}, {5521, 36}, {5557, 76}, {5633, 3}, {5636, 67}, {5703, 3},
+	{5706, 59}, {5765, 3}, {5768, 51}, {5819, 3}, {5822, 43}, {5865, 3}, {5868, 35}, {5903, 3},
+	{5906, 27}, {5933, 3}, {5936, 19}, {5955, 3}, {5958, 11}, {5969, 3}, {5972, 30}, {6002, 3},
+	{6005, 11}, {6016, 18}, {6034, 3}, {6037, 3}, {6040, 5}, {6045, 122}, {6167, 75}, {6242, 71},
+	{6313, 67}, {6380, 63}, {6443, 59}, {6502, 55}, {6557, 51}, {6608, 47}, {6655, 43}, {6698, 39},
+	{6737, 35}, {6772, 31}, {6803, 27}, {6830, 23}, {6853, 19}, {6872, 15}, {6887, 11}, {6898, 7}
+};
+
+
+static int
+setup_teapot_shader (teapot_shader_t *shader, char *str_vs, char *str_fs)
 {
-	// use only offset here instead of absolute pointer addresses
-	glDrawElements(GL_TRIANGLE_STRIP, 12, GL_UNSIGNED_SHORT, (GLushort*)0+0);
-	glDrawElements(GL_TRIANGLE_STRIP, 78, GL_UNSIGNED_SHORT, (GLushort*)0+12);
-	glDrawElements(GL_TRIANGLE_STRIP, 35, GL_UNSIGNED_SHORT, (GLushort*)0+90);
-	glDrawElements(GL_TRIANGLE_STRIP, 70, GL_UNSIGNED_SHORT, (GLushort*)0+125);
-	glDrawElements(GL_TRIANGLE_STRIP, 65, GL_UNSIGNED_SHORT, (GLushort*)0+195);
-	glDrawElements(GL_TRIANGLE_STRIP, 37, GL_UNSIGNED_SHORT, (GLushort*)0+260);
-	glDrawElements(GL_TRIANGLE_STRIP, 35, GL_UNSIGNED_SHORT, (GLushort*)0+297);
-	glDrawElements(GL_TRIANGLE_STRIP, 32, GL_UNSIGNED_SHORT, (GLushort*)0+332);
-	glDrawElements(GL_TRIANGLE_STRIP, 56, GL_UNSIGNED_SHORT, (GLushort*)0+364);
-	glDrawElements(GL_TRIANGLE_STRIP, 45, GL_UNSIGNED_SHORT, (GLushort*)0+420);
-	glDrawElements(GL_TRIANGLE_STRIP, 41, GL_UNSIGNED_SHORT, (GLushort*)0+465);
-	glDrawElements(GL_TRIANGLE_STRIP, 37, GL_UNSIGNED_SHORT, (GLushort*)0+506);
-	glDrawElements(GL_TRIANGLE_STRIP, 33, GL_UNSIGNED_SHORT, (GLushort*)0+543);
-	glDrawElements(GL_TRIANGLE_STRIP, 29, GL_UNSIGNED_SHORT, (GLushort*)0+576);
-	glDrawElements(GL_TRIANGLE_STRIP, 25, GL_UNSIGNED_SHORT, (GLushort*)0+605);
-	glDrawElements(GL_TRIANGLE_STRIP, 21, GL_UNSIGNED_SHORT, (GLushort*)0+630);
-	glDrawElements(GL_TRIANGLE_STRIP, 17, GL_UNSIGNED_SHORT, (GLushort*)0+651);
-	glDrawElements(GL_TRIANGLE_STRIP, 13, GL_UNSIGNED_SHORT, (GLushort*)0+668);
-	glDrawElements(GL_TRIANGLE_STRIP, 9, GL_UNSIGNED_SHORT, (GLushort*)0+681);
-	glDrawElements(GL_TRIANGLE_STRIP, 27, GL_UNSIGNED_SHORT, (GLushort*)0+690);
-	glDrawElements(GL_TRIANGLE_STRIP, 16, GL_UNSIGNED_SHORT, (GLushort*)0+717);
-	glDrawElements(GL_TRIANGLE_STRIP, 22, GL_UNSIGNED_SHORT, (GLushort*)0+733);
-	glDrawElements(GL_TRIANGLE_STRIP, 50, GL_UNSIGNED_SHORT, (GLushort*)0+755);
-	glDrawElements(GL_TRIANGLE_STRIP, 42, GL_UNSIGNED_SHORT, (GLushort*)0+805);
-	glDrawElements(GL_TRIANGLE_STRIP, 43, GL_UNSIGNED_SHORT, (GLushort*)0+847);
-	glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_SHORT, (GLushort*)0+890);
-	glDrawElements(GL_TRIANGLE_STRIP, 143, GL_UNSIGNED_SHORT, (GLushort*)0+894);
-	glDrawElements(GL_TRIANGLE_STRIP, 234, GL_UNSIGNED_SHORT, (GLushort*)0+1037);
-	glDrawElements(GL_TRIANGLE_STRIP, 224, GL_UNSIGNED_SHORT, (GLushort*)0+1271);
-	glDrawElements(GL_TRIANGLE_STRIP, 71, GL_UNSIGNED_SHORT, (GLushort*)0+1495);
-	glDrawElements(GL_TRIANGLE_STRIP, 69, GL_UNSIGNED_SHORT, (GLushort*)0+1566);
-	glDrawElements(GL_TRIANGLE_STRIP, 67, GL_UNSIGNED_SHORT, (GLushort*)0+1635);
-	glDrawElements(GL_TRIANGLE_STRIP, 65, GL_UNSIGNED_SHORT, (GLushort*)0+1702);
-	glDrawElements(GL_TRIANGLE_STRIP, 63, GL_UNSIGNED_SHORT, (GLushort*)0+1767);
-	glDrawElements(GL_TRIANGLE_STRIP, 61, GL_UNSIGNED_SHORT, (GLushort*)0+1830);
-	glDrawElements(GL_TRIANGLE_STRIP, 59, GL_UNSIGNED_SHORT, (GLushort*)0+1891);
-	glDrawElements(GL_TRIANGLE_STRIP, 57, GL_UNSIGNED_SHORT, (GLushort*)0+1950);
-	glDrawElements(GL_TRIANGLE_STRIP, 55, GL_UNSIGNED_SHORT, (GLushort*)0+2007);
-	glDrawElements(GL_TRIANGLE_STRIP, 53, GL_UNSIGNED_SHORT, (GLushort*)0+2062);
-	glDrawElements(GL_TRIANGLE_STRIP, 51, GL_UNSIGNED_SHORT, (GLushort*)0+2115);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+2166);
-	glDrawElements(GL_TRIANGLE_STRIP, 50, GL_UNSIGNED_SHORT, (GLushort*)0+2169);
-	glDrawElements(GL_TRIANGLE_STRIP, 48, GL_UNSIGNED_SHORT, (GLushort*)0+2219);
-	glDrawElements(GL_TRIANGLE_STRIP, 46, GL_UNSIGNED_SHORT, (GLushort*)0+2267);
-	glDrawElements(GL_TRIANGLE_STRIP, 44, GL_UNSIGNED_SHORT, (GLushort*)0+2313);
-	glDrawElements(GL_TRIANGLE_STRIP, 42, GL_UNSIGNED_SHORT, (GLushort*)0+2357);
-	glDrawElements(GL_TRIANGLE_STRIP, 40, GL_UNSIGNED_SHORT, (GLushort*)0+2399);
-	glDrawElements(GL_TRIANGLE_STRIP, 38, GL_UNSIGNED_SHORT, (GLushort*)0+2439);
-	glDrawElements(GL_TRIANGLE_STRIP, 36, GL_UNSIGNED_SHORT, (GLushort*)0+2477);
-	glDrawElements(GL_TRIANGLE_STRIP, 34, GL_UNSIGNED_SHORT, (GLushort*)0+2513);
-	glDrawElements(GL_TRIANGLE_STRIP, 32, GL_UNSIGNED_SHORT, (GLushort*)0+2547);
-	glDrawElements(GL_TRIANGLE_STRIP, 30, GL_UNSIGNED_SHORT, (GLushort*)0+2579);
-	glDrawElements(GL_TRIANGLE_STRIP, 28, GL_UNSIGNED_SHORT, (GLushort*)0+2609);
-	glDrawElements(GL_TRIANGLE_STRIP, 26, GL_UNSIGNED_SHORT, (GLushort*)0+2637);
-	glDrawElements(GL_TRIANGLE_STRIP, 24, GL_UNSIGNED_SHORT, (GLushort*)0+2663);
-	glDrawElements(GL_TRIANGLE_STRIP, 22, GL_UNSIGNED_SHORT, (GLushort*)0+2687);
-	glDrawElements(GL_TRIANGLE_STRIP, 20, GL_UNSIGNED_SHORT, (GLushort*)0+2709);
-	glDrawElements(GL_TRIANGLE_STRIP, 18, GL_UNSIGNED_SHORT, (GLushort*)0+2729);
-	glDrawElements(GL_TRIANGLE_STRIP, 16, GL_UNSIGNED_SHORT, (GLushort*)0+2747);
-	glDrawElements(GL_TRIANGLE_STRIP, 14, GL_UNSIGNED_SHORT, (GLushort*)0+2763);
-	glDrawElements(GL_TRIANGLE_STRIP, 12, GL_UNSIGNED_SHORT, (GLushort*)0+2777);
-	glDrawElements(GL_TRIANGLE_STRIP, 10, GL_UNSIGNED_SHORT, (GLushort*)0+2789);
-	glDrawElements(GL_TRIANGLE_STRIP, 8, GL_UNSIGNED_SHORT, (GLushort*)0+2799);
-	glDrawElements(GL_TRIANGLE_STRIP, 6, GL_UNSIGNED_SHORT, (GLushort*)0+2807);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+2813);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+2816);
-	glDrawElements(GL_TRIANGLE_STRIP, 200, GL_UNSIGNED_SHORT, (GLushort*)0+2819);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+3019);
-	glDrawElements(GL_TRIANGLE_STRIP, 66, GL_UNSIGNED_SHORT, (GLushort*)0+3022);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+3088);
-	glDrawElements(GL_TRIANGLE_STRIP, 209, GL_UNSIGNED_SHORT, (GLushort*)0+3091);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+3300);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+3303);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+3306);
-	glDrawElements(GL_TRIANGLE_STRIP, 38, GL_UNSIGNED_SHORT, (GLushort*)0+3309);
-	glDrawElements(GL_TRIANGLE_STRIP, 15, GL_UNSIGNED_SHORT, (GLushort*)0+3347);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+3362);
-	glDrawElements(GL_TRIANGLE_STRIP, 26, GL_UNSIGNED_SHORT, (GLushort*)0+3365);
-	glDrawElements(GL_TRIANGLE_STRIP, 9, GL_UNSIGNED_SHORT, (GLushort*)0+3391);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+3400);
-	glDrawElements(GL_TRIANGLE_STRIP, 14, GL_UNSIGNED_SHORT, (GLushort*)0+3403);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+3417);
-	glDrawElements(GL_TRIANGLE_STRIP, 115, GL_UNSIGNED_SHORT, (GLushort*)0+3420);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+3535);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+3538);
-	glDrawElements(GL_TRIANGLE_STRIP, 39, GL_UNSIGNED_SHORT, (GLushort*)0+3541);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+3580);
-	glDrawElements(GL_TRIANGLE_STRIP, 91, GL_UNSIGNED_SHORT, (GLushort*)0+3583);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+3674);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+3677);
-	glDrawElements(GL_TRIANGLE_STRIP, 31, GL_UNSIGNED_SHORT, (GLushort*)0+3680);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+3711);
-	glDrawElements(GL_TRIANGLE_STRIP, 67, GL_UNSIGNED_SHORT, (GLushort*)0+3714);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+3781);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+3784);
-	glDrawElements(GL_TRIANGLE_STRIP, 23, GL_UNSIGNED_SHORT, (GLushort*)0+3787);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+3810);
-	glDrawElements(GL_TRIANGLE_STRIP, 45, GL_UNSIGNED_SHORT, (GLushort*)0+3813);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+3858);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+3861);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+3864);
-	glDrawElements(GL_TRIANGLE_STRIP, 32, GL_UNSIGNED_SHORT, (GLushort*)0+3867);
-	glDrawElements(GL_TRIANGLE_STRIP, 38, GL_UNSIGNED_SHORT, (GLushort*)0+3899);
-	glDrawElements(GL_TRIANGLE_STRIP, 15, GL_UNSIGNED_SHORT, (GLushort*)0+3937);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+3952);
-	glDrawElements(GL_TRIANGLE_STRIP, 26, GL_UNSIGNED_SHORT, (GLushort*)0+3955);
-	glDrawElements(GL_TRIANGLE_STRIP, 9, GL_UNSIGNED_SHORT, (GLushort*)0+3981);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+3990);
-	glDrawElements(GL_TRIANGLE_STRIP, 14, GL_UNSIGNED_SHORT, (GLushort*)0+3993);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+4007);
-	glDrawElements(GL_TRIANGLE_STRIP, 135, GL_UNSIGNED_SHORT, (GLushort*)0+4010);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+4145);
-	glDrawElements(GL_TRIANGLE_STRIP, 76, GL_UNSIGNED_SHORT, (GLushort*)0+4148);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+4224);
-	glDrawElements(GL_TRIANGLE_STRIP, 60, GL_UNSIGNED_SHORT, (GLushort*)0+4227);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+4287);
-	glDrawElements(GL_TRIANGLE_STRIP, 23, GL_UNSIGNED_SHORT, (GLushort*)0+4290);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+4313);
-	glDrawElements(GL_TRIANGLE_STRIP, 26, GL_UNSIGNED_SHORT, (GLushort*)0+4316);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+4342);
-	glDrawElements(GL_TRIANGLE_STRIP, 6, GL_UNSIGNED_SHORT, (GLushort*)0+4345);
-	glDrawElements(GL_TRIANGLE_STRIP, 947, GL_UNSIGNED_SHORT, (GLushort*)0+4351);
-	glDrawElements(GL_TRIANGLE_STRIP, 35, GL_UNSIGNED_SHORT, (GLushort*)0+5298);
-	glDrawElements(GL_TRIANGLE_STRIP, 31, GL_UNSIGNED_SHORT, (GLushort*)0+5333);
-	glDrawElements(GL_TRIANGLE_STRIP, 27, GL_UNSIGNED_SHORT, (GLushort*)0+5364);
-	glDrawElements(GL_TRIANGLE_STRIP, 23, GL_UNSIGNED_SHORT, (GLushort*)0+5391);
-	glDrawElements(GL_TRIANGLE_STRIP, 20, GL_UNSIGNED_SHORT, (GLushort*)0+5414);
-	glDrawElements(GL_TRIANGLE_STRIP, 24, GL_UNSIGNED_SHORT, (GLushort*)0+5434);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+5458);
-	glDrawElements(GL_TRIANGLE_STRIP, 28, GL_UNSIGNED_SHORT, (GLushort*)0+5461);
-	glDrawElements(GL_TRIANGLE_STRIP, 32, GL_UNSIGNED_SHORT, (GLushort*)0+5489);
-	glDrawElements(GL_TRIANGLE_STRIP, 36, GL_UNSIGNED_SHORT, (GLushort*)0+5521);
-	glDrawElements(GL_TRIANGLE_STRIP, 76, GL_UNSIGNED_SHORT, (GLushort*)0+5557);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+5633);
-	glDrawElements(GL_TRIANGLE_STRIP, 67, GL_UNSIGNED_SHORT, (GLushort*)0+5636);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+5703);
-	glDrawElements(GL_TRIANGLE_STRIP, 59, GL_UNSIGNED_SHORT, (GLushort*)0+5706);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+5765);
-	glDrawElements(GL_TRIANGLE_STRIP, 51, GL_UNSIGNED_SHORT, (GLushort*)0+5768);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+5819);
-	glDrawElements(GL_TRIANGLE_STRIP, 43, GL_UNSIGNED_SHORT, (GLushort*)0+5822);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+5865);
-	glDrawElements(GL_TRIANGLE_STRIP, 35, GL_UNSIGNED_SHORT, (GLushort*)0+5868);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+5903);
-	glDrawElements(GL_TRIANGLE_STRIP, 27, GL_UNSIGNED_SHORT, (GLushort*)0+5906);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+5933);
-	glDrawElements(GL_TRIANGLE_STRIP, 19, GL_UNSIGNED_SHORT, (GLushort*)0+5936);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+5955);
-	glDrawElements(GL_TRIANGLE_STRIP, 11, GL_UNSIGNED_SHORT, (GLushort*)0+5958);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+5969);
-	glDrawElements(GL_TRIANGLE_STRIP, 30, GL_UNSIGNED_SHORT, (GLushort*)0+5972);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+6002);
-	glDrawElements(GL_TRIANGLE_STRIP, 11, GL_UNSIGNED_SHORT, (GLushort*)0+6005);
-	glDrawElements(GL_TRIANGLE_STRIP, 18, GL_UNSIGNED_SHORT, (GLushort*)0+6016);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+6034);
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, (GLushort*)0+6037);
-	glDrawElements(GL_TRIANGLE_STRIP, 5, GL_UNSIGNED_SHORT, (GLushort*)0+6040);
-	glDrawElements(GL_TRIANGLE_STRIP, 122, GL_UNSIGNED_SHORT, (GLushort*)0+6045);
-	glDrawElements(GL_TRIANGLE_STRIP, 75, GL_UNSIGNED_SHORT, (GLushort*)0+6167);
-	glDrawElements(GL_TRIANGLE_STRIP, 71, GL_UNSIGNED_SHORT, (GLushort*)0+6242);
-	glDrawElements(GL_TRIANGLE_STRIP, 67, GL_UNSIGNED_SHORT, (GLushort*)0+6313);
-	glDrawElements(GL_TRIANGLE_STRIP, 63, GL_UNSIGNED_SHORT, (GLushort*)0+6380);
-	glDrawElements(GL_TRIANGLE_STRIP, 59, GL_UNSIGNED_SHORT, (GLushort*)0+6443);
-	glDrawElements(GL_TRIANGLE_STRIP, 55, GL_UNSIGNED_SHORT, (GLushort*)0+6502);
-	glDrawElements(GL_TRIANGLE_STRIP, 51, GL_UNSIGNED_SHORT, (GLushort*)0+6557);
-	glDrawElements(GL_TRIANGLE_STRIP, 47, GL_UNSIGNED_SHORT, (GLushort*)0+6608);
-	glDrawElements(GL_TRIANGLE_STRIP, 43, GL_UNSIGNED_SHORT, (GLushort*)0+6655);
-	glDrawElements(GL_TRIANGLE_STRIP, 39, GL_UNSIGNED_SHORT, (GLushort*)0+6698);
-	glDrawElements(GL_TRIANGLE_STRIP, 35, GL_UNSIGNED_SHORT, (GLushort*)0+6737);
-	glDrawElements(GL_TRIANGLE_STRIP, 31, GL_UNSIGNED_SHORT, (GLushort*)0+6772);
-	glDrawElements(GL_TRIANGLE_STRIP, 27, GL_UNSIGNED_SHORT, (GLushort*)0+6803);
-	glDrawElements(GL_TRIANGLE_STRIP, 23, GL_UNSIGNED_SHORT, (GLushort*)0+6830);
-	glDrawElements(GL_TRIANGLE_STRIP, 19, GL_UNSIGNED_SHORT, (GLushort*)0+6853);
-	glDrawElements(GL_TRIANGLE_STRIP, 15, GL_UNSIGNED_SHORT, (GLushort*)0+6872);
-	glDrawElements(GL_TRIANGLE_STRIP, 11, GL_UNSIGNED_SHORT, (GLushort*)0+6887);
-	glDrawElements(GL_TRIANGLE_STRIP, 7, GL_UNSIGNED_SHORT, (GLushort*)0+6898);
+    if (generate_shader (&shader->sobj, str_vs, str_fs) < 0)
+        return -1;
+
+    GLuint prog = shader->sobj.program;
+    shader->loc_mtx_mv  = glGetUniformLocation(prog, "u_MVMatrix" );
+    shader->loc_mtx_pmv = glGetUniformLocation(prog, "u_PMVMatrix" );
+    shader->loc_mtx_nrm = glGetUniformLocation(prog, "u_ModelViewIT" );
+    shader->loc_color   = glGetUniformLocation(prog, "u_color" );
+
+    return 0;
 }
 
 
 int
 init_teapot ()
 {
-    glEnable (GL_DEPTH_TEST);
-    glEnable (GL_CULL_FACE);
+    glstate_enable (GL_DEPTH_TEST);
+    glstate_enable (GL_CULL_FACE);
+
+    setup_teapot_shader (&s_shader, s_strVS, s_strFS);
+
+    /*
+     *  the 176 strips and triangles -> one triangle list, reordered for the
+     *  post-transform vertex cache: drawn with a single glDrawElements().
+     */
+    int num_vtx    = sizeof(teapotVertices) / (sizeof(GLfloat) * 3);
+    int num_strips = sizeof(teapotStrips) / sizeof(mesh_strip_t);
+    int max_idx    = 0;
+
+    for (int i = 0; i < num_strips; i ++)
+        max_idx += (teapotStrips[i].count - 2) * 3;
+
+    GLushort *tri_idx = (GLushort *)malloc (sizeof(GLushort) * max_idx);
+    if (tri_idx == NULL)
+        return -1;
 
-    generate_shader (&s_sobj, s_strVS, s_strFS);
-    s_loc_mtx_mv  = glGetUniformLocation(s_sobj.program, "u_MVMatrix" );
-    s_loc_mtx_pmv = glGetUniformLocation(s_sobj.program, "u_PMVMatrix" );
-    s_loc_mtx_nrm = glGetUniformLocation(s_sobj.program, "u_ModelViewIT" );
-    s_loc_color   = glGetUniformLocation(s_sobj.program, "u_color" );
+    int num_idx = mesh_strips_to_triangles (teapotIndices, GL_UNSIGNED_SHORT,
+                                            teapotStrips, num_strips, tri_idx);
 
-    glGenBuffers (1, &s_vtx_id);
-    glBindBuffer (GL_ARRAY_BUFFER, s_vtx_id);
-    glBufferData (GL_ARRAY_BUFFER, sizeof(teapotVertices), &teapotVertices[0], GL_STATIC_DRAW);
+    float acmr0 = mesh_get_acmr (tri_idx, GL_UNSIGNED_SHORT, num_idx, num_vtx, 16);
+    mesh_optimize_vcache (tri_idx, GL_UNSIGNED_SHORT, num_idx, num_vtx);
+    float acmr1 = mesh_get_acmr (tri_idx, GL_UNSIGNED_SHORT, num_idx, num_vtx, 16);
 
-    glGenBuffers (1, &s_nrm_id);
-    glBindBuffer (GL_ARRAY_BUFFER, s_nrm_id);
-    glBufferData (GL_ARRAY_BUFFER, sizeof(teapotNormals), &teapotNormals[0], GL_STATIC_DRAW);
+    LOGI ("teapot: %d strips -> %d triangles, ACMR(FIFO 16) %.3f -> %.3f\n",
+          num_strips, num_idx / 3, acmr0, acmr1);
 
-    glGenBuffers (1, &g_idx_id);
-    glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, g_idx_id);
-    glBufferData (GL_ELEMENT_ARRAY_BUFFER, sizeof(teapotIndices), &teapotIndices[0], GL_STATIC_DRAW);
+    /* half positions and octahedral normals interleaved: 24 -> 12 bytes/vertex */
+    mesh_src_t src = {};
+    src.num_vtx  = num_vtx;
+    src.vtx      = teapotVertices;
+    src.nrm      = teapotNormals;
+    src.num_idx  = num_idx;
+    src.idx      = tri_idx;
+    src.idx_type = GL_UNSIGNED_SHORT;
+    src.prim     = GL_TRIANGLES;
+
+    int ret = mesh_create (&s_teapot, &src, MESH_FMT_COMPACT);
+    free (tri_idx);
+    if (ret < 0)
+        return -1;
 
     GLASSERT ();
     return 0;
 }
 
+
+/* build the stereo multiview shader used by draw_teapot_multiview(). */
 int
-draw_teapot (int count, float col[3], float *matP, float *matV)
+init_teapot_multiview ()
 {
-    float matM[16], matVM[16], matPVM[16], matVMI4x4[16], matVMI3x3[9];;
+    int ret = setup_teapot_shader (&s_shader_mv, s_strVS_mv, s_strFS_mv);
 
-    glUseProgram (s_sobj.program);
-    glEnableVertexAttribArray (s_sobj.loc_vtx);
-    glEnableVertexAttribArray (s_sobj.loc_nrm);
+    GLASSERT ();
+    return ret;
+}
 
-    glBindBuffer (GL_ARRAY_BUFFER, s_vtx_id);
-    glVertexAttribPointer (s_sobj.loc_vtx, 3, GL_FLOAT, GL_FALSE, 0, 0);
 
-    glBindBuffer (GL_ARRAY_BUFFER, s_nrm_id);
-    glVertexAttribPointer (s_sobj.loc_nrm, 3, GL_FLOAT, GL_FALSE, 0, 0);
+/* (matP) and (matV) are arrays of (num_views) matrices. */
+static int
+draw_teapot_views (teapot_shader_t *shader, int count, float col[3], float *matP, float *matV, int num_views)
+{
+    float matM[16], matVM[2][16], matPVM[2][16], matVMI3x3[2][9];
 
-    glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, g_idx_id);
+    glstate_use_program (shader->sobj.program);
+    mesh_bind (&s_teapot, shader->sobj.program);
 
     matrix_identity (matM);
     matrix_translate (matM, 0.0f, 0.0f, -3.0f);
@@ -4011,43 +3968,48 @@ draw_teapot (int count, float col[3], float *matP, float *matV)
     matrix_scale (matM, 0.3f, 0.3f, 0.3f);
     matrix_translate (matM, 0.0f, -4.0f, 0.0f);
 
-    matrix_mult (matVM, matV, matM);
+    for (int i = 0; i < num_views; i ++)
+    {
+        matrix_mult (matVM[i], &matV[16 * i], matM);
 
-    matrix_copy (matVMI4x4, matVM);
-    matrix_invert   (matVMI4x4);
-    matrix_transpose(matVMI4x4);
-    matVMI3x3[0] = matVMI4x4[0];
-    matVMI3x3[1] = matVMI4x4[1];
-    matVMI3x3[2] = matVMI4x4[2];
-    matVMI3x3[3] = matVMI4x4[4];
-    matVMI3x3[4] = matVMI4x4[5];
-    matVMI3x3[5] = matVMI4x4[6];
-    matVMI3x3[6] = matVMI4x4[8];
-    matVMI3x3[7] = matVMI4x4[9];
-    matVMI3x3[8] = matVMI4x4[10];
+        matrix_normal3x3 (matVMI3x3[i], matVM[i]);
 
-    matrix_mult (matPVM, matP, matVM);
-    glUniformMatrix4fv (s_loc_mtx_mv,   1, GL_FALSE, matVM );
-    glUniformMatrix4fv (s_loc_mtx_pmv,  1, GL_FALSE, matPVM);
-    glUniformMatrix3fv (s_loc_mtx_nrm,  1, GL_FALSE, matVMI3x3);
+        matrix_mult (matPVM[i], &matP[16 * i], matVM[i]);
+    }
+    glUniformMatrix4fv (shader->loc_mtx_mv,   num_views, GL_FALSE, &matVM[0][0] );
+    glUniformMatrix4fv (shader->loc_mtx_pmv,  num_views, GL_FALSE, &matPVM[0][0]);
+    glUniformMatrix3fv (shader->loc_mtx_nrm,  num_views, GL_FALSE, &matVMI3x3[0][0]);
 
-    glUniform3f (s_loc_color, col[0], col[1], col[2]);
+    glUniform3f (shader->loc_color, col[0], col[1], col[2]);
 
-    glEnable (GL_DEPTH_TEST);
-    draw_teapot_vbo (col);
+    glstate_enable (GL_DEPTH_TEST);
+    glstate_enable (GL_CULL_FACE);
+    glstate_front_face (GL_CCW);
+    glstate_disable (GL_BLEND);
+    mesh_draw (&s_teapot);
 
     GLASSERT ();
     return 0;
 }
 
+int
+draw_teapot (int count, float col[3], float *matP, float *matV)
+{
+    return draw_teapot_views (&s_shader, count, col, matP, matV, 1);
+}
+
+/* draw into both layers of a GL_OVR_multiview2 render target. matP/matV: float[2][16] */
+int
+draw_teapot_multiview (int count, float col[3], float *matP, float *matV)
+{
+    return draw_teapot_views (&s_shader_mv, count, col, matP, matV, 2);
+}
+
 int
 delete_teapot ()
 {
-    glDeleteBuffers (1, &s_vtx_id);
-    glDeleteBuffers (1, &s_nrm_id);
-    glDeleteBuffers (1, &g_idx_id);
+    mesh_destroy (&s_teapot);
 
     GLASSERT ();
     return 0;
 }
-
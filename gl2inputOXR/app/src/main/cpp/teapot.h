@@ -7,6 +7,8 @@
 
 int init_teapot ();
 int draw_teapot (int count, float col[3], float *matP, float *matV);
+int init_teapot_multiview ();
+int draw_teapot_multiview (int count, float col[3], float *matP, float *matV);
 int delete_teapot ();
 
 #endif /* _EAPOT_H_ */
@@ -1,3 +1,4 @@
+#include <cstddef>
 #include "util_egl.h"
 #include "util_oxr.h"
 #include "app_engine.h"
@@ -48,13 +49,27 @@ AppEngine::InitOpenXR_GLES ()
     m_stageSpace = oxr_create_ref_space (m_session, XR_REFERENCE_SPACE_TYPE_STAGE);
     m_viewSpace  = oxr_create_ref_space (m_session, XR_REFERENCE_SPACE_TYPE_VIEW);
 
-    m_viewSurface = oxr_create_viewsurface (m_instance, m_systemId, m_session);
+    /*
+     *  the scene is alpha blended over the passthrough. let the runtime
+     *  foveate up to MEDIUM while the GPU is busy.
+     */
+    oxr_swapchain_config_t sc_config = OXR_SWAPCHAIN_CONFIG_DEFAULT;
+    sc_config.foveation_level   = FOVEATION_LEVEL_MEDIUM;
+    sc_config.foveation_dynamic = true;
+    m_viewSurface = oxr_create_viewsurface (m_instance, m_systemId, m_session, &sc_config);
 
     InitializeActions ();
 
+    /* spaces located at every frame, in the order of LocatedSpace */
+    m_spaces.init (m_instance, m_session, m_appSpace);
+    m_spaces.add (m_stageSpace);
+    m_spaces.add (m_viewSpace);
+    for (int i = 0; i < Side::COUNT; i ++)
+        m_spaces.add (oxr_get_action_table_space (m_actions, ACT_GRIP_POSE, i));
+    for (int i = 0; i < Side::COUNT; i ++)
+        m_spaces.add (oxr_get_action_table_space (m_actions, ACT_AIM_POSE,  i));
+
     oxr_create_handtrackers (m_instance, m_session, m_handTracker);
-    m_handJointLoc[0] = oxr_create_handjoint_loc ();
-    m_handJointLoc[1] = oxr_create_handjoint_loc ();
 
     oxr_create_passthrough_layer (m_instance, m_session, m_passthrough, m_ptLayer);
     oxr_start_passthrough (m_instance, m_passthrough);
@@ -66,189 +81,59 @@ AppEngine::InitOpenXR_GLES ()
 
 /* ---------------------------------------------------------------------------- *
  *  Initialize Hand Controller Action
- * ---------------------------------------------------------------------------- *
- *
- * -----------+-----------+-----------------+-------------------------------------
- *  XrAction  | ActionType|  SubactionPath  | BindingPath
- * -----------+-----------+-----------------+-------------------------------------
- *  poseAction| POSE   IN | /user/hand/left | /user/hand/left /input/grip/pose
- *            |           | /user/hand/right| /user/hand/right/input/grip/pose
- *  aimAction | POSE   IN | /user/hand/left | /user/hand/left /input/aim/pose
- *            |           | /user/hand/right| /user/hand/right/input/aim/pose
- *  squzAction| FLOAT  IN | /user/hand/left | /user/hand/left /input/squeeze/value
- *            |           | /user/hand/right| /user/hand/right/input/squeeze/value
- *  trigAction| FLOAT  IN | /user/hand/left | /user/hand/left /input/trigger/value
- *            |           | /user/hand/right| /user/hand/right/input/trigger/value
- *  stikAction| FLOAT  IN | /user/hand/left | /user/hand/left /input/trigger/value
- *            |           | /user/hand/right| /user/hand/right/input/trigger/value
- * -----------+-----------+-----------------+-------------------------------------
- *  vibrAction|VIBRATE OUT| /user/hand/left | /user/hand/left /output/haptic
- *            |           | /user/hand/right| /user/hand/right/output/haptic
- * -----------+-----------+-----------------+-------------------------------------
- *  clksAction| BOOL   IN | /user/hand/left | /user/hand/left /input/thumbstick/click
- *  clksAction| BOOL   IN | /user/hand/right| /user/hand/right/input/thumbstick/click
- *  clkaAction| BOOL   IN |                 | /user/hand/right/input/a/click
- *  clkbAction| BOOL   IN |                 | /user/hand/right/input/b/click
- *  clkxAction| BOOL   IN |                 | /user/hand/left /input/x/click
- *  clkyAction| BOOL   IN |                 | /user/hand/left /input/y/click
- *  quitAction| BOOL   IN |                 | /user/hand/left /input/menu/click
- * -----------+-----------+-----------------+-------------------------------------
- *
- */
+ *    The actions are declared in s_action_desc[] in the order of AppAction.
+ *    (offset) tells PollActions() where to store the value in InputState.
+ * ---------------------------------------------------------------------------- */
+static const oxr_action_desc_t s_action_desc[ACT_NUM] =
+{
+    /* type                             name         local_name   per_hand  binding {/user/hand/left, /user/hand/right}          offset */
+    {XR_ACTION_TYPE_POSE_INPUT,       "grip_pose", "GripPose",  true,  {"/input/grip/pose",        "/input/grip/pose"       }, offsetof (InputState, handActive)},
+    {XR_ACTION_TYPE_POSE_INPUT,       "aim_pose",  "Aim Pose",  true,  {"/input/aim/pose",         "/input/aim/pose"        }, -1},
+    {XR_ACTION_TYPE_FLOAT_INPUT,      "squeeze",   "Squeeze",   true,  {"/input/squeeze/value",    "/input/squeeze/value"   }, offsetof (InputState, squeezeVal)},
+    {XR_ACTION_TYPE_FLOAT_INPUT,      "trigger",   "Trigger",   true,  {"/input/trigger/value",    "/input/trigger/value"   }, offsetof (InputState, triggerVal)},
+    {XR_ACTION_TYPE_VECTOR2F_INPUT,   "thumstick", "ThumStick", true,  {"/input/thumbstick",       "/input/thumbstick"      }, offsetof (InputState, stickVal)},
+    {XR_ACTION_TYPE_VIBRATION_OUTPUT, "haptic",    "Haptic",    true,  {"/output/haptic",          "/output/haptic"         }, -1},
+    {XR_ACTION_TYPE_BOOLEAN_INPUT,    "click_s",   "ClickS",    true,  {"/input/thumbstick/click", "/input/thumbstick/click"}, offsetof (InputState, clickS)},
+    {XR_ACTION_TYPE_BOOLEAN_INPUT,    "click_a",   "ClickA",    false, {NULL,                      "/input/a/click"         }, offsetof (InputState, clickA)},
+    {XR_ACTION_TYPE_BOOLEAN_INPUT,    "click_b",   "ClickB",    false, {NULL,                      "/input/b/click"         }, offsetof (InputState, clickB)},
+    {XR_ACTION_TYPE_BOOLEAN_INPUT,    "click_x",   "ClickX",    false, {"/input/x/click",          NULL                     }, offsetof (InputState, clickX)},
+    {XR_ACTION_TYPE_BOOLEAN_INPUT,    "click_y",   "ClickY",    false, {"/input/y/click",          NULL                     }, offsetof (InputState, clickY)},
+    {XR_ACTION_TYPE_BOOLEAN_INPUT,    "menu_quit", "MenuQuit",  false, {"/input/menu/click",       NULL                     }, offsetof (InputState, clickMenu)},
+};
 
-#define HANDL       "/user/hand/left"
-#define HANDR       "/user/hand/right"
-#define HANDL_IN    "/user/hand/left/input"
-#define HANDR_IN    "/user/hand/right/input"
-#define HANDL_OT    "/user/hand/left/output"
-#define HANDR_OT    "/user/hand/right/output"
 
 void
 AppEngine::InitializeActions()
 {
-    m_input.actionSet = oxr_create_actionset (m_instance, "app_action_set", "AppActionSet", 0);
-
-    xrStringToPath (m_instance, HANDL, &m_input.handSubactionPath[Side::LEFT ]);
-    xrStringToPath (m_instance, HANDR, &m_input.handSubactionPath[Side::RIGHT]);
-
-    XrActionSet           &actSet  = m_input.actionSet;
-    std::array<XrPath, 2> &subPath = m_input.handSubactionPath;
-
-    // Create actions.
-    m_input.poseAction = oxr_create_action (actSet, XR_ACTION_TYPE_POSE_INPUT,       "grip_pose","GripPose", 2, subPath.data());
-    m_input.aimAction  = oxr_create_action (actSet, XR_ACTION_TYPE_POSE_INPUT,       "aim_pose", "Aim Pose", 2, subPath.data());
-    m_input.squzAction = oxr_create_action (actSet, XR_ACTION_TYPE_FLOAT_INPUT,      "squeeze",  "Aqueeze",  2, subPath.data());
-    m_input.trigAction = oxr_create_action (actSet, XR_ACTION_TYPE_FLOAT_INPUT,      "trigger",  "Trigger",  2, subPath.data());
-    m_input.stikAction = oxr_create_action (actSet, XR_ACTION_TYPE_VECTOR2F_INPUT,   "thumstick","ThumStick",2, subPath.data());
-    m_input.vibrAction = oxr_create_action (actSet, XR_ACTION_TYPE_VIBRATION_OUTPUT, "haptic",   "Haptic",   2, subPath.data());
-    m_input.clisAction = oxr_create_action (actSet, XR_ACTION_TYPE_BOOLEAN_INPUT,    "click_s",  "ClickS",   2, subPath.data());
-    m_input.cliaAction = oxr_create_action (actSet, XR_ACTION_TYPE_BOOLEAN_INPUT,    "click_a",  "ClickA",   0, NULL);
-    m_input.clibAction = oxr_create_action (actSet, XR_ACTION_TYPE_BOOLEAN_INPUT,    "click_b",  "ClickB",   0, NULL);
-    m_input.clixAction = oxr_create_action (actSet, XR_ACTION_TYPE_BOOLEAN_INPUT,    "click_x",  "ClickX",   0, NULL);
-    m_input.cliyAction = oxr_create_action (actSet, XR_ACTION_TYPE_BOOLEAN_INPUT,    "click_y",  "ClickY",   0, NULL);
-    m_input.quitAction = oxr_create_action (actSet, XR_ACTION_TYPE_BOOLEAN_INPUT,    "menu_quit","MenuQuit", 0, NULL);
-
-    // Suggest bindings for the Oculus Touch.
-    {
-        std::vector<XrActionSuggestedBinding> bindings;
-        bindings.push_back ({m_input.poseAction, oxr_str2path (m_instance, HANDL_IN"/grip/pose"    )});
-        bindings.push_back ({m_input.poseAction, oxr_str2path (m_instance, HANDR_IN"/grip/pose"    )});
-        bindings.push_back ({m_input.aimAction,  oxr_str2path (m_instance, HANDL_IN"/aim/pose"     )});
-        bindings.push_back ({m_input.aimAction,  oxr_str2path (m_instance, HANDR_IN"/aim/pose"     )});
-        bindings.push_back ({m_input.squzAction, oxr_str2path (m_instance, HANDL_IN"/squeeze/value")});
-        bindings.push_back ({m_input.squzAction, oxr_str2path (m_instance, HANDR_IN"/squeeze/value")});
-        bindings.push_back ({m_input.trigAction, oxr_str2path (m_instance, HANDL_IN"/trigger/value")});
-        bindings.push_back ({m_input.trigAction, oxr_str2path (m_instance, HANDR_IN"/trigger/value")});
-        bindings.push_back ({m_input.stikAction, oxr_str2path (m_instance, HANDL_IN"/thumbstick"   )});
-        bindings.push_back ({m_input.stikAction, oxr_str2path (m_instance, HANDR_IN"/thumbstick"   )});
-        bindings.push_back ({m_input.vibrAction, oxr_str2path (m_instance, HANDL_OT"/haptic"       )});
-        bindings.push_back ({m_input.vibrAction, oxr_str2path (m_instance, HANDR_OT"/haptic"       )});
-        bindings.push_back ({m_input.clisAction, oxr_str2path (m_instance, HANDR_IN"/thumbstick/click")});
-        bindings.push_back ({m_input.clisAction, oxr_str2path (m_instance, HANDL_IN"/thumbstick/click")});
-        bindings.push_back ({m_input.cliaAction, oxr_str2path (m_instance, HANDR_IN"/a/click"      )});
-        bindings.push_back ({m_input.clibAction, oxr_str2path (m_instance, HANDR_IN"/b/click"      )});
-        bindings.push_back ({m_input.clixAction, oxr_str2path (m_instance, HANDL_IN"/x/click"      )});
-        bindings.push_back ({m_input.cliyAction, oxr_str2path (m_instance, HANDL_IN"/y/click"      )});
-        bindings.push_back ({m_input.quitAction, oxr_str2path (m_instance, HANDL_IN"/menu/click"   )});
-
-        oxr_bind_interaction (m_instance, "/interaction_profiles/oculus/touch_controller", bindings);
-    }
-
-    /* attach actions bound to the device. */
-    oxr_attach_actionsets (m_session, m_input.actionSet);
-
-    /* create ActionSpace */
-    m_input.handSpace[Side::LEFT ] = oxr_create_action_space (m_session, m_input.poseAction, subPath[Side::LEFT ]);
-    m_input.handSpace[Side::RIGHT] = oxr_create_action_space (m_session, m_input.poseAction, subPath[Side::RIGHT]);
-    m_input.aimSpace [Side::LEFT ] = oxr_create_action_space (m_session, m_input.aimAction,  subPath[Side::LEFT ]);
-    m_input.aimSpace [Side::RIGHT] = oxr_create_action_space (m_session, m_input.aimAction,  subPath[Side::RIGHT]);
+    oxr_create_action_table (m_instance, m_session, "/interaction_profiles/oculus/touch_controller",
+                             s_action_desc, ACT_NUM, m_actions);
 }
 
 
-void 
+/*
+ *  all the values are read in one loop into m_input.
+ *  the handlers below react only to the inputs changed since the last poll.
+ */
+void
 AppEngine::PollActions()
 {
-    oxr_sync_actions (m_session, m_input.actionSet);
-
-    m_input.handActive = {XR_FALSE, XR_FALSE};
+    m_input.changed = oxr_poll_action_table (m_session, m_actions, &m_input);
 
-    // Get Pose and Squeeze action state and start Haptic vibrate when hand is 90% squeezed.
+    /* start Haptic vibrate when hand is 90% squeezed. */
     for (auto hand : {Side::LEFT, Side::RIGHT})
     {
-        XrPath subPath = m_input.handSubactionPath[hand];
-
-        /* Squeeze */
-        {
-            XrActionStateFloat stat = oxr_get_action_state_float (m_session, m_input.squzAction, subPath);
-            if (stat.isActive == XR_TRUE)
-            {
-                m_input.squeezeVal[hand] = stat.currentState;
-                if (stat.currentState > 0.9f)
-                {
-                    oxr_apply_haptic_feedback_vibrate (m_session, m_input.vibrAction, subPath,
-                        XR_MIN_HAPTIC_DURATION, XR_FREQUENCY_UNSPECIFIED, 0.5f);
-                }
-            }
-        }
-        /* Trigger */
-        {
-            XrActionStateFloat stat = oxr_get_action_state_float (m_session, m_input.trigAction, subPath);
-            if (stat.isActive == XR_TRUE)
-                m_input.triggerVal[hand] = stat.currentState;
-        }
-        /* ThumbStick */
-        {
-            XrActionStateVector2f stat = oxr_get_action_state_vector2 (m_session, m_input.stikAction, subPath);
-            if (stat.isActive == XR_TRUE)
-                m_input.stickVal[hand] = stat.currentState;
-        }
-        /* Button-S (ThumbStick Click) */
+        if ((m_input.changed & OXR_ACTION_BIT (ACT_SQUEEZE, hand)) && m_input.squeezeVal[hand] > 0.9f)
         {
-            XrActionStateBoolean stat = oxr_get_action_state_boolean (m_session, m_input.clisAction, subPath);
-            if (stat.isActive == XR_TRUE)
-                m_input.clickS[hand] = stat.currentState;
-        }
-        /* Pose */
-        {
-            XrActionStatePose stat = oxr_get_action_state_pose (m_session, m_input.poseAction, subPath);
-            m_input.handActive[hand] = stat.isActive;
+            oxr_apply_haptic_feedback_vibrate (m_session, m_actions.action[ACT_HAPTIC], m_actions.handPath[hand],
+                XR_MIN_HAPTIC_DURATION, XR_FREQUENCY_UNSPECIFIED, 0.5f);
         }
     }
 
-    /* Button-A */
-    {
-        XrActionStateBoolean stat = oxr_get_action_state_boolean (m_session, m_input.cliaAction, 0);
-        if (stat.isActive == XR_TRUE)
-            m_input.clickA = stat.currentState;
-    }
-    /* Button-B */
-    {
-        XrActionStateBoolean stat = oxr_get_action_state_boolean (m_session, m_input.clibAction, 0);
-        if (stat.isActive == XR_TRUE)
-            m_input.clickB = stat.currentState;
-    }
-    /* Button-X */
-    {
-        XrActionStateBoolean stat = oxr_get_action_state_boolean (m_session, m_input.clixAction, 0);
-        if (stat.isActive == XR_TRUE)
-            m_input.clickX = stat.currentState;
-    }
-    /* Button-Y */
-    {
-        XrActionStateBoolean stat = oxr_get_action_state_boolean (m_session, m_input.cliyAction, 0);
-        if (stat.isActive == XR_TRUE)
-            m_input.clickY = stat.currentState;
-    }
     /* Button-Menu */
+    if ((m_input.changed & OXR_ACTION_BIT (ACT_MENU_QUIT, 0)) && m_input.clickMenu)
     {
-        XrActionStateBoolean stat = oxr_get_action_state_boolean (m_session, m_input.quitAction, 0);
-        if ((stat.isActive             == XR_TRUE) &&
-            (stat.changedSinceLastSync == XR_TRUE) &&
-            (stat.currentState         == XR_TRUE))
-        {
-            xrRequestExitSession (m_session);
-            LOGI ("----------- xrRequestExitSession() --------");
-        }
+        xrRequestExitSession (m_session);
+        LOGI ("----------- xrRequestExitSession() --------");
     }
 }
 
@@ -282,7 +167,14 @@ AppEngine::RenderFrame()
     std::vector<XrCompositionLayerBaseHeader*> all_layers;
 
     XrTime dpy_time, elapsed_us;
-    oxr_begin_frame (m_session, &dpy_time);
+    int should_render = oxr_begin_frame (m_session, &dpy_time);
+
+    /* The runtime will not show this frame: skip swapchain acquire and rendering */
+    if (!should_render)
+    {
+        oxr_end_frame (m_session, dpy_time, all_layers);
+        return;
+    }
 
     static XrTime init_time = -1;
     if (init_time < 0)
@@ -328,27 +220,25 @@ AppEngine::RenderLayer(XrTime dpy_time,
 
     layerViews.resize (viewCount);
 
-    /* Acquire Stage Location, View Location (rerative to the View Location) */
-    XrSpaceLocation stageLoc {XR_TYPE_SPACE_LOCATION};
-    XrSpaceLocation viewLoc  {XR_TYPE_SPACE_LOCATION};
-    xrLocateSpace (m_stageSpace, m_appSpace, dpy_time, &stageLoc);
-    xrLocateSpace (m_viewSpace,  m_appSpace, dpy_time, &viewLoc);
+    /* Acquire all the registered Space Locations (rerative to the App Space) at once */
+    m_spaces.locate (dpy_time);
 
+    XrSpaceLocation stageLoc = m_spaces.get (LOC_STAGE);
+    XrSpaceLocation viewLoc  = m_spaces.get (LOC_VIEW);
 
-    /* Acquire Hand-Space Location (rerative to the View Location) */
+
+    /* Hand-Space Locations */
     std::array<XrSpaceLocation, 2> handLoc;
     std::array<XrSpaceLocation, 2> aimLoc;
     for (uint32_t i = 0; i < 2; i ++)
     {
-        handLoc[i] = {XR_TYPE_SPACE_LOCATION};
-        xrLocateSpace (m_input.handSpace[i], m_appSpace, dpy_time, &handLoc[i]);
-
-        aimLoc[i]  = {XR_TYPE_SPACE_LOCATION};
-        xrLocateSpace (m_input.aimSpace[i],  m_appSpace, dpy_time, &aimLoc[i]);
+        handLoc[i] = m_spaces.get (LOC_GRIP + i);
+        aimLoc[i]  = m_spaces.get (LOC_AIM  + i);
     }
 
-    oxr_locate_handjoints (m_instance, m_handTracker[0], m_appSpace, dpy_time, m_handJointLoc[0]);
-    oxr_locate_handjoints (m_instance, m_handTracker[1], m_appSpace, dpy_time, m_handJointLoc[1]);
+    oxr_locate_handjoints (m_instance, m_handTracker[0], m_appSpace, dpy_time, m_handJoints.back (0));
+    oxr_locate_handjoints (m_instance, m_handTracker[1], m_appSpace, dpy_time, m_handJoints.back (1));
+    m_handJoints.publish ();
 
     /* Render each view */
     for (uint32_t i = 0; i < viewCount; i++) {
@@ -367,11 +257,12 @@ AppEngine::RenderLayer(XrTime dpy_time,
         sceneData.system_name   = m_system_name;
         sceneData.elapsed_us    = elapsed_us;
         sceneData.viewID        = i;
+        sceneData.cpu_budget_exceeded = oxr_is_cpu_budget_exceeded ();
         sceneData.views         = views;
         sceneData.handLoc       = handLoc;
         sceneData.aimLoc        = aimLoc;
         sceneData.inputState    = m_input;
-        sceneData.handJointLoc  = m_handJointLoc;
+        sceneData.handJoints    = &m_handJoints;
         render_gles_scene (layerViews[i], rtarget, viewLoc.pose, stageLoc.pose, sceneData);
 
         oxr_release_viewsurface (m_viewSurface[i]);
@@ -6,49 +6,26 @@
 #include "util_matrix.h"
 #include "util_debugstr.h"
 #include "util_render_target.h"
+#include "util_render_line.h"
 #include "teapot.h"
 #include "render_scene.h"
 #include "render_stage.h"
 #include "render_texplate.h"
 #include "render_imgui.h"
 #include "assertgl.h"
+#include "util_gl_state.h"
 
 
-static shader_obj_t     s_sobj;
 static render_target_t  s_rtarget;
 
 #define UI_WIN_W 300
 #define UI_WIN_H 740
 
 
-static char s_strVS[] = "                                   \n\
-                                                            \n\
-attribute vec4  a_Vertex;                                   \n\
-attribute vec4  a_Color;                                    \n\
-varying   vec4  v_color;                                    \n\
-uniform   mat4  u_PMVMatrix;                                \n\
-                                                            \n\
-void main(void)                                             \n\
-{                                                           \n\
-    gl_Position = u_PMVMatrix * a_Vertex;                   \n\
-    v_color     = a_Color;                                  \n\
-}                                                           ";
-
-static char s_strFS[] = "                                   \n\
-precision mediump float;                                    \n\
-varying   vec4  v_color;                                    \n\
-                                                            \n\
-void main(void)                                             \n\
-{                                                           \n\
-    gl_FragColor = v_color;                                 \n\
-}                                                           ";
-
-
-
 int
 init_gles_scene ()
 {
-    generate_shader (&s_sobj, s_strVS, s_strFS);
+    init_line_renderer ();
     init_teapot ();
     init_stage ();
     init_texplate ();
@@ -61,33 +38,6 @@ init_gles_scene ()
 }
 
 
-int
-draw_line (float *mtxPV, float *p0, float *p1, float *color)
-{
-    GLfloat floor_vtx[6];
-    for (int i = 0; i < 3; i ++)
-    {
-        floor_vtx[0 + i] = p0[i];
-        floor_vtx[3 + i] = p1[i];
-    }
-
-    shader_obj_t *sobj = &s_sobj;
-    glUseProgram (sobj->program);
-
-    glEnableVertexAttribArray (sobj->loc_vtx);
-    glVertexAttribPointer (sobj->loc_vtx, 3, GL_FLOAT, GL_FALSE, 0, floor_vtx);
-
-    glDisableVertexAttribArray (sobj->loc_clr);
-    glVertexAttrib4fv (sobj->loc_clr, color);
-
-    glUniformMatrix4fv (sobj->loc_mtx,  1, GL_FALSE, mtxPV);
-
-    glEnable (GL_DEPTH_TEST);
-    glDrawArrays (GL_LINES, 0, 2);
-
-    return 0;
-}
-
 int
 draw_stage (float *matStage)
 {
@@ -103,17 +53,17 @@ draw_stage (float *matStage)
         float *col = (x == 0) ? col_b : col_gray;
         float p0[3]  = {1.0f * x, 0.0f, -10.0f};
         float p1[3]  = {1.0f * x, 0.0f,  10.0f};
-        draw_line (matStage, p0, p1, col);
+        line_batch_add (matStage, p0, p1, col);
     }
     for (int z = -10; z <= 10; z ++)
     {
         float *col = (z == 0) ? col_r : col_gray;
         float p0[3]  = {-10.0f, 0.0f, 1.0f * z};
         float p1[3]  = { 10.0f, 0.0f, 1.0f * z};
-        draw_line (matStage, p0, p1, col);
+        line_batch_add (matStage, p0, p1, col);
     }
 
-    draw_line (matStage, p0, py, col_g);
+    line_batch_add (matStage, p0, py, col_g);
     GLASSERT();
 
     return 0;
@@ -125,34 +75,38 @@ draw_uiplane (float *matPVMbase,
               XrCompositionLayerProjectionView &layerView,
               scene_data_t &sceneData)
 {
-    /* save current FBO */
-    render_target_t rtarget0;
-    get_render_target (&rtarget0);
+    /* CPU budget exceeded: skip the UI refresh, and show the UI texture of the previous frame */
+    if (!sceneData.cpu_budget_exceeded)
+    {
+        /* save current FBO */
+        render_target_t rtarget0;
+        get_render_target (&rtarget0);
 
-    /* render to UIPlane-FBO */
-    set_render_target (&s_rtarget);
-    glClearColor (0.0f, 0.0f, 0.0f, 0.0f);
-    glClear (GL_COLOR_BUFFER_BIT);
+        /* render to UIPlane-FBO */
+        set_render_target (&s_rtarget);
+        glClearColor (0.0f, 0.0f, 0.0f, 0.0f);
+        glClear (GL_COLOR_BUFFER_BIT);
 
-    {
-        static uint32_t prev_us = 0;
-        if (sceneData.viewID == 0)
         {
-            sceneData.interval_ms = (sceneData.elapsed_us - prev_us) / 1000.0f;
-            prev_us = sceneData.elapsed_us;
+            static uint32_t prev_us = 0;
+            if (sceneData.viewID == 0)
+            {
+                sceneData.interval_ms = (sceneData.elapsed_us - prev_us) / 1000.0f;
+                prev_us = sceneData.elapsed_us;
+            }
+
+            sceneData.gl_version = glGetString (GL_VERSION);
+            sceneData.gl_vendor  = glGetString (GL_VENDOR);
+            sceneData.gl_render  = glGetString (GL_RENDERER);
+            sceneData.viewport   = layerView.subImage.imageRect;
+            invoke_imgui (&sceneData);
         }
 
-        sceneData.gl_version = glGetString (GL_VERSION);
-        sceneData.gl_vendor  = glGetString (GL_VENDOR);
-        sceneData.gl_render  = glGetString (GL_RENDERER);
-        sceneData.viewport   = layerView.subImage.imageRect;
-        invoke_imgui (&sceneData);
+        /* restore FBO */
+        set_render_target (&rtarget0);
     }
 
-    /* restore FBO */
-    set_render_target (&rtarget0);
-
-    glEnable (GL_DEPTH_TEST);
+    glstate_enable (GL_DEPTH_TEST);
 
     {
         float matPVM[16], matT[16];
@@ -191,14 +145,13 @@ render_gles_scene (XrCompositionLayerProjectionView &layerView,
 
     glClearColor (0.1f, 0.1f, 0.1f, 0.0f);
     glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glEnable (GL_DEPTH_TEST);
+    glstate_enable (GL_DEPTH_TEST);
 
     /* ------------------------------------------- *
      *  Matrix Setup
      *    (matPV)  = (proj) x (view)
-     *    (matPVM) = (proj) x (view) x (model)
      * ------------------------------------------- */
-    XrMatrix4x4f matP, matV, matC, matM, matPV, matPVM;
+    XrMatrix4x4f matP, matV, matC, matM, matPV;
 
     /* Projection Matrix */
     XrMatrix4x4f_CreateProjectionFov (&matP, GRAPHICS_OPENGL_ES, layerView.fov, 0.05f, 100.0f);
@@ -213,15 +166,13 @@ render_gles_scene (XrCompositionLayerProjectionView &layerView,
     XrMatrix4x4f_CreateTranslationRotationScale (&matM, &stagePose.position, &stagePose.orientation, &scale);
 
     XrMatrix4x4f_Multiply (&matPV, &matP, &matV);
-    XrMatrix4x4f_Multiply (&matPVM, &matPV, &matM);
 
 
     /* ------------------------------------------- *
      *  Render
      * ------------------------------------------- */
-    float *matStage = reinterpret_cast<float*>(&matPVM);
-
-    draw_stage (matStage);
+    draw_stage ((float *)&matM);
+    line_batch_flush ((float *)&matPV);
 
     /* Axis of global origin */
     {
@@ -270,18 +221,23 @@ render_gles_scene (XrCompositionLayerProjectionView &layerView,
     }
 #endif
 
-    for (XrHandJointLocationsEXT *loc : sceneData.handJointLoc)
+    /* joints of both hands in one instanced draw per shape */
     {
-        for (uint32_t i = 0; i < loc->jointCount; i ++)
+        float matJoint[HAND_NUM * HAND_JOINT_NUM][16];
+        int   num_joint = 0;
+
+        for (int hand = 0; hand < HAND_NUM; hand ++)
         {
-            XrVector3f    &pos  = loc->jointLocations[i].pose.position;
-            XrQuaternionf &qtn  = loc->jointLocations[i].pose.orientation;
-            float         rad   = loc->jointLocations[i].radius;
-            XrVector3f    scale = {rad, rad, rad};
-            XrMatrix4x4f_CreateTranslationRotationScale (&matM, &pos, &qtn, &scale);
-            draw_axis ((float *)&matP, (float *)&matV, (float *)&matM);
-            GLASSERT();
+            const hand_joint_set_t &joints = sceneData.handJoints->front (hand);
+            if (!joints.active)
+                continue;
+
+            matrix_trs_batch_soa (matJoint[num_joint], joints.qtn, joints.pos, joints.radius, HAND_JOINT_NUM);
+            num_joint += HAND_JOINT_NUM;
         }
+
+        draw_axes ((float *)&matP, (float *)&matV, (float *)matJoint, num_joint);
+        GLASSERT();
     }
 
 
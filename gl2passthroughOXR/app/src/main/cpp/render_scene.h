@@ -17,10 +17,11 @@ typedef struct scene_data_t
     XrRect2Di           viewport;
     std::vector<XrView> views;
     uint32_t            viewID;
+    bool                cpu_budget_exceeded;  /* drop optional passes (UI refresh) */
     std::array<XrSpaceLocation, 2> handLoc;
     std::array<XrSpaceLocation, 2> aimLoc;
 
-    std::array<XrHandJointLocationsEXT *, 2> handJointLoc;
+    const HandJointStore *handJoints;
 
     struct InputState   inputState;
 } scene_data_t;
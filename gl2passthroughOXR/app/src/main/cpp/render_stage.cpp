@@ -1,12 +1,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 
 #include <GLES2/gl2.h>
+#include <GLES3/gl3.h>
 #include "util_egl.h"
 #include "assertgl.h"
+#include "util_gl_state.h"
 #include "util_shader.h"
 #include "util_matrix.h"
+#include "util_mesh.h"
 #include "shapes.h"
 #include "assertgl.h"
 
@@ -23,12 +27,38 @@ static shape_obj_t  s_cylinder;
 static shape_obj_t  s_cone;
 static shape_obj_t  s_sphere;
 
+/*
+ *  instanced axis renderer.
+ *    each axis is 3 cylinders, 3 cones and 1 sphere. The shapes of all the
+ *    axes are drawn with one glDrawElementsInstanced() per shape.
+ */
+#define AXIS_MAX_NUM        64      /* axes per glDrawElementsInstanced() */
+#define AXIS_SHAPE_NUM      7       /* cylinder x3, cone x3, sphere */
 
+typedef struct axis_instance_t
+{
+    float matMV[16];
+    float matMVIT[9];
+    float color[4];
+} axis_instance_t;
+
+static shader_obj_t     s_sobj_inst;
+static GLint            s_loc_inst_mtx_p;
+static GLint            s_loc_inst_lightpos;
+static GLint            s_loc_inst_mv;
+static GLint            s_loc_inst_mvit;
+static GLint            s_loc_inst_clr;
+static GLuint           s_vbo_inst;
+static float            s_matAxisShape[AXIS_SHAPE_NUM][16];
+static float            s_colAxisShape[AXIS_SHAPE_NUM][4];
+static axis_instance_t  s_axis_inst[AXIS_SHAPE_NUM * AXIS_MAX_NUM];
+
+
+/* the shapes are stored in MESH_FMT_COMPACT: a_Normal is octahedral */
 static char s_strVS[] = "                                   \n\
                                                             \n\
 attribute vec4  a_Vertex;                                   \n\
-attribute vec3  a_Normal;                                   \n\
-attribute vec2  a_TexCoord;                                 \n\
+attribute vec2  a_Normal;                                   \n\
 uniform   mat4  u_PMVMatrix;                                \n\
 uniform   mat4  u_MVMatrix;                                 \n\
 uniform   mat3  u_ModelViewIT;                              \n\
@@ -43,12 +73,12 @@ void DirectionalLight (vec3 normal, vec3 eyePos)            \n\
     float dVP      = max(dot(normal, lightDir), 0.0);       \n\
                                                             \n\
     v_diffuse += dVP * LightCol;                            \n\
-}                                                           \n\
-                                                            \n\
+}                                                           \n"
+MESH_GLSL_OCT_DECODE "                                      \n\
 void main(void)                                             \n\
 {                                                           \n\
     gl_Position = u_PMVMatrix * a_Vertex;                   \n\
-    vec3 normal = normalize(u_ModelViewIT * a_Normal);      \n\
+    vec3 normal = normalize(u_ModelViewIT * oct_decode (a_Normal));\n\
     vec3 eyePos = vec3(u_MVMatrix * a_Vertex);              \n\
                                                             \n\
     v_diffuse  = vec3(0.5);                                 \n\
@@ -71,26 +101,113 @@ void main(void)                                             \n\
     gl_FragColor = vec4(color, u_alpha);                    \n\
 }                                                           ";
 
+/* the same lighting as s_strVS, with the matrices and color per instance */
+static char s_strVS_inst[] = "#version 300 es                     \n\
+                                                            \n\
+in        vec4  a_Vertex;                                   \n\
+in        vec2  a_Normal;                                   \n\
+in        mat4  a_MVMatrix;                                 \n\
+in        mat3  a_ModelViewIT;                              \n\
+in        vec4  a_Color;                                    \n\
+uniform   mat4  u_PMatrix;                                  \n\
+uniform   vec3  u_LightPos;                                 \n\
+out       vec4  v_color;                                    \n\
+const     vec3  LightCol = vec3(1.0, 1.0, 1.0);             \n"
+MESH_GLSL_OCT_DECODE "                                      \n\
+void main(void)                                             \n\
+{                                                           \n\
+    vec4 eyePos = a_MVMatrix * a_Vertex;                    \n\
+    gl_Position = u_PMatrix * eyePos;                       \n\
+    vec3 normal = normalize(a_ModelViewIT * oct_decode (a_Normal));\n\
+                                                            \n\
+    vec3  lightDir = normalize (u_LightPos);                \n\
+    float dVP      = max(dot(normal, lightDir), 0.0);       \n\
+    vec3  diffuse  = clamp(vec3(0.5) + dVP * LightCol, 0.0, 1.0);\n\
+                                                            \n\
+    v_color = vec4(a_Color.rgb * diffuse, a_Color.a);       \n\
+}                                                           ";
+
+static char s_strFS_inst[] = "#version 300 es                     \n\
+precision mediump float;                                    \n\
+                                                            \n\
+in      vec4    v_color;                                    \n\
+out     vec4    o_color;                                    \n\
+                                                            \n\
+void main(void)                                             \n\
+{                                                           \n\
+    o_color = v_color;                                      \n\
+}                                                           ";
+
 
+/*
+ *  local matrices of the 7 shapes of an axis.
+ *  the same transforms as draw_axis() used to pass to draw_cylinder/draw_cone/draw_sphere.
+ */
 static void
-compute_invmat3x3 (float *matMVI3x3, float *matMV)
+init_axis_shape_matrix ()
 {
-    float matMVI4x4[16];
-
-    matrix_copy (matMVI4x4, matMV);
-    matrix_invert   (matMVI4x4);
-    matrix_transpose(matMVI4x4);
-    matMVI3x3[0] = matMVI4x4[0];
-    matMVI3x3[1] = matMVI4x4[1];
-    matMVI3x3[2] = matMVI4x4[2];
-    matMVI3x3[3] = matMVI4x4[4];
-    matMVI3x3[4] = matMVI4x4[5];
-    matMVI3x3[5] = matMVI4x4[6];
-    matMVI3x3[6] = matMVI4x4[8];
-    matMVI3x3[7] = matMVI4x4[9];
-    matMVI3x3[8] = matMVI4x4[10];
+    float col_r[4] = {1.0f, 0.0f, 0.0f, 1.0f};
+    float col_g[4] = {0.0f, 1.0f, 0.0f, 1.0f};
+    float col_b[4] = {0.0f, 0.0f, 1.0f, 1.0f};
+    float col_w[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    float *col_axis[3] = {col_r, col_g, col_b};
+    float radius = 0.03f;
+    float length = 1.0f;
+    float cone_r = radius * 3;
+    float cone_l = 0.1f;
+
+    for (int i = 0; i < 3; i ++)
+    {
+        float matR[16], matTmp[16];
+
+        matrix_identity (matR);
+        if (i == 0) matrix_rotate (matR,  90.0f, 0.0f, 1.0f, 0.0f);  /* X axis */
+        if (i == 1) matrix_rotate (matR, -90.0f, 1.0f, 0.0f, 0.0f);  /* Y axis */
+
+        /* cylinder */
+        matrix_identity (matTmp);
+        matrix_scale    (matTmp, radius, radius, length * 0.5f);
+        matrix_translate (matTmp, 0, 0, 1.0f);
+        matrix_mult (s_matAxisShape[0 + i], matR, matTmp);
+
+        /* cone */
+        matrix_identity (matTmp);
+        matrix_translate (matTmp, 0, 0, 1 + cone_l);
+        matrix_scale    (matTmp, cone_r, cone_r, cone_l);
+        matrix_mult (s_matAxisShape[3 + i], matR, matTmp);
+
+        memcpy (s_colAxisShape[0 + i], col_axis[i], sizeof (float) * 4);
+        memcpy (s_colAxisShape[3 + i], col_axis[i], sizeof (float) * 4);
+    }
+
+    /* center sphere */
+    matrix_identity (s_matAxisShape[6]);
+    matrix_scale    (s_matAxisShape[6], 0.1f, 0.1f, 0.1f);
+    memcpy (s_colAxisShape[6], col_w, sizeof (float) * 4);
 }
 
+static int
+init_axis_instanced ()
+{
+    if (generate_shader (&s_sobj_inst, s_strVS_inst, s_strFS_inst) < 0)
+        return -1;
+
+    s_loc_inst_mtx_p    = glGetUniformLocation (s_sobj_inst.program, "u_PMatrix");
+    s_loc_inst_lightpos = glGetUniformLocation (s_sobj_inst.program, "u_LightPos");
+    s_loc_inst_mv       = glGetAttribLocation  (s_sobj_inst.program, "a_MVMatrix");
+    s_loc_inst_mvit     = glGetAttribLocation  (s_sobj_inst.program, "a_ModelViewIT");
+    s_loc_inst_clr      = glGetAttribLocation  (s_sobj_inst.program, "a_Color");
+
+    glGenBuffers (1, &s_vbo_inst);
+    glstate_bind_buffer (GL_ARRAY_BUFFER, s_vbo_inst);
+    glBufferData (GL_ARRAY_BUFFER, sizeof (s_axis_inst), NULL, GL_STREAM_DRAW);
+    glstate_bind_buffer (GL_ARRAY_BUFFER, 0);
+
+    init_axis_shape_matrix ();
+    GLASSERT();
+
+    return 0;
+}
 
 
 int
@@ -104,9 +221,16 @@ init_stage ()
     s_loc_alpha   = glGetUniformLocation(s_sobj.program, "u_alpha" );
     s_loc_lightpos= glGetUniformLocation(s_sobj.program, "u_LightPos" );
 
-    shape_create (SHAPE_CYLINDER, 20, 20, &s_cylinder);
-    shape_create (SHAPE_CONE,     20, 20, &s_cone);
-    shape_create (SHAPE_SPHERE,   20, 20, &s_sphere);
+    /* one interleaved VBO of half positions and octahedral normals: 12 bytes/vertex */
+    unsigned int attr = (1 << MESH_ATTR_VTX) | (1 << MESH_ATTR_NRM);
+    shape_create_ex (SHAPE_CYLINDER, 20, 20, attr, MESH_FMT_COMPACT, &s_cylinder);
+    shape_create_ex (SHAPE_CONE,     20, 20, attr, MESH_FMT_COMPACT, &s_cone);
+    shape_create_ex (SHAPE_SPHERE,   20, 20, attr, MESH_FMT_COMPACT, &s_sphere);
+
+    /* uploaded: the CPU copies are not needed any more */
+    shape_clear_cache ();
+
+    init_axis_instanced ();
     return 0;
 }
 
@@ -114,6 +238,11 @@ init_stage ()
 
 
 
+/*
+ *  each draw_xxx() sets all the state it depends on through the state cache
+ *  (util_gl_state.h), and leaves it as it is for the next draw.
+ *  The vertex arrays are the VAO of the shape (util_mesh.h).
+ */
 int
 draw_cylinder (float *matP, float *matV, float *matM, float radius, float length, float *color)
 {
@@ -129,17 +258,14 @@ draw_cylinder (float *matP, float *matV, float *matM, float radius, float length
     }
 
 
-    glEnable (GL_DEPTH_TEST);
-    glEnable (GL_CULL_FACE);
-    glFrontFace (GL_CW);
-
-    glUseProgram (s_sobj.program);
+    glstate_enable (GL_DEPTH_TEST);
+    glstate_enable (GL_CULL_FACE);
+    glstate_front_face (GL_CW);
 
-    glEnableVertexAttribArray (s_sobj.loc_vtx);
-    glEnableVertexAttribArray (s_sobj.loc_nrm);
+    glstate_use_program (s_sobj.program);
 
     matrix_mult (matVM, matV, matB);
-    compute_invmat3x3 (matVMI3x3, matVM);
+    matrix_normal3x3 (matVMI3x3, matVM);
     matrix_mult (matPVM, matP, matVM);
 
     glUniformMatrix4fv (s_loc_mtx_mv,   1, GL_FALSE, matVM );
@@ -150,24 +276,13 @@ draw_cylinder (float *matP, float *matV, float *matM, float radius, float length
     glUniform1f (s_loc_alpha, color[3]);
 
     if (color[3] < 1.0f)
-        glEnable (GL_BLEND);
-
-    glBindBuffer (GL_ARRAY_BUFFER, s_cylinder.vbo_vtx);
-    glVertexAttribPointer (s_sobj.loc_vtx, 3, GL_FLOAT, GL_FALSE, 0, 0);
+        glstate_enable (GL_BLEND);
+    else
+        glstate_disable (GL_BLEND);
 
-    glBindBuffer (GL_ARRAY_BUFFER, s_cylinder.vbo_nrm);
-    glVertexAttribPointer (s_sobj.loc_nrm, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    mesh_bind (&s_cylinder.mesh, s_sobj.program);
+    mesh_draw (&s_cylinder.mesh);
 
-    glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, s_cylinder.vbo_idx);
-    glDrawElements (GL_TRIANGLES, s_cylinder.num_faces * 3, GL_UNSIGNED_SHORT, 0);
-
-    glBindBuffer (GL_ARRAY_BUFFER, 0);
-    glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
-
-    glFrontFace (GL_CCW);
-    glDisable (GL_BLEND);
-    glDisable (GL_DEPTH_TEST);
-    glDisable (GL_CULL_FACE);
     GLASSERT();
 
     return 0;
@@ -190,17 +305,14 @@ draw_cone (float *matP, float *matV, float *matM, float radius, float length, fl
     }
 
 
-    glEnable (GL_DEPTH_TEST);
-    glDisable (GL_CULL_FACE);
-    glFrontFace (GL_CW);
+    glstate_enable (GL_DEPTH_TEST);
+    glstate_disable (GL_CULL_FACE);
+    glstate_front_face (GL_CW);
 
-    glUseProgram (s_sobj.program);
-
-    glEnableVertexAttribArray (s_sobj.loc_vtx);
-    glEnableVertexAttribArray (s_sobj.loc_nrm);
+    glstate_use_program (s_sobj.program);
 
     matrix_mult (matVM, matV, matB);
-    compute_invmat3x3 (matVMI3x3, matVM);
+    matrix_normal3x3 (matVMI3x3, matVM);
     matrix_mult (matPVM, matP, matVM);
 
     glUniformMatrix4fv (s_loc_mtx_mv,   1, GL_FALSE, matVM );
@@ -211,24 +323,13 @@ draw_cone (float *matP, float *matV, float *matM, float radius, float length, fl
     glUniform1f (s_loc_alpha, color[3]);
 
     if (color[3] < 1.0f)
-        glEnable (GL_BLEND);
-
-    glBindBuffer (GL_ARRAY_BUFFER, s_cone.vbo_vtx);
-    glVertexAttribPointer (s_sobj.loc_vtx, 3, GL_FLOAT, GL_FALSE, 0, 0);
+        glstate_enable (GL_BLEND);
+    else
+        glstate_disable (GL_BLEND);
 
-    glBindBuffer (GL_ARRAY_BUFFER, s_cone.vbo_nrm);
-    glVertexAttribPointer (s_sobj.loc_nrm, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    mesh_bind (&s_cone.mesh, s_sobj.program);
+    mesh_draw (&s_cone.mesh);
 
-    glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, s_cone.vbo_idx);
-    glDrawElements (GL_TRIANGLES, s_cone.num_faces * 3, GL_UNSIGNED_SHORT, 0);
-
-    glBindBuffer (GL_ARRAY_BUFFER, 0);
-    glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
-
-    glFrontFace (GL_CCW);
-    glDisable (GL_BLEND);
-    glDisable (GL_DEPTH_TEST);
-    glDisable (GL_CULL_FACE);
     GLASSERT();
 
     return 0;
@@ -249,17 +350,14 @@ draw_sphere (float *matP, float *matV, float *matM, float radius, float *color)
     }
 
 
-    glEnable (GL_DEPTH_TEST);
-    glEnable (GL_CULL_FACE);
-    glFrontFace (GL_CW);
-
-    glUseProgram (s_sobj.program);
+    glstate_enable (GL_DEPTH_TEST);
+    glstate_enable (GL_CULL_FACE);
+    glstate_front_face (GL_CW);
 
-    glEnableVertexAttribArray (s_sobj.loc_vtx);
-    glEnableVertexAttribArray (s_sobj.loc_nrm);
+    glstate_use_program (s_sobj.program);
 
     matrix_mult (matVM, matV, matB);
-    compute_invmat3x3 (matVMI3x3, matVM);
+    matrix_normal3x3 (matVMI3x3, matVM);
     matrix_mult (matPVM, matP, matVM);
 
     glUniformMatrix4fv (s_loc_mtx_mv,   1, GL_FALSE, matVM );
@@ -270,74 +368,160 @@ draw_sphere (float *matP, float *matV, float *matM, float radius, float *color)
     glUniform1f (s_loc_alpha, color[3]);
 
     if (color[3] < 1.0f)
-        glEnable (GL_BLEND);
+        glstate_enable (GL_BLEND);
+    else
+        glstate_disable (GL_BLEND);
 
-    glBindBuffer (GL_ARRAY_BUFFER, s_sphere.vbo_vtx);
-    glVertexAttribPointer (s_sobj.loc_vtx, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    mesh_bind (&s_sphere.mesh, s_sobj.program);
+    mesh_draw (&s_sphere.mesh);
 
-    glBindBuffer (GL_ARRAY_BUFFER, s_sphere.vbo_nrm);
-    glVertexAttribPointer (s_sobj.loc_nrm, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    GLASSERT();
 
-    glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, s_sphere.vbo_idx);
-    glDrawElements (GL_TRIANGLES, s_sphere.num_faces * 3, GL_UNSIGNED_SHORT, 0);
+    return 0;
+}
 
-    glBindBuffer (GL_ARRAY_BUFFER, 0);
-    glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
 
-    glFrontFace (GL_CCW);
-    glDisable (GL_BLEND);
-    glDisable (GL_DEPTH_TEST);
-    glDisable (GL_CULL_FACE);
-    GLASSERT();
+/*
+ *  set the per-instance attributes to the (first)-th instance in s_vbo_inst.
+ *    mat4 and mat3 attributes take 4 and 3 consecutive locations.
+ */
+static void
+set_axis_instance_attrib (int first)
+{
+    GLsizei stride = sizeof (axis_instance_t);
+    char   *base   = (char *)NULL + first * stride;
 
-    return 0;
+    for (int i = 0; i < 4; i ++)
+    {
+        glVertexAttribPointer (s_loc_inst_mv + i, 4, GL_FLOAT, GL_FALSE, stride,
+                               base + offsetof (axis_instance_t, matMV) + sizeof (float) * 4 * i);
+    }
+    for (int i = 0; i < 3; i ++)
+    {
+        glVertexAttribPointer (s_loc_inst_mvit + i, 3, GL_FLOAT, GL_FALSE, stride,
+                               base + offsetof (axis_instance_t, matMVIT) + sizeof (float) * 3 * i);
+    }
+    glVertexAttribPointer (s_loc_inst_clr, 4, GL_FLOAT, GL_FALSE, stride,
+                           base + offsetof (axis_instance_t, color));
+}
+
+/* the per-instance arrays of the VAO of a shape: set once, when mesh_bind() creates it */
+static void
+enable_axis_instance_attrib ()
+{
+    for (int i = 0; i < 4; i ++)
+    {
+        glstate_enable_vertex_attrib_array (s_loc_inst_mv + i);
+        glVertexAttribDivisor (s_loc_inst_mv + i, 1);
+    }
+    for (int i = 0; i < 3; i ++)
+    {
+        glstate_enable_vertex_attrib_array (s_loc_inst_mvit + i);
+        glVertexAttribDivisor (s_loc_inst_mvit + i, 1);
+    }
+    glstate_enable_vertex_attrib_array (s_loc_inst_clr);
+    glVertexAttribDivisor (s_loc_inst_clr, 1);
+}
+
+static void
+draw_axis_shape_instanced (shape_obj_t *shape, int first, int num)
+{
+    if (mesh_bind (&shape->mesh, s_sobj_inst.program) > 0)
+        enable_axis_instance_attrib ();
+
+    glstate_bind_buffer (GL_ARRAY_BUFFER, s_vbo_inst);
+    set_axis_instance_attrib (first);
+
+    mesh_draw_instanced (&shape->mesh, num);
 }
 
 
+/*
+ *  draw (num) axes. (matM) is an array of (num) model matrices.
+ *    3 draw calls (cylinders, cones, spheres) per AXIS_MAX_NUM axes.
+ */
 int
-draw_axis (float *matP, float *matV, float *matM)
+draw_axes (float *matP, float *matV, float *matM, int num)
 {
-    float col_r[4] = {1.0f, 0.0f, 0.0f, 1.0f};
-    float col_g[4] = {0.0f, 1.0f, 0.0f, 1.0f};
-    float col_b[4] = {0.0f, 0.0f, 1.0f, 1.0f};
-    float col_w[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    glstate_enable (GL_DEPTH_TEST);
+    glstate_disable (GL_BLEND);
+    glstate_front_face (GL_CW);
 
-    float matVM[16], matPVM[16];
-    matrix_mult (matVM,  matV, matM);
-    matrix_mult (matPVM, matP, matVM);
+    glstate_use_program (s_sobj_inst.program);
+    glUniformMatrix4fv (s_loc_inst_mtx_p, 1, GL_FALSE, matP);
+    glUniform3f (s_loc_inst_lightpos, 1.0f, 1.0f, 1.0f);
 
-    /* axis arrow */
+    for (int top = 0; top < num; top += AXIS_MAX_NUM)
     {
-        float radius = 0.03f;
-        float length = 1.0f;
-        float matR[16];
+        int   n = (num - top < AXIS_MAX_NUM) ? (num - top) : AXIS_MAX_NUM;
+        float matVM[AXIS_MAX_NUM][16];
 
-        /* X axis */
-        matrix_identity (matR);
-        matrix_rotate (matR,  90.0f, 0.0f, 1.0f, 0.0f);
-        matrix_mult (matR, matM, matR);
-        draw_cylinder (matP, matV, matR, radius, length, col_r);
-        draw_cone (matP, matV, matR, radius*3, 0.1, col_r);
+        matrix_mult_batch (matVM[0], matV, &matM[16 * top], n);
 
-        /* Y axis */
-        matrix_identity (matR);
-        matrix_rotate (matR, -90.0f, 1.0f, 0.0f, 0.0f);
-        matrix_mult (matR, matM, matR);
-        draw_cylinder (matP, matV, matR, radius, length, col_g);
-        draw_cone (matP, matV, matR, radius*3, 0.1, col_g);
+        /* s_axis_inst = [cylinder x 3n][cone x 3n][sphere x n] */
+        for (int j = 0; j < AXIS_SHAPE_NUM; j ++)
+        {
+            int base = (j < 3) ? j : (j < 6) ? (3 * n + j - 3) : (6 * n);
+            int step = (j < 6) ? 3 : 1;
 
-        /* Z axis */
-        matrix_identity (matR);
-        matrix_mult (matR, matM, matR);
-        draw_cylinder (matP, matV, matR, radius, length, col_b);
-        draw_cone (matP, matV, matR, radius*3, 0.1, col_b);
+            for (int i = 0; i < n; i ++)
+            {
+                axis_instance_t *inst = &s_axis_inst[base + step * i];
+
+                matrix_mult (inst->matMV, matVM[i], s_matAxisShape[j]);
+                matrix_normal3x3 (inst->matMVIT, inst->matMV);
+                memcpy (inst->color, s_colAxisShape[j], sizeof (inst->color));
+            }
+        }
+
+        glstate_bind_buffer (GL_ARRAY_BUFFER, s_vbo_inst);
+        glBufferData (GL_ARRAY_BUFFER, sizeof (s_axis_inst), NULL, GL_STREAM_DRAW);   /* orphan */
+        glBufferSubData (GL_ARRAY_BUFFER, 0, sizeof (axis_instance_t) * AXIS_SHAPE_NUM * n, s_axis_inst);
+
+        glstate_enable (GL_CULL_FACE);
+        draw_axis_shape_instanced (&s_cylinder, 0,     3 * n);
+
+        glstate_disable (GL_CULL_FACE);
+        draw_axis_shape_instanced (&s_cone,     3 * n, 3 * n);
+
+        glstate_enable (GL_CULL_FACE);
+        draw_axis_shape_instanced (&s_sphere,   6 * n, n);
     }
 
-    /* center sphere */
+    GLASSERT();
+
+    return 0;
+}
+
+
+/*
+ *  draw (num) axes at the poses scaled by the radii.
+ *    (pose) and (radius) are strided as matrix_trs_batch(),
+ *    e.g. &XrHandJointLocationEXT::pose and ::radius.
+ */
+int
+draw_axes_pose (float *matP, float *matV, const void *pose, int pose_stride,
+                const float *radius, int radius_stride, int num)
+{
+    const char *ppose = (const char *)pose;
+    const char *prad  = (const char *)radius;
+
+    for (int top = 0; top < num; top += AXIS_MAX_NUM)
     {
-        float radius = 0.1f;
-        draw_sphere (matP, matV, matM, radius, col_w);
+        int   n = (num - top < AXIS_MAX_NUM) ? (num - top) : AXIS_MAX_NUM;
+        float matM[AXIS_MAX_NUM][16];
+
+        matrix_trs_batch (matM[0], ppose + pose_stride * top, pose_stride,
+                          radius ? (const float *)(prad + radius_stride * top) : NULL, radius_stride, n);
+        draw_axes (matP, matV, matM[0], n);
     }
 
     return 0;
 }
+
+
+int
+draw_axis (float *matP, float *matV, float *matM)
+{
+    return draw_axes (matP, matV, matM, 1);
+}
@@ -13,39 +13,47 @@ const int RIGHT = 1;
 const int COUNT = 2;
 }
 
-struct InputState {
-    XrActionSet actionSet  {XR_NULL_HANDLE};
-    XrAction    poseAction {XR_NULL_HANDLE};
-    XrAction    aimAction  {XR_NULL_HANDLE};
-
-    XrAction    squzAction {XR_NULL_HANDLE};
-    XrAction    trigAction {XR_NULL_HANDLE};
-    XrAction    stikAction {XR_NULL_HANDLE};
-
-    XrAction    clisAction {XR_NULL_HANDLE};
-    XrAction    cliaAction {XR_NULL_HANDLE};
-    XrAction    clibAction {XR_NULL_HANDLE};
-    XrAction    clixAction {XR_NULL_HANDLE};
-    XrAction    cliyAction {XR_NULL_HANDLE};
-
-    XrAction    vibrAction {XR_NULL_HANDLE};
-    XrAction    quitAction {XR_NULL_HANDLE};
-
-    std::array<XrPath,   Side::COUNT> handSubactionPath;
+/* actions of AppEngine::m_actions, in the order of s_action_desc[] */
+enum AppAction {
+    ACT_GRIP_POSE = 0,
+    ACT_AIM_POSE,
+    ACT_SQUEEZE,
+    ACT_TRIGGER,
+    ACT_STICK,
+    ACT_HAPTIC,
+    ACT_CLICK_S,
+    ACT_CLICK_A,
+    ACT_CLICK_B,
+    ACT_CLICK_X,
+    ACT_CLICK_Y,
+    ACT_MENU_QUIT,
+    ACT_NUM
+};
 
-    std::array<XrSpace,  Side::COUNT> handSpace;
-    std::array<XrSpace,  Side::COUNT> aimSpace;
+/* spaces of AppEngine::m_spaces, in the order of registration */
+enum LocatedSpace {
+    LOC_STAGE = 0,
+    LOC_VIEW,
+    LOC_GRIP,                       /* + Side::LEFT/RIGHT */
+    LOC_AIM   = LOC_GRIP + Side::COUNT,
+    LOC_NUM   = LOC_AIM  + Side::COUNT
+};
 
+/* input snapshot, written by oxr_poll_action_table() */
+struct InputState {
+    std::array<XrBool32,    Side::COUNT> handActive;
     std::array<float,       Side::COUNT> squeezeVal;
     std::array<float,       Side::COUNT> triggerVal;
     std::array<XrVector2f,  Side::COUNT> stickVal;
-    std::array<XrBool32,    Side::COUNT> handActive;
 
     std::array<bool,        Side::COUNT> clickS;
     bool    clickA;
     bool    clickB;
     bool    clickX;
     bool    clickY;
+    bool    clickMenu;
+
+    uint64_t changed;   /* OXR_ACTION_BIT() of the values changed at the last poll */
 };
 
 
@@ -70,11 +78,13 @@ private:
     XrSpace             m_appSpace;
     XrSpace             m_stageSpace;
     XrSpace             m_viewSpace;
+    SpaceLocator        m_spaces;       /* located relative to m_appSpace once a frame */
 
     XrSystemId          m_systemId;
     std::vector<viewsurface_t> m_viewSurface;
 
     InputState          m_input = {};
+    oxr_action_table_t  m_actions;
 
     std::string         m_runtime_name;
     std::string         m_system_name;
@@ -5,6 +5,7 @@
 #include "imgui.h"
 #include "imgui_impl_opengl3.h"
 #include "render_imgui.h"
+#include "util_gl_state.h"
 
 #define DISPLAY_SCALE_X 1
 #define DISPLAY_SCALE_Y 1
@@ -206,7 +207,14 @@ invoke_imgui (scene_data_t *scn_data)
     render_gui (scn_data);
 
     ImGui::Render();
+
+    /*
+     *  the ES2 backend draws from the bound VAO, and leaves the element
+     *  buffer and the attribute arrays of its own: forget them after.
+     */
+    glstate_bind_vertex_array (0);
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    glstate_invalidate ();
 
     return 0;
 }
@@ -6,12 +6,14 @@
 #include "util_matrix.h"
 #include "util_debugstr.h"
 #include "util_render_target.h"
+#include "util_render_line.h"
 #include "teapot.h"
 #include "render_scene.h"
 #include "render_stage.h"
 #include "render_texplate.h"
 #include "render_imgui.h"
 #include "assertgl.h"
+#include "util_gl_state.h"
 
 typedef struct fvec2d_t
 {
@@ -29,40 +31,15 @@ typedef struct uiplane_t
 } uiplane_t;
 
 static uiplane_t        s_uiplane[5];
-static shader_obj_t     s_sobj;
 
 #define UI_WIN_W 300
 #define UI_WIN_H 740
 
 
-static char s_strVS[] = "                                   \n\
-                                                            \n\
-attribute vec4  a_Vertex;                                   \n\
-attribute vec4  a_Color;                                    \n\
-varying   vec4  v_color;                                    \n\
-uniform   mat4  u_PMVMatrix;                                \n\
-                                                            \n\
-void main(void)                                             \n\
-{                                                           \n\
-    gl_Position = u_PMVMatrix * a_Vertex;                   \n\
-    v_color     = a_Color;                                  \n\
-}                                                           ";
-
-static char s_strFS[] = "                                   \n\
-precision mediump float;                                    \n\
-varying   vec4  v_color;                                    \n\
-                                                            \n\
-void main(void)                                             \n\
-{                                                           \n\
-    gl_FragColor = v_color;                                 \n\
-}                                                           ";
-
-
-
 int
 init_gles_scene ()
 {
-    generate_shader (&s_sobj, s_strVS, s_strFS);
+    init_line_renderer ();
     init_teapot ();
     init_stage ();
     init_texplate ();
@@ -91,33 +68,6 @@ init_gles_scene ()
 }
 
 
-int
-draw_line (float *mtxPV, float *p0, float *p1, float *color)
-{
-    GLfloat floor_vtx[6];
-    for (int i = 0; i < 3; i ++)
-    {
-        floor_vtx[0 + i] = p0[i];
-        floor_vtx[3 + i] = p1[i];
-    }
-
-    shader_obj_t *sobj = &s_sobj;
-    glUseProgram (sobj->program);
-
-    glEnableVertexAttribArray (sobj->loc_vtx);
-    glVertexAttribPointer (sobj->loc_vtx, 3, GL_FLOAT, GL_FALSE, 0, floor_vtx);
-
-    glDisableVertexAttribArray (sobj->loc_clr);
-    glVertexAttrib4fv (sobj->loc_clr, color);
-
-    glUniformMatrix4fv (sobj->loc_mtx,  1, GL_FALSE, mtxPV);
-
-    glEnable (GL_DEPTH_TEST);
-    glDrawArrays (GL_LINES, 0, 2);
-
-    return 0;
-}
-
 int
 draw_stage (float *matStage)
 {
@@ -133,17 +83,17 @@ draw_stage (float *matStage)
         float *col = (x == 0) ? col_b : col_gray;
         float p0[3]  = {1.0f * x, 0.0f, -10.0f};
         float p1[3]  = {1.0f * x, 0.0f,  10.0f};
-        draw_line (matStage, p0, p1, col);
+        line_batch_add (matStage, p0, p1, col);
     }
     for (int z = -10; z <= 10; z ++)
     {
         float *col = (z == 0) ? col_r : col_gray;
         float p0[3]  = {-10.0f, 0.0f, 1.0f * z};
         float p1[3]  = { 10.0f, 0.0f, 1.0f * z};
-        draw_line (matStage, p0, p1, col);
+        line_batch_add (matStage, p0, p1, col);
     }
 
-    draw_line (matStage, p0, py, col_g);
+    line_batch_add (matStage, p0, py, col_g);
     GLASSERT();
 
     return 0;
@@ -199,40 +149,44 @@ draw_uiplane (float *matP, float *matV, float *matM,
     matrix_mult (matVM, matV, uiplane->matM);
     matrix_mult (matPVM, matP, matVM);
 
-    /* save current FBO */
-    render_target_t rtarget0;
-    get_render_target (&rtarget0);
-
-    /* render to UIPlane-FBO */
-    set_render_target (&uiplane->rtarget);
+    /* CPU budget exceeded: skip the UI refresh, and show the UI texture of the previous frame */
+    if (!sceneData.cpu_budget_exceeded)
     {
-        glClearColor (0.0f, 0.0f, 0.0f, 0.0f);
-        glClear (GL_COLOR_BUFFER_BIT);
+        /* save current FBO */
+        render_target_t rtarget0;
+        get_render_target (&rtarget0);
 
-        static uint32_t prev_us = 0;
-        if (sceneData.viewID == 0)
+        /* render to UIPlane-FBO */
+        set_render_target (&uiplane->rtarget);
         {
-            sceneData.interval_ms = (sceneData.elapsed_us - prev_us) / 1000.0f;
-            prev_us = sceneData.elapsed_us;
-        }
+            glClearColor (0.0f, 0.0f, 0.0f, 0.0f);
+            glClear (GL_COLOR_BUFFER_BIT);
 
-        sceneData.gl_version = glGetString (GL_VERSION);
-        sceneData.gl_vendor  = glGetString (GL_VENDOR);
-        sceneData.gl_render  = glGetString (GL_RENDERER);
-        sceneData.viewport   = layerView.subImage.imageRect;
+            static uint32_t prev_us = 0;
+            if (sceneData.viewID == 0)
+            {
+                sceneData.interval_ms = (sceneData.elapsed_us - prev_us) / 1000.0f;
+                prev_us = sceneData.elapsed_us;
+            }
 
-        float hitx = uiplane->hit[1].x;
-        float hity = uiplane->hit[1].y;
+            sceneData.gl_version = glGetString (GL_VERSION);
+            sceneData.gl_vendor  = glGetString (GL_VENDOR);
+            sceneData.gl_render  = glGetString (GL_RENDERER);
+            sceneData.viewport   = layerView.subImage.imageRect;
 
-        imgui_mousemove (hitx, hity);
-        imgui_mousebutton (0, sceneData.inputState.clickA, hitx, hity);
-        invoke_imgui (&sceneData);
-    }
+            float hitx = uiplane->hit[1].x;
+            float hity = uiplane->hit[1].y;
 
-    /* restore FBO */
-    set_render_target (&rtarget0);
+            imgui_mousemove (hitx, hity);
+            imgui_mousebutton (0, sceneData.inputState.clickA, hitx, hity);
+            invoke_imgui (&sceneData);
+        }
+
+        /* restore FBO */
+        set_render_target (&rtarget0);
+    }
 
-    glEnable (GL_DEPTH_TEST);
+    glstate_enable (GL_DEPTH_TEST);
     draw_tex_plate (uiplane->rtarget.texc_id, matPVM, RENDER2D_FLIP_V);
 
     return 0;
@@ -297,6 +251,9 @@ draw_plane (float *matP, float *matV, float *matM, int plane_id, scene_data_t &s
         set_2d_projection_matrix (win_w, win_h);
         update_dbgstr_winsize (win_w, win_h);
 
+        /* grid and hit marks in a few draw calls */
+        begin_2d_batch ();
+
         draw_grid (win_w, win_h);
 
         for (int ihand = 0; ihand < 2; ihand ++)
@@ -319,7 +276,18 @@ draw_plane (float *matP, float *matV, float *matM, int plane_id, scene_data_t &s
                 draw_2d_line (0, hity, win_w, hity, col, 1.0f);
                 draw_2d_line (hitx, 0, hitx, win_h, col, 1.0f);
                 draw_2d_fillcircle (hitx, hity, rad, col);
+            }
+        }
 
+        end_2d_batch ();
+
+        /* the labels go on top of everything */
+        for (int ihand = 0; ihand < 2; ihand ++)
+        {
+            float hitx  = uiplane->hit[ihand].x;
+            float hity  = uiplane->hit[ihand].y;
+            if (hitx > 0 && hity > 0)
+            {
                 char strbuf[128];
                 sprintf (strbuf, "(%5.1f, %5.1f)", hitx, hity);
 
@@ -331,7 +299,7 @@ draw_plane (float *matP, float *matV, float *matM, int plane_id, scene_data_t &s
     /* restore FBO */
     set_render_target (&rtarget0);
 
-    glEnable (GL_DEPTH_TEST);
+    glstate_enable (GL_DEPTH_TEST);
     draw_tex_plate (uiplane->rtarget.texc_id, matPVM, RENDER2D_FLIP_V);
 
     return 0;
@@ -339,18 +307,13 @@ draw_plane (float *matP, float *matV, float *matM, int plane_id, scene_data_t &s
 
 
 static int
-draw_beam (float *matP, float *matV, float *matM)
+draw_beam (float *matM)
 {
-    float matPVM[16], matVM[16];
-    matrix_mult (matVM, matV, matM);
-    matrix_mult (matPVM, matP, matVM);
-
     float col[4] = {0.0f, 1.0f, 1.0f, 1.0f};
     float p0[3]  = {0.0f, 0.0f,     0.0f};
     float p1[3]  = {0.0f, 0.0f, -1000.0f};
 
-    draw_line (matPVM, p0, p1, col);
-    GLASSERT();
+    line_batch_add (matM, p0, p1, col);
 
     return 0;
 }
@@ -426,14 +389,13 @@ render_gles_scene (XrCompositionLayerProjectionView &layerView,
 
     glClearColor (0.1f, 0.1f, 0.1f, 1.0f);
     glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glEnable (GL_DEPTH_TEST);
+    glstate_enable (GL_DEPTH_TEST);
 
     /* ------------------------------------------- *
      *  Matrix Setup
      *    (matPV)  = (proj) x (view)
-     *    (matPVM) = (proj) x (view) x (model)
      * ------------------------------------------- */
-    XrMatrix4x4f matP, matV, matC, matM, matPV, matPVM;
+    XrMatrix4x4f matP, matV, matC, matM, matPV;
 
     /* Projection Matrix */
     XrMatrix4x4f_CreateProjectionFov (&matP, GRAPHICS_OPENGL_ES, layerView.fov, 0.05f, 100.0f);
@@ -448,15 +410,12 @@ render_gles_scene (XrCompositionLayerProjectionView &layerView,
     XrMatrix4x4f_CreateTranslationRotationScale (&matM, &stagePose.position, &stagePose.orientation, &scale);
 
     XrMatrix4x4f_Multiply (&matPV, &matP, &matV);
-    XrMatrix4x4f_Multiply (&matPVM, &matPV, &matM);
 
 
     /* ------------------------------------------- *
      *  Render
      * ------------------------------------------- */
-    float *matStage = reinterpret_cast<float*>(&matPVM);
-
-    draw_stage (matStage);
+    draw_stage ((float *)&matM);
 
     /* Axis of global origin */
     {
@@ -515,8 +474,9 @@ render_gles_scene (XrCompositionLayerProjectionView &layerView,
         if (sceneData.viewID == 0)
             update_hittest ((float *)&matM, ihand, sceneData);
 
-        draw_beam ((float *)&matP, (float *)&matV, (float *)&matM);
+        draw_beam ((float *)&matM);
     }
+    line_batch_flush ((float *)&matPV);
 
     /* plane for hittest*/
     {
@@ -4,6 +4,7 @@
 #include "util_matrix.h"
 #include "render_texplate.h"
 #include "assertgl.h"
+#include "util_gl_state.h"
 
 
 static shader_obj_t s_sobj;
@@ -106,14 +107,15 @@ draw_texture_in (texparam_t *tparam)
         1.0, 1.0 };
     float *uv = tarray;
 
-    glBindBuffer (GL_ARRAY_BUFFER, 0);
-    glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+    glstate_bind_vertex_array (0);
+    glstate_bind_buffer (GL_ARRAY_BUFFER, 0);
+    glstate_bind_buffer (GL_ELEMENT_ARRAY_BUFFER, 0);
 
-    glUseProgram (sobj->program);
-    glActiveTexture (GL_TEXTURE0);
+    glstate_use_program (sobj->program);
+    glstate_active_texture (GL_TEXTURE0);
     glUniform1i(sobj->loc_tex, 0);
 
-    glBindTexture (GL_TEXTURE_2D, texid);
+    glstate_bind_texture (GL_TEXTURE_2D, texid);
 
     flip_texcoord (uv, tparam->upsidedown);
 
@@ -124,20 +126,22 @@ draw_texture_in (texparam_t *tparam)
 
     if (sobj->loc_uv >= 0)
     {
-        glEnableVertexAttribArray (sobj->loc_uv);
+        glstate_enable_vertex_attrib_array (sobj->loc_uv);
         glVertexAttribPointer (sobj->loc_uv, 2, GL_FLOAT, GL_FALSE, 0, uv);
     }
 
-    glEnable (GL_BLEND);
+    /* the depth test is up to the caller */
+    glstate_disable (GL_CULL_FACE);
+    glstate_enable (GL_BLEND);
 
     if (tparam->blendfunc_en)
     {
-        glBlendFuncSeparate (tparam->blendfunc[0], tparam->blendfunc[1],
+        glstate_blend_func_separate (tparam->blendfunc[0], tparam->blendfunc[1],
                    tparam->blendfunc[2], tparam->blendfunc[3]);
     }
     else
     {
-        glBlendFuncSeparate (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA,
+        glstate_blend_func_separate (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA,
                    GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
     }
 
@@ -146,14 +150,12 @@ draw_texture_in (texparam_t *tparam)
 
     if (sobj->loc_vtx >= 0)
     {
-        glEnableVertexAttribArray (sobj->loc_vtx);
+        glstate_enable_vertex_attrib_array (sobj->loc_vtx);
         glVertexAttribPointer (sobj->loc_vtx, 3, GL_FLOAT, GL_FALSE, 0, varray);
     }
 
     glDrawArrays (GL_TRIANGLE_STRIP, 0, 4);
 
-    glDisable (GL_BLEND);
-
     GLASSERT ();
     return 0;
 }
@@ -194,12 +196,7 @@ hittest_tex_plate (float *matVM, float *ray0, float *ray1, float *out)
 {
     /* transform Vertex coord into View space */
     float trans_vtx[3 * 4];
-    for (int i = 0; i < 4; i ++)
-    {
-        float *src = &varray   [3 * i];
-        float *dst = &trans_vtx[3 * i];
-        matrix_multvec3 (matVM, src, dst);
-    }
+    matrix_multvec3_batch (matVM, varray, trans_vtx, 4);
 
     /* Hit test in View space */
     for (int i = 0; i < 2; i ++)    /* plate has 2 tris */
@@ -215,7 +212,7 @@ hittest_tex_plate (float *matVM, float *ray0, float *ray1, float *out)
             /* transform Intersection coord into Model space */
             float matVMInv[16];
             matrix_copy (matVMInv, matVM);
-            matrix_invert (matVMInv);
+            matrix_invert_affine (matVMInv);
 
             float org_vtx[3];
             matrix_multvec3 (matVMInv, cp, org_vtx);
@@ -6,12 +6,15 @@
 #include "util_matrix.h"
 #include "util_debugstr.h"
 #include "util_render_target.h"
+#include "util_render_line.h"
+#include "util_gpu_profiler.h"
 #include "teapot.h"
 #include "render_scene.h"
 #include "render_stage.h"
 #include "render_texplate.h"
 #include "render_imgui.h"
 #include "assertgl.h"
+#include "util_gl_state.h"
 
 typedef struct fvec2d_t
 {
@@ -28,41 +31,16 @@ typedef struct uiplane_t
 } uiplane_t;
 
 static uiplane_t        s_uiplane[5];
-static shader_obj_t     s_sobj;
 static snece_state_t    s_sstate;
 
 #define UI_WIN_W 300
 #define UI_WIN_H 740
 
 
-static char s_strVS[] = "                                   \n\
-                                                            \n\
-attribute vec4  a_Vertex;                                   \n\
-attribute vec4  a_Color;                                    \n\
-varying   vec4  v_color;                                    \n\
-uniform   mat4  u_PMVMatrix;                                \n\
-                                                            \n\
-void main(void)                                             \n\
-{                                                           \n\
-    gl_Position = u_PMVMatrix * a_Vertex;                   \n\
-    v_color     = a_Color;                                  \n\
-}                                                           ";
-
-static char s_strFS[] = "                                   \n\
-precision mediump float;                                    \n\
-varying   vec4  v_color;                                    \n\
-                                                            \n\
-void main(void)                                             \n\
-{                                                           \n\
-    gl_FragColor = v_color;                                 \n\
-}                                                           ";
-
-
-
 int
 init_gles_scene ()
 {
-    generate_shader (&s_sobj, s_strVS, s_strFS);
+    init_line_renderer ();
     init_teapot ();
     init_stage ();
     init_texplate ();
@@ -91,34 +69,6 @@ init_gles_scene ()
 }
 
 
-int
-draw_line (float *mtxPV, float *p0, float *p1, float *color)
-{
-    GLfloat floor_vtx[6];
-    for (int i = 0; i < 3; i ++)
-    {
-        floor_vtx[0 + i] = p0[i];
-        floor_vtx[3 + i] = p1[i];
-    }
-
-    shader_obj_t *sobj = &s_sobj;
-    glUseProgram (sobj->program);
-
-    glEnableVertexAttribArray (sobj->loc_vtx);
-    glVertexAttribPointer (sobj->loc_vtx, 3, GL_FLOAT, GL_FALSE, 0, floor_vtx);
-
-    glDisableVertexAttribArray (sobj->loc_clr);
-    glVertexAttrib4fv (sobj->loc_clr, color);
-
-    glUniformMatrix4fv (sobj->loc_mtx,  1, GL_FALSE, mtxPV);
-
-    glLineWidth (1.0f);
-    glEnable (GL_DEPTH_TEST);
-    glDrawArrays (GL_LINES, 0, 2);
-
-    return 0;
-}
-
 int
 draw_stage (float *matStage)
 {
@@ -134,17 +84,17 @@ draw_stage (float *matStage)
         float *col = (x == 0) ? col_b : col_gray;
         float p0[3]  = {1.0f * x, 0.0f, -10.0f};
         float p1[3]  = {1.0f * x, 0.0f,  10.0f};
-        draw_line (matStage, p0, p1, col);
+        line_batch_add (matStage, p0, p1, col);
     }
     for (int z = -10; z <= 10; z ++)
     {
         float *col = (z == 0) ? col_r : col_gray;
         float p0[3]  = {-10.0f, 0.0f, 1.0f * z};
         float p1[3]  = { 10.0f, 0.0f, 1.0f * z};
-        draw_line (matStage, p0, p1, col);
+        line_batch_add (matStage, p0, p1, col);
     }
 
-    draw_line (matStage, p0, py, col_g);
+    line_batch_add (matStage, p0, py, col_g);
     GLASSERT();
 
     return 0;
@@ -200,41 +150,47 @@ draw_uiplane (float *matP, float *matV, float *matM,
     matrix_mult (matVM, matV, uiplane->matM);
     matrix_mult (matPVM, matP, matVM);
 
-    /* save current FBO */
-    render_target_t rtarget0;
-    get_render_target (&rtarget0);
-
-    /* render to UIPlane-FBO */
-    set_render_target (&uiplane->rtarget);
+    /* CPU budget exceeded: skip the UI refresh, and show the UI texture of the previous frame */
+    if (!sceneData.cpu_budget_exceeded)
     {
-        glClearColor (0.0f, 0.0f, 0.0f, 0.0f);
-        glClear (GL_COLOR_BUFFER_BIT);
+        /* save current FBO */
+        render_target_t rtarget0;
+        get_render_target (&rtarget0);
 
-        static uint32_t prev_us = 0;
-        if (sceneData.viewID == 0)
+        /* render to UIPlane-FBO */
+        gpu_profiler_begin_pass ("imgui");
+        set_render_target (&uiplane->rtarget);
         {
-            sceneData.interval_ms = (sceneData.elapsed_us - prev_us) / 1000.0f;
-            prev_us = sceneData.elapsed_us;
-        }
+            glClearColor (0.0f, 0.0f, 0.0f, 0.0f);
+            glClear (GL_COLOR_BUFFER_BIT);
 
-        sceneData.gl_version = glGetString (GL_VERSION);
-        sceneData.gl_vendor  = glGetString (GL_VENDOR);
-        sceneData.gl_render  = glGetString (GL_RENDERER);
-        sceneData.viewport   = layerView.subImage.imageRect;
-#if 0
-        float hitx = uiplane->hit[1].x;
-        float hity = uiplane->hit[1].y;
+            static uint32_t prev_us = 0;
+            if (sceneData.viewID == 0)
+            {
+                sceneData.interval_ms = (sceneData.elapsed_us - prev_us) / 1000.0f;
+                prev_us = sceneData.elapsed_us;
+            }
 
-        imgui_mousemove (hitx, hity);
-        imgui_mousebutton (0, sceneData.inputState.clickA, hitx, hity);
-#endif
-        invoke_imgui (&sceneData);
-    }
+            sceneData.gl_version = glGetString (GL_VERSION);
+            sceneData.gl_vendor  = glGetString (GL_VENDOR);
+            sceneData.gl_render  = glGetString (GL_RENDERER);
+            sceneData.viewport   = layerView.subImage.imageRect;
+    #if 0
+            float hitx = uiplane->hit[1].x;
+            float hity = uiplane->hit[1].y;
+
+            imgui_mousemove (hitx, hity);
+            imgui_mousebutton (0, sceneData.inputState.clickA, hitx, hity);
+    #endif
+            invoke_imgui (&sceneData);
+        }
+        gpu_profiler_end_pass ();
 
-    /* restore FBO */
-    set_render_target (&rtarget0);
+        /* restore FBO */
+        set_render_target (&rtarget0);
+    }
 
-    glEnable (GL_DEPTH_TEST);
+    glstate_enable (GL_DEPTH_TEST);
     draw_tex_plate (uiplane->rtarget.texc_id, matPVM, RENDER2D_FLIP_V);
 
     return 0;
@@ -277,6 +233,9 @@ draw_keyboard (int win_w, int win_h, int plane_id)
 
     set_2d_projection_matrix (win_w, win_h);
 
+    /* the whole keyboard in a few draw calls */
+    begin_2d_batch ();
+
     /* white key */
     col = col_white;
     draw_2d_fillrect (0, 0, win_w, win_h, col);
@@ -305,6 +264,8 @@ draw_keyboard (int win_w, int win_h, int plane_id)
         int x = i * wkey_w - (bkey_w / 2);
         draw_2d_fillrect (x, 0, bkey_w, win_h * 0.6, col);
     }
+
+    end_2d_batch ();
 }
 
 
@@ -325,6 +286,7 @@ draw_plane (float *matP, float *matV, float *matM, int plane_id, scene_data_t &s
     get_render_target (&rtarget0);
 
     /* render to UIPlane-FBO */
+    gpu_profiler_begin_pass ("plane fbo");
     set_render_target (&uiplane->rtarget);
     {
         glClearColor (0.1f, 0.1f, 0.2f, 1.0f);
@@ -357,11 +319,12 @@ draw_plane (float *matP, float *matV, float *matM, int plane_id, scene_data_t &s
             }
         }
     }
+    gpu_profiler_end_pass ();
 
     /* restore FBO */
     set_render_target (&rtarget0);
 
-    glEnable (GL_DEPTH_TEST);
+    glstate_enable (GL_DEPTH_TEST);
     draw_tex_plate (uiplane->rtarget.texc_id, matPVM, RENDER2D_FLIP_V);
 
     return 0;
@@ -369,18 +332,13 @@ draw_plane (float *matP, float *matV, float *matM, int plane_id, scene_data_t &s
 
 
 static int
-draw_beam (float *matP, float *matV, float *matM)
+draw_beam (float *matM)
 {
-    float matPVM[16], matVM[16];
-    matrix_mult (matVM, matV, matM);
-    matrix_mult (matPVM, matP, matVM);
-
     float col[4] = {0.0f, 1.0f, 1.0f, 1.0f};
     float p0[3]  = {0.0f, 0.0f,     0.0f};
     float p1[3]  = {0.0f, 0.0f, -1000.0f};
 
-    draw_line (matPVM, p0, p1, col);
-    GLASSERT();
+    line_batch_add (matM, p0, p1, col);
 
     return 0;
 }
@@ -467,6 +425,8 @@ render_gles_scene (XrCompositionLayerProjectionView &layerView,
                    XrPosef                          &stagePose,
                    scene_data_t                     &sceneData)
 {
+    CPU_PROF_SCOPE ("render_gles_scene");
+
     int view_x = layerView.subImage.imageRect.offset.x;
     int view_y = layerView.subImage.imageRect.offset.y;
     int view_w = layerView.subImage.imageRect.extent.width;
@@ -478,14 +438,13 @@ render_gles_scene (XrCompositionLayerProjectionView &layerView,
 
     glClearColor (0.1f, 0.1f, 0.1f, 1.0f);
     glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glEnable (GL_DEPTH_TEST);
+    glstate_enable (GL_DEPTH_TEST);
 
     /* ------------------------------------------- *
      *  Matrix Setup
      *    (matPV)  = (proj) x (view)
-     *    (matPVM) = (proj) x (view) x (model)
      * ------------------------------------------- */
-    XrMatrix4x4f matP, matV, matC, matM, matPV, matPVM;
+    XrMatrix4x4f matP, matV, matC, matM, matPV;
 
     /* Projection Matrix */
     XrMatrix4x4f_CreateProjectionFov (&matP, GRAPHICS_OPENGL_ES, layerView.fov, 0.05f, 100.0f);
@@ -500,15 +459,14 @@ render_gles_scene (XrCompositionLayerProjectionView &layerView,
     XrMatrix4x4f_CreateTranslationRotationScale (&matM, &stagePose.position, &stagePose.orientation, &scale);
 
     XrMatrix4x4f_Multiply (&matPV, &matP, &matV);
-    XrMatrix4x4f_Multiply (&matPVM, &matPV, &matM);
 
 
     /* ------------------------------------------- *
      *  Render
      * ------------------------------------------- */
-    float *matStage = reinterpret_cast<float*>(&matPVM);
-
-    draw_stage (matStage);
+    gpu_profiler_begin_pass ("stage");
+    draw_stage ((float *)&matM);
+    gpu_profiler_end_pass ();
 #if 0
     /* Axis of global origin */
     {
@@ -529,11 +487,14 @@ render_gles_scene (XrCompositionLayerProjectionView &layerView,
     }
 #endif
     /* teapot */
+    gpu_profiler_begin_pass ("teapot");
     float col[] = {1.0f, 0.0f, 0.0f};
     draw_teapot (sceneData.elapsed_us / 1000, col, (float *)&matP, (float *)&matV);
+    gpu_profiler_end_pass ();
 
 
     /* Axis of hand grip */
+    gpu_profiler_begin_pass ("hand axes");
     for (XrSpaceLocation loc : sceneData.handLoc)
     {
         XrVector3f    scale = {0.2f, 0.2f, 0.2f};
@@ -567,10 +528,13 @@ render_gles_scene (XrCompositionLayerProjectionView &layerView,
         if (sceneData.viewID == 0)
             update_hittest ((float *)&matM, ihand, sceneData);
 
-        draw_beam ((float *)&matP, (float *)&matV, (float *)&matM);
+        draw_beam ((float *)&matM);
     }
+    line_batch_flush ((float *)&matPV);
+    gpu_profiler_end_pass ();
 
     /* plane for hittest*/
+    gpu_profiler_begin_pass ("planes");
     {
         XrVector3f    scale = {1.0f, 1.0f, 1.0f};
         XrVector3f    &pos  = stagePose.position;
@@ -581,8 +545,10 @@ render_gles_scene (XrCompositionLayerProjectionView &layerView,
         for (int i = 1; i < numplane; i ++)
             draw_plane ((float *)&matP, (float *)&matV, (float *)&matM, i, sceneData);
     }
+    gpu_profiler_end_pass ();
 
     /* UI plane always view front */
+    gpu_profiler_begin_pass ("uiplane");
     {
         XrVector3f    scale = {1.0f, 1.0f, 1.0f};
         XrVector3f    &pos  = viewPose.position;
@@ -591,7 +557,9 @@ render_gles_scene (XrCompositionLayerProjectionView &layerView,
 
         draw_uiplane ((float *)&matP, (float *)&matV, (float *)&matM, layerView, sceneData);
     }
+    gpu_profiler_end_pass ();
 
+    gpu_profiler_begin_pass ("debug text");
     {
         XrVector3f    &pos = layerView.pose.position;
         XrQuaternionf &rot = layerView.pose.orientation;
@@ -611,7 +579,23 @@ render_gles_scene (XrCompositionLayerProjectionView &layerView,
         sprintf (strbuf, "VIEWFOV(%6.4f, %6.4f, %6.4f, %6.4f)",
             fov.angleLeft, fov.angleRight, fov.angleUp, fov.angleDown);
         draw_dbgstr(strbuf, x, y); y += 22;
+
+        sprintf (strbuf, "RENDER SCALE(%4.2f)", sceneData.render_scale);
+        draw_dbgstr(strbuf, x, y); y += 22;
+
+        /* state calls since the previous view */
+        static glstate_stats_t s_glstate_prev;
+        glstate_stats_t glstate;
+        glstate_get_stats (&glstate);
+        sprintf (strbuf, "GL STATE(issued:%4d, elided:%4d)",
+                 (int)(glstate.issued - s_glstate_prev.issued),
+                 (int)(glstate.elided - s_glstate_prev.elided));
+        draw_dbgstr(strbuf, x, y); y += 22;
+        s_glstate_prev = glstate;
+
+        draw_gpu_profiler (x, y);
     }
+    gpu_profiler_end_pass ();
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
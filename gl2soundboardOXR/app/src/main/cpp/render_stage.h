@@ -3,8 +3,11 @@
 
 
 int init_stage ();
-int draw_stage (float *mtxPV);
+int draw_stage (float *matStage);
 int draw_axis  (float *matP, float *matV, float *matM);
+int draw_axes  (float *matP, float *matV, float *matM, int num);
+int draw_axes_pose (float *matP, float *matV, const void *pose, int pose_stride,
+                    const float *radius, int radius_stride, int num);
 int draw_bone  (float *matP, float *matV, float *matM, float radius, float *color);
 
 #endif
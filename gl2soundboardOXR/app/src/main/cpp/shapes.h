@@ -5,6 +5,8 @@
 #ifndef _SHAPES_H_
 #define _SHAPES_H_
 
+#include "util_mesh.h"
+
 #ifndef M_PI
 #define M_PI (3.1415926535f)
 #endif
@@ -20,17 +22,31 @@
 
 typedef struct shape_obj_t
 {
-    GLuint  vbo_vtx;
-    GLuint  vbo_col;
-    GLuint  vbo_nrm;
-    GLuint  vbo_uv;
-    GLuint  vbo_tng;
-    GLuint  vbo_idx;
-    int     num_faces;
+    mesh_obj_t  mesh;
+    int         num_faces;
 } shape_obj_t;
 
 int
 shape_create (int type, int nDivU, int nDivV, shape_obj_t *shape);
 
+int
+shape_create_ex (int type, int nDivU, int nDivV, unsigned int attr_mask,
+                 unsigned int format, shape_obj_t *shape);
+
+void
+shape_destroy (shape_obj_t *shape);
+
+/*
+ *  the generated shapes are cached by (type, nDivU, nDivV) in memory, and
+ *  in (dir) when set, for the grids of 65536 vertices or more. the cache
+ *  keeps a CPU copy of every grid: call shape_clear_cache() once the
+ *  shapes are created. shape_destroy() keeps the cache.
+ */
+void
+shape_set_cache_dir (const char *dir);
+
+void
+shape_clear_cache ();
+
 
 #endif /* _SHAPES_H_ */
@@ -5,6 +5,22 @@ struct AndroidAppState {
     bool Resumed = false;
 };
 
+/*
+ *  CPU profile of the session so far, in the external files dir:
+ *    adb pull /sdcard/Android/data/<package>/files/cpu_trace.json
+ */
+static void
+WriteCpuTrace (struct android_app* app)
+{
+    const char *dir = app->activity->externalDataPath;
+    if (dir == NULL)
+        return;
+
+    std::string path = std::string (dir) + "/cpu_trace";
+    cpu_profiler_write_chrome_trace   ((path + ".json").c_str ());
+    cpu_profiler_write_perfetto_trace ((path + ".perfetto-trace").c_str ());
+}
+
 static void
 ProcessAndroidCmd (struct android_app* app, int32_t cmd)
 {
@@ -23,6 +39,7 @@ ProcessAndroidCmd (struct android_app* app, int32_t cmd)
     case APP_CMD_PAUSE:
         LOGI ("APP_CMD_PAUSE");
         appState->Resumed = false;
+        WriteCpuTrace (app);
         break;
 
     case APP_CMD_STOP:
@@ -58,6 +75,8 @@ void android_main(struct android_app* app)
     app->userData = &appState;
     app->onAppCmd = ProcessAndroidCmd;
 
+    cpu_profiler_set_thread_name ("main");
+
     AppEngine engine (app);
     engine.InitOpenXR_GLES();
 
@@ -1,3 +1,4 @@
+#include <time.h>
 #include "util_egl.h"
 #include "util_oxr.h"
 #include "app_engine.h"
@@ -11,6 +12,12 @@ AppEngine::AppEngine (android_app* app)
 
 AppEngine::~AppEngine()
 {
+    if (m_pipeline.is_running ())
+    {
+        oxr_set_session_stop_callback (NULL, NULL);
+        m_pipeline.stop ();
+        egl_make_current ();
+    }
 }
 
 
@@ -47,7 +54,38 @@ AppEngine::InitOpenXR_GLES ()
     m_appSpace   = oxr_create_ref_space (m_session, XR_REFERENCE_SPACE_TYPE_LOCAL);
     m_stageSpace = oxr_create_ref_space (m_session, XR_REFERENCE_SPACE_TYPE_STAGE);
 
-    m_viewSurface = oxr_create_viewsurface (m_instance, m_systemId, m_session);
+    /* single-pass stereo with GL_OVR_multiview2, or fall back to per-eye rendering */
+    m_multiview = false;
+    if (is_multiview_supported () && init_gles_scene_multiview () == 0)
+    {
+        m_viewSurface = oxr_create_viewsurface_multiview (m_instance, m_systemId, m_session);
+        m_multiview   = !m_viewSurface.empty();
+    }
+    if (!m_multiview)
+        m_viewSurface = oxr_create_viewsurface (m_instance, m_systemId, m_session);
+    set_gles_scene_multiview (m_multiview);
+
+    LOGI ("Render path: %s", m_multiview ? "multiview (single pass)" : "per-eye");
+
+#if defined (USE_FRAME_PIPELINE)
+    /* hand the GL context over to the render thread */
+    egl_release_current ();
+    m_pipeline.start ([this](frame_snapshot_t &frame) {
+                          oxr_begin_frame_nowait (m_session);
+                          SubmitFrame (frame);
+                      },
+                      [] {
+                          cpu_profiler_set_thread_name ("render");
+                          egl_make_current ();
+                      },
+                      [] { egl_release_current (); });
+
+    /* no frame may be in flight at xrEndSession */
+    oxr_set_session_stop_callback ([](void *arg) {
+                                       ((AppEngine *)arg)->m_pipeline.drain ();
+                                   }, this);
+    LOGI ("Frame loop: pipelined");
+#endif
 }
 
 
@@ -57,6 +95,8 @@ AppEngine::InitOpenXR_GLES ()
 void
 AppEngine::UpdateFrame()
 {
+    CPU_PROF_SCOPE ("UpdateFrame");
+
     bool exit_loop, req_restart;
     oxr_poll_events (m_instance, m_session, &exit_loop, &req_restart);
 
@@ -71,64 +111,154 @@ AppEngine::UpdateFrame()
 
 /* ------------------------------------------------------------------------------------ *
  *  RenderFrame (Frame/Layer/View)
+ *
+ *    serial   : xrWaitFrame -> simulate -> xrBeginFrame -> render -> xrEndFrame
+ *    pipelined: [main thread]   xrWaitFrame -> simulate -> push snapshot
+ *               [render thread] pop snapshot -> xrBeginFrame -> render -> xrEndFrame
  * ------------------------------------------------------------------------------------ */
 void
 AppEngine::RenderFrame()
 {
-    std::vector<XrCompositionLayerBaseHeader*> all_layers;
+    CPU_PROF_SCOPE ("RenderFrame");
+
+    frame_snapshot_t frame;
+    XrFrameState     frameState;
 
-    XrTime dpy_time, elapsed_us;
-    oxr_begin_frame (m_session, &dpy_time);
+    oxr_wait_frame (m_session, &frameState);
+    SimulateFrame (frameState, frame);
+
+    if (m_pipeline.is_running ())
+    {
+        m_pipeline.push (frame);
+        return;
+    }
+
+    oxr_begin_frame_nowait (m_session);
+    SubmitFrame (frame);
+}
+
+
+/* ------------------------------------------------------------------------------------ *
+ *  SimulateFrame: everything of the frame that does not touch GL.
+ *    The views are located at the predictedDisplayTime of this frame, which
+ *    is carried in the snapshot to xrEndFrame.
+ * ------------------------------------------------------------------------------------ */
+void
+AppEngine::SimulateFrame (const XrFrameState &frameState, frame_snapshot_t &frame)
+{
+    CPU_PROF_SCOPE ("SimulateFrame");
+
+    XrTime dpy_time = frameState.predictedDisplayTime;
 
     static XrTime init_time = -1;
     if (init_time < 0)
         init_time = dpy_time;
-    elapsed_us = (dpy_time - init_time) / 1000;
+
+    frame.dpy_time      = dpy_time;
+    frame.elapsed_us    = (dpy_time - init_time) / 1000;
+    frame.should_render = frameState.shouldRender;
+    frame.view_count    = 0;
+    if (!frame.should_render)
+        return;
+
+    /* Acquire View Location */
+    uint32_t viewCount = m_multiview ? m_viewSurface[0].array_size : (uint32_t)m_viewSurface.size();
+    if (viewCount > MAX_VIEW_NUM)
+        viewCount = MAX_VIEW_NUM;
+
+    for (uint32_t i = 0; i < viewCount; i++)
+        frame.views[i] = {XR_TYPE_VIEW};
+    oxr_locate_views (m_session, dpy_time, m_appSpace, &viewCount, frame.views);
+    frame.view_count = viewCount;
+
+    /* Acquire Stage Location (rerative to the View Location) */
+    XrSpaceLocation stageLoc {XR_TYPE_SPACE_LOCATION};
+    xrLocateSpace (m_stageSpace, m_appSpace, dpy_time, &stageLoc);
+    frame.stage_pose = stageLoc.pose;
+}
+
+
+/* ------------------------------------------------------------------------------------ *
+ *  SubmitFrame: GL submission and composition of a frame begun by xrBeginFrame.
+ * ------------------------------------------------------------------------------------ */
+void
+AppEngine::SubmitFrame (frame_snapshot_t &frame)
+{
+    CPU_PROF_SCOPE ("SubmitFrame");
+
+    std::vector<XrCompositionLayerBaseHeader*> all_layers;
 
     std::vector<XrCompositionLayerProjectionView> projLayerViews;
     XrCompositionLayerProjection                  projLayer;
-    RenderLayer (dpy_time, elapsed_us, projLayerViews, projLayer);
+
+    /* The runtime will not show this frame: skip swapchain acquire and rendering */
+    if (!frame.should_render)
+    {
+        oxr_end_frame (m_session, frame.dpy_time, all_layers);
+        return;
+    }
+
+    uint64_t t0 = GetCpuTimeNs ();
+    RenderLayer (frame, projLayerViews, projLayer);
+    ReportCpuTime (GetCpuTimeNs () - t0);
 
     all_layers.push_back(reinterpret_cast<XrCompositionLayerBaseHeader*>(&projLayer));
 
     /* Compose all layers */
-    oxr_end_frame (m_session, dpy_time, all_layers);
+    oxr_end_frame (m_session, frame.dpy_time, all_layers);
 }
 
 bool
-AppEngine::RenderLayer(XrTime dpy_time,
-                       XrTime elapsed_us,
+AppEngine::RenderLayer(frame_snapshot_t                              &frame,
                        std::vector<XrCompositionLayerProjectionView> &layerViews,
                        XrCompositionLayerProjection                  &layer)
 {
-    /* Acquire View Location */
-    uint32_t viewCount = (uint32_t)m_viewSurface.size();
+    CPU_PROF_SCOPE ("RenderLayer");
 
-    std::vector<XrView> views(viewCount, {XR_TYPE_VIEW});
-    oxr_locate_views (m_session, dpy_time, m_appSpace, &viewCount, views.data());
+    uint32_t    viewCount  = frame.view_count;
+    XrView      *views     = frame.views;
+    XrTime      elapsed_us = frame.elapsed_us;
+    XrPosef     &stagePose = frame.stage_pose;
 
     layerViews.resize (viewCount);
 
-    /* Acquire Stage Location (rerative to the View Location) */
-    XrSpaceLocation stageLoc {XR_TYPE_SPACE_LOCATION};
-    xrLocateSpace (m_stageSpace, m_appSpace, dpy_time, &stageLoc);
 
+    if (m_multiview) {
+        /* Render all views at once */
+        if (viewCount > 0) {
+            std::vector<XrSwapchainSubImage> subImg (viewCount);
+            render_target_t                  rtarget;
+
+            oxr_acquire_viewsurface_multiview (m_viewSurface[0], rtarget, subImg.data());
+
+            for (uint32_t i = 0; i < viewCount; i++) {
+                layerViews[i] = {XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW};
+                layerViews[i].pose     = views[i].pose;
+                layerViews[i].fov      = views[i].fov;
+                layerViews[i].subImage = subImg[i];
+            }
 
-    /* Render each view */
-    for (uint32_t i = 0; i < viewCount; i++) {
-        XrSwapchainSubImage subImg;
-        render_target_t     rtarget;
+            render_gles_scene_multiview (layerViews, rtarget, stagePose, elapsed_us);
 
-        oxr_acquire_viewsurface (m_viewSurface[i], rtarget, subImg);
+            oxr_release_viewsurface (m_viewSurface[0]);
+        }
+    } else {
+        /* Render each view */
+        for (uint32_t i = 0; i < viewCount; i++) {
+            XrSwapchainSubImage subImg;
+            render_target_t     rtarget;
 
-        layerViews[i] = {XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW};
-        layerViews[i].pose     = views[i].pose;
-        layerViews[i].fov      = views[i].fov;
-        layerViews[i].subImage = subImg;
+            oxr_acquire_viewsurface (m_viewSurface[i], rtarget, subImg);
 
-        render_gles_scene (layerViews[i], rtarget, stageLoc.pose, elapsed_us, i);
+            layerViews[i] = {XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW};
+            layerViews[i].pose     = views[i].pose;
+            layerViews[i].fov      = views[i].fov;
+            layerViews[i].subImage = subImg;
 
-        oxr_release_viewsurface (m_viewSurface[i]);
+            render_gles_scene (layerViews[i], rtarget, stagePose, elapsed_us, i);
+
+            oxr_release_viewsurface (m_viewSurface[i]);
+        }
     }
     layer = {XR_TYPE_COMPOSITION_LAYER_PROJECTION};
     layer.space     = m_appSpace;
@@ -138,3 +268,36 @@ AppEngine::RenderLayer(XrTime dpy_time,
     return true;
 }
 
+
+
+/* ------------------------------------------------------------------------------------ *
+ *  CPU time spent in RenderLayer(), averaged and logged every REPORT_FRAMES frames
+ *  so that the per-eye and multiview paths can be compared on the device.
+ * ------------------------------------------------------------------------------------ */
+#define REPORT_FRAMES   300
+
+uint64_t
+AppEngine::GetCpuTimeNs ()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void
+AppEngine::ReportCpuTime (uint64_t cpu_ns)
+{
+    m_cpuTimeSum += cpu_ns;
+    m_cpuTimeCnt ++;
+
+    if (m_cpuTimeCnt < REPORT_FRAMES)
+        return;
+
+    LOGI ("[%s%s] CPU render time: %.3f ms/frame",
+          m_multiview ? "multiview" : "per-eye",
+          m_pipeline.is_running () ? ", pipelined" : "",
+          (double)m_cpuTimeSum / m_cpuTimeCnt / 1000000.0);
+
+    m_cpuTimeSum = 0;
+    m_cpuTimeCnt = 0;
+}
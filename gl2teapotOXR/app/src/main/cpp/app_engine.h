@@ -2,6 +2,20 @@
 
 #include "util_egl.h"
 #include "util_oxr.h"
+#include "util_frame_pipeline.h"
+
+#define MAX_VIEW_NUM    2
+
+/* everything the render thread needs to draw one frame */
+typedef struct frame_snapshot_t
+{
+    XrTime      dpy_time;       /* predictedDisplayTime from xrWaitFrame */
+    XrTime      elapsed_us;
+    bool        should_render;
+    uint32_t    view_count;
+    XrView      views[MAX_VIEW_NUM];
+    XrPosef     stage_pose;
+} frame_snapshot_t;
 
 
 class AppEngine {
@@ -25,12 +39,20 @@ private:
     XrSpace             m_stageSpace;
     XrSystemId          m_systemId;
     std::vector<viewsurface_t> m_viewSurface;
+    bool                m_multiview  = false;
+    uint64_t            m_cpuTimeSum = 0;
+    uint32_t            m_cpuTimeCnt = 0;
+
+    FramePipeline<frame_snapshot_t> m_pipeline;
 
     void RenderFrame();
-    bool RenderLayer(XrTime dpy_time,
-                     XrTime elapsed_us,
+    void SimulateFrame (const XrFrameState &frameState, frame_snapshot_t &frame);
+    void SubmitFrame (frame_snapshot_t &frame);
+    bool RenderLayer(frame_snapshot_t                              &frame,
                      std::vector<XrCompositionLayerProjectionView> &layerViews,
                      XrCompositionLayerProjection                  &layer);
+    uint64_t GetCpuTimeNs ();
+    void ReportCpuTime (uint64_t cpu_ns);
 public:
 };
 
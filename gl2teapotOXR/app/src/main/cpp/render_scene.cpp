@@ -3,40 +3,17 @@
 #include "util_egl.h"
 #include "util_oxr.h"
 #include "util_shader.h"
+#include "util_gl_state.h"
 #include "util_matrix.h"
 #include "util_debugstr.h"
+#include "util_render_line.h"
 #include "teapot.h"
 
-static shader_obj_t     s_sobj;
-
-static char s_strVS[] = "                                   \n\
-                                                            \n\
-attribute vec4  a_Vertex;                                   \n\
-attribute vec4  a_Color;                                    \n\
-varying   vec4  v_color;                                    \n\
-uniform   mat4  u_PMVMatrix;                                \n\
-                                                            \n\
-void main(void)                                             \n\
-{                                                           \n\
-    gl_Position = u_PMVMatrix * a_Vertex;                   \n\
-    v_color     = a_Color;                                  \n\
-}                                                           ";
-
-static char s_strFS[] = "                                   \n\
-precision mediump float;                                    \n\
-varying   vec4  v_color;                                    \n\
-                                                            \n\
-void main(void)                                             \n\
-{                                                           \n\
-    gl_FragColor = v_color;                                 \n\
-}                                                           ";
-
-
 
 int
 init_gles_scene ()
 {
-    generate_shader (&s_sobj, s_strVS, s_strFS);
+    init_line_renderer ();
     init_teapot ();
     init_dbgstr (0, 0);
 
@@ -44,33 +21,34 @@ init_gles_scene ()
 }
 
 
+/* shaders for the single-pass stereo path. Fails without GL_OVR_multiview2. */
 int
-draw_line (float *mtxPV, float *p0, float *p1, float *color)
+init_gles_scene_multiview ()
 {
-    GLfloat floor_vtx[6];
-    for (int i = 0; i < 3; i ++)
-    {
-        floor_vtx[0 + i] = p0[i];
-        floor_vtx[3 + i] = p1[i];
-    }
+    if (init_line_renderer_multiview () < 0)
+        return -1;
 
-    shader_obj_t *sobj = &s_sobj;
-    glUseProgram (sobj->program);
+    if (init_teapot_multiview () < 0)
+        return -1;
 
-    glEnableVertexAttribArray (sobj->loc_vtx);
-    glVertexAttribPointer (sobj->loc_vtx, 3, GL_FLOAT, GL_FALSE, 0, floor_vtx);
+    if (init_dbgstr_multiview () < 0)
+        return -1;
 
-    glDisableVertexAttribArray (sobj->loc_clr);
-    glVertexAttrib4fv (sobj->loc_clr, color);
-
-    glUniformMatrix4fv (sobj->loc_mtx,  1, GL_FALSE, mtxPV);
+    return 0;
+}
 
-    glEnable (GL_DEPTH_TEST);
-    glDrawArrays (GL_LINES, 0, 2);
 
-    return 0;
+/*
+ *  select the render path once the swapchains are created: the debug text
+ *  keeps its multiview program only while the multiview render target is in use.
+ */
+void
+set_gles_scene_multiview (bool enable)
+{
+    set_dbgstr_multiview (enable ? 1 : 0);
 }
 
+
 int
 draw_stage (float *matStage)
 {
@@ -86,27 +64,53 @@ draw_stage (float *matStage)
         float *col = (x == 0) ? col_b : col_gray;
         float p0[3]  = {1.0f * x, 0.0f, -10.0f};
         float p1[3]  = {1.0f * x, 0.0f,  10.0f};
-        draw_line (matStage, p0, p1, col);
+        line_batch_add (matStage, p0, p1, col);
     }
     for (int z = -10; z <= 10; z ++)
     {
         float *col = (z == 0) ? col_r : col_gray;
         float p0[3]  = {-10.0f, 0.0f, 1.0f * z};
         float p1[3]  = { 10.0f, 0.0f, 1.0f * z};
-        draw_line (matStage, p0, p1, col);
+        line_batch_add (matStage, p0, p1, col);
     }
 
-    draw_line (matStage, p0, py, col_g);
+    line_batch_add (matStage, p0, py, col_g);
 
     return 0;
 }
 
 
+static void
+draw_view_info (XrCompositionLayerProjectionView &layerView, int view_w, int view_h)
+{
+    XrVector3f    &pos = layerView.pose.position;
+    XrQuaternionf &rot = layerView.pose.orientation;
+    XrFovf        &fov = layerView.fov;
+    int x = 100;
+    int y = 100;
+    char strbuf[128];
+
+    update_dbgstr_winsize (view_w, view_h);
+
+    sprintf (strbuf, "VIEWPOS(%6.4f, %6.4f, %6.4f)", pos.x, pos.y, pos.z);
+    draw_dbgstr(strbuf, x, y); y += 22;
+
+    sprintf (strbuf, "VIEWROT(%6.4f, %6.4f, %6.4f, %6.4f)", rot.x, rot.y, rot.z, rot.w);
+    draw_dbgstr(strbuf, x, y); y += 22;
+
+    sprintf (strbuf, "VIEWFOV(%6.4f, %6.4f, %6.4f, %6.4f)",
+        fov.angleLeft, fov.angleRight, fov.angleUp, fov.angleDown);
+    draw_dbgstr(strbuf, x, y); y += 22;
+}
+
+
 int
 render_gles_scene (XrCompositionLayerProjectionView &layerView,
                    render_target_t &rtarget, XrPosef &stagePose,
                    XrTime   elapsed_us, uint32_t viewID)
 {
+    CPU_PROF_SCOPE ("render_gles_scene");
+
     int view_x = layerView.subImage.imageRect.offset.x;
     int view_y = layerView.subImage.imageRect.offset.y;
     int view_w = layerView.subImage.imageRect.extent.width;
@@ -118,14 +122,13 @@ render_gles_scene (XrCompositionLayerProjectionView &layerView,
 
     glClearColor (0.1f, 0.1f, 0.1f, 1.0f);
     glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glEnable (GL_DEPTH_TEST);
+    glstate_enable (GL_DEPTH_TEST);
 
     /* ------------------------------------------- *
      *  Matrix Setup
      *    (matPV)  = (proj) x (view)
-     *    (matPVM) = (proj) x (view) x (model)
      * ------------------------------------------- */
-    XrMatrix4x4f matP, matV, matC, matM, matPV, matPVM;
+    XrMatrix4x4f matP, matV, matC, matM, matPV;
 
     /* Projection Matrix */
     XrMatrix4x4f_CreateProjectionFov (&matP, GRAPHICS_OPENGL_ES, layerView.fov, 0.05f, 100.0f);
@@ -140,40 +143,82 @@ render_gles_scene (XrCompositionLayerProjectionView &layerView,
     XrMatrix4x4f_CreateTranslationRotationScale (&matM, &stagePose.position, &stagePose.orientation, &scale);
 
     XrMatrix4x4f_Multiply (&matPV, &matP, &matV);
-    XrMatrix4x4f_Multiply (&matPVM, &matPV, &matM);
 
 
     /* ------------------------------------------- *
      *  Render
      * ------------------------------------------- */
-    float *matStage = reinterpret_cast<float*>(&matPVM);
-
-    draw_stage (matStage);
+    draw_stage ((float *)&matM);
+    line_batch_flush ((float *)&matPV);
 
     float col[] = {1.0f, 0.0f, 0.0f};
     draw_teapot (elapsed_us / 1000, col, (float *)&matP, (float *)&matV);
-    
-    {
-        XrVector3f    &pos = layerView.pose.position;
-        XrQuaternionf &rot = layerView.pose.orientation;
-        XrFovf        &fov = layerView.fov;
-        int x = 100;
-        int y = 100;
-        char strbuf[128];
 
-        update_dbgstr_winsize (view_w, view_h);
+    draw_view_info (layerView, view_w, view_h);
 
-        sprintf (strbuf, "VIEWPOS(%6.4f, %6.4f, %6.4f)", pos.x, pos.y, pos.z);
-        draw_dbgstr(strbuf, x, y); y += 22;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-        sprintf (strbuf, "VIEWROT(%6.4f, %6.4f, %6.4f, %6.4f)", rot.x, rot.y, rot.z, rot.w);
-        draw_dbgstr(strbuf, x, y); y += 22;
+    return 0;
+}
 
-        sprintf (strbuf, "VIEWFOV(%6.4f, %6.4f, %6.4f, %6.4f)",
-            fov.angleLeft, fov.angleRight, fov.angleUp, fov.angleDown);
-        draw_dbgstr(strbuf, x, y); y += 22;
+
+/*
+ *  Render both views in one pass into the 2-layer array swapchain image.
+ *  The shaders pick their view/projection matrix with gl_ViewID_OVR.
+ */
+int
+render_gles_scene_multiview (std::vector<XrCompositionLayerProjectionView> &layerViews,
+                             render_target_t &rtarget, XrPosef &stagePose, XrTime elapsed_us)
+{
+    CPU_PROF_SCOPE ("render_gles_scene_multiview");
+
+    int view_x = layerViews[0].subImage.imageRect.offset.x;
+    int view_y = layerViews[0].subImage.imageRect.offset.y;
+    int view_w = layerViews[0].subImage.imageRect.extent.width;
+    int view_h = layerViews[0].subImage.imageRect.extent.height;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, rtarget.fbo_id);
+
+    glViewport(view_x, view_y, view_w, view_h);
+
+    glClearColor (0.1f, 0.1f, 0.1f, 1.0f);
+    glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glstate_enable (GL_DEPTH_TEST);
+
+    /* ------------------------------------------- *
+     *  Matrix Setup
+     *    (matPV[i])  = (proj[i]) x (view[i])
+     * ------------------------------------------- */
+    XrMatrix4x4f matP[2], matV[2], matC, matM, matPV[2];
+    XrVector3f scale = {1.0f, 1.0f, 1.0f};
+
+    for (int i = 0; i < 2; i ++)
+    {
+        XrMatrix4x4f_CreateProjectionFov (&matP[i], GRAPHICS_OPENGL_ES, layerViews[i].fov, 0.05f, 100.0f);
+
+        const auto &vewPose = layerViews[i].pose;
+        XrMatrix4x4f_CreateTranslationRotationScale (&matC, &vewPose.position, &vewPose.orientation, &scale);
+        XrMatrix4x4f_InvertRigidBody (&matV[i], &matC);
+
+        XrMatrix4x4f_Multiply (&matPV[i], &matP[i], &matV[i]);
     }
 
+    /* Stage Space Matrix */
+    XrMatrix4x4f_CreateTranslationRotationScale (&matM, &stagePose.position, &stagePose.orientation, &scale);
+
+
+    /* ------------------------------------------- *
+     *  Render
+     * ------------------------------------------- */
+    draw_stage ((float *)&matM);
+    line_batch_flush_multiview ((float *)matPV);
+
+    float col[] = {1.0f, 0.0f, 0.0f};
+    draw_teapot_multiview (elapsed_us / 1000, col, (float *)matP, (float *)matV);
+
+    /* screen space: both views show the left view's info */
+    draw_view_info (layerViews[0], view_w, view_h);
+
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
     return 0;
@@ -1,6 +1,11 @@
 #pragma once
 
 int init_gles_scene ();
+int init_gles_scene_multiview ();
+void set_gles_scene_multiview (bool enable);
 int render_gles_scene (XrCompositionLayerProjectionView &layerView,
                        render_target_t &rtarget, XrPosef &stagePose,
                        XrTime elapsed_us, uint32_t viewID);
+int render_gles_scene_multiview (std::vector<XrCompositionLayerProjectionView> &layerViews,
+                                 render_target_t &rtarget, XrPosef &stagePose,
+                                 XrTime elapsed_us);
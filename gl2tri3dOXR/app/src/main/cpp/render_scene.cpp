@@ -3,8 +3,10 @@
 #include "util_egl.h"
 #include "util_oxr.h"
 #include "util_shader.h"
+#include "util_gl_state.h"
 #include "util_matrix.h"
 #include "util_debugstr.h"
+#include "util_render_line.h"
 
 static shader_obj_t     s_sobj;
 
@@ -51,39 +53,13 @@ int
 init_gles_scene ()
 {
     generate_shader (&s_sobj, s_strVS, s_strFS);
+    init_line_renderer ();
     init_dbgstr (0, 0);
 
     return 0;
 }
 
 
-int
-draw_line (float *mtxPV, float *p0, float *p1, float *color)
-{
-    GLfloat floor_vtx[6];
-    for (int i = 0; i < 3; i ++)
-    {
-        floor_vtx[0 + i] = p0[i];
-        floor_vtx[3 + i] = p1[i];
-    }
-
-    shader_obj_t *sobj = &s_sobj;
-    glUseProgram (sobj->program);
-
-    glEnableVertexAttribArray (sobj->loc_vtx);
-    glVertexAttribPointer (sobj->loc_vtx, 3, GL_FLOAT, GL_FALSE, 0, floor_vtx);
-
-    glDisableVertexAttribArray (sobj->loc_clr);
-    glVertexAttrib4fv (sobj->loc_clr, color);
-
-    glUniformMatrix4fv (sobj->loc_mtx,  1, GL_FALSE, mtxPV);
-
-    glEnable (GL_DEPTH_TEST);
-    glDrawArrays (GL_LINES, 0, 2);
-
-    return 0;
-}
-
 int
 draw_stage (float *matStage)
 {
@@ -99,17 +75,17 @@ draw_stage (float *matStage)
         float *col = (x == 0) ? col_b : col_gray;
         float p0[3]  = {1.0f * x, 0.0f, -10.0f};
         float p1[3]  = {1.0f * x, 0.0f,  10.0f};
-        draw_line (matStage, p0, p1, col);
+        line_batch_add (matStage, p0, p1, col);
     }
     for (int z = -10; z <= 10; z ++)
     {
         float *col = (z == 0) ? col_r : col_gray;
         float p0[3]  = {-10.0f, 0.0f, 1.0f * z};
         float p1[3]  = { 10.0f, 0.0f, 1.0f * z};
-        draw_line (matStage, p0, p1, col);
+        line_batch_add (matStage, p0, p1, col);
     }
 
-    draw_line (matStage, p0, py, col_g);
+    line_batch_add (matStage, p0, py, col_g);
 
     return 0;
 }
@@ -124,10 +100,11 @@ draw_triangle (float *matStage)
     matrix_translate (matM, 0.0f, 1.0f, -1.0f);
     matrix_mult (matPVM, matStage, matM);
 
-    glUseProgram (sobj->program);
+    glstate_use_program (sobj->program);
 
-    glEnableVertexAttribArray (sobj->loc_vtx);
-    glEnableVertexAttribArray (sobj->loc_clr);
+    glstate_bind_buffer (GL_ARRAY_BUFFER, 0);   /* client arrays */
+    glstate_enable_vertex_attrib_array (sobj->loc_vtx);
+    glstate_enable_vertex_attrib_array (sobj->loc_clr);
     glVertexAttribPointer (sobj->loc_vtx, 2, GL_FLOAT, GL_FALSE, 0, s_vtx);
     glVertexAttribPointer (sobj->loc_clr, 4, GL_FLOAT, GL_FALSE, 0, s_col);
 
@@ -185,7 +162,8 @@ render_gles_scene (XrCompositionLayerProjectionView &layerView,
      * ------------------------------------------- */
     float *matStage = reinterpret_cast<float*>(&matPVM);
 
-    draw_stage (matStage);
+    draw_stage ((float *)&matM);
+    line_batch_flush ((float *)&matPV);
     draw_triangle (matStage);
 
     {
@@ -2,6 +2,7 @@
 #include "util_egl.h"
 #include "util_oxr.h"
 #include "util_shader.h"
+#include "util_gl_state.h"
 
 
 static shader_obj_t     s_sobj;
@@ -73,10 +74,11 @@ render_gles_scene (render_target_t &rtarget, XrRect2Di imgRect)
      *  Render
      * ------------------------------------------- */
     shader_obj_t *sobj = &s_sobj;
-    glUseProgram (sobj->program);
+    glstate_use_program (sobj->program);
 
-    glEnableVertexAttribArray (sobj->loc_vtx);
-    glEnableVertexAttribArray (sobj->loc_clr);
+    glstate_bind_buffer (GL_ARRAY_BUFFER, 0);   /* client arrays */
+    glstate_enable_vertex_attrib_array (sobj->loc_vtx);
+    glstate_enable_vertex_attrib_array (sobj->loc_clr);
     glVertexAttribPointer (sobj->loc_vtx, 2, GL_FLOAT, GL_FALSE, 0, s_vtx);
     glVertexAttribPointer (sobj->loc_clr, 4, GL_FLOAT, GL_FALSE, 0, s_col);
 
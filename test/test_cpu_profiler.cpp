@@ -0,0 +1,332 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <string>
+#include "util_cpu_profiler.h"
+#include "test_util.h"
+
+/*
+ *  CpuProfiler (util_cpu_profiler.h): scope nesting, recording from several
+ *  threads while exporting, ring wrap-around, and both export formats.
+ */
+
+#define THREAD_NUM      4
+#define SCOPE_NUM       5000
+
+typedef struct trace_event_t
+{
+    char    name[32];
+    double  ts;
+    double  dur;
+    int     tid;
+} trace_event_t;
+
+
+/* the complete events of the Chrome trace JSON, one per line */
+static std::vector<trace_event_t>
+parse_chrome_trace (const std::string &json)
+{
+    std::vector<trace_event_t> events;
+    size_t pos = 0;
+
+    while ((pos = json.find ("\n{\"name\":\"", pos)) != std::string::npos)
+    {
+        trace_event_t ev;
+        int pid;
+        size_t eol = json.find ('\n', ++ pos);
+        std::string line = json.substr (pos, eol - pos);
+        if (sscanf (line.c_str (), "{\"name\":\"%31[^\"]\",\"cat\":\"cpu\",\"ph\":\"X\",\"ts\":%lf,\"dur\":%lf,\"pid\":%d,\"tid\":%d}",
+                    ev.name, &ev.ts, &ev.dur, &pid, &ev.tid) == 5)
+        {
+            events.push_back (ev);
+        }
+    }
+    return events;
+}
+
+
+static void
+test_nesting (void)
+{
+    cpu_profiler_clear ();
+    {
+        CPU_PROF_SCOPE ("frame");
+        {
+            CPU_PROF_SCOPE ("wait");
+        }
+        {
+            CPU_PROF_SCOPE ("render");
+            CPU_PROF_SCOPE ("eye0");
+        }
+    }
+
+    std::string json;
+    int num = cpu_profiler_export_chrome_trace (json);
+    std::vector<trace_event_t> ev = parse_chrome_trace (json);
+
+    EXPECT (num == 4 && ev.size () == 4, "%d events, %d parsed", num, (int)ev.size ());
+    if (ev.size () != 4)
+        return;
+
+    /* sorted by begin time, the outer scope first */
+    EXPECT (strcmp (ev[0].name, "frame") == 0 && strcmp (ev[1].name, "wait") == 0 &&
+            strcmp (ev[2].name, "render") == 0 && strcmp (ev[3].name, "eye0") == 0,
+            "order: %s %s %s %s", ev[0].name, ev[1].name, ev[2].name, ev[3].name);
+
+    for (int i = 1; i < 4; i ++)
+    {
+        EXPECT (ev[i].ts >= ev[0].ts && ev[i].ts + ev[i].dur <= ev[0].ts + ev[0].dur,
+                "%s is not in frame", ev[i].name);
+    }
+    EXPECT (ev[1].ts + ev[1].dur <= ev[2].ts, "wait and render overlap");
+}
+
+
+static void
+test_threads (void)
+{
+    std::atomic<int> ready (0);
+    std::vector<std::thread> threads;
+
+    cpu_profiler_clear ();
+    for (int i = 0; i < THREAD_NUM; i ++)
+    {
+        threads.emplace_back ([i, &ready] {
+            char name[32];
+            snprintf (name, sizeof (name), "worker %d", i);
+            cpu_profiler_set_thread_name (name);
+            ready ++;
+
+            for (int j = 0; j < SCOPE_NUM; j ++)
+            {
+                CPU_PROF_SCOPE ("outer");
+                CPU_PROF_SCOPE ("inner");
+            }
+        });
+    }
+
+    /* export while the threads are recording */
+    std::string json;
+    while (ready.load () < THREAD_NUM)
+        std::this_thread::yield ();
+    for (int i = 0; i < 10; i ++)
+        cpu_profiler_export_chrome_trace (json);
+
+    for (std::thread &t : threads)
+        t.join ();
+
+    int num = cpu_profiler_export_chrome_trace (json);
+    std::vector<trace_event_t> ev = parse_chrome_trace (json);
+    EXPECT (num == THREAD_NUM * SCOPE_NUM * 2, "%d events recorded", num);
+    EXPECT ((int)ev.size () == num, "%d events parsed", (int)ev.size ());
+
+    int named = 0;
+    for (int i = 0; i < THREAD_NUM; i ++)
+    {
+        char name[32];
+        snprintf (name, sizeof (name), "\"name\":\"worker %d\"", i);
+        if (json.find (name) != std::string::npos)
+            named ++;
+    }
+    EXPECT (named == THREAD_NUM, "%d thread names", named);
+}
+
+
+static void
+test_wrap_around (void)
+{
+    cpu_profiler_clear ();
+
+    std::thread t ([] {
+        for (int i = 0; i < CPU_PROF_RING_SIZE + 100; i ++)
+            cpu_profiler_record ("event", i, i + 1, 0);
+    });
+    t.join ();
+
+    std::string json;
+    int num = cpu_profiler_export_chrome_trace (json);
+    std::vector<trace_event_t> ev = parse_chrome_trace (json);
+    /* the oldest slot may be the one being written: a full ring keeps RING_SIZE - 1 */
+    EXPECT (num == CPU_PROF_RING_SIZE - 1, "%d events after the wrap around", num);
+    EXPECT (!ev.empty () && ev[0].ts == 101 / 1000.0, "the oldest events are not dropped: %f", ev.empty () ? 0.0 : ev[0].ts);
+
+    cpu_profiler_clear ();
+    EXPECT (cpu_profiler_export_chrome_trace (json) == 0, "events left after clear");
+}
+
+
+static void
+test_disabled (void)
+{
+    cpu_profiler_clear ();
+    cpu_profiler_set_enabled (false);
+    {
+        CPU_PROF_SCOPE ("disabled");
+    }
+    cpu_profiler_set_enabled (true);
+
+    std::string json;
+    EXPECT (cpu_profiler_export_chrome_trace (json) == 0, "recorded while disabled");
+}
+
+
+static void
+test_clock_offset (void)
+{
+    int64_t t0 = cpu_profiler_now ();
+    cpu_profiler_set_clock_offset (1000000000ll);
+    int64_t t1 = cpu_profiler_now ();
+    cpu_profiler_set_clock_offset (0);
+
+    EXPECT (t1 - t0 >= 1000000000ll && t1 - t0 < 1100000000ll, "offset not applied: %lld", (long long)(t1 - t0));
+}
+
+
+/* ------------------------------------------------------------------------ *
+ *  protobuf decoder, just enough for the TracePacket of the export
+ * ------------------------------------------------------------------------ */
+static bool
+pb_read_varint (const uint8_t *&p, const uint8_t *end, uint64_t &val)
+{
+    val = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7)
+    {
+        uint8_t b = *p ++;
+        val |= (uint64_t)(b & 0x7f) << shift;
+        if ((b & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+/* value of the varint (field), or the payload of the bytes (field) */
+static bool
+pb_find (const uint8_t *p, const uint8_t *end, int field, uint64_t &val, const uint8_t **sub, size_t *sub_len)
+{
+    while (p < end)
+    {
+        uint64_t tag, v;
+        if (!pb_read_varint (p, end, tag) || !pb_read_varint (p, end, v))
+            return false;
+
+        if ((tag & 7) == 2)
+        {
+            if ((int)(tag >> 3) == field && sub)
+            {
+                *sub = p;
+                *sub_len = v;
+                return true;
+            }
+            p += v;
+        }
+        else if ((int)(tag >> 3) == field)
+        {
+            val = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+static void
+test_perfetto (void)
+{
+    cpu_profiler_clear ();
+    {
+        CPU_PROF_SCOPE ("frame");
+        {
+            CPU_PROF_SCOPE ("wait");
+        }
+        {
+            CPU_PROF_SCOPE ("render");
+        }
+    }
+
+    std::vector<uint8_t> trace;
+    int num = cpu_profiler_export_perfetto_trace (trace);
+    EXPECT (num == 3, "%d events", num);
+
+    int descriptors = 0, begins = 0, ends = 0, depth = 0, max_depth = 0;
+    int packets = 0, bad_seq = 0, bad_flags = 0;
+    uint64_t prev_time = 0, first_flags = 0;
+    bool sorted = true;
+
+    const uint8_t *p = trace.data (), *end = trace.data () + trace.size ();
+    while (p < end)
+    {
+        uint64_t tag, len, val;
+        if (!pb_read_varint (p, end, tag) || tag != ((1 << 3) | 2) ||
+            !pb_read_varint (p, end, len) || p + len > end)
+        {
+            EXPECT (false, "broken TracePacket at %d", (int)(p - trace.data ()));
+            return;
+        }
+
+        const uint8_t *packet = p, *sub;
+        size_t sub_len;
+        p += len;
+
+        /* one trusted_packet_sequence_id, its state cleared by the first packet */
+        uint64_t seq_id = 0, seq_flags = 0;
+        pb_find (packet, packet + len, 10, seq_id, NULL, NULL);
+        pb_find (packet, packet + len, 13, seq_flags, NULL, NULL);
+        if (seq_id != 1)
+            bad_seq ++;
+        if (packets ++ == 0)
+            first_flags = seq_flags;
+
+        if (pb_find (packet, packet + len, 60, val, &sub, &sub_len))
+        {
+            descriptors ++;
+            continue;
+        }
+
+        uint64_t time = 0, type = 0;
+        pb_find (packet, packet + len, 8, time, NULL, NULL);
+        if (!pb_find (packet, packet + len, 11, val, &sub, &sub_len) ||
+            !pb_find (sub, sub + sub_len, 9, type, NULL, NULL))
+            continue;
+
+        if (seq_flags != 2)
+            bad_flags ++;
+        if (time < prev_time)
+            sorted = false;
+        prev_time = time;
+
+        if (type == 1) { begins ++; depth ++; }
+        if (type == 2) { ends ++;   depth --; }
+        if (depth > max_depth) max_depth = depth;
+        if (depth < 0) break;
+    }
+
+    EXPECT (descriptors >= 1, "no TrackDescriptor");
+    EXPECT (bad_seq == 0, "%d packets off the sequence", bad_seq);
+    EXPECT (first_flags == 1, "first packet: sequence_flags %d", (int)first_flags);
+    EXPECT (bad_flags == 0, "%d TrackEvents without SEQ_NEEDS_INCREMENTAL_STATE", bad_flags);
+    EXPECT (begins == 3 && ends == 3, "%d SLICE_BEGIN, %d SLICE_END", begins, ends);
+    EXPECT (depth == 0 && max_depth == 2, "slices not nested: depth %d, max %d", depth, max_depth);
+    EXPECT (sorted, "slices out of order");
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    cpu_profiler_set_thread_name ("main");
+
+    test_nesting ();
+    test_threads ();
+    test_wrap_around ();
+    test_disabled ();
+    test_clock_offset ();
+    test_perfetto ();
+
+    return test_report ();
+}
@@ -0,0 +1,100 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdio.h>
+#include "util_dynres.h"
+#include "test_util.h"
+
+/*
+ *  DynamicResolution (util_dynres.h) against a fill-rate bound GPU model:
+ *  the GPU time is a fixed cost plus a cost proportional to the pixels.
+ */
+
+#define TARGET_MS   11.1f   /* 90 Hz */
+
+
+static float
+model_gpu_ms (float scale, float fixed_ms, float fill_ms)
+{
+    return fixed_ms + fill_ms * scale * scale;
+}
+
+
+static void
+test_scaled_size (void)
+{
+    EXPECT (DynamicResolution::scaled_size (1443, 1.0f) == 1443, "full size changed");
+    EXPECT (DynamicResolution::scaled_size (1440, 0.5f) ==  720, "half size");
+    EXPECT (DynamicResolution::scaled_size (1440, 0.7f) % DYNRES_ALIGN == 0, "not aligned");
+    EXPECT (DynamicResolution::scaled_size (1444, 0.999f) <= 1444, "larger than the swapchain");
+    EXPECT (DynamicResolution::scaled_size (16, 0.01f) == DYNRES_ALIGN, "smaller than DYNRES_ALIGN");
+}
+
+
+static void
+test_spike (void)
+{
+    DynamicResolution dynres;
+    dynres.set_target (TARGET_MS);
+
+    /* light: stays at full resolution */
+    for (int i = 0; i < 100; i ++)
+        dynres.update (model_gpu_ms (dynres.scale (), 1.0f, 6.0f));
+    EXPECT (dynres.scale () == DYNRES_MAX_SCALE, "shrunk on a light scene: %.2f", dynres.scale ());
+
+    /* spike: 15 ms at full resolution */
+    int first_change = -1, changes = 0;
+    float prev = dynres.scale ();
+    for (int i = 0; i < 300; i ++)
+    {
+        dynres.update (model_gpu_ms (dynres.scale (), 1.0f, 14.0f));
+        if (dynres.scale () != prev)
+        {
+            if (first_change < 0) first_change = i;
+            changes ++;
+            prev = dynres.scale ();
+        }
+    }
+    float ms = model_gpu_ms (dynres.scale (), 1.0f, 14.0f);
+    EXPECT (first_change >= 0 && first_change < 10, "slow to shrink: frame %d", first_change);
+    EXPECT (ms < TARGET_MS * DYNRES_SHRINK_RATIO, "still over budget: %.2f ms at %.2f", ms, dynres.scale ());
+    EXPECT (changes <= 3, "scale oscillated: %d changes", changes);
+
+    /* back to light: grows back slowly to full resolution */
+    int first_grow = -1;
+    prev = dynres.scale ();
+    for (int i = 0; i < 2000; i ++)
+    {
+        dynres.update (model_gpu_ms (dynres.scale (), 1.0f, 6.0f));
+        if (first_grow < 0 && dynres.scale () != prev)
+            first_grow = i;
+    }
+    EXPECT (first_grow + 1 >= DYNRES_GROW_FRAMES, "grew too early: frame %d", first_grow);
+    EXPECT (dynres.scale () == DYNRES_MAX_SCALE, "not back to full resolution: %.2f", dynres.scale ());
+}
+
+
+static void
+test_range (void)
+{
+    DynamicResolution dynres;
+    dynres.set_target (TARGET_MS);
+    dynres.set_range (0.8f, 1.0f);
+
+    /* far over budget: clamped at the minimum */
+    for (int i = 0; i < 300; i ++)
+        dynres.update (model_gpu_ms (dynres.scale (), 1.0f, 40.0f));
+    EXPECT (dynres.scale () == 0.8f, "not clamped: %.2f", dynres.scale ());
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    test_scaled_size ();
+    test_spike ();
+    test_range ();
+
+    return test_report ();
+}
@@ -0,0 +1,149 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdio.h>
+#include "util_foveation.h"
+#include "test_util.h"
+
+/*
+ *  FoveationController (util_foveation.h) driven by a headless mock of
+ *  XR_FB_foveation: the mock keeps the level set to its swapchains, and
+ *  models the GPU time of a fill-rate bound frame at that level.
+ */
+
+#define TARGET_MS   13.8f   /* 72 Hz */
+
+
+/* ------------------------------------------------------------------------ *
+ *  mock of xrCreateFoveationProfileFB / xrUpdateSwapchainFB
+ * ------------------------------------------------------------------------ */
+typedef struct mock_foveation_ext_t
+{
+    int     swapchain_level[2];     /* level set to each eye's swapchain */
+    int     update_cnt;             /* xrUpdateSwapchainFB calls */
+    int     fail_cnt;               /* fail the next (fail_cnt) updates */
+} mock_foveation_ext_t;
+
+static bool
+mock_set_foveation (mock_foveation_ext_t *ext, int level)
+{
+    if (ext->fail_cnt > 0)
+    {
+        ext->fail_cnt --;
+        return false;
+    }
+
+    for (int i = 0; i < 2; i ++)
+    {
+        ext->swapchain_level[i] = level;
+        ext->update_cnt ++;
+    }
+    return true;
+}
+
+/* fixed cost + fill cost scaled by the shaded pixels at the level */
+static float
+mock_gpu_ms (const mock_foveation_ext_t *ext, float fixed_ms, float fill_ms)
+{
+    static const float s_shaded_ratio[] = {1.00f, 0.85f, 0.70f, 0.55f};
+    return fixed_ms + fill_ms * s_shaded_ratio[ext->swapchain_level[0]];
+}
+
+
+static void
+setup (FoveationController &ctrl, mock_foveation_ext_t &ext)
+{
+    ext = {};
+    ctrl.set_target (TARGET_MS);
+    ctrl.set_apply_func ([&ext](int level) { return mock_set_foveation (&ext, level); });
+}
+
+
+static void
+test_fixed (void)
+{
+    FoveationController  ctrl;
+    mock_foveation_ext_t ext;
+    setup (ctrl, ext);
+
+    ctrl.set_range (FOVEATION_LEVEL_MEDIUM, FOVEATION_LEVEL_MEDIUM);
+    for (int i = 0; i < 300; i ++)
+        ctrl.update (mock_gpu_ms (&ext, 2.0f, (i < 150) ? 20.0f : 2.0f));
+
+    EXPECT (ext.swapchain_level[0] == FOVEATION_LEVEL_MEDIUM && ext.swapchain_level[1] == FOVEATION_LEVEL_MEDIUM,
+            "fixed level not applied: %d", ext.swapchain_level[0]);
+    EXPECT (ext.update_cnt == 2, "fixed level applied %d times", ext.update_cnt / 2);
+}
+
+
+static void
+test_spike (void)
+{
+    FoveationController  ctrl;
+    mock_foveation_ext_t ext;
+    setup (ctrl, ext);
+
+    /* light scene: stays at NONE */
+    for (int i = 0; i < 200; i ++)
+        ctrl.update (mock_gpu_ms (&ext, 2.0f, 8.0f));
+    EXPECT (ctrl.level () == FOVEATION_LEVEL_NONE, "raised on a light scene: %d", ctrl.level ());
+
+    /* spike: 16 ms at NONE, 12.6 ms at MEDIUM */
+    int changes = 0, prev = ctrl.level ();
+    int first_raise = -1;
+    for (int i = 0; i < 300; i ++)
+    {
+        ctrl.update (mock_gpu_ms (&ext, 2.0f, 14.0f));
+        if (ctrl.level () != prev)
+        {
+            if (first_raise < 0) first_raise = i;
+            changes ++;
+            prev = ctrl.level ();
+        }
+    }
+    EXPECT (first_raise >= 0 && first_raise < 10, "slow to raise: frame %d", first_raise);
+    EXPECT (ext.swapchain_level[0] >= FOVEATION_LEVEL_MEDIUM, "level %d too low for the spike", ext.swapchain_level[0]);
+    EXPECT (mock_gpu_ms (&ext, 2.0f, 14.0f) < TARGET_MS, "still over budget: %.2f ms", mock_gpu_ms (&ext, 2.0f, 14.0f));
+    EXPECT (changes <= 3, "level oscillated: %d changes", changes);
+
+    /* back to light: lowered slowly, down to NONE */
+    int first_lower = -1;
+    prev = ctrl.level ();
+    for (int i = 0; i < 1000; i ++)
+    {
+        ctrl.update (mock_gpu_ms (&ext, 2.0f, 4.0f));
+        if (first_lower < 0 && ctrl.level () != prev)
+            first_lower = i;
+    }
+    EXPECT (first_lower >= FOVEATION_LOWER_FRAMES, "lowered too early: frame %d", first_lower);
+    EXPECT (ext.swapchain_level[0] == FOVEATION_LEVEL_NONE, "not lowered back: %d", ext.swapchain_level[0]);
+}
+
+
+static void
+test_apply_retry (void)
+{
+    FoveationController  ctrl;
+    mock_foveation_ext_t ext;
+    setup (ctrl, ext);
+
+    ext.fail_cnt = 3;
+    ctrl.set_range (FOVEATION_LEVEL_LOW, FOVEATION_LEVEL_LOW);
+    for (int i = 0; i < 5; i ++)
+        ctrl.update (1.0f);
+
+    EXPECT (ext.swapchain_level[0] == FOVEATION_LEVEL_LOW, "failed update not retried");
+    EXPECT (ext.update_cnt == 2, "applied %d times after the retries", ext.update_cnt / 2);
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    test_fixed ();
+    test_spike ();
+    test_apply_retry ();
+
+    return test_report ();
+}
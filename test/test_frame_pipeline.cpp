@@ -0,0 +1,110 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include "util_frame_pipeline.h"
+#include "test_util.h"
+
+/*
+ *  FramePipeline (util_frame_pipeline.h): every pushed frame is rendered
+ *  once, in order, on one thread other than the producer, and the producer
+ *  never gets more than (depth) frames ahead.
+ */
+
+#define FRAME_NUM   1000
+
+typedef struct test_frame_t
+{
+    int64_t dpy_time;
+    int     frame_no;
+} test_frame_t;
+
+
+static void
+test_order (size_t depth)
+{
+    FramePipeline<test_frame_t> pipe (depth);
+    std::atomic<int> pushed (0);
+    int  rendered  = 0;
+    int  max_ahead = 0;
+    bool in_order  = true;
+    bool on_thread = true;
+    bool begun = false, ended = false;
+    std::thread::id main_id = std::this_thread::get_id ();
+
+    pipe.start ([&](test_frame_t &frame) {
+                    if (frame.frame_no != rendered || frame.dpy_time != 1000 * (int64_t)frame.frame_no)
+                        in_order = false;
+                    if (std::this_thread::get_id () == main_id)
+                        on_thread = false;
+
+                    /* frames pushed, but not rendered yet (excluding this one) */
+                    int ahead = pushed - rendered - 1;
+                    if (ahead > max_ahead)
+                        max_ahead = ahead;
+
+                    if (frame.frame_no % 100 == 0)
+                        std::this_thread::sleep_for (std::chrono::microseconds (500));
+                    rendered ++;
+                },
+                [&] { begun = true; },
+                [&] { ended = true; });
+
+    for (int i = 0; i < FRAME_NUM; i ++)
+    {
+        test_frame_t frame = {1000 * (int64_t)i, i};
+        EXPECT (pipe.push (frame), "push(%d) failed", i);
+        pushed ++;
+    }
+
+    pipe.drain ();
+    EXPECT (rendered == FRAME_NUM, "depth=%zu: rendered %d/%d after drain", depth, rendered, FRAME_NUM);
+
+    pipe.stop ();
+    EXPECT (!pipe.is_running (), "depth=%zu: still running", depth);
+    EXPECT (in_order,  "depth=%zu: frames out of order", depth);
+    EXPECT (on_thread, "depth=%zu: rendered on the producer thread", depth);
+    EXPECT (max_ahead <= (int)depth, "depth=%zu: producer %d frames ahead", depth, max_ahead);
+    EXPECT (begun && ended, "depth=%zu: thread hooks not called", depth);
+
+    test_frame_t frame = {0, 0};
+    EXPECT (!pipe.push (frame), "depth=%zu: push after stop", depth);
+}
+
+
+/* stop() renders the queued frames before the thread ends. */
+static void
+test_stop (void)
+{
+    FramePipeline<test_frame_t> pipe (2);
+    int rendered = 0;
+
+    pipe.start ([&](test_frame_t &frame) {
+                    std::this_thread::sleep_for (std::chrono::milliseconds (1));
+                    rendered ++;
+                });
+
+    for (int i = 0; i < 3; i ++)
+    {
+        test_frame_t frame = {0, i};
+        pipe.push (frame);
+    }
+    pipe.stop ();
+
+    EXPECT (rendered == 3, "rendered %d/3 at stop", rendered);
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    test_order (1);
+    test_order (2);
+    test_stop ();
+
+    return test_report ();
+}
@@ -0,0 +1,263 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <GLES3/gl3.h>
+#include "util_egl.h"
+#include "util_gl_state.h"
+#include "test_util.h"
+
+/*
+ *  util_gl_state on the headless EGL context: redundant calls elided,
+ *  the validation catching a state changed behind the cache, invalidation,
+ *  the bindings forgotten on deletion, and the VAO state passed through.
+ */
+
+static GLint
+get_integer (GLenum pname)
+{
+    GLint val = 0;
+    glGetIntegerv (pname, &val);
+    return val;
+}
+
+
+static void
+test_elision (void)
+{
+    glstate_stats_t st;
+
+    glstate_invalidate ();
+    glstate_bind_vertex_array (0);
+    glstate_reset_stats ();
+
+    /* the state is unknown: issued once, then elided */
+    for (int i = 0; i < 3; i ++)
+    {
+        glstate_enable (GL_DEPTH_TEST);
+        glstate_front_face (GL_CW);
+        glstate_blend_func_separate (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        glstate_enable_vertex_attrib_array (1);
+    }
+    glstate_get_stats (&st);
+    EXPECT (st.issued == 4 && st.elided == 8, "issued %d, elided %d", (int)st.issued, (int)st.elided);
+
+    EXPECT (glIsEnabled (GL_DEPTH_TEST), "GL_DEPTH_TEST not enabled");
+    EXPECT (get_integer (GL_FRONT_FACE) == GL_CW, "GL_FRONT_FACE not set");
+    EXPECT (get_integer (GL_BLEND_SRC_RGB) == GL_SRC_ALPHA, "blend func not set");
+
+    /* a change is issued */
+    glstate_reset_stats ();
+    glstate_disable (GL_DEPTH_TEST);
+    glstate_enable  (GL_DEPTH_TEST);
+    glstate_blend_func (GL_ONE, GL_ZERO);
+    glstate_get_stats (&st);
+    EXPECT (st.issued == 3 && st.elided == 0, "issued %d, elided %d", (int)st.issued, (int)st.elided);
+    EXPECT (get_integer (GL_BLEND_SRC_ALPHA) == GL_ONE, "blend func not set");
+
+    /* untracked caps pass through */
+    glstate_reset_stats ();
+    glstate_enable (GL_POLYGON_OFFSET_FILL);
+    glstate_enable (GL_SAMPLE_COVERAGE);
+    glstate_enable (GL_SAMPLE_COVERAGE);
+    glstate_get_stats (&st);
+    EXPECT (st.issued == 3 && st.elided == 0, "issued %d, elided %d", (int)st.issued, (int)st.elided);
+    glstate_disable (GL_POLYGON_OFFSET_FILL);
+    glstate_disable (GL_SAMPLE_COVERAGE);
+    glstate_disable_vertex_attrib_array (1);
+
+    EXPECT (glGetError () == GL_NO_ERROR, "GL error");
+}
+
+
+static void
+test_texture_unit (void)
+{
+    GLuint tex[2];
+    glstate_stats_t st;
+
+    glGenTextures (2, tex);
+    glstate_invalidate ();
+
+    glstate_active_texture (GL_TEXTURE0);
+    glstate_bind_texture (GL_TEXTURE_2D, tex[0]);
+    glstate_active_texture (GL_TEXTURE1);
+    glstate_bind_texture (GL_TEXTURE_2D, tex[1]);
+
+    /* the bindings are per unit */
+    glstate_reset_stats ();
+    glstate_active_texture (GL_TEXTURE0);
+    glstate_bind_texture (GL_TEXTURE_2D, tex[0]);
+    glstate_get_stats (&st);
+    EXPECT (st.issued == 1 && st.elided == 1, "issued %d, elided %d", (int)st.issued, (int)st.elided);
+    EXPECT (get_integer (GL_TEXTURE_BINDING_2D) == (GLint)tex[0], "unit 0 binding");
+
+    /* the name of a deleted texture is forgotten on every unit */
+    glstate_delete_textures (2, tex);
+    glGenTextures (2, tex);
+
+    glstate_reset_stats ();
+    glstate_bind_texture (GL_TEXTURE_2D, tex[0]);
+    glstate_active_texture (GL_TEXTURE1);
+    glstate_bind_texture (GL_TEXTURE_2D, tex[1]);
+    glstate_get_stats (&st);
+    EXPECT (st.issued == 3, "the reused names are elided: issued %d", (int)st.issued);
+    EXPECT (get_integer (GL_TEXTURE_BINDING_2D) == (GLint)tex[1], "unit 1 binding");
+
+    glstate_active_texture (GL_TEXTURE0);
+    glstate_delete_textures (2, tex);
+    EXPECT (glstate_validate () == 0, "stale after the deletion");
+    EXPECT (glGetError () == GL_NO_ERROR, "GL error");
+}
+
+
+static void
+test_buffer_delete (void)
+{
+    GLuint vbo;
+    glstate_stats_t st;
+
+    glGenBuffers (1, &vbo);
+    glstate_bind_buffer (GL_ARRAY_BUFFER, vbo);
+    glstate_delete_buffers (1, &vbo);
+    EXPECT (get_integer (GL_ARRAY_BUFFER_BINDING) == 0, "deleted buffer still bound");
+
+    /* GL may give the same name again */
+    glGenBuffers (1, &vbo);
+    glstate_reset_stats ();
+    glstate_bind_buffer (GL_ARRAY_BUFFER, vbo);
+    glstate_get_stats (&st);
+    EXPECT (st.issued == 1, "the bind of a new buffer is elided");
+    EXPECT (get_integer (GL_ARRAY_BUFFER_BINDING) == (GLint)vbo, "buffer not bound");
+
+    glstate_bind_buffer (GL_ARRAY_BUFFER, 0);
+    glstate_delete_buffers (1, &vbo);
+    EXPECT (glGetError () == GL_NO_ERROR, "GL error");
+}
+
+
+static void
+test_vertex_array (void)
+{
+    GLuint vao, ibo;
+    glstate_stats_t st;
+
+    glGenVertexArrays (1, &vao);
+    glGenBuffers (1, &ibo);
+    glstate_invalidate ();
+    glstate_bind_vertex_array (0);
+    glstate_bind_buffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+    glstate_disable_vertex_attrib_array (2);
+
+    /* the arrays of another VAO pass through, and keep the default VAO shadow */
+    glstate_bind_vertex_array (vao);
+    glstate_reset_stats ();
+    glstate_bind_buffer (GL_ELEMENT_ARRAY_BUFFER, ibo);
+    glstate_bind_buffer (GL_ELEMENT_ARRAY_BUFFER, ibo);
+    glstate_enable_vertex_attrib_array (2);
+    glstate_enable_vertex_attrib_array (2);
+    glstate_get_stats (&st);
+    EXPECT (st.issued == 4 && st.elided == 0, "issued %d, elided %d", (int)st.issued, (int)st.elided);
+    EXPECT (glstate_validate () == 0, "stale state in the VAO");
+
+    glstate_reset_stats ();
+    glstate_bind_vertex_array (0);
+    glstate_bind_buffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+    glstate_disable_vertex_attrib_array (2);
+    glstate_get_stats (&st);
+    EXPECT (st.issued == 1 && st.elided == 2, "issued %d, elided %d", (int)st.issued, (int)st.elided);
+    EXPECT (get_integer (GL_ELEMENT_ARRAY_BUFFER_BINDING) == 0, "the default VAO has the buffer");
+    EXPECT (glstate_validate () == 0, "stale state in the default VAO");
+
+    /* the default VAO is bound again on the deletion */
+    glstate_bind_vertex_array (vao);
+    glstate_delete_vertex_arrays (1, &vao);
+    EXPECT (get_integer (GL_VERTEX_ARRAY_BINDING) == 0, "deleted VAO still bound");
+    EXPECT (glstate_validate () == 0, "stale after the deletion");
+
+    /*
+     *  the element buffer of the default VAO deleted while another VAO is
+     *  bound: a new buffer given the same name must be bound again.
+     */
+    GLuint ibo2, vao2;
+    glGenBuffers (1, &ibo2);
+    glGenVertexArrays (1, &vao2);
+    glstate_bind_buffer (GL_ELEMENT_ARRAY_BUFFER, ibo2);
+    glstate_bind_vertex_array (vao2);
+    glstate_delete_buffers (1, &ibo2);
+
+    glstate_reset_stats ();
+    glstate_bind_vertex_array (0);
+    glstate_bind_buffer (GL_ELEMENT_ARRAY_BUFFER, ibo2);    /* the name reused */
+    glstate_get_stats (&st);
+    EXPECT (st.issued == 2 && st.elided == 0, "issued %d, elided %d", (int)st.issued, (int)st.elided);
+
+    glstate_bind_buffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+    glstate_delete_buffers (1, &ibo2);
+    glstate_delete_vertex_arrays (1, &vao2);
+    glstate_delete_buffers (1, &ibo);
+    EXPECT (glGetError () == GL_NO_ERROR, "GL error");
+}
+
+
+static void
+test_validate (void)
+{
+    glstate_stats_t st;
+
+    glstate_invalidate ();
+    glstate_enable (GL_CULL_FACE);
+    glstate_use_program (0);
+    EXPECT (glstate_validate () == 0, "stale state found");
+
+    /* changed behind the cache: the next call would be elided wrongly */
+    glDisable (GL_CULL_FACE);
+    glstate_reset_stats ();
+    glstate_set_validate (1);
+    glstate_enable (GL_CULL_FACE);
+    glstate_set_validate (0);
+    glstate_get_stats (&st);
+    EXPECT (st.mismatch == 1, "%d mismatches", (int)st.mismatch);
+    EXPECT (st.issued == 1, "the call is not issued after the mismatch");
+    EXPECT (glIsEnabled (GL_CULL_FACE), "GL_CULL_FACE not enabled");
+
+    /* glstate_validate() finds and forgets it */
+    glFrontFace (GL_CCW);
+    glstate_front_face (GL_CW);
+    glFrontFace (GL_CCW);
+    EXPECT (glstate_validate () == 1, "stale GL_FRONT_FACE not found");
+    EXPECT (glstate_validate () == 0, "stale GL_FRONT_FACE not forgotten");
+
+    /* or glstate_invalidate() after the raw calls */
+    glDisable (GL_CULL_FACE);
+    glstate_invalidate ();
+    glstate_enable (GL_CULL_FACE);
+    EXPECT (glIsEnabled (GL_CULL_FACE), "GL_CULL_FACE not enabled after invalidate");
+
+    glstate_disable (GL_CULL_FACE);
+    glstate_front_face (GL_CCW);
+    EXPECT (glGetError () == GL_NO_ERROR, "GL error");
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    if (egl_init_with_pbuffer_surface (3, 24, 0, 0, 16, 16) < 0)
+    {
+        fprintf (stderr, "ERR: %s(%d): failed to initialize EGL\n", __FILE__, __LINE__);
+        return -1;
+    }
+
+    test_elision ();
+    test_texture_unit ();
+    test_buffer_delete ();
+    test_vertex_array ();
+    test_validate ();
+
+    egl_terminate ();
+
+    return test_report ();
+}
@@ -0,0 +1,158 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <GLES3/gl3.h>
+#include "util_egl.h"
+#include "util_gpu_profiler.h"
+#include "test_util.h"
+
+/*
+ *  util_gpu_profiler on the headless EGL context (llvmpipe): pass nesting,
+ *  the read back latency, and unbalanced begin/end calls.
+ *  Skipped when GL_EXT_disjoint_timer_query is not supported.
+ */
+
+static void
+clear_n (int num)
+{
+    for (int i = 0; i < num; i ++)
+    {
+        glClearColor (i * 0.1f, 0.0f, 0.0f, 1.0f);
+        glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+}
+
+
+static void
+render_frame (void)
+{
+    gpu_profiler_begin_frame ();
+    for (int eye = 0; eye < 2; eye ++)
+    {
+        gpu_profiler_begin_pass (eye == 0 ? "eye0" : "eye1");
+        {
+            gpu_profiler_begin_pass ("scene");
+            clear_n (4);
+            gpu_profiler_end_pass ();
+
+            gpu_profiler_begin_pass ("ui");
+            clear_n (1);
+            gpu_profiler_end_pass ();
+        }
+        gpu_profiler_end_pass ();
+    }
+    gpu_profiler_end_frame ();
+
+    /* the results are available when read back */
+    glFinish ();
+}
+
+
+static void
+test_latency (void)
+{
+    gpu_pass_stats_t stats;
+
+    /* frame 0 is read back by the begin_frame() after GPU_PROF_FRAME_LATENCY more frames */
+    for (int i = 0; i < GPU_PROF_FRAME_LATENCY + 1; i ++)
+        render_frame ();
+
+    int pass = gpu_profiler_find_pass ("eye0");
+    gpu_profiler_get_stats (pass, &stats);
+    EXPECT (gpu_profiler_get_pass_num () == 4, "pass num %d", gpu_profiler_get_pass_num ());
+    EXPECT (stats.samples == 0, "read back before the latency: %d samples", stats.samples);
+
+    for (int i = 0; i < 20; i ++)
+        render_frame ();
+
+    gpu_profiler_get_stats (pass, &stats);
+    EXPECT (stats.samples == 20, "%d samples after 20 frames", stats.samples);
+    EXPECT (stats.p50_ms <= stats.p90_ms && stats.p90_ms <= stats.p99_ms && stats.p99_ms <= stats.max_ms,
+            "percentiles not ordered: %f %f %f %f", stats.p50_ms, stats.p90_ms, stats.p99_ms, stats.max_ms);
+}
+
+
+static void
+test_nesting (void)
+{
+    gpu_pass_stats_t eye0, eye1, scene, ui;
+
+    gpu_profiler_get_stats (gpu_profiler_find_pass ("eye0"),  &eye0);
+    gpu_profiler_get_stats (gpu_profiler_find_pass ("eye1"),  &eye1);
+    gpu_profiler_get_stats (gpu_profiler_find_pass ("scene"), &scene);
+    gpu_profiler_get_stats (gpu_profiler_find_pass ("ui"),    &ui);
+
+    EXPECT (eye0.depth == 0 && eye1.depth == 0, "eye depth %d %d", eye0.depth, eye1.depth);
+    EXPECT (scene.depth == 1 && ui.depth == 1,  "nested depth %d %d", scene.depth, ui.depth);
+
+    /* the frame is the sum of the outermost passes */
+    float frame_ms = gpu_profiler_get_frame_ms ();
+    EXPECT (frame_ms == eye0.last_ms + eye1.last_ms,
+            "frame %f != eye0 %f + eye1 %f", frame_ms, eye0.last_ms, eye1.last_ms);
+
+    /* a nested pass issued per eye is summed, and fits in its parents */
+    if (scene.samples > 0)
+    {
+        EXPECT (scene.last_ms + ui.last_ms <= eye0.last_ms + eye1.last_ms + 0.01f,
+                "nested %f + %f exceeds the eyes %f", scene.last_ms, ui.last_ms, frame_ms);
+    }
+}
+
+
+static void
+test_unbalanced (void)
+{
+    int pass_num = gpu_profiler_get_pass_num ();
+
+    /* deeper than GPU_PROF_MAX_DEPTH, and left open at the end of the frame */
+    gpu_profiler_begin_frame ();
+    for (int i = 0; i < GPU_PROF_MAX_DEPTH + 4; i ++)
+        gpu_profiler_begin_pass ("deep");
+    for (int i = 0; i < 2; i ++)
+        gpu_profiler_end_pass ();
+    gpu_profiler_end_frame ();
+
+    /* an extra end is ignored */
+    gpu_profiler_begin_frame ();
+    gpu_profiler_end_pass ();
+    gpu_profiler_end_frame ();
+
+    for (int i = 0; i < GPU_PROF_FRAME_LATENCY + 2; i ++)
+        render_frame ();
+
+    gpu_pass_stats_t stats;
+    gpu_profiler_get_stats (gpu_profiler_find_pass ("eye0"), &stats);
+    EXPECT (gpu_profiler_get_pass_num () == pass_num + 1, "pass num %d", gpu_profiler_get_pass_num ());
+    EXPECT (stats.depth == 0, "eye0 depth %d after the unbalanced frames", stats.depth);
+    EXPECT (glGetError () == GL_NO_ERROR, "GL error");
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    if (egl_init_with_pbuffer_surface (3, 24, 0, 0, 16, 16) < 0)
+    {
+        fprintf (stderr, "ERR: %s(%d): failed to initialize EGL\n", __FILE__, __LINE__);
+        return -1;
+    }
+
+    if (init_gpu_profiler () < 0)
+    {
+        printf ("GL_EXT_disjoint_timer_query is not supported: skipped\n");
+        egl_terminate ();
+        return 0;
+    }
+
+    test_latency ();
+    test_nesting ();
+    test_unbalanced ();
+
+    destroy_gpu_profiler ();
+    egl_terminate ();
+
+    return test_report ();
+}
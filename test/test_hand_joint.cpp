@@ -0,0 +1,107 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include "util_hand_joint.h"
+#include "test_util.h"
+
+/*
+ *  HandJointStore (util_hand_joint.h): publish() swaps the buffers,
+ *  the arrays are cache aligned, and extrapolate() follows the velocities.
+ */
+
+#define MS_TO_NS(ms)    ((int64_t)(ms) * 1000 * 1000)
+
+
+static void
+fill_hand (hand_joint_set_t *set, int64_t time, float x)
+{
+    set->time   = time;
+    set->active = true;
+    for (int i = 0; i < HAND_JOINT_NUM; i ++)
+    {
+        set->pos[3 * i + 0] = x;
+        set->pos[3 * i + 1] = (float)i;
+        set->pos[3 * i + 2] = 0.0f;
+        set->qtn[4 * i + 0] = 0.0f;
+        set->qtn[4 * i + 1] = 0.0f;
+        set->qtn[4 * i + 2] = 0.0f;
+        set->qtn[4 * i + 3] = 1.0f;
+        set->linvel[3 * i + 0] = 1.0f;     /* 1 m/s along +X */
+        set->linvel[3 * i + 1] = 0.0f;
+        set->linvel[3 * i + 2] = 0.0f;
+        set->angvel[3 * i + 0] = 0.0f;
+        set->angvel[3 * i + 1] = (float)M_PI; /* half a turn per second around +Y */
+        set->angvel[3 * i + 2] = 0.0f;
+        set->radius[i] = 0.01f;
+        set->flags[i]  = HAND_JOINT_POSE_VALID | HAND_JOINT_VELOCITY_VALID;
+    }
+}
+
+
+static void
+test_publish (void)
+{
+    HandJointStore store;
+
+    for (int hand = 0; hand < HAND_NUM; hand ++)
+    {
+        EXPECT (!store.front (hand).active, "hand %d: active before the first publish", hand);
+        EXPECT (((uintptr_t)store.back (hand)->pos    & 63) == 0, "hand %d: pos not aligned", hand);
+        EXPECT (((uintptr_t)store.back (hand)->qtn    & 63) == 0, "hand %d: qtn not aligned", hand);
+        EXPECT (((uintptr_t)store.back (hand)->radius & 63) == 0, "hand %d: radius not aligned", hand);
+    }
+
+    fill_hand (store.back (0), MS_TO_NS (10), 1.0f);
+    EXPECT (store.front (0).pos[0] == 0.0f, "back() written through to front()");
+
+    store.publish ();
+    EXPECT (store.front (0).pos[0] == 1.0f && store.front (0).time == MS_TO_NS (10), "publish() did not swap");
+    EXPECT (store.back (0) != &store.front (0), "back() == front() after publish()");
+
+    fill_hand (store.back (0), MS_TO_NS (20), 2.0f);
+    EXPECT (store.front (0).pos[0] == 1.0f, "front() changed before publish()");
+    store.publish ();
+    EXPECT (store.front (0).pos[0] == 2.0f, "second publish() did not swap");
+}
+
+
+static void
+test_extrapolate (void)
+{
+    HandJointStore store;
+    float pos[HAND_JOINT_NUM * 3], qtn[HAND_JOINT_NUM * 4];
+
+    EXPECT (!store.extrapolate (0, 0, pos, qtn), "untracked hand extrapolated");
+
+    fill_hand (store.back (0), MS_TO_NS (100), 0.0f);
+    store.back (0)->flags[1] = HAND_JOINT_POSE_VALID;   /* no velocity */
+    store.publish ();
+
+    /* +10ms: 1cm along X, 1.8 deg around Y */
+    EXPECT (store.extrapolate (0, MS_TO_NS (110), pos, qtn), "extrapolate failed");
+
+    float half = 0.5f * (float)M_PI * 0.010f;
+    EXPECT (fabsf (pos[0] - 0.010f) < 1e-6f, "pos.x = %f", pos[0]);
+    EXPECT (fabsf (qtn[1] - sinf (half)) < 1e-6f && fabsf (qtn[3] - cosf (half)) < 1e-6f,
+            "qtn = (%f, %f, %f, %f)", qtn[0], qtn[1], qtn[2], qtn[3]);
+    EXPECT (pos[3] == 0.0f && qtn[7] == 1.0f, "joint without velocity moved");
+    EXPECT (pos[3 * 5 + 1] == 5.0f, "pos.y changed");
+
+    /* far in the future: clamped */
+    store.extrapolate (0, MS_TO_NS (100) + 10 * HAND_JOINT_MAX_EXTRAPOLATE_NS, pos, qtn);
+    EXPECT (fabsf (pos[0] - HAND_JOINT_MAX_EXTRAPOLATE_NS * 1e-9f) < 1e-6f, "not clamped: pos.x = %f", pos[0]);
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    test_publish ();
+    test_extrapolate ();
+
+    return test_report ();
+}
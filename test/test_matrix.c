@@ -0,0 +1,527 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include "util_matrix.h"
+#include "test_util.h"
+
+/*
+ *  Compare the SIMD kernels of util_matrix.c against the scalar code.
+ *
+ *  On x86 the SSE/AVX kernels use the same multiply/add order as the
+ *  scalar code, so the results must be bit-identical (except for the
+ *  sign of zero). Elsewhere (NEON, or when the compiler contracts the
+ *  scalar code into FMA) they are checked against an error bound.
+ */
+#if (defined (__x86_64__) || defined (__i386__)) && !defined (__FMA__)
+#define EXPECT_BITEXACT 1
+#else
+#define EXPECT_BITEXACT 0
+#endif
+
+#define TEST_LOOP   10000
+
+
+static unsigned int s_seed = 1;
+
+static float
+rand_float (float vmin, float vmax)
+{
+    s_seed = s_seed * 1103515245 + 12345;
+    return vmin + (vmax - vmin) * ((s_seed >> 8) & 0xFFFF) / 65535.0f;
+}
+
+/* T * R * S */
+static void
+rand_affine (float *m)
+{
+    matrix_identity (m);
+    matrix_translate (m, rand_float (-10, 10), rand_float (-10, 10), rand_float (-10, 10));
+    matrix_rotate (m, rand_float (-180, 180), rand_float (-1, 1), rand_float (-1, 1), rand_float (0.1f, 1));
+    matrix_scale (m, rand_float (0.01f, 2), rand_float (0.01f, 2), rand_float (0.01f, 2));
+}
+
+/* diagonally dominant, so that it is well conditioned */
+static void
+rand_general (float *m)
+{
+    for (int i = 0; i < 16; i ++)
+        m[i] = rand_float (-1, 1);
+    m[ 0] += 4.0f;
+    m[ 5] += 4.0f;
+    m[10] += 4.0f;
+    m[15] += 4.0f;
+}
+
+static void
+rand_matrix (float *m, int i)
+{
+    switch (i % 3)
+    {
+    case 0: rand_affine (m);  break;
+    case 1: rand_general (m); break;
+    default:
+        matrix_proj_perspective (m, rand_float (30, 120), rand_float (0.5f, 2), rand_float (0.01f, 1), rand_float (10, 1000));
+        break;
+    }
+}
+
+
+/* |a - b| <= tol * scale */
+static int
+is_near (float a, float b, float tol, float scale)
+{
+    if (a == b)
+        return 1;
+    return fabsf (a - b) <= tol * scale + FLT_MIN;
+}
+
+static int
+is_equal_array (float *a, float *b, int n)
+{
+    for (int i = 0; i < n; i ++)
+    {
+        if (a[i] != b[i])
+            return 0;
+    }
+    return 1;
+}
+
+/* error bound of a dot product: n * eps * sum |a_k * b_k| */
+static float
+mult_bound (float *m1, float *m2, int row, int col)
+{
+    float sum = 0.0f;
+    for (int k = 0; k < 4; k ++)
+        sum += fabsf (m1[row + 4 * k] * m2[k + 4 * col]);
+    return sum;
+}
+
+static float
+max_abs (float *m, int n)
+{
+    float v = 0.0f;
+    for (int i = 0; i < n; i ++)
+        v = fmaxf (v, fabsf (m[i]));
+    return v;
+}
+
+
+static void
+test_mult (int simd)
+{
+    for (int i = 0; i < TEST_LOOP; i ++)
+    {
+        float m1[16], m2[16], ref[16], out[16], alias[16];
+
+        rand_matrix (m1, i);
+        rand_matrix (m2, i / 3);
+
+        matrix_simd_select (MATRIX_SIMD_NONE);
+        matrix_mult (ref, m1, m2);
+
+        matrix_simd_select (simd);
+        matrix_mult (out, m1, m2);
+
+        if (EXPECT_BITEXACT)
+        {
+            EXPECT (is_equal_array (ref, out, 16), "[%s] matrix_mult (%d)", matrix_simd_name (simd), i);
+        }
+        else
+        {
+            for (int j = 0; j < 16; j ++)
+            {
+                float scale = mult_bound (m1, m2, j % 4, j / 4);
+                EXPECT (is_near (ref[j], out[j], 8 * FLT_EPSILON, scale),
+                        "[%s] matrix_mult (%d)[%d] %e != %e", matrix_simd_name (simd), i, j, ref[j], out[j]);
+            }
+        }
+
+        /* m == m1 */
+        matrix_copy (alias, m1);
+        matrix_mult (alias, alias, m2);
+        EXPECT (is_equal_array (alias, out, 16), "[%s] matrix_mult (m, m, m2)", matrix_simd_name (simd));
+
+        /* m == m2 */
+        matrix_copy (alias, m2);
+        matrix_mult (alias, m1, alias);
+        EXPECT (is_equal_array (alias, out, 16), "[%s] matrix_mult (m, m1, m)", matrix_simd_name (simd));
+    }
+}
+
+
+static void
+test_multvec (int simd)
+{
+    for (int i = 0; i < TEST_LOOP; i ++)
+    {
+        float m[16];
+        float v[4], ref3[4], out3[4], ref4[4], out4[4], alias[4];
+
+        rand_matrix (m, i);
+        v[0] = rand_float (-10, 10);
+        v[1] = rand_float (-10, 10);
+        v[2] = rand_float (-10, 10);
+        v[3] = rand_float (-2, 2);
+
+        /* multvec3 writes 3 floats only */
+        out3[3] = ref3[3] = 12345.0f;
+
+        matrix_simd_select (MATRIX_SIMD_NONE);
+        matrix_multvec3 (m, v, ref3);
+        matrix_multvec4 (m, v, ref4);
+
+        matrix_simd_select (simd);
+        matrix_multvec3 (m, v, out3);
+        matrix_multvec4 (m, v, out4);
+
+        EXPECT (out3[3] == 12345.0f, "[%s] matrix_multvec3 overrun", matrix_simd_name (simd));
+
+        if (EXPECT_BITEXACT)
+        {
+            EXPECT (is_equal_array (ref3, out3, 3), "[%s] matrix_multvec3 (%d)", matrix_simd_name (simd), i);
+            EXPECT (is_equal_array (ref4, out4, 4), "[%s] matrix_multvec4 (%d)", matrix_simd_name (simd), i);
+        }
+        else
+        {
+            float scale = max_abs (m, 16) * (fabsf (v[0]) + fabsf (v[1]) + fabsf (v[2]) + fabsf (v[3]) + 1.0f);
+            for (int j = 0; j < 3; j ++)
+                EXPECT (is_near (ref3[j], out3[j], 8 * FLT_EPSILON, scale), "[%s] matrix_multvec3 (%d)", matrix_simd_name (simd), i);
+            for (int j = 0; j < 4; j ++)
+                EXPECT (is_near (ref4[j], out4[j], 8 * FLT_EPSILON, scale), "[%s] matrix_multvec4 (%d)", matrix_simd_name (simd), i);
+        }
+
+        /* dvec == svec */
+        memcpy (alias, v, sizeof (alias));
+        matrix_multvec3 (m, alias, alias);
+        EXPECT (is_equal_array (alias, out3, 3), "[%s] matrix_multvec3 (m, v, v)", matrix_simd_name (simd));
+
+        memcpy (alias, v, sizeof (alias));
+        matrix_multvec4 (m, alias, alias);
+        EXPECT (is_equal_array (alias, out4, 4), "[%s] matrix_multvec4 (m, v, v)", matrix_simd_name (simd));
+    }
+}
+
+
+static void
+test_transpose (int simd)
+{
+    for (int i = 0; i < TEST_LOOP; i ++)
+    {
+        float m[16], ref[16], out[16];
+
+        rand_matrix (m, i);
+        matrix_copy (ref, m);
+        matrix_copy (out, m);
+
+        matrix_simd_select (MATRIX_SIMD_NONE);
+        matrix_transpose (ref);
+
+        matrix_simd_select (simd);
+        matrix_transpose (out);
+
+        EXPECT (is_equal_array (ref, out, 16), "[%s] matrix_transpose (%d)", matrix_simd_name (simd), i);
+        EXPECT (out[1] == m[4] && out[4] == m[1] && out[11] == m[14], "[%s] matrix_transpose", matrix_simd_name (simd));
+    }
+}
+
+
+static void
+test_invert (int simd)
+{
+    for (int i = 0; i < TEST_LOOP; i ++)
+    {
+        float m[16], ref[16], out[16], chk[16];
+        int   is_affine = (i % 3 == 0);
+
+        rand_matrix (m, i);
+        matrix_copy (ref, m);
+        matrix_copy (out, m);
+
+        matrix_simd_select (MATRIX_SIMD_NONE);
+        matrix_invert (ref);
+
+        matrix_simd_select (simd);
+        matrix_invert (out);
+
+        if (is_affine)
+        {
+            /* the 4th row must stay exactly (0, 0, 0, 1) for the next affine check */
+            EXPECT (out[3] == 0.0f && out[7] == 0.0f && out[11] == 0.0f && out[15] == 1.0f,
+                    "[%s] matrix_invert (affine) 4th row", matrix_simd_name (simd));
+        }
+
+        if (EXPECT_BITEXACT && is_affine)
+        {
+            EXPECT (is_equal_array (ref, out, 16), "[%s] matrix_invert (affine) (%d)", matrix_simd_name (simd), i);
+        }
+        else
+        {
+            float scale = max_abs (ref, 16);
+            for (int j = 0; j < 16; j ++)
+                EXPECT (is_near (ref[j], out[j], 1e-5f, scale),
+                        "[%s] matrix_invert (%d)[%d] %e != %e", matrix_simd_name (simd), i, j, ref[j], out[j]);
+        }
+
+        /* M^-1 * M = I */
+        matrix_mult (chk, out, m);
+        for (int j = 0; j < 16; j ++)
+        {
+            float e = (j % 5 == 0) ? 1.0f : 0.0f;
+            float scale = fmaxf (1.0f, max_abs (out, 16) * max_abs (m, 16));
+            EXPECT (is_near (chk[j], e, 1e-5f, scale), "[%s] M^-1 * M (%d)[%d] = %e", matrix_simd_name (simd), i, j, chk[j]);
+        }
+    }
+
+    /* singular matrix is left untouched */
+    {
+        float m[16] = {0}, out[16];
+
+        matrix_simd_select (simd);
+        m[15] = 1.0f;
+        matrix_copy (out, m);
+        matrix_invert (out);
+        EXPECT (is_equal_array (m, out, 16), "[%s] matrix_invert (singular, affine)", matrix_simd_name (simd));
+
+        m[15] = 0.0f;
+        m[ 3] = 1.0f;
+        matrix_copy (out, m);
+        matrix_invert (out);
+        EXPECT (is_equal_array (m, out, 16), "[%s] matrix_invert (singular)", matrix_simd_name (simd));
+    }
+}
+
+
+static void
+test_invert_affine (void)
+{
+    for (int i = 0; i < TEST_LOOP; i ++)
+    {
+        float m[16], ref[16], out[16], n[9];
+        float axis[3];
+
+        rand_affine (m);
+
+        /* the same as the affine path of matrix_invert (scalar) */
+        matrix_simd_select (MATRIX_SIMD_NONE);
+        matrix_copy (ref, m);
+        matrix_invert (ref);
+        matrix_copy (out, m);
+        matrix_invert_affine (out);
+        EXPECT (is_equal_array (ref, out, 16), "matrix_invert_affine (%d)", i);
+
+        /* normal matrix = upper 3x3 of (M^-1)^T */
+        matrix_normal3x3 (n, m);
+        for (int j = 0; j < 9; j ++)
+        {
+            float e = ref[(j % 3) * 4 + (j / 3)];
+            EXPECT (is_near (n[j], e, 1e-5f, max_abs (ref, 16)), "matrix_normal3x3 (%d)[%d] %e != %e", i, j, n[j], e);
+        }
+
+        /* rigid: rotation + translation only */
+        axis[0] = rand_float (-1, 1);
+        axis[1] = rand_float (-1, 1);
+        axis[2] = rand_float (0.1f, 1);
+        matrix_identity (m);
+        matrix_translate (m, rand_float (-10, 10), rand_float (-10, 10), rand_float (-10, 10));
+        matrix_rotate (m, rand_float (-180, 180), axis[0], axis[1], axis[2]);
+        matrix_copy (ref, m);
+        matrix_invert_affine (ref);
+        matrix_copy (out, m);
+        matrix_invert_rigid (out);
+        for (int j = 0; j < 16; j ++)
+            EXPECT (is_near (ref[j], out[j], 1e-5f, 10.0f), "matrix_invert_rigid (%d)[%d] %e != %e", i, j, ref[j], out[j]);
+    }
+
+    /* singular */
+    {
+        float m[16] = {0}, out[16], n[9];
+
+        m[15] = 1.0f;
+        matrix_copy (out, m);
+        matrix_invert_affine (out);
+        EXPECT (is_equal_array (m, out, 16), "matrix_invert_affine (singular)");
+
+        m[0] = 1.0f; m[4] = 2.0f; m[8] = 3.0f;
+        matrix_normal3x3 (n, m);
+        EXPECT (n[0] == 1.0f && n[1] == 2.0f && n[2] == 3.0f && n[8] == 0.0f, "matrix_normal3x3 (singular)");
+    }
+}
+
+
+#define BATCH_NUM   37      /* not a multiple of the SIMD width */
+
+static void
+test_batch (int simd)
+{
+    for (int i = 0; i < TEST_LOOP / 100; i ++)
+    {
+        float m1[16], m2[16 * BATCH_NUM], ref[16 * BATCH_NUM], out[16 * BATCH_NUM];
+        float v[4 * BATCH_NUM], refv[4 * BATCH_NUM], outv[4 * BATCH_NUM];
+
+        rand_matrix (m1, i);
+        for (int j = 0; j < BATCH_NUM; j ++)
+            rand_matrix (&m2[16 * j], i + j);
+        for (int j = 0; j < 4 * BATCH_NUM; j ++)
+            v[j] = rand_float (-10, 10);
+
+        matrix_simd_select (simd);
+
+        /* the batch gives the same result as the single version */
+        for (int j = 0; j < BATCH_NUM; j ++)
+            matrix_mult (&ref[16 * j], m1, &m2[16 * j]);
+        matrix_mult_batch (out, m1, m2, BATCH_NUM);
+        EXPECT (is_equal_array (ref, out, 16 * BATCH_NUM), "[%s] matrix_mult_batch (%d)", matrix_simd_name (simd), i);
+
+        /* m == m2 */
+        matrix_mult_batch (m2, m1, m2, BATCH_NUM);
+        EXPECT (is_equal_array (ref, m2, 16 * BATCH_NUM), "[%s] matrix_mult_batch (m, m1, m)", matrix_simd_name (simd));
+
+        for (int j = 0; j < BATCH_NUM; j ++)
+            matrix_multvec3 (m1, &v[3 * j], &refv[3 * j]);
+        outv[3 * BATCH_NUM] = 12345.0f;
+        matrix_multvec3_batch (m1, v, outv, BATCH_NUM);
+        EXPECT (is_equal_array (refv, outv, 3 * BATCH_NUM), "[%s] matrix_multvec3_batch (%d)", matrix_simd_name (simd), i);
+        EXPECT (outv[3 * BATCH_NUM] == 12345.0f, "[%s] matrix_multvec3_batch overrun", matrix_simd_name (simd));
+
+        for (int j = 0; j < BATCH_NUM; j ++)
+            matrix_multvec4 (m1, &v[4 * j], &refv[4 * j]);
+        matrix_multvec4_batch (m1, v, outv, BATCH_NUM);
+        EXPECT (is_equal_array (refv, outv, 4 * BATCH_NUM), "[%s] matrix_multvec4_batch (%d)", matrix_simd_name (simd), i);
+
+        /* dvec == svec */
+        matrix_multvec4_batch (m1, v, v, BATCH_NUM);
+        EXPECT (is_equal_array (refv, v, 4 * BATCH_NUM), "[%s] matrix_multvec4_batch (m, v, v)", matrix_simd_name (simd));
+    }
+}
+
+
+/* the layout of XrHandJointLocationEXT */
+typedef struct joint_loc_t
+{
+    unsigned long long flags;
+    float pose[7];          /* qx, qy, qz, qw, px, py, pz */
+    float radius;
+} joint_loc_t;
+
+/* v' = v + 2w(q x v) + 2q x (q x v) */
+static void
+qtn_rotate (float *dst, float *q, float *v)
+{
+    float t[3], u[3];
+
+    vec3_cross (t, q, v);
+    vec3_cross (u, q, t);
+    for (int i = 0; i < 3; i ++)
+        dst[i] = v[i] + 2.0f * q[3] * t[i] + 2.0f * u[i];
+}
+
+static void
+test_trs_batch (void)
+{
+    joint_loc_t loc[BATCH_NUM];
+    float m[16 * BATCH_NUM], m1[16 * BATCH_NUM];
+
+    for (int i = 0; i < BATCH_NUM; i ++)
+    {
+        float *q = loc[i].pose;
+        for (int j = 0; j < 4; j ++)
+            q[j] = rand_float (-1, 1);
+        float len = sqrtf (q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+        for (int j = 0; j < 4; j ++)
+            q[j] /= len;
+        for (int j = 4; j < 7; j ++)
+            loc[i].pose[j] = rand_float (-10, 10);
+        loc[i].radius = rand_float (0.001f, 0.1f);
+    }
+
+    matrix_trs_batch (m,  &loc[0].pose, sizeof (joint_loc_t), &loc[0].radius, sizeof (joint_loc_t), BATCH_NUM);
+    matrix_trs_batch (m1, &loc[0].pose, sizeof (joint_loc_t), NULL, 0, BATCH_NUM);
+
+    for (int i = 0; i < BATCH_NUM; i ++)
+    {
+        float *pos = &loc[i].pose[4];
+        float v[3], rv[3], ref[3], out[3];
+        float s = loc[i].radius;
+
+        v[0] = rand_float (-1, 1);
+        v[1] = rand_float (-1, 1);
+        v[2] = rand_float (-1, 1);
+
+        /* T * R * S * v = pos + R(s * v) */
+        qtn_rotate (rv, loc[i].pose, v);
+        for (int j = 0; j < 3; j ++)
+            ref[j] = pos[j] + s * rv[j];
+
+        matrix_multvec3 (&m[16 * i], v, out);
+        for (int j = 0; j < 3; j ++)
+            EXPECT (is_near (ref[j], out[j], 1e-5f, 10.0f), "matrix_trs_batch (%d)[%d] %e != %e", i, j, ref[j], out[j]);
+
+        matrix_multvec3 (&m1[16 * i], v, out);
+        for (int j = 0; j < 3; j ++)
+            EXPECT (is_near (pos[j] + rv[j], out[j], 1e-5f, 10.0f), "matrix_trs_batch (scale=NULL) (%d)[%d]", i, j);
+
+        EXPECT (m[16 * i + 3] == 0.0f && m[16 * i + 7] == 0.0f && m[16 * i + 11] == 0.0f && m[16 * i + 15] == 1.0f,
+                "matrix_trs_batch (%d) 4th row", i);
+    }
+
+    /* the SoA version gives the same matrices */
+    {
+        float qtn[4 * BATCH_NUM], pos[3 * BATCH_NUM], rad[BATCH_NUM];
+        float m2[16 * BATCH_NUM];
+
+        for (int i = 0; i < BATCH_NUM; i ++)
+        {
+            memcpy (&qtn[4 * i], &loc[i].pose[0], 4 * sizeof (float));
+            memcpy (&pos[3 * i], &loc[i].pose[4], 3 * sizeof (float));
+            rad[i] = loc[i].radius;
+        }
+
+        matrix_trs_batch_soa (m2, qtn, pos, rad, BATCH_NUM);
+        EXPECT (memcmp (m, m2, sizeof (m)) == 0, "matrix_trs_batch_soa");
+    }
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    int simd_list[] = {MATRIX_SIMD_NONE, MATRIX_SIMD_SSE, MATRIX_SIMD_AVX, MATRIX_SIMD_NEON};
+    int default_simd = matrix_simd_get ();
+
+    printf ("default: %s\n", matrix_simd_name (default_simd));
+
+    for (unsigned int i = 0; i < sizeof (simd_list) / sizeof (simd_list[0]); i ++)
+    {
+        int simd = simd_list[i];
+        int fail0 = s_fail_num;
+
+        if (!matrix_simd_is_available (simd))
+        {
+            printf ("%-8s: not available\n", matrix_simd_name (simd));
+            EXPECT (matrix_simd_select (simd) < 0, "select unavailable %s", matrix_simd_name (simd));
+            continue;
+        }
+
+        s_seed = 1;
+        test_mult (simd);
+        test_multvec (simd);
+        test_transpose (simd);
+        test_invert (simd);
+        test_batch (simd);
+
+        printf ("%-8s: %s\n", matrix_simd_name (simd), (s_fail_num == fail0) ? "OK" : "FAIL");
+    }
+
+    matrix_simd_select (default_simd);
+
+    test_invert_affine ();
+    test_trs_batch ();
+
+    return test_report ();
+}
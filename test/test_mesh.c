@@ -0,0 +1,346 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <GLES3/gl3.h>
+#include "util_egl.h"
+#include "util_shader.h"
+#include "util_gl_state.h"
+#include "util_mesh.h"
+#include "test_util.h"
+
+/*
+ *  util_mesh: the half float and octahedral encoders, the vertex layouts,
+ *  the index conditioning, and the draw through the VAOs on the headless
+ *  EGL context.
+ */
+
+static void
+test_half (void)
+{
+    /* exact values */
+    EXPECT (mesh_float_to_half ( 1.0f)  == 0x3c00, "1.0 -> %04x", mesh_float_to_half (1.0f));
+    EXPECT (mesh_float_to_half (-2.0f)  == 0xc000, "-2.0 -> %04x", mesh_float_to_half (-2.0f));
+    EXPECT (mesh_float_to_half (0.0f)   == 0x0000, "0.0");
+    EXPECT (mesh_float_to_half (65504.0f) == 0x7bff, "max");
+
+    /* round to nearest even: 1 + 2^-11 is the tie between 0x3c00 and 0x3c01 */
+    EXPECT (mesh_float_to_half (1.0f + 1.0f / 2048) == 0x3c00, "tie to even (down)");
+    EXPECT (mesh_float_to_half (1.0f + 3.0f / 2048) == 0x3c02, "tie to even (up)");
+
+    /* overflow and subnormals */
+    EXPECT (mesh_float_to_half (70000.0f) == 0x7c00, "overflow to Inf");
+    EXPECT (mesh_float_to_half (ldexpf (1.0f, -24)) == 0x0001, "smallest subnormal");
+    EXPECT (mesh_float_to_half (ldexpf (1.0f, -26)) == 0x0000, "underflow to 0");
+    EXPECT (mesh_half_to_float (0x0001) == ldexpf (1.0f, -24), "subnormal decode");
+
+    /* round trip of every finite half */
+    int bad = 0;
+    for (int h = 0; h < 0x10000; h ++)
+    {
+        if ((h & 0x7c00) == 0x7c00)
+            continue;
+        if (mesh_float_to_half (mesh_half_to_float ((uint16_t)h)) != h)
+            bad ++;
+    }
+    EXPECT (bad == 0, "%d halfs not round tripped", bad);
+
+    /* relative error of the conversion: 2^-11 */
+    float max_err = 0.0f;
+    for (float f = 0.01f; f < 1000.0f; f *= 1.01f)
+    {
+        float err = fabsf (mesh_half_to_float (mesh_float_to_half (f)) - f) / f;
+        if (err > max_err)
+            max_err = err;
+    }
+    EXPECT (max_err <= 1.0f / 2048, "max relative error %g", max_err);
+}
+
+
+static void
+test_oct (void)
+{
+    float max_err = 0.0f;
+
+    /* the directions over the sphere, the poles and the fold edges included */
+    for (int i = 0; i <= 64; i ++)
+    {
+        for (int j = 0; j < 128; j ++)
+        {
+            float th = (float)M_PI * i / 64;
+            float ph = 2.0f * (float)M_PI * j / 128;
+            float n[3] = {sinf (th) * cosf (ph), sinf (th) * sinf (ph), cosf (th)};
+            float d[3];
+            int16_t oct[2];
+
+            mesh_oct_encode (n, oct);
+            mesh_oct_decode (oct, d);
+
+            /* the chord: acos() of the dot product is not precise near 1.0 */
+            float dx = d[0] - n[0], dy = d[1] - n[1], dz = d[2] - n[2];
+            float err = sqrtf (dx * dx + dy * dy + dz * dz);
+            if (err > max_err)
+                max_err = err;
+        }
+    }
+    /* snorm16 octahedral: well under 0.01 degree */
+    EXPECT (max_err < 0.0002f, "max angular error %g rad", max_err);
+
+    {
+        float n[3] = {0.0f, 0.0f, -1.0f}, d[3];
+        int16_t oct[2];
+        mesh_oct_encode (n, oct);
+        mesh_oct_decode (oct, d);
+        EXPECT (d[2] < -0.9999f, "-Z decoded to (%f, %f, %f)", d[0], d[1], d[2]);
+    }
+}
+
+
+static void
+test_layout (void)
+{
+    unsigned int pn  = (1 << MESH_ATTR_VTX) | (1 << MESH_ATTR_NRM);
+    unsigned int all = (1 << MESH_ATTR_NUM) - 1;
+
+    EXPECT (mesh_get_stride (pn,  MESH_FMT_FLOAT)   == 24, "float pos+nrm: %d", mesh_get_stride (pn,  MESH_FMT_FLOAT));
+    EXPECT (mesh_get_stride (pn,  MESH_FMT_COMPACT) == 12, "compact pos+nrm: %d", mesh_get_stride (pn,  MESH_FMT_COMPACT));
+    EXPECT (mesh_get_stride (all, MESH_FMT_FLOAT)   == 56, "float all: %d", mesh_get_stride (all, MESH_FMT_FLOAT));
+    EXPECT (mesh_get_stride (all, MESH_FMT_COMPACT) == 24, "compact all: %d", mesh_get_stride (all, MESH_FMT_COMPACT));
+}
+
+
+/* the triangle with its smallest index first: the same triangle in any rotation */
+static void
+canonical_tri (const unsigned int *t, unsigned int *c)
+{
+    int k = (t[0] < t[1]) ? ((t[0] < t[2]) ? 0 : 2) : ((t[1] < t[2]) ? 1 : 2);
+    c[0] = t[k];
+    c[1] = t[(k + 1) % 3];
+    c[2] = t[(k + 2) % 3];
+}
+
+static int
+compare_tri (const void *a, const void *b)
+{
+    return memcmp (a, b, sizeof (unsigned int) * 3);
+}
+
+static void
+test_conditioning (void)
+{
+    /* the odd triangles of a strip are flipped, the degenerate ones dropped */
+    {
+        unsigned short strip[] = {0, 1, 2, 3, 4,   5, 6, 6, 7, 8};
+        mesh_strip_t strips[]  = {{0, 5}, {5, 5}};
+        unsigned short tri[18];
+        unsigned short expect[] = {0, 1, 2,  2, 1, 3,  2, 3, 4,  6, 7, 8};
+
+        int num = mesh_strips_to_triangles (strip, GL_UNSIGNED_SHORT, strips, 2, tri);
+        EXPECT (num == 12, "%d indices", num);
+        EXPECT (memcmp (tri, expect, sizeof (expect)) == 0, "strip order");
+    }
+
+    /*
+     *  two triangles sharing an edge: (0 1 2) (2 1 3).
+     *    FIFO 1: 0 1 2 miss, 2 hit, 1 3 miss     -> 5 / 2
+     *    FIFO 2: 0 1 2 miss, [1 2] 2 1 hit, 3    -> 4 / 2
+     *    FIFO 3: the same                        -> 4 / 2
+     *  and 0 1 0 misses three times with a FIFO of 1.
+     */
+    {
+        unsigned short tri[] = {0, 1, 2, 2, 1, 3};
+        unsigned short seq[] = {0, 1, 0};
+        EXPECT (mesh_get_acmr (tri, GL_UNSIGNED_SHORT, 6, 4, 1) == 2.5f, "ACMR(FIFO 1) %f", mesh_get_acmr (tri, GL_UNSIGNED_SHORT, 6, 4, 1));
+        EXPECT (mesh_get_acmr (tri, GL_UNSIGNED_SHORT, 6, 4, 2) == 2.0f, "ACMR(FIFO 2) %f", mesh_get_acmr (tri, GL_UNSIGNED_SHORT, 6, 4, 2));
+        EXPECT (mesh_get_acmr (tri, GL_UNSIGNED_SHORT, 6, 4, 3) == 2.0f, "ACMR(FIFO 3) %f", mesh_get_acmr (tri, GL_UNSIGNED_SHORT, 6, 4, 3));
+        EXPECT (mesh_get_acmr (seq, GL_UNSIGNED_SHORT, 3, 2, 1) == 3.0f, "ACMR(FIFO 1) of 0 1 0: %f", mesh_get_acmr (seq, GL_UNSIGNED_SHORT, 3, 2, 1));
+    }
+
+    /* no vertex is shared: 3.0 at any cache size */
+    {
+        unsigned int tri[] = {0, 1, 2, 3, 4, 5};
+        EXPECT (mesh_get_acmr (tri, GL_UNSIGNED_INT, 6, 6, 16) == 3.0f, "ACMR of separate triangles");
+    }
+
+    /* a 64x64 grid drawn row by row: the rows are too long for the cache */
+    {
+        enum { N = 64, NUM_TRI = (N - 1) * (N - 1) * 2 };
+        static unsigned int idx[NUM_TRI * 3], ref[NUM_TRI * 3];
+        int n = 0;
+
+        for (int j = 0; j < N - 1; j ++)
+        {
+            for (int i = 0; i < N - 1; i ++)
+            {
+                unsigned int v = j * N + i;
+                unsigned int q[6] = {v, v + 1, v + N + 1,  v, v + N + 1, v + N};
+                for (int k = 0; k < 6; k ++)
+                    idx[n ++] = q[k];
+            }
+        }
+
+        float acmr0 = mesh_get_acmr (idx, GL_UNSIGNED_INT, n, N * N, 16);
+        for (int t = 0; t < NUM_TRI; t ++)
+            canonical_tri (&idx[t * 3], &ref[t * 3]);
+
+        EXPECT (mesh_optimize_vcache (idx, GL_UNSIGNED_INT, n, N * N) == 0, "optimize");
+
+        float acmr1 = mesh_get_acmr (idx, GL_UNSIGNED_INT, n, N * N, 16);
+        EXPECT (acmr1 < 0.8f * acmr0, "ACMR %.3f -> %.3f", acmr0, acmr1);
+
+        /* the same triangles in the same winding */
+        for (int t = 0; t < NUM_TRI; t ++)
+        {
+            unsigned int c[3];
+            canonical_tri (&idx[t * 3], c);
+            memcpy (&idx[t * 3], c, sizeof (c));
+        }
+        qsort (idx, NUM_TRI, sizeof (unsigned int) * 3, compare_tri);
+        qsort (ref, NUM_TRI, sizeof (unsigned int) * 3, compare_tri);
+        EXPECT (memcmp (idx, ref, sizeof (idx)) == 0, "triangles changed");
+    }
+}
+
+
+/* the color is the decoded normal */
+static char s_strVS_nrm[] = "                                   \n\
+attribute vec4  a_Vertex;                                   \n\
+attribute vec2  a_Normal;                                   \n\
+varying   vec3  v_color;                                    \n"
+MESH_GLSL_OCT_DECODE "                                      \n\
+void main(void)                                             \n\
+{                                                           \n\
+    gl_Position = a_Vertex;                                 \n\
+    v_color = oct_decode (a_Normal) * 0.5 + 0.5;            \n\
+}                                                           ";
+
+static char s_strVS_clr[] = "                                   \n\
+attribute vec4  a_Vertex;                                   \n\
+attribute vec4  a_Color;                                    \n\
+varying   vec3  v_color;                                    \n\
+void main(void)                                             \n\
+{                                                           \n\
+    gl_Position = a_Vertex;                                 \n\
+    v_color = a_Color.rgb;                                  \n\
+}                                                           ";
+
+static char s_strFS[] = "                                   \n\
+precision mediump float;                                    \n\
+varying vec3    v_color;                                    \n\
+void main(void)                                             \n\
+{                                                           \n\
+    gl_FragColor = vec4(v_color, 1.0);                      \n\
+}                                                           ";
+
+static GLint
+get_integer (GLenum pname)
+{
+    GLint val = 0;
+    glGetIntegerv (pname, &val);
+    return val;
+}
+
+static void
+read_center (unsigned char *rgba)
+{
+    glReadPixels (8, 8, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+}
+
+#define NEAR(a, b)  (abs ((int)(a) - (int)(b)) <= 2)
+
+static void
+test_draw (void)
+{
+    /* a quad over the viewport, facing -Z */
+    float vtx[] = {-1, -1, 0,   1, -1, 0,   -1, 1, 0,   1, 1, 0};
+    float nrm[] = { 0,  0,-1,   0,  0,-1,    0, 0,-1,   0, 0,-1};
+    float clr[] = { 1,  0, 1,   1,  0, 1,    1, 0, 1,   1, 0, 1};
+    unsigned short idx[] = {0, 1, 2, 2, 1, 3};
+    mesh_src_t src = {0};
+    mesh_obj_t mesh;
+    shader_obj_t sobj_nrm, sobj_clr;
+    unsigned char rgba[4];
+
+    EXPECT (generate_shader (&sobj_nrm, s_strVS_nrm, s_strFS) == 0, "shader");
+    EXPECT (generate_shader (&sobj_clr, s_strVS_clr, s_strFS) == 0, "shader");
+
+    src.num_vtx  = 4;
+    src.vtx      = vtx;
+    src.nrm      = nrm;
+    src.clr      = clr;
+    src.num_idx  = 6;
+    src.idx      = idx;
+    src.idx_type = GL_UNSIGNED_SHORT;
+    src.prim     = GL_TRIANGLES;
+
+    glstate_invalidate ();
+    EXPECT (mesh_create (&mesh, &src, MESH_FMT_COMPACT) == 0, "mesh_create");
+    EXPECT (mesh.stride == 16, "stride %d", mesh.stride);
+
+    glstate_disable (GL_DEPTH_TEST);
+    glstate_disable (GL_CULL_FACE);
+    glstate_disable (GL_BLEND);
+
+    /* the normal: (0, 0, -1) -> (0.5, 0.5, 0.0) */
+    glClear (GL_COLOR_BUFFER_BIT);
+    glstate_use_program (sobj_nrm.program);
+    EXPECT (mesh_bind (&mesh, sobj_nrm.program) == 1, "the VAO is not created");
+    mesh_draw (&mesh);
+    read_center (rgba);
+    EXPECT (NEAR (rgba[0], 128) && NEAR (rgba[1], 128) && NEAR (rgba[2], 0),
+            "normal color (%d, %d, %d)", rgba[0], rgba[1], rgba[2]);
+
+    /* another program gets its own VAO */
+    glClear (GL_COLOR_BUFFER_BIT);
+    glstate_use_program (sobj_clr.program);
+    EXPECT (mesh_bind (&mesh, sobj_clr.program) == 1, "the VAO is not created");
+    mesh_draw (&mesh);
+    read_center (rgba);
+    EXPECT (rgba[0] == 255 && rgba[1] == 0 && rgba[2] == 255,
+            "vertex color (%d, %d, %d)", rgba[0], rgba[1], rgba[2]);
+    EXPECT (mesh.vao_num == 2, "%d VAOs", mesh.vao_num);
+
+    /* and the first one is reused */
+    glClear (GL_COLOR_BUFFER_BIT);
+    glstate_use_program (sobj_nrm.program);
+    EXPECT (mesh_bind (&mesh, sobj_nrm.program) == 0, "the VAO is created again");
+    mesh_draw_instanced (&mesh, 2);
+    read_center (rgba);
+    EXPECT (NEAR (rgba[0], 128) && NEAR (rgba[2], 0), "normal color (%d, %d, %d)", rgba[0], rgba[1], rgba[2]);
+
+    EXPECT (glstate_validate () == 0, "stale state after the draws");
+
+    mesh_destroy (&mesh);
+    EXPECT (get_integer (GL_VERTEX_ARRAY_BINDING) == 0, "VAO still bound after the destroy");
+    EXPECT (glstate_validate () == 0, "stale state after the destroy");
+
+    glDeleteProgram (sobj_nrm.program);
+    glDeleteProgram (sobj_clr.program);
+    EXPECT (glGetError () == GL_NO_ERROR, "GL error");
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    test_half ();
+    test_oct ();
+    test_layout ();
+    test_conditioning ();
+
+    if (egl_init_with_pbuffer_surface (3, 24, 0, 0, 16, 16) < 0)
+    {
+        fprintf (stderr, "ERR: %s(%d): failed to initialize EGL\n", __FILE__, __LINE__);
+        return -1;
+    }
+
+    test_draw ();
+
+    egl_terminate ();
+
+    return test_report ();
+}
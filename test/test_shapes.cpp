@@ -0,0 +1,205 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <vector>
+#include <GLES3/gl3.h>
+#include "util_egl.h"
+#include "util_gl_state.h"
+#include "shapes.h"
+#include "test_util.h"
+
+/*
+ *  shapes.cpp of the apps: the smooth normals, the 32bit indices, and the
+ *  memory and file caches of the generated grids.
+ */
+
+static const unsigned int ATTR_ALL = (1 << MESH_ATTR_NUM) - 1;
+
+/* the interleaved vertices as uploaded */
+static std::vector<unsigned char>
+read_vbo (const mesh_obj_t *mesh)
+{
+    size_t size = (size_t)mesh->stride * mesh->num_vtx;
+    std::vector<unsigned char> buf (size);
+
+    glBindBuffer (GL_ARRAY_BUFFER, mesh->vbo);
+    void *p = glMapBufferRange (GL_ARRAY_BUFFER, 0, size, GL_MAP_READ_BIT);
+    if (p)
+    {
+        memcpy (buf.data (), p, size);
+        glUnmapBuffer (GL_ARRAY_BUFFER);
+    }
+    glBindBuffer (GL_ARRAY_BUFFER, 0);
+    glstate_invalidate ();
+    return buf;
+}
+
+static const float *
+vertex_attr (const std::vector<unsigned char> &buf, const mesh_obj_t *mesh, int attr, int n)
+{
+    return (const float *)&buf[(size_t)mesh->stride * n + mesh->attrib[attr].offset];
+}
+
+
+static void
+test_normals ()
+{
+    shape_obj_t shape;
+
+    EXPECT (shape_create (SHAPE_SPHERE, 32, 24, &shape) == 0, "sphere");
+    EXPECT (shape.mesh.idx_type == GL_UNSIGNED_SHORT, "16bit indices expected");
+
+    std::vector<unsigned char> buf = read_vbo (&shape.mesh);
+    int   bad_len = 0, bad_dir = 0, bad_tng = 0;
+    float min_dot = 1.0f;
+
+    /* the unit sphere: the normal is the position, the poles and the seam included */
+    for (int n = 0; n < shape.mesh.num_vtx; n ++)
+    {
+        const float *p = vertex_attr (buf, &shape.mesh, MESH_ATTR_VTX, n);
+        const float *d = vertex_attr (buf, &shape.mesh, MESH_ATTR_NRM, n);
+        const float *t = vertex_attr (buf, &shape.mesh, MESH_ATTR_TNG, n);
+
+        float len = sqrtf (d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+        if (fabsf (len - 1.0f) > 1e-4f)
+            bad_len ++;
+
+        float dot = p[0] * d[0] + p[1] * d[1] + p[2] * d[2];
+        if (dot < min_dot)
+            min_dot = dot;
+        if (dot < 0.99f)
+            bad_dir ++;
+
+        if (fabsf (t[0] * d[0] + t[1] * d[1] + t[2] * d[2]) > 0.01f)
+            bad_tng ++;
+    }
+    EXPECT (bad_len == 0, "%d normals not unit length", bad_len);
+    EXPECT (bad_dir == 0, "%d normals off the radius (min dot %f)", bad_dir, min_dot);
+    EXPECT (bad_tng == 0, "%d tangents not perpendicular to the normal", bad_tng);
+
+    shape_destroy (&shape);
+}
+
+
+static void
+test_large ()
+{
+    shape_obj_t shape;
+
+    /* 300 x 300 = 90000 vertices */
+    EXPECT (shape_create_ex (SHAPE_TORUS, 300, 300, ATTR_ALL, MESH_FMT_COMPACT, &shape) == 0, "torus");
+    EXPECT (shape.mesh.idx_type == GL_UNSIGNED_INT, "32bit indices expected");
+    EXPECT (shape.mesh.num_idx == 299 * 299 * 6, "%d indices", shape.mesh.num_idx);
+    EXPECT (shape.num_faces == 299 * 299 * 2, "%d faces", shape.num_faces);
+
+    /* the last quad reaches the last vertex */
+    GLuint last = 0;
+    glstate_bind_vertex_array (0);
+    glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, shape.mesh.ibo);
+    GLuint *idx = (GLuint *)glMapBufferRange (GL_ELEMENT_ARRAY_BUFFER,
+                        (shape.mesh.num_idx - 1) * sizeof (GLuint), sizeof (GLuint), GL_MAP_READ_BIT);
+    if (idx)
+    {
+        last = *idx;
+        glUnmapBuffer (GL_ELEMENT_ARRAY_BUFFER);
+    }
+    glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+    glstate_invalidate ();
+    EXPECT (last == 300 * 299 + 298, "last index %u", last);
+
+    shape_destroy (&shape);
+
+    EXPECT (shape_create (SHAPE_TORUS, 1, 300, &shape) < 0, "invalid division accepted");
+}
+
+
+static void
+test_cache (const char *dir)
+{
+    shape_obj_t shape0, shape1;
+    char path[512];
+
+    /* the memory cache */
+    shape_set_cache_dir (NULL);
+    shape_clear_cache ();
+    shape_create (SHAPE_KLEINBOTTLE, 256, 256, &shape0);
+    shape_create (SHAPE_KLEINBOTTLE, 256, 256, &shape1);
+    std::vector<unsigned char> ref = read_vbo (&shape0.mesh);
+    EXPECT (ref == read_vbo (&shape1.mesh), "cached shape differs");
+    shape_destroy (&shape0);
+    shape_destroy (&shape1);
+
+    /* the file cache: stored on the first generation, loaded after.
+     * only the grids of 65536 vertices or more go to the files */
+    snprintf (path, sizeof (path), "%s/shape_%d_%dx%d.bin", dir, SHAPE_KLEINBOTTLE, 256, 256);
+    remove (path);
+
+    shape_set_cache_dir (dir);
+    shape_clear_cache ();
+    shape_create (SHAPE_KLEINBOTTLE, 256, 256, &shape0);
+    EXPECT (access (path, R_OK) == 0, "%s not stored", path);
+    shape_destroy (&shape0);
+
+    shape_clear_cache ();
+    shape_create (SHAPE_KLEINBOTTLE, 256, 256, &shape0);
+    EXPECT (ref == read_vbo (&shape0.mesh), "loaded shape differs");
+    shape_destroy (&shape0);
+
+    /* a broken file is generated again */
+    FILE *fp = fopen (path, "r+b");
+    if (fp)
+    {
+        fputs ("XXXX", fp);
+        fclose (fp);
+    }
+    shape_clear_cache ();
+    shape_create (SHAPE_KLEINBOTTLE, 256, 256, &shape0);
+    EXPECT (ref == read_vbo (&shape0.mesh), "shape from the broken file");
+    shape_destroy (&shape0);
+
+    remove (path);
+
+    snprintf (path, sizeof (path), "%s/shape_%d_%dx%d.bin", dir, SHAPE_KLEINBOTTLE, 20, 20);
+    shape_create (SHAPE_KLEINBOTTLE, 20, 20, &shape0);
+    EXPECT (access (path, F_OK) != 0, "%s stored", path);
+    shape_destroy (&shape0);
+    remove (path);
+
+    shape_set_cache_dir (NULL);
+    shape_clear_cache ();
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    if (egl_init_with_pbuffer_surface (3, 24, 0, 0, 16, 16) < 0)
+    {
+        fprintf (stderr, "ERR: %s(%d): failed to initialize EGL\n", __FILE__, __LINE__);
+        return -1;
+    }
+
+    char dir[] = "/tmp/test_shapes_XXXXXX";
+    if (mkdtemp (dir) == NULL)
+    {
+        fprintf (stderr, "ERR: %s(%d): mkdtemp\n", __FILE__, __LINE__);
+        return -1;
+    }
+
+    test_normals ();
+    test_large ();
+    test_cache (dir);
+
+    rmdir (dir);
+    EXPECT (glGetError () == GL_NO_ERROR, "GL error");
+
+    egl_terminate ();
+
+    return test_report ();
+}
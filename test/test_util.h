@@ -0,0 +1,34 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2022 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef TEST_UTIL_H_
+#define TEST_UTIL_H_
+
+#include <stdio.h>
+
+/*
+ *  the check macro of the unit tests. every test is one executable:
+ *  main() ends with "return test_report ();".
+ */
+static int s_fail_num = 0;
+static int s_test_num = 0;
+
+#define EXPECT(cond, ...) do {                                          \
+    s_test_num ++;                                                      \
+    if (!(cond)) {                                                      \
+        s_fail_num ++;                                                  \
+        fprintf (stderr, "FAIL(%s:%d) : ", __FILE__, __LINE__);         \
+        fprintf (stderr, __VA_ARGS__);                                  \
+        fprintf (stderr, "\n");                                         \
+    }                                                                   \
+} while (0)
+
+static inline int
+test_report (void)
+{
+    printf ("%d / %d passed\n", s_test_num - s_fail_num, s_test_num);
+    return (s_fail_num == 0) ? 0 : 1;
+}
+
+#endif /* TEST_UTIL_H_ */